@@ -0,0 +1,86 @@
+/**
+ * include/acpi.h - Поиск таблиц ACPI
+ */
+
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Заголовок любой системной таблицы ACPI
+typedef struct {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_header_t;
+
+// Обобщенный адрес (Generic Address Structure)
+typedef struct {
+    uint8_t address_space;      // 0 - память, 1 - порты
+    uint8_t bit_width;
+    uint8_t bit_offset;
+    uint8_t access_size;
+    uint64_t address;
+} __attribute__((packed)) acpi_gas_t;
+
+#define ACPI_SPACE_MEMORY 0
+
+// Таблица MADT ("APIC"): описание контроллеров прерываний
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t lapic_address;
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt_t;
+
+#define ACPI_MADT_PCAT_COMPAT 0x1     // Есть пара 8259, которую нужно отключить
+
+// Заголовок записи MADT
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) acpi_madt_entry_t;
+
+// Типы записей MADT
+#define ACPI_MADT_LAPIC     0
+#define ACPI_MADT_IOAPIC    1
+#define ACPI_MADT_OVERRIDE  2
+
+// Локальный APIC процессора
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;             // Бит 0 - процессор включен
+} __attribute__((packed)) acpi_madt_lapic_t;
+
+// IOAPIC
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint8_t ioapic_id;
+    uint8_t reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} __attribute__((packed)) acpi_madt_ioapic_t;
+
+// Переопределение источника прерывания ISA
+typedef struct {
+    acpi_madt_entry_t entry;
+    uint8_t bus;
+    uint8_t source;             // IRQ ISA
+    uint32_t gsi;
+    uint16_t flags;             // Полярность (биты 0-1) и режим (биты 2-3)
+} __attribute__((packed)) acpi_madt_override_t;
+
+// Функции
+bool acpi_init(void);
+const acpi_sdt_header_t* acpi_find_table(const char* signature);
+const acpi_madt_entry_t* acpi_madt_next(const acpi_madt_t* madt, const acpi_madt_entry_t* entry);
+
+#endif // ACPI_H
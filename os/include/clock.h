@@ -0,0 +1,62 @@
+/**
+ * include/clock.h - Монотонные часы высокого разрешения
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define NSEC_PER_USEC 1000ull
+#define NSEC_PER_MSEC 1000000ull
+#define NSEC_PER_SEC  1000000000ull
+
+// Источник времени: свободно бегущий счетчик,
+// время в нс = показание * ns_num / ns_den
+typedef struct {
+    const char* name;
+    int rating;                 // Чем выше, тем предпочтительнее источник
+    uint64_t (*read)(void);
+    uint32_t ns_num;
+    uint32_t ns_den;
+} clocksource_t;
+
+// Коэффициенты преобразования: out = (in * mult) >> shift
+typedef struct {
+    uint32_t mult;
+    uint32_t shift;
+} clock_scale_t;
+
+/**
+ * Умножение 64-битного значения на mult с последующим сдвигом
+ * Старшая и младшая половины умножаются отдельно, чтобы
+ * произведение не переполнялось.
+ */
+static inline uint64_t clock_scale(uint64_t value, const clock_scale_t* scale) {
+    uint64_t lo = (uint32_t)value;
+    uint64_t hi = value >> 32;
+    
+    return ((lo * scale->mult) >> scale->shift) +
+           ((hi * scale->mult) << (32 - scale->shift));
+}
+
+// Функции
+void clock_init(void);
+bool clock_register_source(const clocksource_t* cs);
+void clock_scale_init(clock_scale_t* scale, uint32_t num, uint32_t den);
+bool clock_is_tsc(void);
+bool clock_is_highres(void);
+bool clock_is_invariant(void);
+const char* clock_get_source_name(void);
+uint32_t clock_get_tsc_khz(void);
+
+// Чтение часов: без блокировок и без обращения к портам
+uint64_t clock_cycles(void);
+uint64_t clock_ns(void);
+
+// Преобразования
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+uint64_t clock_ns_to_cycles(uint64_t ns);
+
+#endif // CLOCK_H
@@ -0,0 +1,26 @@
+/**
+ * include/clockevent.h - Устройства событий таймера (clockevent)
+ */
+
+#ifndef CLOCKEVENT_H
+#define CLOCKEVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Устройство, умеющее выдать одно прерывание через заданное время.
+// По прерыванию устройство вызывает timer_event_handler().
+typedef struct {
+    const char* name;
+    int rating;                 // Чем выше, тем предпочтительнее устройство
+    uint32_t min_delta_us;      // Минимальная программируемая задержка
+    uint32_t max_delta_us;      // Максимальная программируемая задержка
+    void (*set_next_event)(uint32_t delta_us);
+    void (*shutdown)(void);
+} clockevent_t;
+
+// Функции (реализованы в timer.c)
+bool timer_register_clockevent(const clockevent_t* dev);
+void timer_event_handler(void);
+
+#endif // CLOCKEVENT_H
@@ -0,0 +1,41 @@
+/**
+ * include/cmdreg.h - Реестр команд терминала
+ */
+
+#ifndef CMDREG_H
+#define CMDREG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Максимальное количество зарегистрированных команд
+#define CMDREG_MAX_COMMANDS 64
+
+// Размер хеш-таблицы (степень двойки, вдвое больше числа команд)
+#define CMDREG_HASH_SIZE    128
+
+// Количество узлов префиксного дерева
+#define CMDREG_TRIE_NODES   512
+
+// Алфавит имен команд: a-z, 0-9, '-', '_'
+#define CMDREG_ALPHABET     38
+
+// Тип функции-обработчика команды
+typedef void (*command_func_t)(int argc, char** argv);
+
+// Структура для хранения информации о команде
+typedef struct {
+    const char* name;
+    const char* description;
+    command_func_t execute;
+} command_t;
+
+// Функции
+int cmdreg_register(const char* name, const char* description, command_func_t execute);
+const command_t* cmdreg_lookup(const char* name);
+bool cmdreg_execute(int argc, char** argv);
+int cmdreg_complete(const char* prefix, char* out, int size);
+int cmdreg_count(void);
+const command_t* cmdreg_get(int index);
+
+#endif // CMDREG_H
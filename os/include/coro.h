@@ -0,0 +1,130 @@
+/**
+ * include/coro.h - Бесстековые сопрограммы (protothreads)
+ *
+ * Сопрограмма - функция, которая возвращается в исполнитель на каждом
+ * ожидании и продолжается со следующей строки при повторном вызове
+ * (переход через switch по номеру строки). Своего стека у нее нет:
+ * все сопрограммы выполняются на стеке одного потока, а состояние,
+ * которое переживает ожидание, хранится в структуре (co->data).
+ * Локальные переменные функции между ожиданиями не сохраняются, а
+ * switch внутри сопрограммы пересекаться с ожиданиями не должен.
+ *
+ * Пример:
+ *     static int blink(coro_t* co) {
+ *         CORO_BEGIN(co);
+ *         CORO_SLEEP(co, 500);
+ *         CORO_AWAIT_PS2(co, PS2_PORT_KEYBOARD, 0xED, 0x04, 0);
+ *         CORO_END(co);
+ *     }
+ */
+
+#ifndef CORO_H
+#define CORO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ps2.h"
+#include "timer.h"
+
+// Сопрограмм в пуле (каждая - несколько десятков байт без стека)
+#define CORO_MAX            1024
+
+// Результат шага сопрограммы
+#define CORO_WAITING        0
+#define CORO_DONE           1
+
+// Состояния
+typedef enum {
+    CORO_FREE = 0,
+    CORO_READY,         // В очереди исполнителя
+    CORO_RUNNING,
+    CORO_WAITING_EVENT, // Ждет таймер, IRQ или завершение ввода-вывода
+} coro_state_t;
+
+typedef struct coro coro_t;
+
+// Тело сопрограммы
+typedef int (*coro_func_t)(coro_t* co);
+
+struct coro {
+    coro_func_t func;
+    void* data;                     // Состояние, переживающее ожидания
+    const char* name;
+    uint32_t id;
+    uint16_t line;                  // Точка продолжения (0 - начало)
+    volatile uint8_t state;
+    volatile bool waiting;          // Ожидание начато, пробуждения еще не было
+    int16_t irq;                    // Ожидаемая линия IRQ (-1 - нет)
+    timer_handle_t timer;
+    struct coro* next;              // Очередь готовых или список ожидающих IRQ
+    
+    // Результат последнего ожидания ввода-вывода
+    int status;
+    uint8_t response[PS2_MAX_RESPONSE];
+    int response_length;
+};
+
+// Начало и конец тела сопрограммы
+#define CORO_BEGIN(co) switch ((co)->line) { case 0:
+#define CORO_END(co) } (co)->line = 0; return CORO_DONE
+
+// Досрочное завершение
+#define CORO_EXIT(co) do { (co)->line = 0; return CORO_DONE; } while (0)
+
+// Уступить исполнитель другим готовым сопрограммам
+#define CORO_YIELD(co) do { \
+    (co)->line = __LINE__; \
+    coro_ready(co); \
+    return CORO_WAITING; \
+    case __LINE__:; \
+} while (0)
+
+// Ожидание условия; пока оно ложно, проверяется каждые несколько
+// миллисекунд (условию некому будить сопрограмму)
+#define CORO_WAIT_UNTIL(co, cond) do { \
+    (co)->line = __LINE__; \
+    case __LINE__: \
+    if (!(cond)) { \
+        coro_poll(co); \
+        return CORO_WAITING; \
+    } \
+} while (0)
+
+// Сон ms миллисекунд (однократный таймер колеса)
+#define CORO_SLEEP(co, ms) do { \
+    coro_await_timer((co), (ms)); \
+    (co)->line = __LINE__; \
+    return CORO_WAITING; \
+    case __LINE__:; \
+} while (0)
+
+// Ожидание следующего прерывания линии irq
+#define CORO_AWAIT_IRQ(co, irq_line) do { \
+    coro_await_irq((co), (irq_line)); \
+    (co)->line = __LINE__; \
+    return CORO_WAITING; \
+    case __LINE__:; \
+} while (0)
+
+// Команда устройству PS/2 и ожидание ее завершения; результат в
+// co->status (ps2_status_t) и co->response
+#define CORO_AWAIT_PS2(co, port, command, arg, response_length) do { \
+    if (coro_await_ps2((co), (port), (command), (arg), (response_length))) { \
+        (co)->line = __LINE__; \
+        return CORO_WAITING; \
+    } \
+    case __LINE__:; \
+} while (0)
+
+// Функции
+void coro_init(void);
+coro_t* coro_spawn(const char* name, coro_func_t func, void* data);
+void coro_ready(coro_t* co);
+void coro_wake(coro_t* co);
+void coro_await_timer(coro_t* co, uint32_t ms);
+void coro_poll(coro_t* co);
+void coro_await_irq(coro_t* co, int irq);
+bool coro_await_ps2(coro_t* co, int port, uint8_t command, int arg, int response_length);
+uint32_t coro_run(void);
+
+#endif // CORO_H
@@ -0,0 +1,189 @@
+/**
+ * include/cpu.h - Доступ к инструкциям процессора (CPUID, MSR, TSC, флаги)
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Биты CPUID.1:EDX
+#define CPUID_EDX_FPU      (1 << 0)
+#define CPUID_EDX_PSE      (1 << 3)
+#define CPUID_EDX_TSC      (1 << 4)
+#define CPUID_EDX_MSR      (1 << 5)
+#define CPUID_EDX_APIC     (1 << 9)
+#define CPUID_EDX_FXSR     (1 << 24)
+#define CPUID_EDX_SSE      (1 << 25)
+#define CPUID_EDX_SSE2     (1 << 26)
+
+// Биты CPUID.1:ECX
+#define CPUID_ECX_TSC_DEADLINE (1 << 24)
+
+// Флаг разрешения прерываний в EFLAGS
+#define EFLAGS_IF 0x200
+
+// Биты управляющих регистров
+#define CR0_MP        (1 << 1)
+#define CR0_EM        (1 << 2)
+#define CR0_TS        (1 << 3)
+#define CR0_NE        (1 << 5)
+#define CR0_WP        (1 << 16)
+#define CR0_PG        (1u << 31)
+#define CR4_PSE       (1 << 4)
+#define CR4_OSFXSR    (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+
+// Максимальное количество процессоров
+#define CPU_MAX 8
+
+// Индекс текущего процессора (0..CPU_MAX-1, по области данных в GS; smp.c)
+uint32_t cpu_current(void);
+
+// Порты ввода-вывода (реализованы в irq.c)
+uint8_t inb(uint16_t port);
+void outb(uint16_t port, uint8_t val);
+uint16_t inw(uint16_t port);
+void outw(uint16_t port, uint16_t val);
+
+/**
+ * Выполнение CPUID
+ * @param leaf Номер функции (EAX)
+ */
+static inline void cpu_cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx,
+                             uint32_t* ecx, uint32_t* edx) {
+    asm volatile("cpuid"
+                 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                 : "a"(leaf), "c"(0));
+}
+
+/**
+ * Чтение модельно-специфичного регистра
+ */
+static inline uint64_t cpu_rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Запись модельно-специфичного регистра
+ */
+static inline void cpu_wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+/**
+ * Чтение счетчика тактов (TSC)
+ */
+static inline uint64_t cpu_rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Запрет прерываний с сохранением флагов
+ * @return Прежнее значение EFLAGS
+ */
+static inline uint32_t cpu_irq_save(void) {
+    uint32_t flags;
+    asm volatile("pushf; pop %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+/**
+ * Восстановление флага прерываний
+ * @param flags Значение, возвращенное cpu_irq_save
+ */
+static inline void cpu_irq_restore(uint32_t flags) {
+    if (flags & EFLAGS_IF) {
+        asm volatile("sti" : : : "memory");
+    }
+}
+
+/**
+ * Разрешение прерываний
+ */
+static inline void cpu_irq_enable(void) {
+    asm volatile("sti" : : : "memory");
+}
+
+/**
+ * Запрет прерываний
+ */
+static inline void cpu_irq_disable(void) {
+    asm volatile("cli" : : : "memory");
+}
+
+/**
+ * Чтение и запись CR0
+ */
+static inline uint32_t cpu_read_cr0(void) {
+    uint32_t value;
+    asm volatile("mov %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr0(uint32_t value) {
+    asm volatile("mov %0, %%cr0" : : "r"(value) : "memory");
+}
+
+/**
+ * Сброс CR0.TS (FPU снова доступен без #NM)
+ */
+static inline void cpu_clts(void) {
+    asm volatile("clts" : : : "memory");
+}
+
+/**
+ * Адрес последней ошибки страницы (CR2)
+ */
+static inline uint32_t cpu_read_cr2(void) {
+    uint32_t value;
+    asm volatile("mov %%cr2, %0" : "=r"(value));
+    return value;
+}
+
+/**
+ * Чтение и запись CR3 (каталог страниц)
+ */
+static inline uint32_t cpu_read_cr3(void) {
+    uint32_t value;
+    asm volatile("mov %%cr3, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr3(uint32_t value) {
+    asm volatile("mov %0, %%cr3" : : "r"(value) : "memory");
+}
+
+/**
+ * Сброс TLB для одной страницы
+ */
+static inline void cpu_invlpg(uint32_t addr) {
+    asm volatile("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
+/**
+ * Чтение и запись CR4
+ */
+static inline uint32_t cpu_read_cr4(void) {
+    uint32_t value;
+    asm volatile("mov %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void cpu_write_cr4(uint32_t value) {
+    asm volatile("mov %0, %%cr4" : : "r"(value) : "memory");
+}
+
+/**
+ * Пауза в цикле ожидания
+ */
+static inline void cpu_relax(void) {
+    asm volatile("pause" : : : "memory");
+}
+
+#endif // CPU_H
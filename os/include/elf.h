@@ -0,0 +1,61 @@
+/**
+ * include/elf.h - Загрузчик исполняемых файлов ELF32
+ */
+
+#ifndef ELF_H
+#define ELF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Идентификация
+#define ELF_MAGIC           0x464C457F  // "\x7FELF"
+#define ELF_CLASS_32        1
+#define ELF_DATA_LSB        1
+#define ELF_TYPE_EXEC       2
+#define ELF_MACHINE_386     3
+
+// Тип и флаги программного заголовка
+#define ELF_PT_LOAD         1
+#define ELF_PF_X            (1 << 0)
+#define ELF_PF_W            (1 << 1)
+#define ELF_PF_R            (1 << 2)
+
+// Заголовок файла
+typedef struct {
+    uint32_t magic;
+    uint8_t class;
+    uint8_t data;
+    uint8_t version;
+    uint8_t pad[9];
+    uint16_t type;
+    uint16_t machine;
+    uint32_t version2;
+    uint32_t entry;
+    uint32_t phoff;
+    uint32_t shoff;
+    uint32_t flags;
+    uint16_t ehsize;
+    uint16_t phentsize;
+    uint16_t phnum;
+    uint16_t shentsize;
+    uint16_t shnum;
+    uint16_t shstrndx;
+} __attribute__((packed)) elf_header_t;
+
+// Программный заголовок (сегмент)
+typedef struct {
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} __attribute__((packed)) elf_phdr_t;
+
+// Функции
+bool elf_load(uint32_t directory, uint32_t image, uint32_t size, uint32_t* entry);
+
+#endif // ELF_H
@@ -0,0 +1,41 @@
+/**
+ * include/framebuffer.h - Абстракция над VBE framebuffer
+ */
+
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Графический режим, который выбирает загрузчик
+#define SCREEN_WIDTH  1024
+#define SCREEN_HEIGHT 768
+
+// Функции
+void framebuffer_init(void);
+void framebuffer_swap(void);
+void framebuffer_swap_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+void framebuffer_clear(uint32_t color);
+void framebuffer_put_pixel(uint16_t x, uint16_t y, uint32_t color);
+uint32_t framebuffer_get_pixel(uint16_t x, uint16_t y);
+void framebuffer_draw_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t color);
+void framebuffer_draw_rect_outline(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                                   uint8_t thickness, uint32_t color);
+void framebuffer_draw_line(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t color);
+void framebuffer_draw_char(uint16_t x, uint16_t y, char c, uint32_t color, uint32_t bg_color);
+void framebuffer_draw_string(uint16_t x, uint16_t y, const char* str, uint32_t color, uint32_t bg_color);
+void framebuffer_printf(uint16_t x, uint16_t y, uint32_t color, uint32_t bg_color, const char* format, ...);
+void framebuffer_draw_image(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint32_t* data);
+void framebuffer_save_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t* dst);
+void framebuffer_restore_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint32_t* src);
+void framebuffer_draw_surface(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                              const uint32_t* src, uint32_t stride);
+void framebuffer_blit(uint16_t src_x, uint16_t src_y, uint16_t width, uint16_t height,
+                      uint16_t dst_x, uint16_t dst_y);
+uint16_t framebuffer_get_width(void);
+uint16_t framebuffer_get_height(void);
+bool framebuffer_is_initialized(void);
+void framebuffer_test(void);
+
+#endif // FRAMEBUFFER_H
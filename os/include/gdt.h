@@ -6,6 +6,7 @@
 #define GDT_H
 
 #include <stdint.h>
+#include "cpu.h"
 
 // Структура дескриптора GDT
 struct gdt_entry {
@@ -64,6 +65,10 @@ extern void tss_flush();
 #define GDT_USER_CODE_SEG   0x18
 #define GDT_USER_DATA_SEG   0x20
 #define GDT_TSS_SEG         0x28
+#define GDT_PERCPU_SEG      0x30    // Область данных процессора (GS)
+
+// Дескрипторов в GDT каждого процессора
+#define GDT_ENTRIES         7
 
 // Константы для флагов доступа
 #define GDT_ACCESS_PRESENT      (1 << 7)
@@ -82,13 +87,15 @@ extern void tss_flush();
 
 // Функции
 void gdt_init(void);
-void gdt_set_entry(int index, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags);
-void tss_init(uint32_t idx, uint16_t ss0, uint32_t esp0);
+void gdt_init_cpu(uint32_t cpu, uint32_t percpu_base, uint32_t percpu_size, uint32_t esp0);
+void gdt_set_entry(struct gdt_entry* table, int index, uint32_t base, uint32_t limit,
+                   uint8_t access, uint8_t flags);
 void tss_set_stack(uint32_t esp0);
+uint32_t tss_get_stack(void);
 
-// Глобальные переменные
-extern struct gdt_entry gdt_entries[6];
-extern struct gdt_ptr gdt_pointer;
-extern struct tss_entry tss;
+// Глобальные переменные: у каждого процессора своя GDT и свой TSS
+extern struct gdt_entry gdt_entries[CPU_MAX][GDT_ENTRIES];
+extern struct gdt_ptr gdt_pointers[CPU_MAX];
+extern struct tss_entry tss[CPU_MAX];
 
 #endif // GDT_H
\ No newline at end of file
@@ -0,0 +1,64 @@
+/**
+ * include/history.h - Кольцевая история команд
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Максимальное количество записей в истории
+#define HISTORY_MAX_ENTRIES 64
+
+// Размер арены для текста команд (записи переменной длины)
+#define HISTORY_ARENA_SIZE  4096
+
+// Максимальная длина строки поиска
+#define HISTORY_QUERY_MAX   64
+
+// Запись истории (текст хранится в арене вместе с завершающим нулем)
+typedef struct {
+    uint16_t offset;        // Смещение текста в арене
+    uint16_t length;        // Длина без завершающего нуля
+} history_entry_t;
+
+// Состояние инкрементального обратного поиска
+typedef struct {
+    bool active;
+    char query[HISTORY_QUERY_MAX];
+    int query_len;
+    uint32_t matches[HISTORY_MAX_ENTRIES]; // Номера совпавших записей, от новых к старым
+    int match_count;
+    int match_pos;                          // Текущая позиция в списке совпадений
+    uint8_t level[HISTORY_MAX_ENTRIES];     // Длина запроса, с которым совпадает запись
+} history_search_t;
+
+// История команд
+typedef struct {
+    char arena[HISTORY_ARENA_SIZE];
+    history_entry_t entries[HISTORY_MAX_ENTRIES];
+    uint32_t first;         // Порядковый номер самой старой записи
+    uint32_t next;          // Порядковый номер следующей записи
+    uint16_t arena_head;    // Позиция записи в арене
+    uint32_t cursor;        // Позиция навигации стрелками
+    history_search_t search;
+} history_t;
+
+// Функции
+void history_init(history_t* h);
+void history_add(history_t* h, const char* line);
+int history_count(const history_t* h);
+const char* history_get(const history_t* h, uint32_t seq);
+const char* history_prev(history_t* h);
+const char* history_next(history_t* h);
+void history_reset_cursor(history_t* h);
+
+void history_search_begin(history_t* h);
+const char* history_search_push(history_t* h, char c);
+const char* history_search_pop(history_t* h);
+const char* history_search_older(history_t* h);
+const char* history_search_current(const history_t* h);
+void history_search_end(history_t* h);
+
+#endif // HISTORY_H
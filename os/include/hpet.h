@@ -0,0 +1,25 @@
+/**
+ * include/hpet.h - Драйвер HPET (High Precision Event Timer)
+ */
+
+#ifndef HPET_H
+#define HPET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Регистры HPET (смещения от базового адреса)
+#define HPET_REG_CAPS           0x000   // Возможности и период счетчика
+#define HPET_REG_CONFIG         0x010   // Общая конфигурация
+#define HPET_REG_STATUS         0x020   // Статус прерываний
+#define HPET_REG_COUNTER        0x0F0   // Главный счетчик
+#define HPET_REG_TIMER_CONFIG(n) (0x100 + 0x20 * (n))
+#define HPET_REG_TIMER_CMP(n)    (0x108 + 0x20 * (n))
+
+// Функции
+bool hpet_init(void);
+bool hpet_is_present(void);
+uint64_t hpet_read_counter(void);
+uint32_t hpet_get_period_fs(void);
+
+#endif // HPET_H
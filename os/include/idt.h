@@ -27,7 +27,7 @@ struct idt_ptr {
 
 // Структура для сохранения регистров при прерывании
 struct registers {
-    uint32_t ds;            // Сегмент данных
+    uint32_t gs, fs, es, ds; // Сегментные регистры (в порядке, обратном push)
     uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax; // Регистры общего назначения
     uint32_t int_no, err_code; // Номер прерывания и код ошибки
     uint32_t eip, cs, eflags, useresp, ss; // Автоматически сохраняемые процессором
@@ -86,6 +86,19 @@ extern void irq12();
 extern void irq13();
 extern void irq14();
 extern void irq15();
+extern void irq16();
+extern void irq17();
+extern void irq18();
+extern void irq19();
+extern void irq20();
+extern void irq21();
+extern void irq22();
+extern void irq23();
+
+// Векторы локального APIC
+extern void vector239();
+extern void vector240();
+extern void vector255();
 
 // Константы для флагов IDT
 #define IDT_FLAG_PRESENT    0x80
@@ -0,0 +1,61 @@
+/**
+ * include/input.h - Очередь событий ввода (клавиатура и мышь)
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Размер кольца событий (степень двойки)
+#define INPUT_RING_SIZE     256
+
+// Места, которые движение мыши не занимает: они остаются клавишам,
+// а движение при нехватке места склеивается
+#define INPUT_KEY_RESERVE   64
+
+// Наибольший сон главного цикла без событий (миллисекунды)
+#define INPUT_WAIT_MS       50
+
+// Типы событий
+typedef enum {
+    INPUT_EVENT_KEY = 0,
+    INPUT_EVENT_MOUSE,
+    INPUT_EVENT_TYPES
+} input_event_type_t;
+
+// Событие ввода (16 байт)
+typedef struct {
+    uint8_t type;           // input_event_type_t
+    uint8_t scancode;       // Скан-код (клавиатура)
+    uint8_t buttons;        // Состояние кнопок (мышь)
+    int8_t dz;              // Колесо (мышь)
+    int16_t dx;             // Перемещение (мышь)
+    int16_t dy;
+    uint64_t timestamp;     // Показание TSC в момент прерывания
+} input_event_t;
+
+// Обработчик событий одного типа (вызывается из главного цикла)
+typedef void (*input_handler_t)(const input_event_t* event);
+
+// Статистика очереди
+typedef struct {
+    uint32_t events;        // Помещено в кольцо
+    uint32_t coalesced;     // Пакетов мыши, склеенных с соседними
+    uint32_t dropped;       // Потеряно клавиш (кольцо заполнено целиком)
+    uint32_t max_depth;     // Наибольшая занятость кольца
+} input_stats_t;
+
+// Производитель (обработчики IRQ)
+void input_report_key(uint8_t scancode);
+void input_report_mouse(int dx, int dy, int dz, uint8_t buttons);
+
+// Потребитель (главный цикл)
+input_handler_t input_set_handler(input_event_type_t type, input_handler_t handler);
+bool input_pending(void);
+void input_wait(void);
+uint32_t input_process(void);
+void input_get_stats(input_stats_t* stats);
+
+#endif // INPUT_H
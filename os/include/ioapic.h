@@ -0,0 +1,27 @@
+/**
+ * include/ioapic.h - Контроллер прерываний ввода-вывода (IOAPIC)
+ */
+
+#ifndef IOAPIC_H
+#define IOAPIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Максимальное количество IOAPIC в системе
+#define IOAPIC_MAX 4
+
+// Регистры IOAPIC (косвенный доступ через IOREGSEL/IOWIN)
+#define IOAPIC_REG_ID       0x00
+#define IOAPIC_REG_VERSION  0x01
+#define IOAPIC_REG_REDIR(n) (0x10 + 2 * (n))
+
+// Функции
+bool ioapic_init(void);
+uint32_t ioapic_get_gsi_count(void);
+uint32_t ioapic_irq_to_gsi(uint8_t irq);
+bool ioapic_route_irq(uint8_t irq, uint8_t vector, uint8_t dest_apic_id);
+void ioapic_mask_irq(uint8_t irq);
+void ioapic_unmask_irq(uint8_t irq);
+
+#endif // IOAPIC_H
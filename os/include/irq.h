@@ -0,0 +1,36 @@
+/**
+ * include/irq.h - Обработчики аппаратных прерываний (IRQ)
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt.h"
+#include "cpu.h"
+
+// Количество линий IRQ: 16 линий 8259 или входы IOAPIC
+#define IRQ_LINES       24
+#define IRQ_LEGACY_LINES 16
+
+// Вектор линии IRQ 0 (линия n - вектор IRQ_VECTOR_BASE + n)
+#define IRQ_VECTOR_BASE 32
+
+// Тип обработчика IRQ
+typedef void (*irq_handler_t)(struct registers* regs);
+
+// Уведомление о прерывании любой линии (после ее обработчика)
+typedef void (*irq_notify_t)(int irq);
+
+// Функции
+void irq_init(void);
+bool irq_enable_apic(void);
+bool irq_is_apic(void);
+void irq_handler(struct registers* regs);
+void irq_register_handler(int irq, irq_handler_t handler);
+void irq_unregister_handler(int irq);
+void irq_set_notifier(irq_notify_t notify);
+uint64_t irq_entry_time(void);
+
+#endif // IRQ_H
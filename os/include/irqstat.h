@@ -0,0 +1,39 @@
+/**
+ * include/irqstat.h - Статистика задержек и частоты прерываний
+ */
+
+#ifndef IRQSTAT_H
+#define IRQSTAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "softirq.h"
+
+// Количество корзин гистограммы: корзина n - от 2^n до 2^(n+1) циклов,
+// последняя собирает все более долгие обработчики
+#define IRQSTAT_HIST_BUCKETS 24
+
+// Счетчики одного вектора (или softirq)
+typedef struct {
+    uint32_t count;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t hist[IRQSTAT_HIST_BUCKETS];
+} irqstat_entry_t;
+
+/**
+ * Отметка входа в обработчик
+ * @return Значение TSC
+ */
+static inline uint64_t irqstat_begin(void) {
+    return cpu_rdtsc();
+}
+
+// Функции
+void irqstat_init(void);
+void irqstat_end(uint32_t vector, uint64_t start);
+void irqstat_softirq_end(softirq_nr_t nr, uint64_t start);
+void irqstat_reset(void);
+
+#endif // IRQSTAT_H
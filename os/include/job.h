@@ -0,0 +1,46 @@
+/**
+ * include/job.h - Система заданий с перехватом работы (work stealing)
+ */
+
+#ifndef JOB_H
+#define JOB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Заданий в пуле каждого процессора
+#define JOB_POOL_SIZE   256
+
+// Емкость очереди процессора (степень двойки)
+#define JOB_DEQUE_SIZE  256
+
+typedef struct job job_t;
+
+// Тип функции задания
+typedef void (*job_func_t)(job_t* job, void* data);
+
+// Тип функции parallel_for: обрабатывает полуинтервал [begin, end)
+typedef void (*job_range_func_t)(uint32_t begin, uint32_t end, void* data);
+
+// Задание
+struct job {
+    job_func_t func;
+    void* data;
+    job_t* parent;                  // Кого известить о завершении (NULL - корень)
+    volatile uint32_t unfinished;   // Само задание + незавершенные потомки
+    volatile uint32_t in_use;       // Слот пула занят
+    uint32_t begin;                 // Диапазон для parallel_for
+    uint32_t end;
+};
+
+// Функции
+void job_init(void);
+bool job_is_ready(void);
+job_t* job_create(job_func_t func, void* data);
+job_t* job_create_child(job_t* parent, job_func_t func, void* data);
+void job_run(job_t* job);
+void job_wait(job_t* job);
+void parallel_for(uint32_t begin, uint32_t end, uint32_t grain,
+                  job_range_func_t func, void* data);
+
+#endif // JOB_H
@@ -0,0 +1,48 @@
+/**
+ * include/keyboard.h - Драйвер клавиатуры PS/2
+ */
+
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt.h"
+
+// Коды клавиш, передаваемые терминалу.
+// Печатные символы передаются как есть (ASCII).
+#define KEY_BACKSPACE '\b'
+#define KEY_TAB       '\t'
+#define KEY_ENTER     '\n'
+#define KEY_ESCAPE    0x1B
+#define KEY_CTRL_R    0x12
+#define KEY_CTRL_U    0x15
+#define KEY_CTRL_W    0x17
+#define KEY_DELETE    0x7F
+#define KEY_UP        0x100
+#define KEY_DOWN      0x101
+#define KEY_LEFT      0x102
+#define KEY_RIGHT     0x103
+#define KEY_HOME      0x104
+#define KEY_END       0x105
+
+// Функции
+void keyboard_init(void);
+void keyboard_handler(struct registers* regs);
+void keyboard_backspace(void);
+void keyboard_enter(void);
+void keyboard_tab(void);
+void keyboard_update_leds(void);
+void keyboard_reboot(void);
+
+
+// Состояние клавиш и модификаторов
+bool keyboard_is_key_pressed(uint8_t keycode);
+bool keyboard_is_shift_pressed(void);
+bool keyboard_is_ctrl_pressed(void);
+bool keyboard_is_alt_pressed(void);
+bool keyboard_is_caps_lock(void);
+
+void keyboard_test(void);
+
+#endif // KEYBOARD_H
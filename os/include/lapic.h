@@ -0,0 +1,57 @@
+/**
+ * include/lapic.h - Локальный APIC и его таймер
+ */
+
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Физический адрес регистров LAPIC по умолчанию
+#define LAPIC_DEFAULT_BASE   0xFEE00000
+
+// Регистры LAPIC (смещения)
+#define LAPIC_REG_ID         0x020
+#define LAPIC_REG_VERSION    0x030
+#define LAPIC_REG_TPR        0x080
+#define LAPIC_REG_EOI        0x0B0
+#define LAPIC_REG_SVR        0x0F0
+#define LAPIC_REG_ESR        0x280
+#define LAPIC_REG_ICR_LOW    0x300
+#define LAPIC_REG_ICR_HIGH   0x310
+#define LAPIC_REG_LVT_TIMER  0x320
+#define LAPIC_REG_LVT_LINT0  0x350
+#define LAPIC_REG_LVT_LINT1  0x360
+#define LAPIC_REG_LVT_ERROR  0x370
+#define LAPIC_REG_TIMER_INIT 0x380
+#define LAPIC_REG_TIMER_CUR  0x390
+#define LAPIC_REG_TIMER_DIV  0x3E0
+
+// Биты элементов LVT
+#define LAPIC_LVT_MASKED     0x10000
+#define LAPIC_LVT_NMI        0x400
+
+// Команды межпроцессорных прерываний (ICR)
+#define LAPIC_ICR_FIXED      0x00000
+#define LAPIC_ICR_INIT       0x00500
+#define LAPIC_ICR_STARTUP    0x00600
+#define LAPIC_ICR_PENDING    0x01000    // Доставка еще не завершена
+#define LAPIC_ICR_ASSERT     0x04000
+
+// Векторы прерываний LAPIC
+#define LAPIC_TIMER_VECTOR    0xEF
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+// Функции
+bool lapic_init(void);
+void lapic_init_ap(void);
+bool lapic_is_enabled(void);
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
+void lapic_eoi(void);
+uint8_t lapic_id(void);
+void lapic_send_ipi(uint8_t apic_id, uint32_t command);
+bool lapic_timer_init(void);
+
+#endif // LAPIC_H
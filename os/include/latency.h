@@ -0,0 +1,24 @@
+/**
+ * include/latency.h - Задержка от ввода до кадра на экране
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Гистограмма: до 8 нс точно, дальше 8 корзин на каждую степень двойки
+// (погрешность перцентиля не больше 12.5%), верхняя граница - 2^32 нс
+#define LATENCY_SUB_BITS    3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS     ((32 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+// Функции
+void latency_init(void);
+void latency_input_begin(uint8_t type, uint64_t stamp);
+void latency_input_end(void);
+void latency_present(void);
+void latency_reset(void);
+
+#endif // LATENCY_H
@@ -0,0 +1,44 @@
+/**
+ * include/lineedit.h - Редактор строки ввода на основе gap buffer
+ */
+
+#ifndef LINEEDIT_H
+#define LINEEDIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Емкость строки ввода (включая завершающий ноль при копировании)
+#define LINEEDIT_CAPACITY 256
+
+// Строка ввода: текст до курсора лежит в начале буфера,
+// текст после курсора - в конце, между ними разрыв (gap)
+typedef struct {
+    char buffer[LINEEDIT_CAPACITY];
+    int gap_start;          // Позиция курсора
+    int gap_end;            // Начало текста после курсора
+} lineedit_t;
+
+// Функции
+void lineedit_init(lineedit_t* le);
+int lineedit_length(const lineedit_t* le);
+int lineedit_cursor(const lineedit_t* le);
+char lineedit_char_at(const lineedit_t* le, int pos);
+int lineedit_get(const lineedit_t* le, char* out, int size);
+
+// Редактирование: возвращают первую измененную позицию или -1
+int lineedit_insert(lineedit_t* le, char c);
+int lineedit_backspace(lineedit_t* le);
+int lineedit_delete(lineedit_t* le);
+int lineedit_kill_word(lineedit_t* le);
+int lineedit_kill_line(lineedit_t* le);
+int lineedit_set(lineedit_t* le, const char* text);
+int lineedit_clear(lineedit_t* le);
+
+// Перемещение курсора
+bool lineedit_left(lineedit_t* le);
+bool lineedit_right(lineedit_t* le);
+bool lineedit_home(lineedit_t* le);
+bool lineedit_end(lineedit_t* le);
+
+#endif // LINEEDIT_H
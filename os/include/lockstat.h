@@ -0,0 +1,39 @@
+/**
+ * include/lockstat.h - Статистика блокировок
+ */
+
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Счетчики одной блокировки
+// Захваты, ожидание и удержание учитывает владелец (пока держит
+// блокировку), поэтому счетчики обновляются без атомарных операций.
+// Читатели rwlock считаются отдельно атомарными операциями.
+typedef struct lockstat {
+    const char* name;
+    int instance;                   // Номер экземпляра (-1 - единственный)
+    uint32_t acquisitions;
+    uint32_t contended;             // Захваты, которым пришлось ждать
+    uint64_t wait_cycles;
+    uint64_t hold_cycles;
+    uint32_t max_hold_cycles;
+    uint64_t acquired_at;           // TSC последнего захвата
+    volatile uint32_t read_acquisitions;
+    volatile uint32_t read_contended;
+    struct lockstat* next;          // Список для команды lockstat
+    volatile uint32_t registered;
+} lockstat_t;
+
+#define LOCKSTAT_INIT(label) { .name = (label), .instance = -1 }
+
+// Функции
+void lockstat_init(void);
+void lockstat_acquired(lockstat_t* stat, uint64_t start, bool contended);
+void lockstat_released(lockstat_t* stat);
+void lockstat_read_acquired(lockstat_t* stat, bool contended);
+void lockstat_reset(void);
+
+#endif // LOCKSTAT_H
@@ -0,0 +1,69 @@
+/**
+ * include/multiboot.h - Сведения от загрузчика Multiboot (GRUB)
+ */
+
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Сигнатура заголовка в образе ядра и значение EAX при входе
+#define MULTIBOOT_HEADER_MAGIC      0x1BADB002
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002
+
+// Флаги заголовка
+#define MULTIBOOT_PAGE_ALIGN        (1 << 0)    // Модули по границе страницы
+#define MULTIBOOT_MEMORY_INFO       (1 << 1)    // Нужна карта памяти
+
+// Флаги структуры сведений (какие поля заполнены)
+#define MULTIBOOT_INFO_MEMORY       (1 << 0)
+#define MULTIBOOT_INFO_CMDLINE      (1 << 2)
+#define MULTIBOOT_INFO_MODS         (1 << 3)
+#define MULTIBOOT_INFO_MEM_MAP      (1 << 6)
+
+// Тип области карты памяти: доступная ОЗУ
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+// Модулей, которые ядро запоминает
+#define MULTIBOOT_MAX_MODULES       16
+
+// Сведения, которые загрузчик передает в EBX
+typedef struct {
+    uint32_t flags;
+    uint32_t mem_lower;         // КБ ниже 1 МБ
+    uint32_t mem_upper;         // КБ выше 1 МБ
+    uint32_t boot_device;
+    uint32_t cmdline;
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;
+    uint32_t mmap_addr;
+} __attribute__((packed)) multiboot_info_t;
+
+// Загруженный модуль
+typedef struct {
+    uint32_t mod_start;         // Физический адрес начала
+    uint32_t mod_end;           // Адрес за последним байтом
+    uint32_t string;            // Командная строка модуля
+    uint32_t reserved;
+} __attribute__((packed)) multiboot_module_t;
+
+// Область карты памяти (size не включает само поле size)
+typedef struct {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+// Функции
+bool multiboot_init(uint32_t magic, uint32_t info);
+const multiboot_info_t* multiboot_get_info(void);
+uint32_t multiboot_module_count(void);
+const multiboot_module_t* multiboot_get_module(uint32_t index);
+const char* multiboot_module_name(const multiboot_module_t* mod);
+const multiboot_module_t* multiboot_find_module(const char* name);
+
+#endif // MULTIBOOT_H
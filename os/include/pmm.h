@@ -0,0 +1,34 @@
+/**
+ * include/pmm.h - Менеджер физических страниц
+ */
+
+#ifndef PMM_H
+#define PMM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Размер страницы
+#define PAGE_SIZE           4096
+#define PAGE_MASK           (~(PAGE_SIZE - 1))
+
+// Выравнивание адреса по границе страницы
+#define PAGE_ALIGN_DOWN(a)  ((uint32_t)(a) & PAGE_MASK)
+#define PAGE_ALIGN_UP(a)    (((uint32_t)(a) + PAGE_SIZE - 1) & PAGE_MASK)
+
+// Раздаваемая память: ниже 1 ГБ ядро отображает ее один к одному,
+// поэтому страница доступна ядру по своему физическому адресу
+#define PMM_LIMIT           0x40000000
+#define PMM_PAGES           (PMM_LIMIT / PAGE_SIZE)
+
+// Функции
+bool pmm_init(void);
+uint32_t pmm_alloc(void);
+uint32_t pmm_alloc_zeroed(void);
+uint32_t pmm_alloc_range(uint32_t count);
+void pmm_free(uint32_t page);
+void pmm_free_range(uint32_t start, uint32_t count);
+uint32_t pmm_free_pages(void);
+uint32_t pmm_total_pages(void);
+
+#endif // PMM_H
@@ -0,0 +1,50 @@
+/**
+ * include/proc.h - Процессы кольца 3
+ */
+
+#ifndef PROC_H
+#define PROC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt.h"
+#include "sched.h"
+
+// Пул процессов
+#define PROC_MAX            8
+#define PROC_NAME_LENGTH    SCHED_NAME_LENGTH
+
+// Стек процесса (отображается сразу целиком под VMM_USER_STACK_TOP)
+#define PROC_STACK_PAGES    16
+
+// Состояния процесса
+typedef enum {
+    PROC_FREE = 0,
+    PROC_STARTING,      // Загружается
+    PROC_RUNNING,
+    PROC_ZOMBIE,        // Завершен, код ждет proc_wait()
+} proc_state_t;
+
+typedef struct proc {
+    uint32_t pid;
+    volatile proc_state_t state;
+    char name[PROC_NAME_LENGTH];
+    uint32_t directory;             // Каталог страниц (физический адрес)
+    uint32_t entry;                 // Точка входа в кольце 3
+    thread_t* thread;
+    thread_t* poller;               // Поток опроса кольца (uring): действует от имени процесса
+    struct proc* parent;            // NULL - запущен ядром
+    bool orphan;                    // Родитель завершился: никто не ждет
+    int32_t exit_code;
+} proc_t;
+
+// Функции
+void proc_init(void);
+int32_t proc_spawn(const char* name, proc_t* parent);
+int32_t proc_wait(uint32_t pid);
+void proc_exit(int32_t code) __attribute__((noreturn));
+void proc_fault(struct registers* regs) __attribute__((noreturn));
+proc_t* proc_current(void);
+bool proc_check_user(uint32_t addr, uint32_t length, bool write);
+
+#endif // PROC_H
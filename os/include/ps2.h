@@ -0,0 +1,55 @@
+/**
+ * include/ps2.h - Контроллер PS/2 (8042)
+ */
+
+#ifndef PS2_H
+#define PS2_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Порты контроллера
+#define PS2_DATA_PORT       0x60
+#define PS2_STATUS_PORT     0x64
+#define PS2_COMMAND_PORT    0x64
+
+// Биты регистра состояния
+#define PS2_STATUS_OUTPUT   0x01    // Есть байт для чтения
+#define PS2_STATUS_INPUT    0x02    // Контроллер еще не забрал записанный байт
+
+// Порты устройств
+#define PS2_PORT_KEYBOARD   0
+#define PS2_PORT_MOUSE      1
+#define PS2_PORTS           2
+
+// Ответы устройств
+#define PS2_ACK             0xFA
+#define PS2_RESEND          0xFE
+
+// Очередь команд одного порта
+#define PS2_QUEUE_SIZE      16
+#define PS2_MAX_RESPONSE    2       // Байтов ответа после ACK
+
+// Нет аргумента команды
+#define PS2_NO_ARG          (-1)
+
+// Результат команды
+typedef enum {
+    PS2_OK = 0,
+    PS2_ERROR,          // Устройство не приняло команду после повторов
+    PS2_TIMEOUT,        // Нет ответа
+} ps2_status_t;
+
+// Завершение команды (вызывается из прерывания или из таймера,
+// при запрещенных прерываниях)
+typedef void (*ps2_done_t)(int port, ps2_status_t status,
+                           const uint8_t* response, int length, void* data);
+
+// Функции
+bool ps2_init(void);
+bool ps2_send(int port, uint8_t command, int arg, int response_length,
+              ps2_done_t done, void* data);
+bool ps2_receive(int port, uint8_t data);
+bool ps2_is_busy(int port);
+
+#endif // PS2_H
@@ -0,0 +1,80 @@
+/**
+ * include/sched.h - Потоки ядра и вытесняющий планировщик
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Пул потоков и размер стека потока
+#define SCHED_MAX_THREADS   16
+#define SCHED_STACK_SIZE    8192
+#define SCHED_NAME_LENGTH   16
+
+// Квант времени
+#define SCHED_SLICE_MS      10
+
+// Область сохранения FPU (FXSAVE - 512 байт, FNSAVE - 108)
+#define SCHED_FPU_STATE_SIZE 512
+
+// Состояния потока
+typedef enum {
+    THREAD_FREE = 0,
+    THREAD_READY,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,
+    THREAD_DEAD,
+} thread_state_t;
+
+typedef void (*thread_func_t)(void* arg);
+
+// Поток ядра
+typedef struct thread {
+    uint8_t fpu_state[SCHED_FPU_STATE_SIZE] __attribute__((aligned(16)));
+    uint32_t esp;               // Сохраненный указатель стека
+    uint32_t stack_top;         // Вершина стека (esp0 в TSS)
+    uint32_t page_directory;    // Каталог страниц (0 - каталог ядра)
+    struct thread* next;        // Очередь готовых
+    uint32_t id;
+    uint32_t cpu;               // Процессор, на котором выполняется поток
+    thread_state_t state;
+    volatile bool wake_pending; // sched_wake() пришел, пока поток не спал
+    uint32_t switches;          // Сколько раз поток получал процессор
+    uint32_t fpu_loads;         // Сколько раз его состояние FPU загружалось по #NM
+    uint64_t runtime_ns;        // Суммарное время на процессоре
+    uint64_t start_ns;          // Начало текущего кванта
+    char name[SCHED_NAME_LENGTH];
+} thread_t;
+
+// Функции
+void sched_init(void);
+thread_t* sched_create(const char* name, thread_func_t func, void* arg);
+thread_t* sched_create_on(const char* name, thread_func_t func, void* arg, uint32_t cpu);
+void sched_start_cpu(void) __attribute__((noreturn));
+void sched_exit(void) __attribute__((noreturn));
+thread_t* sched_current(void);
+bool sched_is_running(void);
+
+// Переключение
+void sched_yield(void);
+void sched_block(void);
+void sched_wake(thread_t* t);
+void sched_preempt(void);
+bool sched_can_block(void);
+void sched_sleep_ms(uint32_t ms);
+
+// Запрет вытеснения (вложенный)
+void sched_preempt_disable(void);
+void sched_preempt_enable(void);
+
+// Ленивое переключение FPU
+bool sched_fpu_trap(void);
+bool kernel_fpu_begin(void);
+void kernel_fpu_end(void);
+
+// Переключение стеков (sched_asm.asm)
+extern void sched_switch(uint32_t* old_esp, uint32_t new_esp);
+
+#endif // SCHED_H
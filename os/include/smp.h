@@ -0,0 +1,41 @@
+/**
+ * include/smp.h - Запуск дополнительных процессоров (SMP)
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+
+// Адрес стартового кода AP (ниже 1 МБ, кратен 4 КБ); вектор SIPI - номер страницы
+#define SMP_TRAMPOLINE_BASE 0x8000
+
+// Стек ядра каждого AP
+#define SMP_STACK_SIZE      16384
+
+// Межпроцессорное прерывание "перепланируй"
+#define SMP_RESCHED_VECTOR  0xF0
+
+// Индекс загрузочного процессора
+#define SMP_BSP             0
+
+// Область данных процессора; сегмент GS указывает на нее
+typedef struct percpu {
+    struct percpu* self;        // Адрес самой области (смещение 0)
+    uint32_t index;             // Индекс процессора (смещение 4)
+    uint32_t apic_id;
+    volatile bool online;
+    uint32_t stack_top;         // Вершина стека ядра
+} __attribute__((aligned(64))) percpu_t;
+
+// Функции
+percpu_t* smp_percpu_setup(uint32_t cpu);
+percpu_t* smp_this_cpu(void);
+void smp_init(void);
+uint32_t smp_cpu_count(void);
+bool smp_cpu_online(uint32_t cpu);
+void smp_send_reschedule(uint32_t cpu);
+
+#endif // SMP_H
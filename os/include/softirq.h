@@ -0,0 +1,50 @@
+/**
+ * include/softirq.h - Отложенная обработка прерываний (softirq и tasklet)
+ */
+
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Номера отложенных обработчиков (меньший номер выполняется раньше)
+typedef enum {
+    SOFTIRQ_TIMER = 0,
+    SOFTIRQ_TASKLET,
+    SOFTIRQ_COUNT
+} softirq_nr_t;
+
+// Сколько раз подряд softirq перезапускается на выходе из прерывания,
+// прежде чем оставить работу главному циклу
+#define SOFTIRQ_MAX_RESTART 10
+
+typedef void (*softirq_func_t)(void);
+
+// Разовая отложенная работа; повторное планирование до выполнения
+// ничего не делает
+typedef struct tasklet {
+    struct tasklet* next;
+    void (*func)(void* data);
+    void* data;
+    volatile bool scheduled;
+} tasklet_t;
+
+// Функции
+void softirq_init(void);
+void softirq_open(softirq_nr_t nr, softirq_func_t func);
+void softirq_raise(softirq_nr_t nr);
+bool softirq_pending(void);
+void softirq_run(void);
+uint32_t softirq_get_count(softirq_nr_t nr);
+
+// Границы обработчика аппаратного прерывания
+void irq_enter(void);
+void irq_exit(void);
+bool in_interrupt(void);
+
+// Tasklet
+void tasklet_init(tasklet_t* t, void (*func)(void* data), void* data);
+bool tasklet_schedule(tasklet_t* t);
+
+#endif // SOFTIRQ_H
@@ -0,0 +1,307 @@
+/**
+ * include/spinlock.h - Спин-блокировки: билетные, чтения-записи и seqlock
+ *
+ * Защищают данные, общие для нескольких процессоров. Если данные
+ * трогает и обработчик прерывания, нужна версия с _irqsave: иначе
+ * прерывание на том же процессоре будет ждать блокировку вечно.
+ * Вытеснение блокировки не запрещают, поэтому из потоков их берут
+ * тоже с _irqsave.
+ *
+ * К блокировке можно привязать счетчики lockstat_t (SPINLOCK_INIT_STAT,
+ * spin_init_stat): тогда учитываются захваты, ожидание и удержание.
+ */
+
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "cpu.h"
+#include "lockstat.h"
+
+// Билетная блокировка: процессоры получают ее в порядке очереди
+typedef struct {
+    union {
+        volatile uint32_t ticket;       // Оба поля для trylock
+        struct {
+            volatile uint16_t owner;    // Чей билет обслуживается
+            volatile uint16_t next;     // Следующий свободный билет
+        };
+    };
+    lockstat_t* stat;                   // NULL - без статистики
+} spinlock_t;
+
+#define SPINLOCK_INIT { { 0 }, NULL }
+#define SPINLOCK_INIT_STAT(s) { { 0 }, (s) }
+
+// Блокировка и ее счетчики одним объявлением
+#define SPINLOCK_DEFINE(var, label) \
+    static lockstat_t var##_stat = LOCKSTAT_INIT(label); \
+    static spinlock_t var = SPINLOCK_INIT_STAT(&var##_stat)
+
+/**
+ * Инициализация блокировки
+ */
+static inline void spin_init(spinlock_t* lock) {
+    lock->ticket = 0;
+    lock->stat = NULL;
+}
+
+/**
+ * Инициализация блокировки со счетчиками
+ * @param stat Счетчики (живут столько же, сколько блокировка)
+ */
+static inline void spin_init_stat(spinlock_t* lock, lockstat_t* stat) {
+    lock->ticket = 0;
+    lock->stat = stat;
+}
+
+/**
+ * Проверка, занята ли блокировка
+ */
+static inline bool spin_is_locked(spinlock_t* lock) {
+    uint32_t t = __atomic_load_n(&lock->ticket, __ATOMIC_RELAXED);
+    return (uint16_t)t != (uint16_t)(t >> 16);
+}
+
+/**
+ * Попытка захвата без ожидания
+ * Билет берется, только если очередь пуста.
+ * @return true, если блокировка захвачена
+ */
+static inline bool spin_trylock(spinlock_t* lock) {
+    uint64_t start = lock->stat ? cpu_rdtsc() : 0;
+    uint32_t t = __atomic_load_n(&lock->ticket, __ATOMIC_RELAXED);
+    
+    if ((uint16_t)t != (uint16_t)(t >> 16)) return false;
+    if (!__atomic_compare_exchange_n(&lock->ticket, &t, t + 0x10000, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    
+    if (lock->stat) lockstat_acquired(lock->stat, start, false);
+    return true;
+}
+
+/**
+ * Захват блокировки
+ * Берем билет и ждем своей очереди, только читая поле владельца.
+ */
+static inline void spin_lock(spinlock_t* lock) {
+    uint64_t start = lock->stat ? cpu_rdtsc() : 0;
+    uint32_t t = __atomic_fetch_add(&lock->ticket, 0x10000, __ATOMIC_ACQUIRE);
+    uint16_t me = (uint16_t)(t >> 16);
+    bool contended = (uint16_t)t != me;
+    
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != me) {
+        cpu_relax();
+    }
+    
+    if (lock->stat) lockstat_acquired(lock->stat, start, contended);
+}
+
+/**
+ * Освобождение блокировки: обслуживается следующий билет
+ */
+static inline void spin_unlock(spinlock_t* lock) {
+    if (lock->stat) lockstat_released(lock->stat);
+    
+    __atomic_store_n(&lock->owner, (uint16_t)(lock->owner + 1), __ATOMIC_RELEASE);
+}
+
+/**
+ * Запрет прерываний и захват блокировки
+ * @return Прежнее значение EFLAGS для spin_unlock_irqrestore
+ */
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = cpu_irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+/**
+ * Освобождение блокировки и восстановление флага прерываний
+ */
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    cpu_irq_restore(flags);
+}
+
+// Блокировка чтения-записи
+// Читатели не мешают друг другу; писатель, объявивший себя, не пускает
+// новых читателей и ждет, пока уйдут текущие.
+#define RWLOCK_WRITER 0x80000000u
+
+typedef struct {
+    volatile uint32_t state;            // Бит писателя + число читателей
+    lockstat_t* stat;
+} rwlock_t;
+
+#define RWLOCK_INIT { 0, NULL }
+#define RWLOCK_INIT_STAT(s) { 0, (s) }
+
+/**
+ * Инициализация блокировки чтения-записи
+ * @param stat Счетчики или NULL
+ */
+static inline void rwlock_init(rwlock_t* lock, lockstat_t* stat) {
+    lock->state = 0;
+    lock->stat = stat;
+}
+
+/**
+ * Захват на чтение
+ */
+static inline void read_lock(rwlock_t* lock) {
+    bool contended = false;
+    
+    for (;;) {
+        if (!(__atomic_load_n(&lock->state, __ATOMIC_RELAXED) & RWLOCK_WRITER)) {
+            uint32_t old = __atomic_fetch_add(&lock->state, 1, __ATOMIC_ACQUIRE);
+            if (!(old & RWLOCK_WRITER)) break;
+            
+            // Писатель успел раньше - уступаем
+            __atomic_fetch_sub(&lock->state, 1, __ATOMIC_RELAXED);
+        }
+        contended = true;
+        cpu_relax();
+    }
+    
+    if (lock->stat) lockstat_read_acquired(lock->stat, contended);
+}
+
+/**
+ * Освобождение после чтения
+ */
+static inline void read_unlock(rwlock_t* lock) {
+    __atomic_fetch_sub(&lock->state, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Захват на запись
+ * Сначала занимаем бит писателя, затем ждем ухода читателей.
+ */
+static inline void write_lock(rwlock_t* lock) {
+    uint64_t start = lock->stat ? cpu_rdtsc() : 0;
+    bool contended = false;
+    
+    while (__atomic_fetch_or(&lock->state, RWLOCK_WRITER, __ATOMIC_ACQUIRE) & RWLOCK_WRITER) {
+        contended = true;
+        while (__atomic_load_n(&lock->state, __ATOMIC_RELAXED) & RWLOCK_WRITER) {
+            cpu_relax();
+        }
+    }
+    
+    while (__atomic_load_n(&lock->state, __ATOMIC_ACQUIRE) & ~RWLOCK_WRITER) {
+        contended = true;
+        cpu_relax();
+    }
+    
+    if (lock->stat) lockstat_acquired(lock->stat, start, contended);
+}
+
+/**
+ * Освобождение после записи
+ */
+static inline void write_unlock(rwlock_t* lock) {
+    if (lock->stat) lockstat_released(lock->stat);
+    
+    __atomic_fetch_and(&lock->state, ~RWLOCK_WRITER, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t read_lock_irqsave(rwlock_t* lock) {
+    uint32_t flags = cpu_irq_save();
+    read_lock(lock);
+    return flags;
+}
+
+static inline void read_unlock_irqrestore(rwlock_t* lock, uint32_t flags) {
+    read_unlock(lock);
+    cpu_irq_restore(flags);
+}
+
+static inline uint32_t write_lock_irqsave(rwlock_t* lock) {
+    uint32_t flags = cpu_irq_save();
+    write_lock(lock);
+    return flags;
+}
+
+static inline void write_unlock_irqrestore(rwlock_t* lock, uint32_t flags) {
+    write_unlock(lock);
+    cpu_irq_restore(flags);
+}
+
+// Seqlock: читатели не блокируются, а повторяют чтение, если за это
+// время писатель менял данные (нечетный номер - запись идет)
+typedef struct {
+    volatile uint32_t sequence;
+    spinlock_t lock;                    // Писатели между собой
+} seqlock_t;
+
+#define SEQLOCK_INIT { 0, SPINLOCK_INIT }
+#define SEQLOCK_INIT_STAT(s) { 0, SPINLOCK_INIT_STAT(s) }
+
+/**
+ * Инициализация seqlock
+ * @param stat Счетчики писателей или NULL
+ */
+static inline void seqlock_init(seqlock_t* sl, lockstat_t* stat) {
+    sl->sequence = 0;
+    spin_init_stat(&sl->lock, stat);
+}
+
+/**
+ * Начало чтения
+ * Писателя, прерванного на этом же процессоре, ждать нельзя, поэтому
+ * писатели, которых может прервать читатель, берут _irqsave.
+ * @return Номер для read_seqretry
+ */
+static inline uint32_t read_seqbegin(const seqlock_t* sl) {
+    uint32_t seq;
+    
+    while ((seq = __atomic_load_n(&sl->sequence, __ATOMIC_ACQUIRE)) & 1) {
+        cpu_relax();
+    }
+    return seq;
+}
+
+/**
+ * Конец чтения
+ * @param seq Значение read_seqbegin
+ * @return true, если данные менялись и чтение нужно повторить
+ */
+static inline bool read_seqretry(const seqlock_t* sl, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&sl->sequence, __ATOMIC_RELAXED) != seq;
+}
+
+/**
+ * Начало записи
+ */
+static inline void write_seqlock(seqlock_t* sl) {
+    spin_lock(&sl->lock);
+    __atomic_store_n(&sl->sequence, sl->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Конец записи
+ */
+static inline void write_sequnlock(seqlock_t* sl) {
+    __atomic_store_n(&sl->sequence, sl->sequence + 1, __ATOMIC_RELEASE);
+    spin_unlock(&sl->lock);
+}
+
+static inline uint32_t write_seqlock_irqsave(seqlock_t* sl) {
+    uint32_t flags = cpu_irq_save();
+    write_seqlock(sl);
+    return flags;
+}
+
+static inline void write_sequnlock_irqrestore(seqlock_t* sl, uint32_t flags) {
+    write_sequnlock(sl);
+    cpu_irq_restore(flags);
+}
+
+#endif // SPINLOCK_H
@@ -0,0 +1,42 @@
+/**
+ * include/surface.h - Разделяемые поверхности окон
+ *
+ * Поверхность - буфер пикселей из смежных физических страниц. Ядро
+ * видит его по физическому адресу, процесс - по адресу
+ * SURFACE_USER_ADDR(id) в своей области. Клиент рисует прямо в эти
+ * страницы и сообщает измененный прямоугольник (SYS_SURFACE_DAMAGE),
+ * а поток "compositor" выводит на экран только эту часть, читая ее из
+ * тех же страниц: пиксели через границу колец не копируются.
+ */
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Поверхностей в системе
+#define SURFACE_MAX             8
+
+// Адреса поверхностей в области процесса: у каждой свой участок
+// в 4 МБ (своя таблица страниц), чего хватает на весь экран 1024x768
+#define SURFACE_USER_BASE       0x70000000
+#define SURFACE_USER_SPAN       0x400000
+#define SURFACE_USER_ADDR(id)   (SURFACE_USER_BASE + (uint32_t)(id) * SURFACE_USER_SPAN)
+
+struct proc;
+
+// Функции
+void surface_init(void);
+int32_t surface_create(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+bool surface_damage(int32_t id, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+bool surface_destroy(int32_t id);
+bool surface_fill(int32_t id, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                  uint32_t color);
+bool surface_copy(int32_t id, uint16_t src_x, uint16_t src_y, uint16_t dst_x, uint16_t dst_y,
+                  uint16_t width, uint16_t height);
+uint32_t* surface_pixels(int32_t id);
+void surface_release(struct proc* owner);
+void surface_invalidate_all(void);
+
+#endif // SURFACE_H
@@ -0,0 +1,100 @@
+/**
+ * include/syscall.h - Системные вызовы
+ *
+ * Номер вызова передается в EAX, аргументы - в EBX, ECX, EDX, ESI, EDI,
+ * результат возвращается в EAX (-1 - ошибка).
+ *
+ * Два входа:
+ *   int 0x80 - шлюз с DPL 3, работает из любого кольца;
+ *   SYSENTER - быстрый путь из кольца 3 (если процессор его поддерживает).
+ *     SYSEXIT берет адрес возврата из EDX и стек из ECX, поэтому
+ *     вызывающий код кладет аргументы 2 и 3 на свой стек, а в ECX и EDX
+ *     передает стек и адрес возврата (см. syscall_sysenter3).
+ */
+
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt.h"
+
+// Вектор программного прерывания
+#define SYSCALL_VECTOR      0x80
+
+// Размер таблицы вызовов
+#define SYSCALL_MAX         64
+
+// Номера вызовов
+#define SYS_NULL            0   // Ничего не делает (замер стоимости входа)
+#define SYS_EXIT            1   // Завершение потока: код
+#define SYS_WRITE           2   // Вывод в терминал: буфер, длина
+#define SYS_YIELD           3   // Отдать процессор
+#define SYS_SLEEP           4   // Сон: миллисекунды
+#define SYS_TIME            5   // Миллисекунды с загрузки
+#define SYS_SPAWN           6   // Запуск процесса: имя модуля
+#define SYS_WAIT            7   // Ожидание потомка: pid
+#define SYS_GETPID          8   // Идентификатор процесса
+#define SYS_SURFACE_CREATE  9   // Поверхность окна: x, y, ширина, высота
+#define SYS_SURFACE_DAMAGE  10  // Вывод части поверхности: номер, x, y, ширина, высота
+#define SYS_SURFACE_DESTROY 11  // Закрытие поверхности: номер
+#define SYS_URING_SETUP     12  // Кольца вызовов: флаги
+#define SYS_URING_ENTER     13  // Выполнение операций из кольца: сколько, сколько ждать, флаги
+
+// MSR быстрого входа
+#define MSR_SYSENTER_CS     0x174
+#define MSR_SYSENTER_ESP    0x175
+#define MSR_SYSENTER_EIP    0x176
+
+// Бит CPUID.1:EDX - есть SYSENTER/SYSEXIT
+#define CPUID_EDX_SEP       (1 << 11)
+
+// Обработчик вызова: аргументы из EBX, ECX, EDX, ESI, EDI
+typedef int32_t (*syscall_func_t)(uint32_t a1, uint32_t a2, uint32_t a3,
+                                  uint32_t a4, uint32_t a5);
+
+// Функции
+void syscall_init(void);
+void syscall_init_cpu(void);
+bool syscall_register(uint32_t num, syscall_func_t func);
+bool syscall_has_sysenter(void);
+void syscall_dispatch(struct registers* regs);
+void syscall_sysenter_handler(struct registers* regs);
+
+// Входы (syscall_asm.asm)
+extern void syscall_int80_entry(void);
+extern void syscall_sysenter_entry(void);
+extern void syscall_enter_user(uint32_t eip, uint32_t esp) __attribute__((noreturn));
+
+/**
+ * Системный вызов через int 0x80
+ */
+static inline int32_t syscall_int80(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3) {
+    int32_t ret;
+    asm volatile("int $0x80"
+                 : "=a"(ret)
+                 : "a"(num), "b"(a1), "c"(a2), "d"(a3)
+                 : "memory");
+    return ret;
+}
+
+/**
+ * Системный вызов через SYSENTER (только из кольца 3)
+ * ECX и EDX портятся: в них уходят стек и адрес возврата.
+ */
+static inline int32_t syscall_sysenter3(uint32_t num, uint32_t a1, uint32_t a2, uint32_t a3) {
+    int32_t ret;
+    asm volatile("push %%edx\n\t"
+                 "push %%ecx\n\t"
+                 "mov %%esp, %%ecx\n\t"
+                 "mov $1f, %%edx\n\t"
+                 "sysenter\n"
+                 "1:\n\t"
+                 "add $8, %%esp"
+                 : "=a"(ret), "+c"(a2), "+d"(a3)
+                 : "a"(num), "b"(a1)
+                 : "memory");
+    return ret;
+}
+
+#endif // SYSCALL_H
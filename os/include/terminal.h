@@ -0,0 +1,82 @@
+/**
+ * include/terminal.h - Эмулятор терминала
+ */
+
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include "lineedit.h"
+
+// Размеры текстовой области терминала (в символах 8x16)
+#define TERMINAL_WIDTH       72
+#define MAX_TERMINAL_LINES   21
+#define TERMINAL_BUFFER_SIZE (TERMINAL_WIDTH * MAX_TERMINAL_LINES)
+
+// Размер области терминала в окне (в пикселях)
+#define TERMINAL_VIEW_WIDTH  580
+#define TERMINAL_VIEW_HEIGHT 340
+
+// Количество виртуальных консолей (Alt+F1..F6)
+#define TERMINAL_CONSOLES    6
+
+// Максимальная длина командной строки
+#define COMMAND_MAX_LENGTH   256
+
+// Период мигания курсора (миллисекунды)
+#define TERMINAL_BLINK_MS    500
+
+// Максимальное количество параметров escape-последовательности
+#define TERMINAL_MAX_ESCAPE_PARAMS 8
+
+// Состояние терминала
+typedef struct {
+    int cursor_x;                   // Позиция курсора (столбец)
+    int cursor_y;                   // Позиция курсора (строка)
+    int scroll_offset;              // Количество прокрученных строк
+    lineedit_t input;               // Редактируемая строка ввода
+    int input_origin;               // Позиция начала ввода в буфере (после приглашения)
+    int input_shown;                // Сколько ячеек ввода сейчас занято на экране
+    bool escape_mode;
+    int escape_params[TERMINAL_MAX_ESCAPE_PARAMS];
+    int escape_param_count;
+    bool cursor_visible;
+    bool show_prompt;
+    char prompt[32];
+} terminal_state_t;
+
+// Функции
+void terminal_init(void);
+void terminal_draw(void);
+void terminal_putchar(char c);
+void terminal_backspace(void);
+void terminal_print(const char* str);
+void terminal_print_line(const char* str);
+void terminal_printf(const char* format, ...);
+void terminal_print_banner(void);
+void terminal_print_prompt(void);
+void terminal_process_input(void);
+void terminal_wait_input(void);
+void terminal_process_command_input(const char* input);
+void terminal_process_command(const char* command);
+void terminal_clear(void);
+void terminal_handle_key(int key);
+void terminal_blink(void);
+
+// Виртуальные консоли
+bool terminal_switch_console(int index);
+int terminal_active_console(void);
+
+// История команд
+void terminal_show_history(void);
+void terminal_history_navigate(int direction);
+void terminal_history_search(void);
+
+void terminal_autocomplete(void);
+terminal_state_t* terminal_get_state(void);
+int terminal_get_window_id(void);
+void terminal_test(void);
+
+#endif // TERMINAL_H
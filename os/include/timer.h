@@ -0,0 +1,56 @@
+/**
+ * include/timer.h - Драйвер программируемого интервального таймера (PIT)
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "idt.h"
+#include "clockevent.h"
+
+// Частота тиков таймера в Гц
+#define TIMER_FREQUENCY     1000
+#define TIMER_US_PER_TICK   (1000000 / TIMER_FREQUENCY)
+
+// Максимальное количество одновременно взведенных таймеров
+#define TIMER_MAX_TIMERS    64
+
+// Иерархическое колесо таймеров: 4 уровня по 64 слота,
+// уровень N покрывает интервалы до 64^(N+1) тиков
+#define TIMER_WHEEL_BITS    6
+#define TIMER_WHEEL_SLOTS   (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS  4
+
+// Дескриптор таймера: индекс и поколение, поэтому отмена
+// уже сработавшего или переиспользованного таймера безопасна
+typedef uint32_t timer_handle_t;
+#define TIMER_INVALID_HANDLE 0
+
+// Функция обратного вызова (выполняется в SOFTIRQ_TIMER при разрешенных прерываниях)
+typedef void (*timer_func_t)(void* data);
+
+// Функции
+void timer_init(uint32_t frequency);
+void timer_handler(struct registers* regs);
+uint32_t timer_get_ticks(void);
+uint32_t timer_get_seconds(void);
+void timer_sleep(uint32_t ms);
+void timer_sleep_us(uint32_t us);
+void timer_get_time_string(char* buffer);
+void timer_test(void);
+
+// Простой и статистика
+void timer_pit_wait_us(uint32_t us);
+void timer_idle(void);
+uint32_t timer_get_event_count(void);
+const char* timer_get_clockevent_name(void);
+
+// Таймеры
+timer_handle_t timer_register_callback(timer_func_t func, void* data, uint32_t interval_ms);
+timer_handle_t timer_register_oneshot(timer_func_t func, void* data, uint32_t delay_ms);
+bool timer_unregister_callback(timer_handle_t handle);
+bool timer_is_pending(timer_handle_t handle);
+
+#endif // TIMER_H
@@ -0,0 +1,96 @@
+/**
+ * include/uring.h - Кольца отправки и завершения системных вызовов
+ *
+ * Процесс получает одну страницу по адресу URING_USER_ADDR, общую с
+ * ядром. В ней заголовок и два кольца: SQ (операции процесса) и CQ
+ * (результаты ядра). Процесс заполняет элементы SQ и сдвигает
+ * sq_tail, ядро забирает их, сдвигая sq_head, и кладет результаты в
+ * CQ (cq_tail); процесс читает их и сдвигает cq_head. Индексы
+ * растут без ограничения, позиция в кольце - индекс & URING_MASK.
+ *
+ * Забрать операции можно двумя способами:
+ *   SYS_URING_ENTER - все накопленные операции за один вход в ядро;
+ *   URING_SETUP_SQPOLL - поток ядра сам опрашивает SQ, и системные
+ *     вызовы не нужны, пока он не уснул (флаг URING_NEED_WAKEUP,
+ *     будится SYS_URING_ENTER с URING_ENTER_WAKEUP).
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Адрес страницы колец в области процесса (своя таблица страниц,
+// ниже поверхностей)
+#define URING_USER_ADDR         0x6FC00000
+
+// Элементов в каждом кольце (степень двойки)
+#define URING_ENTRIES           64
+#define URING_MASK              (URING_ENTRIES - 1)
+
+// Колец в системе
+#define URING_MAX               8
+
+// Поток опроса засыпает, если SQ пуста дольше этого (миллисекунды)
+#define URING_SQPOLL_IDLE_MS    20
+
+// Флаги SYS_URING_SETUP
+#define URING_SETUP_SQPOLL      (1 << 0)
+
+// Флаги SYS_URING_ENTER
+#define URING_ENTER_WAKEUP      (1 << 0)    // Разбудить поток опроса
+
+// Флаги заголовка (пишет ядро)
+#define URING_NEED_WAKEUP       (1 << 0)    // Поток опроса спит
+
+// Операции
+#define URING_OP_NOP            0
+#define URING_OP_WRITE          1   // Вывод в терминал: буфер, длина
+#define URING_OP_FILL           2   // Заливка: поверхность, XY, WH, цвет
+#define URING_OP_COPY           3   // Копирование в поверхности: поверхность, XY источника, XY назначения, WH
+#define URING_OP_DAMAGE         4   // Вывод на экран: поверхность, XY, WH
+#define URING_OP_MAX            5
+
+// Упаковка пары координат или размеров в один аргумент
+#define URING_XY(x, y)          ((uint32_t)(x) | ((uint32_t)(y) << 16))
+#define URING_LOW(v)            ((uint16_t)((v) & 0xFFFF))
+#define URING_HIGH(v)           ((uint16_t)((v) >> 16))
+
+// Элемент SQ (32 байта)
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t user_data;         // Возвращается в CQ без изменений
+    uint32_t args[6];
+} uring_sqe_t;
+
+// Элемент CQ (8 байт)
+typedef struct {
+    uint32_t user_data;
+    int32_t result;             // Как у системного вызова: -1 - ошибка
+} uring_cqe_t;
+
+// Общая страница
+typedef struct {
+    volatile uint32_t sq_head;  // Пишет ядро
+    volatile uint32_t sq_tail;  // Пишет процесс
+    volatile uint32_t cq_head;  // Пишет процесс
+    volatile uint32_t cq_tail;  // Пишет ядро
+    volatile uint32_t flags;    // URING_NEED_WAKEUP
+    uint32_t reserved[11];
+    uring_sqe_t sq[URING_ENTRIES];
+    uring_cqe_t cq[URING_ENTRIES];
+} uring_shared_t;
+
+struct proc;
+
+// Функции
+void uring_init(void);
+int32_t uring_setup(uint32_t flags);
+int32_t uring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+uring_shared_t* uring_shared(void);
+void uring_release(struct proc* owner);
+
+#endif // URING_H
@@ -0,0 +1,40 @@
+/**
+ * include/vmm.h - Страничная адресация и адресные пространства
+ */
+
+#ifndef VMM_H
+#define VMM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pmm.h"
+
+// Область процесса: свои таблицы страниц у каждого каталога.
+// Остальные 3 ГБ - общее для всех тождественное отображение ядра
+// (ОЗУ, буфер кадра, LAPIC, IOAPIC, HPET) страницами по 4 МБ.
+#define VMM_USER_BASE       0x40000000
+#define VMM_USER_END        0x80000000
+
+// Вершина стека процесса
+#define VMM_USER_STACK_TOP  VMM_USER_END
+
+// Биты элементов каталога и таблиц
+#define VMM_PRESENT         (1 << 0)
+#define VMM_WRITABLE        (1 << 1)
+#define VMM_USER            (1 << 2)
+#define VMM_LARGE           (1 << 7)    // Страница 4 МБ (элемент каталога)
+#define VMM_SHARED          (1 << 9)    // Чужая страница: не освобождать
+
+// Функции
+bool vmm_init(void);
+void vmm_init_cpu(void);
+bool vmm_is_enabled(void);
+uint32_t vmm_create(bool kernel_user);
+void vmm_destroy(uint32_t directory);
+void vmm_switch(uint32_t directory);
+bool vmm_map(uint32_t directory, uint32_t virt, uint32_t phys, uint32_t flags);
+uint32_t vmm_unmap(uint32_t directory, uint32_t virt);
+uint32_t vmm_translate(uint32_t directory, uint32_t virt, uint32_t* flags);
+bool vmm_check_user(uint32_t directory, uint32_t addr, uint32_t length, bool write);
+
+#endif // VMM_H
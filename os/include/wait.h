@@ -0,0 +1,85 @@
+/**
+ * include/wait.h - Очереди ожидания
+ */
+
+#ifndef WAIT_H
+#define WAIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cpu.h"
+#include "spinlock.h"
+#include "sched.h"
+
+// Запись ожидающего (живет на его стеке, пока он ждет)
+typedef struct wait_entry {
+    thread_t* thread;
+    struct wait_entry* next;
+    bool queued;
+} wait_entry_t;
+
+// Очередь ожидания: потоки, ждущие одного условия
+typedef struct {
+    spinlock_t lock;
+    wait_entry_t* head;
+    wait_entry_t* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT { SPINLOCK_INIT, NULL, NULL }
+
+// Функции
+void wait_queue_init(wait_queue_t* wq);
+void wait_prepare(wait_queue_t* wq, wait_entry_t* entry);
+void wait_finish(wait_queue_t* wq, wait_entry_t* entry);
+void wait_sleep(void);
+bool wait_sleep_until(uint64_t deadline_ns);
+uint64_t wait_deadline(uint32_t ms);
+void wake_up(wait_queue_t* wq);
+void wake_up_all(wait_queue_t* wq);
+bool wait_queue_active(wait_queue_t* wq);
+
+/**
+ * Ожидание условия
+ * Поток встает в очередь до проверки условия, поэтому wake_up(),
+ * пришедший между проверкой и сном, не теряется. Условие проверяется
+ * при запрещенных прерываниях и должно быть коротким. Без планировщика
+ * (или в потоке простоя) процессор простаивает до прерывания.
+ * @param wq Очередь (wait_queue_t*)
+ * @param cond Условие; вычисляется заново после каждого пробуждения
+ */
+#define wait_event(wq, cond) do { \
+    wait_entry_t __wait = { NULL, NULL, false }; \
+    uint32_t __flags = cpu_irq_save(); \
+    for (;;) { \
+        wait_prepare((wq), &__wait); \
+        if (cond) break; \
+        wait_sleep(); \
+    } \
+    wait_finish((wq), &__wait); \
+    cpu_irq_restore(__flags); \
+} while (0)
+
+/**
+ * Ожидание условия не дольше ms миллисекунд
+ * Срок отмеряет однократный таймер, который будит поток.
+ * @return true, если условие выполнено; false - истек срок
+ */
+#define wait_event_timeout(wq, cond, ms) ({ \
+    wait_entry_t __wait = { NULL, NULL, false }; \
+    uint64_t __deadline = wait_deadline(ms); \
+    uint32_t __flags = cpu_irq_save(); \
+    bool __done; \
+    for (;;) { \
+        wait_prepare((wq), &__wait); \
+        if ((__done = (cond))) break; \
+        if (!wait_sleep_until(__deadline)) { \
+            __done = (cond); \
+            break; \
+        } \
+    } \
+    wait_finish((wq), &__wait); \
+    cpu_irq_restore(__flags); \
+    __done; \
+})
+
+#endif // WAIT_H
@@ -0,0 +1,172 @@
+/**
+ * kernel/acpi.c - Поиск таблиц ACPI
+ *
+ * RSDP ищется в EBDA и в области BIOS 0xE0000-0xFFFFF, затем
+ * таблицы перебираются по RSDT (или XSDT, если она доступна).
+ * Память пока отображена один к одному, поэтому физические адреса
+ * таблиц используются напрямую.
+ */
+
+#include "acpi.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Области поиска RSDP
+#define ACPI_EBDA_PTR        0x40E
+#define ACPI_BIOS_START      0xE0000
+#define ACPI_BIOS_END        0x100000
+
+// Указатель на корневую таблицу
+typedef struct {
+    char signature[8];          // "RSD PTR "
+    uint8_t checksum;
+    char oem_id[6];
+    uint8_t revision;           // 0 - ACPI 1.0, 2 - ACPI 2.0+
+    uint32_t rsdt_address;
+    // Поля ACPI 2.0+
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t extended_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed)) acpi_rsdp_t;
+
+// Корневая таблица
+static const acpi_sdt_header_t* acpi_root = NULL;
+static bool acpi_root_is_xsdt = false;
+
+/**
+ * Проверка контрольной суммы (сумма байтов равна нулю)
+ * @param data Данные
+ * @param length Длина в байтах
+ * @return true, если сумма верна
+ */
+static bool acpi_checksum(const void* data, uint32_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint8_t sum = 0;
+    
+    for (uint32_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    
+    return sum == 0;
+}
+
+/**
+ * Поиск RSDP в диапазоне памяти (сигнатура выровнена на 16 байт)
+ * @param start Начало диапазона
+ * @param end Конец диапазона
+ * @return Найденный RSDP или NULL
+ */
+static const acpi_rsdp_t* acpi_scan_rsdp(uint32_t start, uint32_t end) {
+    for (uint32_t addr = start; addr + sizeof(acpi_rsdp_t) <= end; addr += 16) {
+        const acpi_rsdp_t* rsdp = (const acpi_rsdp_t*)addr;
+        
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && acpi_checksum(rsdp, 20)) {
+            return rsdp;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Поиск корневой таблицы ACPI
+ * @return true, если RSDT или XSDT найдена
+ */
+bool acpi_init(void) {
+    uint32_t ebda = (uint32_t)(*(const uint16_t*)ACPI_EBDA_PTR) << 4;
+    
+    const acpi_rsdp_t* rsdp = NULL;
+    if (ebda != 0) {
+        rsdp = acpi_scan_rsdp(ebda, ebda + 1024);
+    }
+    if (rsdp == NULL) {
+        rsdp = acpi_scan_rsdp(ACPI_BIOS_START, ACPI_BIOS_END);
+    }
+    
+    if (rsdp == NULL) {
+        #ifdef DEBUG
+        terminal_printf("ACPI: RSDP not found\n");
+        #endif
+        return false;
+    }
+    
+    // XSDT используем, только если она в пределах 32-битного пространства
+    if (rsdp->revision >= 2 && rsdp->xsdt_address != 0 &&
+        rsdp->xsdt_address < 0x100000000ull && acpi_checksum(rsdp, rsdp->length)) {
+        acpi_root = (const acpi_sdt_header_t*)(uint32_t)rsdp->xsdt_address;
+        acpi_root_is_xsdt = true;
+    } else {
+        acpi_root = (const acpi_sdt_header_t*)rsdp->rsdt_address;
+        acpi_root_is_xsdt = false;
+    }
+    
+    if (!acpi_checksum(acpi_root, acpi_root->length)) {
+        acpi_root = NULL;
+        return false;
+    }
+    
+    #ifdef DEBUG
+    terminal_printf("ACPI: %s at %x\n", acpi_root_is_xsdt ? "XSDT" : "RSDT", (uint32_t)acpi_root);
+    #endif
+    
+    return true;
+}
+
+/**
+ * Поиск таблицы по сигнатуре
+ * @param signature Четырехбуквенная сигнатура ("HPET", "APIC", ...)
+ * @return Таблица с верной контрольной суммой или NULL
+ */
+const acpi_sdt_header_t* acpi_find_table(const char* signature) {
+    if (acpi_root == NULL) return NULL;
+    
+    uint32_t entry_size = acpi_root_is_xsdt ? 8 : 4;
+    uint32_t count = (acpi_root->length - sizeof(acpi_sdt_header_t)) / entry_size;
+    const uint8_t* entries = (const uint8_t*)acpi_root + sizeof(acpi_sdt_header_t);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t addr;
+        if (acpi_root_is_xsdt) {
+            addr = *(const uint64_t*)(entries + i * 8);
+        } else {
+            addr = *(const uint32_t*)(entries + i * 4);
+        }
+        
+        if (addr == 0 || addr >= 0x100000000ull) continue;
+        
+        const acpi_sdt_header_t* table = (const acpi_sdt_header_t*)(uint32_t)addr;
+        if (memcmp(table->signature, signature, 4) == 0 &&
+            acpi_checksum(table, table->length)) {
+            return table;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Перебор записей MADT
+ * @param madt Таблица MADT
+ * @param entry Текущая запись (NULL - начать с первой)
+ * @return Следующая запись или NULL в конце таблицы
+ */
+const acpi_madt_entry_t* acpi_madt_next(const acpi_madt_t* madt, const acpi_madt_entry_t* entry) {
+    const uint8_t* end = (const uint8_t*)madt + madt->header.length;
+    const uint8_t* next;
+    
+    if (entry == NULL) {
+        next = (const uint8_t*)madt + sizeof(acpi_madt_t);
+    } else {
+        next = (const uint8_t*)entry + entry->length;
+    }
+    
+    // Запись должна целиком помещаться в таблицу
+    if (next + sizeof(acpi_madt_entry_t) > end) return NULL;
+    
+    const acpi_madt_entry_t* result = (const acpi_madt_entry_t*)next;
+    if (result->length < sizeof(acpi_madt_entry_t) || next + result->length > end) return NULL;
+    
+    return result;
+}
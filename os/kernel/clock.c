@@ -0,0 +1,271 @@
+/**
+ * kernel/clock.c - Монотонные часы высокого разрешения
+ *
+ * Часы читают лучший из зарегистрированных источников времени
+ * (clocksource) по рейтингу: инвариантный TSC, HPET, обычный TSC.
+ * При загрузке частота TSC измеряется по каналу 2 PIT. Перевод
+ * показаний в наносекунды и обратно выполняется умножением и сдвигом
+ * (mult/shift), поэтому чтение часов - это чтение счетчика и пара
+ * умножений, без делений, блокировок и ввода-вывода через порты.
+ * Смену источника читатели замечают по seqlock и повторяют чтение.
+ */
+
+#include "clock.h"
+#include "timer.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "terminal.h"
+#include <stddef.h>
+
+// Длительность одного замера и количество замеров калибровки
+#define CLOCK_CALIBRATE_US    10000
+#define CLOCK_CALIBRATE_RUNS  3
+
+// Бит инвариантного TSC (CPUID 0x80000007, EDX)
+#define CPUID_EDX_INVARIANT_TSC (1 << 8)
+
+// Рейтинги TSC: инвариантный TSC лучше любого другого источника,
+// обычный может менять частоту и уступает HPET
+#define CLOCK_RATING_TSC_INVARIANT 300
+#define CLOCK_RATING_TSC           100
+
+// Текущий источник и коэффициенты (записываются при смене источника)
+static const clocksource_t* clock_source = NULL;
+static clock_scale_t cyc2ns;
+static clock_scale_t ns2cyc;
+static uint64_t clock_base_cycles = 0;  // Показание источника в момент смены
+static uint64_t clock_base_ns = 0;      // Время в момент смены
+static lockstat_t clock_stat = LOCKSTAT_INIT("clock");
+static seqlock_t clock_lock = SEQLOCK_INIT_STAT(&clock_stat);
+
+// TSC как источник (частота заполняется при калибровке)
+static bool clock_invariant = false;
+
+/**
+ * Чтение TSC
+ */
+static uint64_t clock_tsc_read(void) {
+    return cpu_rdtsc();
+}
+
+static clocksource_t tsc_clocksource = {
+    .name = "tsc",
+    .rating = 0,
+    .read = clock_tsc_read,
+    .ns_num = (uint32_t)NSEC_PER_MSEC,
+    .ns_den = 0,
+};
+
+/**
+ * Подбор коэффициентов для умножения на num/den
+ * Выбирается наибольший сдвиг (не больше 32), при котором
+ * множитель помещается в 32 бита.
+ * @param scale Результат
+ * @param num Числитель
+ * @param den Знаменатель
+ */
+void clock_scale_init(clock_scale_t* scale, uint32_t num, uint32_t den) {
+    uint32_t shift = 32;
+    uint64_t mult;
+    
+    while ((mult = ((uint64_t)num << shift) / den) > 0xFFFFFFFFull && shift > 0) {
+        shift--;
+    }
+    
+    scale->mult = (uint32_t)mult;
+    scale->shift = shift;
+}
+
+/**
+ * Чтение времени без seqlock (под блокировкой записи или внутри цикла чтения)
+ */
+static uint64_t clock_read_ns(void) {
+    const clocksource_t* cs = clock_source;
+    if (cs == NULL) {
+        return (uint64_t)timer_get_ticks() * (NSEC_PER_SEC / TIMER_FREQUENCY);
+    }
+    
+    return clock_base_ns + clock_scale(cs->read() - clock_base_cycles, &cyc2ns);
+}
+
+/**
+ * Регистрация источника времени
+ * Источник с более высоким рейтингом заменяет текущий; показания
+ * clock_ns() при смене продолжаются без скачка.
+ * @param cs Источник
+ * @return true, если источник стал текущим
+ */
+bool clock_register_source(const clocksource_t* cs) {
+    if (cs == NULL || cs->read == NULL || cs->ns_num == 0 || cs->ns_den == 0) return false;
+    if (clock_source != NULL && clock_source->rating >= cs->rating) return false;
+    
+    uint32_t flags = write_seqlock_irqsave(&clock_lock);
+    
+    uint64_t now = clock_read_ns();
+    
+    clock_scale_init(&cyc2ns, cs->ns_num, cs->ns_den);
+    clock_scale_init(&ns2cyc, cs->ns_den, cs->ns_num);
+    clock_base_cycles = cs->read();
+    clock_base_ns = now;
+    clock_source = cs;
+    
+    write_sequnlock_irqrestore(&clock_lock, flags);
+    
+    #ifdef DEBUG
+    terminal_printf("Clock: source %s (rating %d)\n", cs->name, cs->rating);
+    #endif
+    
+    return true;
+}
+
+/**
+ * Один замер частоты TSC
+ * @return Количество циклов за CLOCK_CALIBRATE_US
+ */
+static uint64_t clock_measure(void) {
+    uint32_t flags = cpu_irq_save();
+    
+    uint64_t start = cpu_rdtsc();
+    timer_pit_wait_us(CLOCK_CALIBRATE_US);
+    uint64_t end = cpu_rdtsc();
+    
+    cpu_irq_restore(flags);
+    
+    return end - start;
+}
+
+/**
+ * Калибровка TSC по каналу 2 PIT
+ * Берется наименьший замер: задержки (SMI, эмуляция) только
+ * удлиняют интервал.
+ */
+void clock_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_TSC)) {
+        #ifdef DEBUG
+        terminal_printf("Clock: no TSC, using timer ticks\n");
+        #endif
+        return;
+    }
+    
+    cpu_cpuid(0x80000000, &eax, &ebx, &ecx, &edx);
+    if (eax >= 0x80000007) {
+        cpu_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        clock_invariant = (edx & CPUID_EDX_INVARIANT_TSC) != 0;
+    }
+    
+    uint64_t best = 0;
+    for (int i = 0; i < CLOCK_CALIBRATE_RUNS; i++) {
+        uint64_t cycles = clock_measure();
+        if (best == 0 || cycles < best) {
+            best = cycles;
+        }
+    }
+    
+    uint32_t khz = (uint32_t)(best / (CLOCK_CALIBRATE_US / 1000));
+    if (khz == 0) return;
+    
+    tsc_clocksource.ns_den = khz;
+    tsc_clocksource.rating = clock_invariant ? CLOCK_RATING_TSC_INVARIANT : CLOCK_RATING_TSC;
+    
+    #ifdef DEBUG
+    terminal_printf("Clock: TSC %d kHz%s\n", khz, clock_invariant ? " (invariant)" : "");
+    #endif
+    
+    clock_register_source(&tsc_clocksource);
+}
+
+/**
+ * Проверка, является ли текущим источником TSC
+ */
+bool clock_is_tsc(void) {
+    return clock_source == &tsc_clocksource;
+}
+
+/**
+ * Проверка, есть ли источник высокого разрешения (иначе - тики)
+ */
+bool clock_is_highres(void) {
+    return clock_source != NULL;
+}
+
+/**
+ * Имя текущего источника времени
+ */
+const char* clock_get_source_name(void) {
+    return clock_source != NULL ? clock_source->name : "ticks";
+}
+
+/**
+ * Проверка, идет ли TSC с постоянной частотой во всех состояниях
+ */
+bool clock_is_invariant(void) {
+    return clock_invariant;
+}
+
+/**
+ * Частота TSC в кГц
+ * @return Частота или 0, если TSC не откалиброван
+ */
+uint32_t clock_get_tsc_khz(void) {
+    return tsc_clocksource.ns_den;
+}
+
+/**
+ * Текущее показание источника времени
+ * Без источника возвращает наносекунды по тикам таймера.
+ */
+uint64_t clock_cycles(void) {
+    const clocksource_t* cs = clock_source;
+    if (cs == NULL) {
+        return (uint64_t)timer_get_ticks() * (NSEC_PER_SEC / TIMER_FREQUENCY);
+    }
+    
+    return cs->read();
+}
+
+/**
+ * Монотонное время в наносекундах
+ */
+uint64_t clock_ns(void) {
+    uint64_t ns;
+    uint32_t seq;
+    
+    do {
+        seq = read_seqbegin(&clock_lock);
+        ns = clock_read_ns();
+    } while (read_seqretry(&clock_lock, seq));
+    
+    return ns;
+}
+
+/**
+ * Перевод показаний источника (интервала) в наносекунды
+ */
+uint64_t clock_cycles_to_ns(uint64_t cycles) {
+    uint64_t ns;
+    uint32_t seq;
+    
+    do {
+        seq = read_seqbegin(&clock_lock);
+        ns = clock_source != NULL ? clock_scale(cycles, &cyc2ns) : cycles;
+    } while (read_seqretry(&clock_lock, seq));
+    
+    return ns;
+}
+
+/**
+ * Перевод наносекунд в показания источника
+ */
+uint64_t clock_ns_to_cycles(uint64_t ns) {
+    uint64_t cycles;
+    uint32_t seq;
+    
+    do {
+        seq = read_seqbegin(&clock_lock);
+        cycles = clock_source != NULL ? clock_scale(ns, &ns2cyc) : ns;
+    } while (read_seqretry(&clock_lock, seq));
+    
+    return cycles;
+}
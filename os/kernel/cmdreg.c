@@ -0,0 +1,244 @@
+/**
+ * kernel/cmdreg.c - Реестр команд терминала
+ *
+ * Подсистемы регистрируют свои команды при инициализации.
+ * Поиск по имени - хеш-таблица с открытой адресацией (FNV-1a,
+ * линейное пробирование), автодополнение - префиксное дерево,
+ * которое отвечает за O(длина строки).
+ */
+
+#include "cmdreg.h"
+#include <stddef.h>
+#include <string.h>
+
+// Зарегистрированные команды (в порядке регистрации)
+static command_t commands[CMDREG_MAX_COMMANDS];
+static int command_count = 0;
+
+// Хеш-таблица: индекс команды + 1 (0 - пустая ячейка)
+static uint8_t hash_table[CMDREG_HASH_SIZE];
+
+// Узел префиксного дерева
+typedef struct {
+    uint16_t child[CMDREG_ALPHABET]; // Индексы дочерних узлов (0 - нет)
+    uint8_t child_count;             // Количество дочерних узлов
+    uint8_t last_symbol;             // Символ последнего добавленного потомка
+    uint8_t command;                 // Команда, заканчивающаяся здесь (индекс + 1)
+    uint8_t subtree_count;           // Количество команд в поддереве
+} trie_node_t;
+
+// Узел 0 - корень, поэтому индекс 0 в child означает "нет потомка"
+static trie_node_t trie[CMDREG_TRIE_NODES];
+static int trie_node_count = 1;
+
+/**
+ * Хеш FNV-1a для имени команды
+ * @param name Имя команды
+ * @return Значение хеша
+ */
+static uint32_t cmdreg_hash(const char* name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Преобразование символа в индекс алфавита дерева
+ * @param c Символ
+ * @return Индекс или -1, если символ не допускается в имени
+ */
+static int cmdreg_symbol(char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + (c - '0');
+    if (c == '-') return 36;
+    if (c == '_') return 37;
+    return -1;
+}
+
+/**
+ * Обратное преобразование индекса алфавита в символ
+ */
+static char cmdreg_symbol_char(int symbol) {
+    if (symbol < 26) return 'a' + symbol;
+    if (symbol < 36) return '0' + (symbol - 26);
+    return symbol == 36 ? '-' : '_';
+}
+
+/**
+ * Поиск слота хеш-таблицы для имени
+ * @param name Имя команды
+ * @return Номер слота (занятого этим именем или первого пустого)
+ */
+static uint32_t cmdreg_find_slot(const char* name) {
+    uint32_t slot = cmdreg_hash(name) & (CMDREG_HASH_SIZE - 1);
+
+    // Таблица заполнена не более чем наполовину, поэтому пустой слот всегда найдется
+    while (hash_table[slot] != 0) {
+        if (strcmp(commands[hash_table[slot] - 1].name, name) == 0) {
+            break;
+        }
+        slot = (slot + 1) & (CMDREG_HASH_SIZE - 1);
+    }
+
+    return slot;
+}
+
+/**
+ * Добавление имени в префиксное дерево
+ * @param name Имя команды (уже проверенное)
+ * @param index Индекс команды
+ * @return 0 при успехе, -1 если закончились узлы
+ */
+static int cmdreg_trie_insert(const char* name, int index) {
+    // Сначала проверяем, хватит ли узлов, чтобы не оставить дерево наполовину построенным
+    int node = 0;
+    const char* p = name;
+    while (*p && trie[node].child[cmdreg_symbol(*p)] != 0) {
+        node = trie[node].child[cmdreg_symbol(*p)];
+        p++;
+    }
+
+    if (trie_node_count + (int)strlen(p) > CMDREG_TRIE_NODES) {
+        return -1;
+    }
+
+    node = 0;
+    trie[node].subtree_count++;
+
+    for (p = name; *p; p++) {
+        int symbol = cmdreg_symbol(*p);
+
+        if (trie[node].child[symbol] == 0) {
+            trie[node].child[symbol] = trie_node_count++;
+            trie[node].child_count++;
+            trie[node].last_symbol = symbol;
+        }
+
+        node = trie[node].child[symbol];
+        trie[node].subtree_count++;
+    }
+
+    trie[node].command = index + 1;
+    return 0;
+}
+
+/**
+ * Регистрация команды
+ * @param name Имя команды (a-z, 0-9, '-', '_'; строка должна жить вечно)
+ * @param description Краткое описание для help
+ * @param execute Функция-обработчик
+ * @return 0 при успехе, -1 при ошибке
+ */
+int cmdreg_register(const char* name, const char* description, command_func_t execute) {
+    if (name == NULL || name[0] == '\0' || execute == NULL) return -1;
+    if (command_count >= CMDREG_MAX_COMMANDS) return -1;
+
+    // Проверяем допустимость символов имени
+    for (const char* p = name; *p; p++) {
+        if (cmdreg_symbol(*p) < 0) return -1;
+    }
+
+    // Повторная регистрация запрещена
+    uint32_t slot = cmdreg_find_slot(name);
+    if (hash_table[slot] != 0) return -1;
+
+    if (cmdreg_trie_insert(name, command_count) != 0) return -1;
+
+    commands[command_count].name = name;
+    commands[command_count].description = description != NULL ? description : "";
+    commands[command_count].execute = execute;
+    command_count++;
+
+    hash_table[slot] = command_count;
+    return 0;
+}
+
+/**
+ * Поиск команды по имени
+ * @param name Имя команды
+ * @return Указатель на структуру команды или NULL
+ */
+const command_t* cmdreg_lookup(const char* name) {
+    if (name == NULL) return NULL;
+
+    uint32_t slot = cmdreg_find_slot(name);
+    if (hash_table[slot] == 0) return NULL;
+
+    return &commands[hash_table[slot] - 1];
+}
+
+/**
+ * Выполнение команды по разобранной строке
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов (argv[0] - имя команды)
+ * @return true, если команда найдена и выполнена
+ */
+bool cmdreg_execute(int argc, char** argv) {
+    if (argc <= 0) return false;
+
+    const command_t* cmd = cmdreg_lookup(argv[0]);
+    if (cmd == NULL) return false;
+
+    cmd->execute(argc, argv);
+    return true;
+}
+
+/**
+ * Автодополнение имени команды
+ * Проходит по дереву вдоль префикса и продлевает его, пока путь однозначен.
+ * @param prefix Введенный префикс
+ * @param out Буфер для дополненной строки
+ * @param size Размер буфера
+ * @return Количество команд, начинающихся с префикса
+ */
+int cmdreg_complete(const char* prefix, char* out, int size) {
+    if (prefix == NULL || out == NULL || size <= 0) return 0;
+
+    int node = 0;
+    int len = 0;
+
+    for (const char* p = prefix; *p; p++) {
+        int symbol = cmdreg_symbol(*p);
+        if (symbol < 0 || trie[node].child[symbol] == 0) {
+            out[0] = '\0';
+            return 0;
+        }
+        node = trie[node].child[symbol];
+
+        if (len < size - 1) {
+            out[len++] = *p;
+        }
+    }
+
+    int matches = trie[node].subtree_count;
+
+    // Продлеваем префикс, пока у узла ровно один потомок и здесь не кончается другая команда
+    while (trie[node].command == 0 && trie[node].child_count == 1 && len < size - 1) {
+        int symbol = trie[node].last_symbol;
+        out[len++] = cmdreg_symbol_char(symbol);
+        node = trie[node].child[symbol];
+    }
+
+    out[len] = '\0';
+    return matches;
+}
+
+/**
+ * Количество зарегистрированных команд
+ */
+int cmdreg_count(void) {
+    return command_count;
+}
+
+/**
+ * Получение команды по порядковому номеру регистрации
+ * @param index Номер команды
+ * @return Указатель на структуру команды или NULL
+ */
+const command_t* cmdreg_get(int index) {
+    if (index < 0 || index >= command_count) return NULL;
+    return &commands[index];
+}
@@ -3,20 +3,18 @@
  */
 
 #include "commands.h"
+#include "cmdreg.h"
 #include "terminal.h"
 #include "framebuffer.h"
 #include "timer.h"
+#include "clock.h"
+#include "coro.h"
+#include "pmm.h"
+#include "vmm.h"
 #include "gui.h"
 #include "mouse.h"
 #include <string.h>
 
-// Структура для хранения информации о команде
-typedef struct {
-    const char* name;
-    const char* description;
-    void (*execute)(int argc, char** argv);
-} command_t;
-
 // Прототипы функций команд
 static void cmd_help(int argc, char** argv);
 static void cmd_echo(int argc, char** argv);
@@ -61,6 +59,17 @@ static uint32_t terminal_text_color = 0xFFFFFF;
 void commands_init(void) {
     if (commands_initialized) return;
     
+    // Регистрируем встроенные команды в общем реестре
+    for (int i = 0; builtin_commands[i].name != NULL; i++) {
+        if (cmdreg_register(builtin_commands[i].name,
+                            builtin_commands[i].description,
+                            builtin_commands[i].execute) != 0) {
+            #ifdef DEBUG
+            terminal_printf("Failed to register command: %s\n", builtin_commands[i].name);
+            #endif
+        }
+    }
+    
     commands_initialized = true;
     
     #ifdef DEBUG
@@ -95,15 +104,7 @@ void execute_about(int argc, char** argv) {
  * @return Указатель на структуру команды или NULL
  */
 static const command_t* find_command(const char* name) {
-    if (name == NULL) return NULL;
-    
-    for (int i = 0; builtin_commands[i].name != NULL; i++) {
-        if (strcmp(builtin_commands[i].name, name) == 0) {
-            return &builtin_commands[i];
-        }
-    }
-    
-    return NULL;
+    return cmdreg_lookup(name);
 }
 
 /**
@@ -132,9 +133,10 @@ void get_command_list(char* buffer, int size) {
     
     int pos = 0;
     
-    for (int i = 0; builtin_commands[i].name != NULL; i++) {
+    for (int i = 0; i < cmdreg_count(); i++) {
+        const command_t* cmd = cmdreg_get(i);
         int len = snprintf(buffer + pos, size - pos, "  %-10s - %s\n", 
-                          builtin_commands[i].name, builtin_commands[i].description);
+                          cmd->name, cmd->description);
         pos += len;
         
         if (pos >= size - 1) break;
@@ -147,20 +149,39 @@ void get_command_list(char* buffer, int size) {
     }
 }
 
+/**
+ * Строка справки: имя, дополненное пробелами до 10 символов, и описание
+ * (terminal_printf не поддерживает ширину поля)
+ */
+static void print_help_line(const command_t* cmd) {
+    terminal_printf("  %s", cmd->name);
+    for (int len = strlen(cmd->name); len < 10; len++) {
+        terminal_putchar(' ');
+    }
+    terminal_printf(" - %s\n", cmd->description);
+}
+
 /**
  * Команда: help - вывод списка команд
  */
 static void cmd_help(int argc, char** argv) {
-    (void)argc; // Не используется
-    (void)argv; // Не используется
+    // help <command> - описание одной команды
+    if (argc >= 2) {
+        const command_t* cmd = find_command(argv[1]);
+        if (cmd == NULL) {
+            terminal_printf("Unknown command: %s\n", argv[1]);
+        } else {
+            print_help_line(cmd);
+        }
+        return;
+    }
     
     terminal_print_line("Available commands:");
     terminal_print_line("");
     
-    for (int i = 0; builtin_commands[i].name != NULL; i++) {
-        terminal_printf("  %-10s - %s\n", 
-                       builtin_commands[i].name, 
-                       builtin_commands[i].description);
+    for (int i = 0; i < cmdreg_count(); i++) {
+        const command_t* cmd = cmdreg_get(i);
+        print_help_line(cmd);
     }
     
     terminal_print_line("");
@@ -273,6 +294,15 @@ static void cmd_time(int argc, char** argv) {
     terminal_printf("Current time: %s\n", time_str);
     terminal_printf("System uptime: %d seconds\n", timer_get_seconds());
     terminal_printf("Timer ticks: %d\n", timer_get_ticks());
+    terminal_printf("Clock event: %s, %d interrupts\n",
+                    timer_get_clockevent_name(), timer_get_event_count());
+    
+    terminal_printf("Clock: %s, %d ms monotonic\n",
+                    clock_get_source_name(), (uint32_t)(clock_ns() / NSEC_PER_MSEC));
+    if (clock_get_tsc_khz() != 0) {
+        terminal_printf("TSC: %d kHz%s\n",
+                        clock_get_tsc_khz(), clock_is_invariant() ? " (invariant)" : "");
+    }
 }
 
 /**
@@ -288,16 +318,12 @@ static void cmd_date(int argc, char** argv) {
 }
 
 /**
- * Команда: reboot - перезагрузка системы
+ * Перезагрузка после паузы для отображения сообщения (сопрограмма)
  */
-static void cmd_reboot(int argc, char** argv) {
-    (void)argc; // Не используется
-    (void)argv; // Не используется
-    
-    terminal_print_line("Rebooting system...");
+static int reboot_coro(coro_t* co) {
+    CORO_BEGIN(co);
     
-    // Задержка для отображения сообщения
-    timer_sleep(1000);
+    CORO_SLEEP(co, 1000);
     
     // Перезагрузка через клавиатурный контроллер
     outb(0x64, 0xFE);
@@ -307,6 +333,23 @@ static void cmd_reboot(int argc, char** argv) {
     while (1) {
         asm volatile("hlt");
     }
+    
+    CORO_END(co);
+}
+
+/**
+ * Команда: reboot - перезагрузка системы
+ * Пауза отсчитывается в сопрограмме, терминал не блокируется.
+ */
+static void cmd_reboot(int argc, char** argv) {
+    (void)argc; // Не используется
+    (void)argv; // Не используется
+    
+    terminal_print_line("Rebooting system...");
+    
+    if (coro_spawn("reboot", reboot_coro, NULL) == NULL) {
+        outb(0x64, 0xFE);
+    }
 }
 
 /**
@@ -372,8 +415,8 @@ static void cmd_mouse(int argc, char** argv) {
     (void)argc; // Не используется
     (void)argv; // Не используется
     
-    int mouse_x = mouse_get_x();
-    int mouse_y = mouse_get_y();
+    int mouse_x, mouse_y;
+    mouse_get_position(&mouse_x, &mouse_y);
     int mouse_z = mouse_get_z();
     
     terminal_printf("Mouse position: X=%d, Y=%d, Z=%d\n", mouse_x, mouse_y, mouse_z);
@@ -488,12 +531,19 @@ static void cmd_mem(int argc, char** argv) {
     (void)argc; // Не используется
     (void)argv; // Не используется
     
+    uint32_t total = pmm_total_pages();
+    if (total == 0) {
+        terminal_print_line("No memory map from the bootloader");
+        return;
+    }
+    
+    uint32_t free = pmm_free_pages();
+    
     terminal_print_line("Memory Information:");
-    terminal_print_line("  Total: 64 MB (simulated)");
-    terminal_print_line("  Used: ~4 MB");
-    terminal_print_line("  Free: ~60 MB");
-    terminal_print_line("");
-    terminal_print_line("Memory map not implemented");
+    terminal_printf("  Total: %d KB\n", total * (PAGE_SIZE / 1024));
+    terminal_printf("  Used: %d KB\n", (total - free) * (PAGE_SIZE / 1024));
+    terminal_printf("  Free: %d KB\n", free * (PAGE_SIZE / 1024));
+    terminal_printf("  Paging: %s\n", vmm_is_enabled() ? "enabled" : "disabled");
 }
 
 /**
@@ -0,0 +1,330 @@
+/**
+ * kernel/coro.c - Исполнитель бесстековых сопрограмм
+ *
+ * Готовые сопрограммы стоят в очереди; поток "coro" на BSP спит на
+ * очереди ожидания, пока она пуста, и по очереди продолжает их на
+ * своем стеке. Сопрограмма, начавшая ожидание, не занимает ничего,
+ * кроме записи пула: ее будит источник события (таймер, прерывание,
+ * завершение команды PS/2) через coro_wake().
+ *
+ * Пробуждение может прийти из прерывания раньше, чем сопрограмма
+ * вернется в исполнитель, - тогда она просто уже стоит в очереди.
+ */
+
+#include "coro.h"
+#include "irq.h"
+#include "sched.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "wait.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Период проверки условия CORO_WAIT_UNTIL
+#define CORO_POLL_MS 10
+
+static coro_t coro_pool[CORO_MAX];
+static uint32_t coro_next_id = 0;
+
+// Очередь готовых и сопрограммы, ждущие прерываний
+SPINLOCK_DEFINE(coro_lock, "coro");
+static coro_t* coro_ready_head = NULL;
+static coro_t* coro_ready_tail = NULL;
+static coro_t* coro_irq_waiters[IRQ_LINES];
+static volatile uint32_t coro_irq_mask = 0;
+
+// Исполнитель спит здесь, пока готовых нет
+static wait_queue_t coro_wait = WAIT_QUEUE_INIT;
+
+static const char* coro_state_names[] = {
+    "free", "ready", "running", "waiting"
+};
+
+/**
+ * Постановка в очередь готовых (под coro_lock)
+ */
+static void coro_enqueue(coro_t* co) {
+    co->state = CORO_READY;
+    co->next = NULL;
+    
+    if (coro_ready_tail != NULL) {
+        coro_ready_tail->next = co;
+    } else {
+        coro_ready_head = co;
+    }
+    coro_ready_tail = co;
+}
+
+/**
+ * Создание сопрограммы
+ * Первый шаг выполнит исполнитель. Можно вызывать до его запуска.
+ * @param name Имя для команды coros
+ * @param func Тело сопрограммы
+ * @param data Состояние, переживающее ожидания
+ * @return Сопрограмма или NULL, если пул исчерпан
+ */
+coro_t* coro_spawn(const char* name, coro_func_t func, void* data) {
+    if (func == NULL) return NULL;
+    
+    uint32_t flags = spin_lock_irqsave(&coro_lock);
+    
+    coro_t* co = NULL;
+    for (int i = 0; i < CORO_MAX; i++) {
+        if (coro_pool[i].state == CORO_FREE) {
+            co = &coro_pool[i];
+            break;
+        }
+    }
+    
+    if (co != NULL) {
+        co->func = func;
+        co->data = data;
+        co->name = name;
+        co->id = coro_next_id++;
+        co->line = 0;
+        co->waiting = false;
+        co->irq = -1;
+        co->timer = TIMER_INVALID_HANDLE;
+        co->status = 0;
+        co->response_length = 0;
+        coro_enqueue(co);
+    }
+    
+    spin_unlock_irqrestore(&coro_lock, flags);
+    
+    if (co != NULL) wake_up(&coro_wait);
+    return co;
+}
+
+/**
+ * Возврат сопрограммы в очередь готовых (CORO_YIELD)
+ */
+void coro_ready(coro_t* co) {
+    uint32_t flags = spin_lock_irqsave(&coro_lock);
+    co->waiting = false;
+    coro_enqueue(co);
+    spin_unlock_irqrestore(&coro_lock, flags);
+    
+    wake_up(&coro_wait);
+}
+
+/**
+ * Пробуждение сопрограммы источником события
+ * Повторное пробуждение того же ожидания ничего не делает.
+ * Можно вызывать из прерываний и обратных вызовов таймеров.
+ */
+void coro_wake(coro_t* co) {
+    uint32_t flags = spin_lock_irqsave(&coro_lock);
+    
+    bool woken = co->waiting;
+    if (woken) {
+        co->waiting = false;
+        coro_enqueue(co);
+    }
+    
+    spin_unlock_irqrestore(&coro_lock, flags);
+    
+    if (woken) wake_up(&coro_wait);
+}
+
+/**
+ * Срабатывание таймера ожидания
+ */
+static void coro_timer_fire(void* data) {
+    coro_t* co = (coro_t*)data;
+    co->timer = TIMER_INVALID_HANDLE;
+    coro_wake(co);
+}
+
+/**
+ * Начало ожидания таймера (CORO_SLEEP)
+ * @param co Сопрограмма
+ * @param ms Срок в миллисекундах
+ */
+void coro_await_timer(coro_t* co, uint32_t ms) {
+    co->waiting = true;
+    co->timer = timer_register_oneshot(coro_timer_fire, co, ms);
+    
+    // Таймеров нет - продолжим сразу, чем не проснемся никогда
+    if (co->timer == TIMER_INVALID_HANDLE) {
+        coro_wake(co);
+    }
+}
+
+/**
+ * Уведомление о прерывании (из irq_handler)
+ * @param irq Линия IRQ
+ */
+static void coro_irq_notify(int irq) {
+    if (!(coro_irq_mask & (1u << irq))) return;
+    
+    uint32_t flags = spin_lock_irqsave(&coro_lock);
+    
+    coro_t* co = coro_irq_waiters[irq];
+    coro_irq_waiters[irq] = NULL;
+    coro_irq_mask &= ~(1u << irq);
+    
+    while (co != NULL) {
+        coro_t* next = co->next;
+        co->irq = -1;
+        if (co->waiting) {
+            co->waiting = false;
+            coro_enqueue(co);
+        }
+        co = next;
+    }
+    
+    spin_unlock_irqrestore(&coro_lock, flags);
+    
+    wake_up(&coro_wait);
+}
+
+/**
+ * Начало ожидания прерывания (CORO_AWAIT_IRQ)
+ * @param co Сопрограмма
+ * @param irq Линия IRQ
+ */
+void coro_await_irq(coro_t* co, int irq) {
+    if (irq < 0 || irq >= IRQ_LINES) {
+        co->waiting = true;
+        coro_wake(co);
+        return;
+    }
+    
+    irq_set_notifier(coro_irq_notify);
+    
+    uint32_t flags = spin_lock_irqsave(&coro_lock);
+    co->waiting = true;
+    co->irq = irq;
+    co->next = coro_irq_waiters[irq];
+    coro_irq_waiters[irq] = co;
+    coro_irq_mask |= 1u << irq;
+    spin_unlock_irqrestore(&coro_lock, flags);
+}
+
+/**
+ * Завершение команды PS/2 (из прерывания или таймера)
+ */
+static void coro_ps2_done(int port, ps2_status_t status,
+                          const uint8_t* response, int length, void* data) {
+    (void)port;
+    coro_t* co = (coro_t*)data;
+    
+    if (length > PS2_MAX_RESPONSE) length = PS2_MAX_RESPONSE;
+    memcpy(co->response, response, length);
+    co->response_length = length;
+    co->status = status;
+    
+    coro_wake(co);
+}
+
+/**
+ * Отправка команды PS/2 с ожиданием завершения (CORO_AWAIT_PS2)
+ * @return false, если команда не принята в очередь (co->status = PS2_ERROR)
+ */
+bool coro_await_ps2(coro_t* co, int port, uint8_t command, int arg, int response_length) {
+    co->waiting = true;
+    co->response_length = 0;
+    
+    if (!ps2_send(port, command, arg, response_length, coro_ps2_done, co)) {
+        co->waiting = false;
+        co->status = PS2_ERROR;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Повторная проверка условия CORO_WAIT_UNTIL через CORO_POLL_MS
+ */
+void coro_poll(coro_t* co) {
+    coro_await_timer(co, CORO_POLL_MS);
+}
+
+/**
+ * Выполнение готовых сопрограмм
+ * @return Сколько шагов выполнено
+ */
+uint32_t coro_run(void) {
+    uint32_t steps = 0;
+    
+    // Не больше размера пула за раз: уступающие сопрограммы не
+    // удерживают исполнитель вечно
+    while (steps < CORO_MAX) {
+        uint32_t flags = spin_lock_irqsave(&coro_lock);
+        
+        coro_t* co = coro_ready_head;
+        if (co == NULL) {
+            spin_unlock_irqrestore(&coro_lock, flags);
+            break;
+        }
+        coro_ready_head = co->next;
+        if (coro_ready_head == NULL) coro_ready_tail = NULL;
+        co->state = CORO_RUNNING;
+        
+        spin_unlock_irqrestore(&coro_lock, flags);
+        
+        int result = co->func(co);
+        steps++;
+        
+        flags = spin_lock_irqsave(&coro_lock);
+        if (result == CORO_DONE) {
+            co->state = CORO_FREE;
+        } else if (co->state == CORO_RUNNING) {
+            // Пробуждение еще не пришло (иначе она уже в очереди)
+            co->state = CORO_WAITING_EVENT;
+        }
+        spin_unlock_irqrestore(&coro_lock, flags);
+    }
+    
+    return steps;
+}
+
+/**
+ * Поток исполнителя
+ */
+static void coro_thread(void* arg) {
+    (void)arg;
+    
+    for (;;) {
+        wait_event(&coro_wait, coro_ready_head != NULL);
+        coro_run();
+    }
+}
+
+/**
+ * Команда: coros - список сопрограмм
+ */
+static void cmd_coros(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    uint32_t count = 0;
+    
+    for (int i = 0; i < CORO_MAX; i++) {
+        coro_t* co = &coro_pool[i];
+        if (co->state == CORO_FREE) continue;
+        
+        if (co->irq >= 0) {
+            terminal_printf("%d %s: %s, irq %d\n", co->id, co->name,
+                            coro_state_names[co->state], co->irq);
+        } else {
+            terminal_printf("%d %s: %s, line %d\n", co->id, co->name,
+                            coro_state_names[co->state], co->line);
+        }
+        count++;
+    }
+    
+    terminal_printf("%d of %d coroutines in use\n", count, CORO_MAX);
+}
+
+/**
+ * Запуск исполнителя (после sched_init)
+ * Сопрограммы, созданные раньше, ждут в очереди.
+ */
+void coro_init(void) {
+    sched_create_on("coro", coro_thread, NULL, SMP_BSP);
+    cmdreg_register("coros", "List coroutines", cmd_coros);
+}
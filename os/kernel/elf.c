@@ -0,0 +1,119 @@
+/**
+ * kernel/elf.c - Загрузчик исполняемых файлов ELF32
+ *
+ * Образ уже лежит в памяти (модуль Multiboot), поэтому сегменты,
+ * которые процесс только читает, не копируются: их страницы
+ * отображаются в адресное пространство прямо из образа (VMM_SHARED -
+ * при завершении процесса они не освобождаются). Для этого смещение
+ * сегмента в файле и его адрес должны совпадать по модулю размера
+ * страницы, а сам образ - начинаться с границы страницы (флаг
+ * MULTIBOOT_PAGE_ALIGN). Записываемые сегменты и .bss получают свои
+ * обнуленные страницы, в которые копируется содержимое из файла.
+ */
+
+#include "elf.h"
+#include "vmm.h"
+#include "pmm.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Проверка заголовка файла
+ */
+static bool elf_check_header(const elf_header_t* eh, uint32_t size) {
+    if (size < sizeof(elf_header_t)) return false;
+    
+    if (eh->magic != ELF_MAGIC || eh->class != ELF_CLASS_32 ||
+        eh->data != ELF_DATA_LSB || eh->type != ELF_TYPE_EXEC ||
+        eh->machine != ELF_MACHINE_386) {
+        return false;
+    }
+    
+    if (eh->phentsize != sizeof(elf_phdr_t) || eh->phoff > size ||
+        (uint32_t)eh->phnum * sizeof(elf_phdr_t) > size - eh->phoff) {
+        return false;
+    }
+    
+    return eh->entry >= VMM_USER_BASE && eh->entry < VMM_USER_END;
+}
+
+/**
+ * Отображение одного сегмента
+ * @return false, если сегмент некорректен или не хватило памяти
+ */
+static bool elf_load_segment(uint32_t directory, uint32_t image, uint32_t size,
+                             const elf_phdr_t* ph) {
+    if (ph->memsz == 0) return true;
+    
+    if (ph->filesz > ph->memsz || ph->offset > size || ph->filesz > size - ph->offset ||
+        ph->vaddr < VMM_USER_BASE || ph->memsz > VMM_USER_END - ph->vaddr) {
+        return false;
+    }
+    
+    bool writable = (ph->flags & ELF_PF_W) != 0;
+    bool in_place = !writable && ph->memsz == ph->filesz &&
+                    (image % PAGE_SIZE) == 0 &&
+                    (ph->offset % PAGE_SIZE) == (ph->vaddr % PAGE_SIZE);
+    
+    uint32_t file_end = ph->vaddr + ph->filesz;
+    
+    for (uint32_t page = PAGE_ALIGN_DOWN(ph->vaddr);
+         page < ph->vaddr + ph->memsz; page += PAGE_SIZE) {
+        if (in_place) {
+            // Страница образа, на которую приходится page
+            // (для первой страницы page < vaddr - вычитание по модулю 2^32)
+            uint32_t phys = image + ph->offset + page - ph->vaddr;
+            if (!vmm_map(directory, page, phys, VMM_SHARED)) return false;
+            continue;
+        }
+        
+        uint32_t frame = pmm_alloc_zeroed();
+        if (frame == 0) return false;
+        
+        // Часть страницы, покрытая данными из файла
+        uint32_t start = page < ph->vaddr ? ph->vaddr : page;
+        uint32_t end = page + PAGE_SIZE < file_end ? page + PAGE_SIZE : file_end;
+        if (start < end) {
+            memcpy((void*)(frame + start - page),
+                   (const void*)(image + ph->offset + start - ph->vaddr), end - start);
+        }
+        
+        if (!vmm_map(directory, page, frame, writable ? VMM_WRITABLE : 0)) {
+            pmm_free(frame);
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+/**
+ * Загрузка исполняемого файла в адресное пространство
+ * При ошибке уже отображенные страницы остаются в каталоге и
+ * освобождаются вместе с ним (vmm_destroy).
+ * @param directory Каталог процесса
+ * @param image Адрес образа в памяти (физический = виртуальный ядра)
+ * @param size Размер образа
+ * @param entry Сюда записывается точка входа
+ * @return false, если файл не ELF32 для i386 или сегмент не отобразился
+ */
+bool elf_load(uint32_t directory, uint32_t image, uint32_t size, uint32_t* entry) {
+    const elf_header_t* eh = (const elf_header_t*)image;
+    if (!elf_check_header(eh, size)) return false;
+    
+    const elf_phdr_t* ph = (const elf_phdr_t*)(image + eh->phoff);
+    for (uint32_t i = 0; i < eh->phnum; i++) {
+        if (ph[i].type != ELF_PT_LOAD) continue;
+        
+        if (!elf_load_segment(directory, image, size, &ph[i])) {
+            #ifdef DEBUG
+            terminal_printf("ELF: segment %d at %x failed\n", i, ph[i].vaddr);
+            #endif
+            return false;
+        }
+    }
+    
+    *entry = eh->entry;
+    return true;
+}
@@ -0,0 +1,36 @@
+; kernel/entry_asm.asm - Точка входа ядра
+;
+; Загрузчик Multiboot передает магическое число в EAX и адрес сведений
+; в EBX. Их нужно забрать до первого кода на C: пролог функции (защита
+; стека, инструментирование) вправе испортить любой из этих регистров.
+
+KERNEL_STACK_SIZE equ 32768
+
+section .text
+    global _start
+
+extern kernel_main
+
+_start:
+    cli
+    cld
+
+    ; Стек ядра
+    mov esp, kernel_stack_top
+    xor ebp, ebp
+
+    ; kernel_main(magic, info)
+    push ebx
+    push eax
+    call kernel_main
+
+    ; kernel_main не возвращается; на всякий случай останавливаемся
+.halt:
+    hlt
+    jmp .halt
+
+section .bss
+    align 16
+kernel_stack:
+    resb KERNEL_STACK_SIZE
+kernel_stack_top:
@@ -1,13 +1,42 @@
 /**
  * kernel/framebuffer.c - Абстракция над VBE framebuffer
+ *
+ * Заливка и копирование больших областей делятся на полосы строк и
+ * выполняются параллельно на всех процессорах (parallel_for).
+ * Заливка полосы пишет по 4 пикселя регистром SSE, если участок
+ * SSE доступен (kernel_fpu_begin).
  */
 
 #include "framebuffer.h"
 #include "vbe.h"
 #include "terminal.h"
+#include "latency.h"
+#include "job.h"
+#include "sched.h"
 #include <stdbool.h>
 #include <string.h>
 
+// Строк в одной полосе параллельной заливки и копирования
+#define FRAMEBUFFER_BAND_ROWS    32
+
+// Меньшие области (в пикселях) быстрее обработать на месте
+#define FRAMEBUFFER_PARALLEL_MIN 65536
+
+// Меньшие участки заливки (в пикселях, ширина на число строк) не
+// окупают сохранение FPU и заливаются без SSE. Порог ниже
+// FRAMEBUFFER_PARALLEL_MIN: полоса параллельной заливки - всего
+// FRAMEBUFFER_BAND_ROWS строк
+#define FRAMEBUFFER_SIMD_MIN     4096
+
+// Прямоугольник для обработки полосами: строки - диапазон parallel_for
+typedef struct {
+    uint32_t* dst;
+    const uint32_t* src;        // NULL - заливка цветом
+    uint32_t color;
+    uint16_t x;
+    uint16_t width;
+} framebuffer_band_t;
+
 // Глобальные переменные framebuffer
 static uint32_t* back_buffer = NULL;
 static uint32_t* front_buffer = NULL;
@@ -109,16 +138,128 @@ static uint32_t* get_draw_buffer(void) {
     return double_buffering ? back_buffer : front_buffer;
 }
 
+/**
+ * Заливка строк [begin, end) через SSE
+ * Вызывается только между kernel_fpu_begin и kernel_fpu_end. Ядро
+ * собирается без SSE, поэтому XMM разрешены только в этой функции.
+ * Образец цвета передается в asm операндом "x": компилятор сам держит
+ * его в XMM-регистре между записями.
+ * @param band Буфер, цвет, X и ширина
+ * @param begin Первая строка
+ * @param end Строка за последней
+ */
+__attribute__((target("sse2"), noinline))
+static void framebuffer_fill_rows_sse(const framebuffer_band_t* band, uint32_t begin, uint32_t end) {
+    uint32_t color = band->color;
+    uint32_t __attribute__((vector_size(16))) pattern = { color, color, color, color };
+    
+    for (uint32_t py = begin; py < end; py++) {
+        uint32_t* row = &band->dst[py * screen_width + band->x];
+        uint16_t px = 0;
+        
+        for (; px + 4 <= band->width; px += 4) {
+            asm volatile("movdqu %1, (%0)" : : "r"(&row[px]), "x"(pattern) : "memory");
+        }
+        for (; px < band->width; px++) {
+            row[px] = color;
+        }
+    }
+}
+
+/**
+ * Обработка строк [begin, end) прямоугольника (задание parallel_for)
+ * @param data Описание прямоугольника (framebuffer_band_t)
+ */
+static void framebuffer_band_rows(uint32_t begin, uint32_t end, void* data) {
+    const framebuffer_band_t* band = (const framebuffer_band_t*)data;
+    
+    if (band->src == NULL &&
+        (uint32_t)band->width * (end - begin) >= FRAMEBUFFER_SIMD_MIN &&
+        kernel_fpu_begin()) {
+        framebuffer_fill_rows_sse(band, begin, end);
+        kernel_fpu_end();
+        return;
+    }
+    
+    for (uint32_t py = begin; py < end; py++) {
+        uint32_t offset = py * screen_width + band->x;
+        
+        if (band->src != NULL) {
+            memcpy(&band->dst[offset], &band->src[offset], band->width * sizeof(uint32_t));
+        } else {
+            uint32_t* row = &band->dst[offset];
+            for (uint16_t px = 0; px < band->width; px++) {
+                row[px] = band->color;
+            }
+        }
+    }
+}
+
+/**
+ * Заливка или копирование прямоугольника полосами строк
+ * Большие области раздаются процессорам, маленькие обрабатываются сразу.
+ * @param band Буферы, цвет, X и ширина
+ * @param y Первая строка
+ * @param end_y Строка за последней
+ */
+static void framebuffer_process_rect(const framebuffer_band_t* band, uint16_t y, uint16_t end_y) {
+    if ((uint32_t)band->width * (end_y - y) < FRAMEBUFFER_PARALLEL_MIN) {
+        framebuffer_band_rows(y, end_y, (void*)band);
+        return;
+    }
+    
+    parallel_for(y, end_y, FRAMEBUFFER_BAND_ROWS, framebuffer_band_rows, (void*)band);
+}
+
 /**
  * Обмен буферов (отображение back buffer на экран)
  */
 void framebuffer_swap(void) {
-    if (!initialized || !double_buffering) {
+    if (!initialized) {
         return;
     }
     
-    // Копируем back buffer в front buffer
-    memcpy(front_buffer, back_buffer, framebuffer_size);
+    // Копируем back buffer в front buffer полосами
+    if (double_buffering) {
+        framebuffer_band_t band = { front_buffer, back_buffer, 0, 0, screen_width };
+        framebuffer_process_rect(&band, 0, screen_height);
+    }
+    
+    // Кадр на экране: замер задержки ввода
+    latency_present();
+}
+
+/**
+ * Отображение прямоугольной области back buffer на экран
+ * @param x Координата X
+ * @param y Координата Y
+ * @param width Ширина
+ * @param height Высота
+ */
+void framebuffer_swap_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!initialized) {
+        return;
+    }
+    
+    // Без двойной буферизации область уже на экране
+    if (!double_buffering) {
+        latency_present();
+        return;
+    }
+    
+    if (x >= screen_width || y >= screen_height) return;
+    
+    uint16_t end_x = x + width;
+    uint16_t end_y = y + height;
+    
+    if (end_x > screen_width) end_x = screen_width;
+    if (end_y > screen_height) end_y = screen_height;
+    
+    // Копируем только строки области
+    framebuffer_band_t band = { front_buffer, back_buffer, 0, x, end_x - x };
+    framebuffer_process_rect(&band, y, end_y);
+    
+    latency_present();
 }
 
 /**
@@ -128,11 +269,8 @@ void framebuffer_swap(void) {
 void framebuffer_clear(uint32_t color) {
     if (!initialized) return;
     
-    uint32_t* buffer = get_draw_buffer();
-    
-    for (uint32_t i = 0; i < screen_width * screen_height; i++) {
-        buffer[i] = color;
-    }
+    framebuffer_band_t band = { get_draw_buffer(), NULL, color, 0, screen_width };
+    framebuffer_process_rect(&band, 0, screen_height);
 }
 
 /**
@@ -187,14 +325,8 @@ void framebuffer_draw_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t heig
     if (end_x > screen_width) end_x = screen_width;
     if (end_y > screen_height) end_y = screen_height;
     
-    uint32_t* buffer = get_draw_buffer();
-    
-    for (uint16_t py = y; py < end_y; py++) {
-        uint32_t row_offset = py * screen_width;
-        for (uint16_t px = x; px < end_x; px++) {
-            buffer[row_offset + px] = color;
-        }
-    }
+    framebuffer_band_t band = { get_draw_buffer(), NULL, color, x, end_x - x };
+    framebuffer_process_rect(&band, y, end_y);
 }
 
 /**
@@ -392,6 +524,78 @@ void framebuffer_draw_image(uint16_t x, uint16_t y, uint16_t width, uint16_t hei
     }
 }
 
+/**
+ * Сохранение прямоугольной области буфера рисования
+ * @param x Координата X
+ * @param y Координата Y
+ * @param width Ширина
+ * @param height Высота
+ * @param dst Буфер размером width * height пикселей
+ */
+void framebuffer_save_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, uint32_t* dst) {
+    if (!initialized || dst == NULL) return;
+    if (x >= screen_width || y >= screen_height) return;
+    
+    uint32_t* buffer = get_draw_buffer();
+    uint16_t copy_width = width;
+    if (x + copy_width > screen_width) copy_width = screen_width - x;
+    
+    // Копируем построчно, шаг в dst - полная ширина области
+    for (uint16_t py = 0; py < height && y + py < screen_height; py++) {
+        memcpy(&dst[py * width], &buffer[(y + py) * screen_width + x],
+               copy_width * sizeof(uint32_t));
+    }
+}
+
+/**
+ * Вывод сохраненной области в буфер рисования одним копированием
+ * В отличие от framebuffer_draw_image не проверяет прозрачность.
+ * @param x Координата X
+ * @param y Координата Y
+ * @param width Ширина
+ * @param height Высота
+ * @param src Данные, сохраненные framebuffer_save_rect
+ */
+void framebuffer_restore_rect(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint32_t* src) {
+    if (!initialized || src == NULL) return;
+    if (x >= screen_width || y >= screen_height) return;
+    
+    uint32_t* buffer = get_draw_buffer();
+    uint16_t copy_width = width;
+    if (x + copy_width > screen_width) copy_width = screen_width - x;
+    
+    for (uint16_t py = 0; py < height && y + py < screen_height; py++) {
+        memcpy(&buffer[(y + py) * screen_width + x], &src[py * width],
+               copy_width * sizeof(uint32_t));
+    }
+}
+
+/**
+ * Вывод прямоугольника из чужого буфера пикселей в буфер рисования
+ * Буфер может быть шире прямоугольника (поверхность окна, у которой
+ * выводится только измененная часть); прозрачность не проверяется.
+ * @param x Координата X на экране
+ * @param y Координата Y на экране
+ * @param width Ширина
+ * @param height Высота
+ * @param src Первый пиксель прямоугольника в буфере
+ * @param stride Шаг строки буфера в пикселях
+ */
+void framebuffer_draw_surface(uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                              const uint32_t* src, uint32_t stride) {
+    if (!initialized || src == NULL) return;
+    if (x >= screen_width || y >= screen_height) return;
+    
+    uint32_t* buffer = get_draw_buffer();
+    uint16_t copy_width = width;
+    if (x + copy_width > screen_width) copy_width = screen_width - x;
+    
+    for (uint16_t py = 0; py < height && y + py < screen_height; py++) {
+        memcpy(&buffer[(y + py) * screen_width + x], &src[py * stride],
+               copy_width * sizeof(uint32_t));
+    }
+}
+
 /**
  * Копирование области экрана
  * @param src_x Исходная X
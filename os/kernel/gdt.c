@@ -1,118 +1,160 @@
 /**
  * kernel/gdt.c - Реализация глобальной таблицы дескрипторов (GDT)
+ *
+ * У каждого процессора своя GDT с одинаковой раскладкой селекторов:
+ * отличаются только дескриптор TSS (свой стек ядра для каждого
+ * процессора) и сегмент GS, база которого - область данных процессора.
  */
 
 #include "gdt.h"
+#include "smp.h"
+#include <string.h>
 
 // Глобальные переменные GDT
-struct gdt_entry gdt_entries[6];
-struct gdt_ptr gdt_pointer;
-struct tss_entry tss;
+struct gdt_entry gdt_entries[CPU_MAX][GDT_ENTRIES];
+struct gdt_ptr gdt_pointers[CPU_MAX];
+struct tss_entry tss[CPU_MAX];
 
 /**
  * Установка дескриптора в GDT
+ * @param table GDT процессора
  * @param index Индекс дескриптора
  * @param base  Базовый адрес сегмента
  * @param limit Лимит сегмента
  * @param access Флаги доступа
  * @param flags Дополнительные флаги
  */
-void gdt_set_entry(int index, uint32_t base, uint32_t limit, uint8_t access, uint8_t flags) {
-    gdt_entries[index].base_low = base & 0xFFFF;
-    gdt_entries[index].base_middle = (base >> 16) & 0xFF;
-    gdt_entries[index].base_high = (base >> 24) & 0xFF;
+void gdt_set_entry(struct gdt_entry* table, int index, uint32_t base, uint32_t limit,
+                   uint8_t access, uint8_t flags) {
+    table[index].base_low = base & 0xFFFF;
+    table[index].base_middle = (base >> 16) & 0xFF;
+    table[index].base_high = (base >> 24) & 0xFF;
     
-    gdt_entries[index].limit_low = limit & 0xFFFF;
-    gdt_entries[index].granularity = (limit >> 16) & 0x0F;
+    table[index].limit_low = limit & 0xFFFF;
+    table[index].granularity = (limit >> 16) & 0x0F;
     
-    gdt_entries[index].granularity |= flags & 0xF0;
-    gdt_entries[index].access = access;
+    table[index].granularity |= flags & 0xF0;
+    table[index].access = access;
 }
 
 /**
  * Инициализация TSS (Task State Segment)
+ * @param cpu  Индекс процессора
  * @param idx  Индекс TSS в GDT
  * @param ss0  Селектор стека уровня 0
  * @param esp0 Указатель стека уровня 0
  */
-void tss_init(uint32_t idx, uint16_t ss0, uint32_t esp0) {
+static void tss_init(uint32_t cpu, uint32_t idx, uint16_t ss0, uint32_t esp0) {
+    struct tss_entry* t = &tss[cpu];
+    
     // Вычисляем базовый адрес и лимит TSS
-    uint32_t base = (uint32_t)&tss;
-    uint32_t limit = base + sizeof(struct tss_entry);
+    uint32_t base = (uint32_t)t;
+    uint32_t limit = sizeof(struct tss_entry) - 1;
     
     // Устанавливаем дескриптор TSS в GDT
-    gdt_set_entry(idx, base, limit, 
+    gdt_set_entry(gdt_entries[cpu], idx, base, limit,
                   0xE9,  // Present, DPL=3, 32-bit TSS
                   0x00);
     
     // Обнуляем TSS
-    memset(&tss, 0, sizeof(struct tss_entry));
+    memset(t, 0, sizeof(struct tss_entry));
     
     // Устанавливаем стек уровня 0
-    tss.ss0 = ss0;
-    tss.esp0 = esp0;
+    t->ss0 = ss0;
+    t->esp0 = esp0;
     
     // Устанавливаем сегменты
-    tss.cs = 0x0B;      // Код сегмент уровня 3
-    tss.ss = 0x13;      // Стек сегмент уровня 3
-    tss.ds = 0x13;
-    tss.es = 0x13;
-    tss.fs = 0x13;
-    tss.gs = 0x13;
+    t->cs = 0x0B;      // Код сегмент уровня 3
+    t->ss = 0x13;      // Стек сегмент уровня 3
+    t->ds = 0x13;
+    t->es = 0x13;
+    t->fs = 0x13;
+    t->gs = 0x13;
     
     // I/O карта
-    tss.iomap_base = sizeof(struct tss_entry);
+    t->iomap_base = sizeof(struct tss_entry);
 }
 
 /**
- * Установка стека уровня 0 в TSS
+ * Установка стека уровня 0 в TSS текущего процессора
  * @param esp0 Указатель стека уровня 0
  */
 void tss_set_stack(uint32_t esp0) {
-    tss.esp0 = esp0;
+    tss[cpu_current()].esp0 = esp0;
 }
 
 /**
- * Инициализация GDT
+ * Стек уровня 0 в TSS текущего процессора
  */
-void gdt_init(void) {
+uint32_t tss_get_stack(void) {
+    return tss[cpu_current()].esp0;
+}
+
+/**
+ * Построение и загрузка GDT и TSS процессора
+ * Вызывается на самом процессоре: после нее GS указывает на его
+ * область данных, и cpu_current() возвращает cpu.
+ * @param cpu Индекс процессора
+ * @param percpu_base Адрес области данных процессора
+ * @param percpu_size Размер области
+ * @param esp0 Стек ядра для перехода из кольца 3
+ */
+void gdt_init_cpu(uint32_t cpu, uint32_t percpu_base, uint32_t percpu_size, uint32_t esp0) {
+    struct gdt_entry* table = gdt_entries[cpu];
+    
     // Устанавливаем указатель на GDT
-    gdt_pointer.limit = (sizeof(struct gdt_entry) * 6) - 1;
-    gdt_pointer.base = (uint32_t)&gdt_entries;
+    gdt_pointers[cpu].limit = (sizeof(struct gdt_entry) * GDT_ENTRIES) - 1;
+    gdt_pointers[cpu].base = (uint32_t)table;
     
     // Нулевой дескриптор (обязателен)
-    gdt_set_entry(0, 0, 0, 0, 0);
+    gdt_set_entry(table, 0, 0, 0, 0, 0);
     
     // Код сегмент уровня 0 (ядро)
-    gdt_set_entry(1, 0, 0xFFFFFFFF,
-                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_SEGMENT | 
+    gdt_set_entry(table, 1, 0, 0xFFFFFFFF,
+                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_SEGMENT |
                   GDT_ACCESS_CODE | GDT_ACCESS_READABLE,
                   GDT_FLAG_32BIT | GDT_FLAG_4K_GRANULARITY);
     
     // Данные сегмент уровня 0 (ядро)
-    gdt_set_entry(2, 0, 0xFFFFFFFF,
-                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_SEGMENT | 
+    gdt_set_entry(table, 2, 0, 0xFFFFFFFF,
+                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_SEGMENT |
                   GDT_ACCESS_WRITABLE,
                   GDT_FLAG_32BIT | GDT_FLAG_4K_GRANULARITY);
     
     // Код сегмент уровня 3 (пользователь)
-    gdt_set_entry(3, 0, 0xFFFFFFFF,
-                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING3 | GDT_ACCESS_SEGMENT | 
+    gdt_set_entry(table, 3, 0, 0xFFFFFFFF,
+                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING3 | GDT_ACCESS_SEGMENT |
                   GDT_ACCESS_CODE | GDT_ACCESS_READABLE,
                   GDT_FLAG_32BIT | GDT_FLAG_4K_GRANULARITY);
     
     // Данные сегмент уровня 3 (пользователь)
-    gdt_set_entry(4, 0, 0xFFFFFFFF,
-                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING3 | GDT_ACCESS_SEGMENT | 
+    gdt_set_entry(table, 4, 0, 0xFFFFFFFF,
+                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING3 | GDT_ACCESS_SEGMENT |
                   GDT_ACCESS_WRITABLE,
                   GDT_FLAG_32BIT | GDT_FLAG_4K_GRANULARITY);
     
     // Инициализация TSS
-    tss_init(5, GDT_KERNEL_DATA_SEG, 0x90000);
+    tss_init(cpu, 5, GDT_KERNEL_DATA_SEG, esp0);
+    
+    // Область данных процессора (побайтовый лимит)
+    gdt_set_entry(table, 6, percpu_base, percpu_size - 1,
+                  GDT_ACCESS_PRESENT | GDT_ACCESS_RING0 | GDT_ACCESS_SEGMENT |
+                  GDT_ACCESS_WRITABLE,
+                  GDT_FLAG_32BIT);
     
     // Загружаем GDT
-    gdt_flush((uint32_t)&gdt_pointer);
+    gdt_flush((uint32_t)&gdt_pointers[cpu]);
     
     // Загружаем TSS
     tss_flush();
-}
\ No newline at end of file
+    
+    // GS - область данных процессора
+    asm volatile("mov %0, %%gs" : : "r"((uint16_t)GDT_PERCPU_SEG));
+}
+
+/**
+ * Инициализация GDT загрузочного процессора
+ */
+void gdt_init(void) {
+    gdt_init_cpu(SMP_BSP, (uint32_t)smp_percpu_setup(SMP_BSP), sizeof(percpu_t), 0x90000);
+}
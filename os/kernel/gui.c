@@ -7,6 +7,7 @@
 #include "mouse.h"
 #include "keyboard.h"
 #include "terminal.h"
+#include "surface.h"
 #include <stdbool.h>
 #include <string.h>
 
@@ -115,6 +116,9 @@ void gui_draw_desktop(void) {
         }
     }
     
+    // Поверхности процессов дорисует композитор
+    surface_invalidate_all();
+    
     // Рисуем курсор мыши
     mouse_draw_cursor();
 }
@@ -125,8 +129,8 @@ void gui_draw_desktop(void) {
 void gui_update_cursor(void) {
     if (!gui_initialized) return;
     
-    int mouse_x = mouse_get_x();
-    int mouse_y = mouse_get_y();
+    int mouse_x, mouse_y;
+    mouse_get_position(&mouse_x, &mouse_y);
     
     // Если позиция не изменилась, ничего не делаем
     if (mouse_x == cursor_old_x && mouse_y == cursor_old_y) {
@@ -411,8 +415,8 @@ void gui_draw_menu(int menu_id) {
 void gui_handle_mouse(void) {
     if (!gui_initialized) return;
     
-    int mouse_x = mouse_get_x();
-    int mouse_y = mouse_get_y();
+    int mouse_x, mouse_y;
+    mouse_get_position(&mouse_x, &mouse_y);
     bool left_pressed = mouse_is_left_pressed();
     
     // Проверяем клики по кнопкам
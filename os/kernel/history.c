@@ -0,0 +1,289 @@
+/**
+ * kernel/history.c - Кольцевая история команд
+ *
+ * Записи переменной длины лежат подряд в арене фиксированного размера,
+ * индексы записей образуют кольцо. Добавление вытесняет самые старые
+ * записи, без сдвигов и без выделения памяти. Обратный поиск (Ctrl+R)
+ * при удлинении запроса фильтрует только уже найденные совпадения.
+ */
+
+#include "history.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Получение записи по порядковому номеру (без проверок)
+ */
+static history_entry_t* history_entry(history_t* h, uint32_t seq) {
+    return &h->entries[seq % HISTORY_MAX_ENTRIES];
+}
+
+/**
+ * Удаление самой старой записи
+ */
+static void history_evict_oldest(history_t* h) {
+    h->first++;
+    if (h->cursor < h->first) {
+        h->cursor = h->first;
+    }
+}
+
+/**
+ * Проверка, пересекается ли текст записи с областью арены [start, end)
+ */
+static bool history_overlaps(const history_entry_t* e, uint32_t start, uint32_t end) {
+    uint32_t e_end = (uint32_t)e->offset + e->length + 1;
+    return e->offset < end && start < e_end;
+}
+
+/**
+ * Проверка, содержит ли строка подстроку
+ * @param str Строка
+ * @param sub Подстрока
+ * @param sub_len Длина подстроки
+ */
+static bool history_contains(const char* str, const char* sub, int sub_len) {
+    if (sub_len == 0) return true;
+
+    for (; *str; str++) {
+        if (*str == sub[0] && strncmp(str, sub, sub_len) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Инициализация истории
+ * @param h История
+ */
+void history_init(history_t* h) {
+    memset(h, 0, sizeof(history_t));
+}
+
+/**
+ * Добавление команды в историю
+ * @param h История
+ * @param line Текст команды
+ */
+void history_add(history_t* h, const char* line) {
+    if (line == NULL || line[0] == '\0') return;
+
+    uint32_t len = strlen(line);
+    if (len > HISTORY_ARENA_SIZE / 4) {
+        len = HISTORY_ARENA_SIZE / 4;
+    }
+
+    // Повтор предыдущей команды не сохраняем
+    if (h->next != h->first) {
+        history_entry_t* last = history_entry(h, h->next - 1);
+        if (last->length == len && strncmp(&h->arena[last->offset], line, len) == 0) {
+            h->cursor = h->next;
+            return;
+        }
+    }
+
+    uint32_t need = len + 1;
+    uint32_t start = h->arena_head;
+
+    // Хвост арены не вмещает запись: освобождаем его и начинаем с нуля
+    if (start + need > HISTORY_ARENA_SIZE) {
+        while (h->next != h->first && history_entry(h, h->first)->offset >= start) {
+            history_evict_oldest(h);
+        }
+        start = 0;
+    }
+
+    // Вытесняем старые записи, занимающие нужную область
+    while (h->next != h->first && history_overlaps(history_entry(h, h->first), start, start + need)) {
+        history_evict_oldest(h);
+    }
+
+    // Кольцо индексов заполнено
+    if (h->next - h->first >= HISTORY_MAX_ENTRIES) {
+        history_evict_oldest(h);
+    }
+
+    history_entry_t* e = history_entry(h, h->next);
+    e->offset = start;
+    e->length = len;
+    memcpy(&h->arena[start], line, len);
+    h->arena[start + len] = '\0';
+
+    h->arena_head = start + need;
+    h->next++;
+    h->cursor = h->next;
+}
+
+/**
+ * Количество записей в истории
+ */
+int history_count(const history_t* h) {
+    return h->next - h->first;
+}
+
+/**
+ * Получение текста записи по порядковому номеру
+ * @param h История
+ * @param seq Порядковый номер записи
+ * @return Текст команды (указатель внутрь арены) или NULL
+ */
+const char* history_get(const history_t* h, uint32_t seq) {
+    if (seq < h->first || seq >= h->next) return NULL;
+    return &h->arena[h->entries[seq % HISTORY_MAX_ENTRIES].offset];
+}
+
+/**
+ * Переход к более старой команде (стрелка вверх)
+ * @return Текст команды или NULL, если история пуста
+ */
+const char* history_prev(history_t* h) {
+    if (h->next == h->first) return NULL;
+
+    if (h->cursor > h->first) {
+        h->cursor--;
+    }
+
+    return history_get(h, h->cursor);
+}
+
+/**
+ * Переход к более новой команде (стрелка вниз)
+ * @return Текст команды или пустая строка за самой новой записью
+ */
+const char* history_next(history_t* h) {
+    if (h->cursor + 1 < h->next) {
+        h->cursor++;
+        return history_get(h, h->cursor);
+    }
+
+    h->cursor = h->next;
+    return "";
+}
+
+/**
+ * Сброс позиции навигации за самую новую запись
+ */
+void history_reset_cursor(history_t* h) {
+    h->cursor = h->next;
+}
+
+/**
+ * Поиск позиции в списке совпадений, не новее указанной записи
+ */
+static void history_search_seek(history_search_t* s, uint32_t seq) {
+    s->match_pos = 0;
+    while (s->match_pos < s->match_count && s->matches[s->match_pos] > seq) {
+        s->match_pos++;
+    }
+}
+
+/**
+ * Начало обратного поиска
+ */
+void history_search_begin(history_t* h) {
+    history_search_t* s = &h->search;
+
+    s->active = true;
+    s->query_len = 0;
+    s->query[0] = '\0';
+    s->match_count = 0;
+    s->match_pos = 0;
+
+    // С пустым запросом совпадают все записи
+    for (uint32_t seq = h->next; seq-- > h->first; ) {
+        s->level[seq % HISTORY_MAX_ENTRIES] = 0;
+        s->matches[s->match_count++] = seq;
+    }
+}
+
+/**
+ * Добавление символа к запросу
+ * Проверяются только записи, совпавшие с более коротким запросом.
+ * @return Текущее совпадение или NULL
+ */
+const char* history_search_push(history_t* h, char c) {
+    history_search_t* s = &h->search;
+    if (!s->active || s->query_len >= HISTORY_QUERY_MAX - 1) {
+        return history_search_current(h);
+    }
+
+    uint32_t current = s->match_pos < s->match_count ? s->matches[s->match_pos] : h->next;
+
+    s->query[s->query_len++] = c;
+    s->query[s->query_len] = '\0';
+
+    int kept = 0;
+    for (int i = 0; i < s->match_count; i++) {
+        uint32_t seq = s->matches[i];
+        uint8_t* level = &s->level[seq % HISTORY_MAX_ENTRIES];
+
+        if (history_contains(history_get(h, seq), s->query, s->query_len)) {
+            *level = s->query_len;
+            s->matches[kept++] = seq;
+        } else {
+            *level = s->query_len - 1;
+        }
+    }
+    s->match_count = kept;
+
+    history_search_seek(s, current);
+    return history_search_current(h);
+}
+
+/**
+ * Удаление последнего символа запроса
+ * Список совпадений восстанавливается по сохраненным уровням без сравнения строк.
+ * @return Текущее совпадение или NULL
+ */
+const char* history_search_pop(history_t* h) {
+    history_search_t* s = &h->search;
+    if (!s->active || s->query_len == 0) {
+        return history_search_current(h);
+    }
+
+    uint32_t current = s->match_pos < s->match_count ? s->matches[s->match_pos] : h->next;
+
+    s->query[--s->query_len] = '\0';
+    s->match_count = 0;
+
+    for (uint32_t seq = h->next; seq-- > h->first; ) {
+        if (s->level[seq % HISTORY_MAX_ENTRIES] >= s->query_len) {
+            s->matches[s->match_count++] = seq;
+        }
+    }
+
+    history_search_seek(s, current);
+    return history_search_current(h);
+}
+
+/**
+ * Переход к следующему (более старому) совпадению (повторный Ctrl+R)
+ * @return Текущее совпадение или NULL
+ */
+const char* history_search_older(history_t* h) {
+    history_search_t* s = &h->search;
+    if (s->active && s->match_pos + 1 < s->match_count) {
+        s->match_pos++;
+    }
+    return history_search_current(h);
+}
+
+/**
+ * Текущее совпадение поиска
+ * @return Текст команды или NULL, если совпадений нет
+ */
+const char* history_search_current(const history_t* h) {
+    const history_search_t* s = &h->search;
+    if (!s->active || s->match_pos >= s->match_count) return NULL;
+    return history_get(h, s->matches[s->match_pos]);
+}
+
+/**
+ * Завершение обратного поиска
+ */
+void history_search_end(history_t* h) {
+    h->search.active = false;
+    history_reset_cursor(h);
+}
@@ -0,0 +1,241 @@
+/**
+ * kernel/hpet.c - Драйвер HPET (High Precision Event Timer)
+ *
+ * HPET находится по таблице ACPI "HPET" и дает два устройства:
+ * источник времени (главный 64-битный счетчик) и устройство событий
+ * на компараторе таймера 0 в однократном режиме. Прерывание таймера 0
+ * доставляется через режим замещения (legacy replacement) на IRQ0
+ * вместо PIT.
+ */
+
+#include "hpet.h"
+#include "acpi.h"
+#include "clock.h"
+#include "clockevent.h"
+#include "timer.h"
+#include "idt.h"
+#include "irq.h"
+#include "cpu.h"
+#include "terminal.h"
+#include <stddef.h>
+
+// Биты регистра возможностей
+#define HPET_CAPS_COUNT_64      (1 << 13)
+#define HPET_CAPS_LEGACY_ROUTE  (1 << 15)
+
+// Биты общей конфигурации
+#define HPET_CONFIG_ENABLE      (1 << 0)
+#define HPET_CONFIG_LEGACY      (1 << 1)
+
+// Биты конфигурации таймера
+#define HPET_TIMER_INT_LEVEL    (1 << 1)
+#define HPET_TIMER_INT_ENABLE   (1 << 2)
+#define HPET_TIMER_PERIODIC     (1 << 3)
+#define HPET_TIMER_32BIT        (1 << 8)
+
+// Наибольший допустимый период по спецификации (100 нс)
+#define HPET_MAX_PERIOD_FS      100000000
+
+// Рейтинги: HPET уступает инвариантному TSC и таймеру LAPIC
+#define HPET_CLOCKSOURCE_RATING 250
+#define HPET_CLOCKEVENT_RATING  50
+
+// Наименьшая задержка события: запись компаратора должна опередить счетчик
+#define HPET_MIN_DELTA_US       10
+
+// Таблица ACPI "HPET"
+typedef struct {
+    acpi_sdt_header_t header;
+    uint32_t event_timer_block_id;
+    acpi_gas_t address;
+    uint8_t hpet_number;
+    uint16_t min_tick;
+    uint8_t page_protection;
+} __attribute__((packed)) acpi_hpet_t;
+
+// Состояние HPET
+static volatile uint8_t* hpet_base = NULL;
+static uint32_t hpet_period_fs = 0;         // Период счетчика в фемтосекундах
+static clock_scale_t hpet_ns2count;
+
+/**
+ * Чтение 32-битного регистра HPET
+ */
+static inline uint32_t hpet_read(uint32_t reg) {
+    return *(volatile uint32_t*)(hpet_base + reg);
+}
+
+/**
+ * Запись 32-битного регистра HPET
+ */
+static inline void hpet_write(uint32_t reg, uint32_t value) {
+    *(volatile uint32_t*)(hpet_base + reg) = value;
+}
+
+/**
+ * Чтение главного счетчика
+ * 64-битный счетчик читается двумя половинами; если старшая
+ * половина изменилась между чтениями, чтение повторяется.
+ * @return Показание счетчика
+ */
+uint64_t hpet_read_counter(void) {
+    uint32_t hi, lo;
+    
+    do {
+        hi = hpet_read(HPET_REG_COUNTER + 4);
+        lo = hpet_read(HPET_REG_COUNTER);
+    } while (hi != hpet_read(HPET_REG_COUNTER + 4));
+    
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Проверка наличия HPET
+ */
+bool hpet_is_present(void) {
+    return hpet_base != NULL;
+}
+
+/**
+ * Период счетчика в фемтосекундах
+ */
+uint32_t hpet_get_period_fs(void) {
+    return hpet_period_fs;
+}
+
+// Источник времени на главном счетчике (период заполняется в hpet_init)
+static clocksource_t hpet_clocksource = {
+    .name = "hpet",
+    .rating = HPET_CLOCKSOURCE_RATING,
+    .read = hpet_read_counter,
+    .ns_num = 0,
+    .ns_den = 1000000,          // ns = count * period_fs / 10^6
+};
+
+/**
+ * Программирование компаратора таймера 0
+ * Компаратор 32-битный; если счетчик обогнал его до записи,
+ * задержка увеличивается вдвое и запись повторяется.
+ * @param delta_us Задержка в микросекундах
+ */
+static void hpet_set_next_event(uint32_t delta_us) {
+    uint32_t count = (uint32_t)clock_scale((uint64_t)delta_us * NSEC_PER_USEC, &hpet_ns2count);
+    if (count == 0) count = 1;
+    
+    uint32_t config = hpet_read(HPET_REG_TIMER_CONFIG(0));
+    hpet_write(HPET_REG_TIMER_CONFIG(0), config | HPET_TIMER_INT_ENABLE);
+    
+    for (;;) {
+        uint32_t cmp = hpet_read(HPET_REG_COUNTER) + count;
+        hpet_write(HPET_REG_TIMER_CMP(0), cmp);
+        
+        if ((int32_t)(cmp - hpet_read(HPET_REG_COUNTER)) > 0) break;
+        
+        count *= 2;
+    }
+}
+
+/**
+ * Остановка прерываний таймера 0
+ */
+static void hpet_shutdown(void) {
+    uint32_t config = hpet_read(HPET_REG_TIMER_CONFIG(0));
+    hpet_write(HPET_REG_TIMER_CONFIG(0), config & ~HPET_TIMER_INT_ENABLE);
+}
+
+// Устройство событий на компараторе таймера 0
+static clockevent_t hpet_clockevent = {
+    .name = "hpet",
+    .rating = HPET_CLOCKEVENT_RATING,
+    .min_delta_us = HPET_MIN_DELTA_US,
+    .max_delta_us = 0,          // Вычисляется в hpet_init
+    .set_next_event = hpet_set_next_event,
+    .shutdown = hpet_shutdown,
+};
+
+/**
+ * Обработчик прерывания таймера 0 (IRQ0 в режиме замещения)
+ */
+static void hpet_timer_handler(struct registers* regs) {
+    (void)regs;
+    
+    timer_event_handler();
+}
+
+/**
+ * Настройка таймера 0 как устройства событий
+ * @return true, если устройство зарегистрировано
+ */
+static bool hpet_clockevent_init(void) {
+    // Однократный режим, прерывание по фронту, 32-битный компаратор
+    uint32_t config = hpet_read(HPET_REG_TIMER_CONFIG(0));
+    config &= ~(HPET_TIMER_INT_ENABLE | HPET_TIMER_INT_LEVEL | HPET_TIMER_PERIODIC);
+    config |= HPET_TIMER_32BIT;
+    hpet_write(HPET_REG_TIMER_CONFIG(0), config);
+    
+    // Половина 32-битного диапазона, чтобы сравнение со знаком было верным
+    hpet_clockevent.max_delta_us =
+        (uint32_t)(((uint64_t)0x7FFFFFFF * hpet_period_fs) / 1000000000ull);
+    
+    if (!timer_register_clockevent(&hpet_clockevent)) {
+        return false;
+    }
+    
+    // Таймер 0 замещает PIT на IRQ0
+    hpet_write(HPET_REG_CONFIG, hpet_read(HPET_REG_CONFIG) | HPET_CONFIG_LEGACY);
+    irq_register_handler(0, hpet_timer_handler);
+    
+    return true;
+}
+
+/**
+ * Инициализация HPET
+ * Требует acpi_init(); регистрирует источник времени и устройство событий.
+ * @return true, если HPET найден и включен
+ */
+bool hpet_init(void) {
+    const acpi_hpet_t* table = (const acpi_hpet_t*)acpi_find_table("HPET");
+    if (table == NULL || table->address.address_space != ACPI_SPACE_MEMORY) {
+        #ifdef DEBUG
+        terminal_printf("HPET: not found\n");
+        #endif
+        return false;
+    }
+    
+    hpet_base = (volatile uint8_t*)(uint32_t)table->address.address;
+    
+    uint32_t caps = hpet_read(HPET_REG_CAPS);
+    uint32_t period = hpet_read(HPET_REG_CAPS + 4);
+    if (period == 0 || period > HPET_MAX_PERIOD_FS) {
+        hpet_base = NULL;
+        return false;
+    }
+    hpet_period_fs = period;
+    
+    // Останавливаем, обнуляем и запускаем главный счетчик
+    uint32_t config = hpet_read(HPET_REG_CONFIG);
+    hpet_write(HPET_REG_CONFIG, config & ~(HPET_CONFIG_ENABLE | HPET_CONFIG_LEGACY));
+    hpet_write(HPET_REG_COUNTER, 0);
+    hpet_write(HPET_REG_COUNTER + 4, 0);
+    hpet_write(HPET_REG_CONFIG, (config & ~HPET_CONFIG_LEGACY) | HPET_CONFIG_ENABLE);
+    
+    clock_scale_init(&hpet_ns2count, 1000000, hpet_period_fs);
+    
+    #ifdef DEBUG
+    terminal_printf("HPET: at %x, period %d fs, %d timers%s\n",
+                    (uint32_t)hpet_base, hpet_period_fs, ((caps >> 8) & 0x1F) + 1,
+                    (caps & HPET_CAPS_COUNT_64) ? ", 64-bit" : "");
+    #endif
+    
+    // 32-битный счетчик переполняется за минуты и не годится для часов
+    if (caps & HPET_CAPS_COUNT_64) {
+        hpet_clocksource.ns_num = hpet_period_fs;
+        clock_register_source(&hpet_clocksource);
+    }
+    
+    if (caps & HPET_CAPS_LEGACY_ROUTE) {
+        hpet_clockevent_init();
+    }
+    
+    return true;
+}
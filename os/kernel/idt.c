@@ -5,6 +5,8 @@
 #include "idt.h"
 #include "isr.h"
 #include "irq.h"
+#include "softirq.h"
+#include "irqstat.h"
 #include <string.h>
 
 // Глобальные переменные IDT
@@ -48,6 +50,24 @@ void isr_uninstall_handler(int isr) {
     }
 }
 
+/**
+ * Обработчик векторов локального APIC
+ * EOI отправляет сам обработчик вектора (ложному прерыванию он не нужен).
+ * @param regs Регистры на момент прерывания
+ */
+void vector_handler(struct registers* regs) {
+    irq_enter();
+    uint64_t start = irqstat_begin();
+    
+    isr_t handler = interrupt_handlers[regs->int_no & 0xFF];
+    if (handler) {
+        handler(regs);
+    }
+    
+    irqstat_end(regs->int_no, start);
+    irq_exit();
+}
+
 /**
  * Обработчик прерывания по умолчанию
  * @param r Регистры на момент прерывания
@@ -124,6 +144,21 @@ void idt_init(void) {
     idt_set_gate(46, (uint32_t)irq14, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
     idt_set_gate(47, (uint32_t)irq15, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
     
+    // Дополнительные входы IOAPIC (48-55)
+    idt_set_gate(48, (uint32_t)irq16, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(49, (uint32_t)irq17, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(50, (uint32_t)irq18, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(51, (uint32_t)irq19, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(52, (uint32_t)irq20, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(53, (uint32_t)irq21, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(54, (uint32_t)irq22, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(55, (uint32_t)irq23, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    
+    // Векторы локального APIC
+    idt_set_gate(239, (uint32_t)vector239, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(240, (uint32_t)vector240, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    idt_set_gate(255, (uint32_t)vector255, 0x08, IDT_FLAG_PRESENT | IDT_FLAG_RING0 | IDT_FLAG_32BIT_INT);
+    
     // Устанавливаем обработчик по умолчанию для всех прерываний
     for (int i = 0; i < IDT_ENTRIES; i++) {
         isr_install_handler(i, default_handler);
@@ -5,6 +5,7 @@ section .text
 ; Внешние функции из C
 extern isr_handler
 extern irq_handler
+extern vector_handler
 
 ; Макрос для создания обработчика исключения без кода ошибки
 %macro ISR_NOERRCODE 1
@@ -35,6 +36,17 @@ extern irq_handler
         jmp irq_common
 %endmacro
 
+; Макрос для создания обработчика вектора выше 127
+; (push byte расширяет знак, поэтому номер кладется как dword)
+%macro VECTOR 1
+    global vector%1
+    vector%1:
+        cli
+        push byte 0
+        push dword %1
+        jmp vector_common
+%endmacro
+
 ; Создаем обработчики исключений (0-31)
 ISR_NOERRCODE 0   ; Деление на ноль
 ISR_NOERRCODE 1   ; Отладка
@@ -87,6 +99,21 @@ IRQ 13, 45   ; FPU
 IRQ 14, 46   ; Первичный ATA
 IRQ 15, 47   ; Вторичный ATA
 
+; Дополнительные входы IOAPIC (линии PCI)
+IRQ 16, 48
+IRQ 17, 49
+IRQ 18, 50
+IRQ 19, 51
+IRQ 20, 52
+IRQ 21, 53
+IRQ 22, 54
+IRQ 23, 55
+
+; Векторы локального APIC
+VECTOR 239   ; Таймер LAPIC
+VECTOR 240   ; Межпроцессорное: перепланирование
+VECTOR 255   ; Ложное прерывание LAPIC
+
 ; Общий обработчик для исключений
 isr_common:
     ; Сохраняем все регистры
@@ -103,6 +130,7 @@ isr_common:
     mov ds, ax
     mov es, ax
     mov fs, ax
+    mov ax, 0x30          ; GS - область данных текущего процессора
     mov gs, ax
     
     ; Передаем указатель на структуру registers в C-обработчик
@@ -142,6 +170,7 @@ irq_common:
     mov ds, ax
     mov es, ax
     mov fs, ax
+    mov ax, 0x30          ; GS - область данных текущего процессора
     mov gs, ax
     
     ; Передаем указатель на структуру registers в C-обработчик
@@ -165,6 +194,46 @@ irq_common:
     sti
     iret
 
+; Общий обработчик для векторов APIC
+vector_common:
+    ; Сохраняем все регистры
+    pusha
+    
+    ; Сохраняем сегментные регистры
+    push ds
+    push es
+    push fs
+    push gs
+    
+    ; Загружаем сегмент данных ядра
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov ax, 0x30          ; GS - область данных текущего процессора
+    mov gs, ax
+    
+    ; Передаем указатель на структуру registers в C-обработчик
+    push esp
+    call vector_handler
+    add esp, 4
+    
+    ; Восстанавливаем сегментные регистры
+    pop gs
+    pop fs
+    pop es
+    pop ds
+    
+    ; Восстанавливаем регистры общего назначения
+    popa
+    
+    ; Очищаем код ошибки и номер прерывания из стека
+    add esp, 8
+    
+    ; Восстанавливаем состояние процессора и возвращаемся
+    sti
+    iret
+
 ; Функция загрузки IDT
 global idt_load
 idt_load:
@@ -0,0 +1,284 @@
+/**
+ * kernel/input.c - Очередь событий ввода (клавиатура и мышь)
+ *
+ * Обработчики IRQ1 и IRQ12 только кладут компактное событие с меткой
+ * TSC в кольцо, а главный цикл разбирает его. Кольцо рассчитано на
+ * одного писателя и одного читателя: писатели - обработчики IRQ, которые
+ * выполняются при запрещенных прерываниях на одном процессоре и поэтому
+ * не пересекаются, читатель - главный цикл. Блокировок нет: писатель
+ * меняет только input_head, читатель - только input_tail.
+ *
+ * Если читатель отстает, движение мыши не занимает последние
+ * INPUT_KEY_RESERVE мест, а накапливается в отложенном событии, которое
+ * уходит в кольцо одним пакетом, как только появится место. Клавиши
+ * могут занять кольцо целиком и не теряются, пока в нем есть место.
+ */
+
+#include "input.h"
+#include "cpu.h"
+#include "irq.h"
+#include "softirq.h"
+#include "latency.h"
+#include "sched.h"
+#include "timer.h"
+#include "wait.h"
+#include <stddef.h>
+
+#define INPUT_RING_MASK (INPUT_RING_SIZE - 1)
+
+// Барьер компилятора: запись события должна быть видна раньше индекса
+#define input_barrier() asm volatile("" : : : "memory")
+
+// Кольцо событий и индексы (счетчики без заворота, позиция - по маске)
+static input_event_t input_ring[INPUT_RING_SIZE];
+static volatile uint32_t input_head = 0;    // Пишет только производитель
+static volatile uint32_t input_tail = 0;    // Пишет только потребитель
+
+// Движение мыши, не поместившееся в кольцо (принадлежит производителю)
+static input_event_t input_motion;
+static bool input_motion_pending = false;
+
+static input_handler_t input_handlers[INPUT_EVENT_TYPES];
+
+// Потоки, ожидающие событий (input_wait)
+static wait_queue_t input_wait_queue = WAIT_QUEUE_INIT;
+static input_stats_t input_stats;
+
+/**
+ * Помещение события в кольцо
+ * @param event Событие
+ * @param limit Сколько мест кольца разрешено занять
+ * @return true, если событие помещено
+ */
+static bool input_ring_put(const input_event_t* event, uint32_t limit) {
+    uint32_t head = input_head;
+    uint32_t depth = head - input_tail;
+    if (depth >= limit) return false;
+    
+    input_ring[head & INPUT_RING_MASK] = *event;
+    input_barrier();
+    input_head = head + 1;
+    
+    wake_up(&input_wait_queue);
+    
+    input_stats.events++;
+    if (depth + 1 > input_stats.max_depth) {
+        input_stats.max_depth = depth + 1;
+    }
+    
+    return true;
+}
+
+/**
+ * Сложение перемещений с насыщением до int16_t
+ */
+static int16_t input_add_delta(int16_t a, int b) {
+    int sum = a + b;
+    if (sum > INT16_MAX) return INT16_MAX;
+    if (sum < INT16_MIN) return INT16_MIN;
+    return (int16_t)sum;
+}
+
+/**
+ * Сложение поворотов колеса с насыщением до int8_t
+ */
+static int8_t input_add_wheel(int8_t a, int b) {
+    int sum = a + b;
+    if (sum > INT8_MAX) return INT8_MAX;
+    if (sum < INT8_MIN) return INT8_MIN;
+    return (int8_t)sum;
+}
+
+/**
+ * Добавление пакета к отложенному движению
+ */
+static void input_motion_merge(int dx, int dy, int dz, uint8_t buttons) {
+    input_motion.dx = input_add_delta(input_motion.dx, dx);
+    input_motion.dy = input_add_delta(input_motion.dy, dy);
+    input_motion.dz = input_add_wheel(input_motion.dz, dz);
+    
+    // Кнопки - текущее состояние, а не приращение
+    input_motion.buttons = buttons;
+    input_stats.coalesced++;
+}
+
+/**
+ * Метка времени события: вход в текущий обработчик IRQ или, для
+ * синтетических событий, текущий момент
+ */
+static uint64_t input_timestamp(void) {
+    return in_interrupt() ? irq_entry_time() : cpu_rdtsc();
+}
+
+/**
+ * Сообщение о скан-коде (из обработчика IRQ1)
+ * @param scancode Скан-код из контроллера
+ */
+void input_report_key(uint8_t scancode) {
+    input_event_t event = {
+        .type = INPUT_EVENT_KEY,
+        .scancode = scancode,
+        .timestamp = input_timestamp(),
+    };
+    
+    if (!input_ring_put(&event, INPUT_RING_SIZE)) {
+        input_stats.dropped++;
+    }
+}
+
+/**
+ * Сообщение о пакете мыши (из обработчика IRQ12)
+ * @param dx Перемещение по X
+ * @param dy Перемещение по Y (вниз - положительное)
+ * @param dz Поворот колеса
+ * @param buttons Состояние кнопок
+ */
+void input_report_mouse(int dx, int dy, int dz, uint8_t buttons) {
+    uint32_t limit = INPUT_RING_SIZE - INPUT_KEY_RESERVE;
+    
+    if (input_motion_pending) {
+        if (input_motion.buttons == buttons) {
+            // Метка времени остается от первого пакета: задержка
+            // считается от самого старого необработанного движения
+            input_motion_merge(dx, dy, dz, buttons);
+            if (input_ring_put(&input_motion, limit)) {
+                input_motion_pending = false;
+            }
+            return;
+        }
+        
+        // Нажатие или отпускание кнопки: накопленное движение должно уйти
+        // раньше, для этого можно занять и резерв
+        if (!input_ring_put(&input_motion, INPUT_RING_SIZE)) {
+            input_motion_merge(dx, dy, dz, buttons);
+            return;
+        }
+        input_motion_pending = false;
+    }
+    
+    input_event_t event = {
+        .type = INPUT_EVENT_MOUSE,
+        .buttons = buttons,
+        .dz = (int8_t)dz,
+        .dx = (int16_t)dx,
+        .dy = (int16_t)dy,
+        .timestamp = input_timestamp(),
+    };
+    
+    if (!input_ring_put(&event, limit)) {
+        input_motion = event;
+        input_motion_pending = true;
+    }
+}
+
+/**
+ * Установка обработчика событий
+ * @param type Тип события
+ * @param handler Обработчик (NULL - события отбрасываются)
+ * @return Прежний обработчик (для временной подмены)
+ */
+input_handler_t input_set_handler(input_event_type_t type, input_handler_t handler) {
+    if (type >= INPUT_EVENT_TYPES) return NULL;
+    
+    input_handler_t old = input_handlers[type];
+    input_handlers[type] = handler;
+    return old;
+}
+
+/**
+ * Проверка, есть ли необработанные события
+ * Вызывается при запрещенных прерываниях перед простоем.
+ */
+bool input_pending(void) {
+    return input_head != input_tail || input_motion_pending;
+}
+
+/**
+ * Ожидание событий ввода
+ * Поток спит до следующего события, но не дольше INPUT_WAIT_MS:
+ * главный цикл тем временем успевает обновить курсор. Без
+ * планировщика процессор простаивает до прерывания.
+ */
+void input_wait(void) {
+    wait_event_timeout(&input_wait_queue, input_pending(), INPUT_WAIT_MS);
+}
+
+/**
+ * Перенос отложенного движения в кольцо
+ * Отложенное событие принадлежит производителю, поэтому переносится
+ * при запрещенных прерываниях.
+ */
+static void input_flush_motion(void) {
+    uint32_t flags = cpu_irq_save();
+    
+    if (input_motion_pending && input_ring_put(&input_motion, INPUT_RING_SIZE)) {
+        input_motion_pending = false;
+    }
+    
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Разбор очереди событий (главный цикл)
+ * Идущие подряд движения мыши с одинаковыми кнопками передаются
+ * обработчику одним событием.
+ * @return Количество переданных событий
+ */
+uint32_t input_process(void) {
+    uint32_t delivered = 0;
+    
+    // Читатель кольца должен быть один, а обработчики рисуют на экране:
+    // поток, разбирающий очередь, другие потоки не вытесняют
+    sched_preempt_disable();
+    
+    for (;;) {
+        uint32_t tail = input_tail;
+        if (tail == input_head) {
+            if (!input_motion_pending) break;
+            input_flush_motion();
+            continue;
+        }
+        
+        input_event_t event = input_ring[tail & INPUT_RING_MASK];
+        tail++;
+        
+        if (event.type == INPUT_EVENT_MOUSE) {
+            while (tail != input_head) {
+                const input_event_t* next = &input_ring[tail & INPUT_RING_MASK];
+                if (next->type != INPUT_EVENT_MOUSE || next->buttons != event.buttons) break;
+                
+                event.dx = input_add_delta(event.dx, next->dx);
+                event.dy = input_add_delta(event.dy, next->dy);
+                event.dz = input_add_wheel(event.dz, next->dz);
+                tail++;
+            }
+        }
+        
+        // Место освобождается до вызова обработчика: он может выполняться
+        // долго, а прерывания тем временем продолжают заполнять кольцо
+        input_barrier();
+        input_tail = tail;
+        
+        // Первый кадр, выведенный обработчиком, закрывает замер задержки
+        if (event.type < INPUT_EVENT_TYPES && input_handlers[event.type] != NULL) {
+            latency_input_begin(event.type, event.timestamp);
+            input_handlers[event.type](&event);
+            latency_input_end();
+        }
+        delivered++;
+    }
+    
+    sched_preempt_enable();
+    
+    return delivered;
+}
+
+/**
+ * Получение статистики очереди
+ * @param stats Куда записать
+ */
+void input_get_stats(input_stats_t* stats) {
+    uint32_t flags = cpu_irq_save();
+    *stats = input_stats;
+    cpu_irq_restore(flags);
+}
@@ -0,0 +1,242 @@
+/**
+ * kernel/ioapic.c - Контроллер прерываний ввода-вывода (IOAPIC)
+ *
+ * IOAPIC и переопределения IRQ ISA берутся из таблицы ACPI MADT.
+ * Номер IRQ ядра совпадает с IRQ ISA для линий 0-15 и с глобальным
+ * номером прерывания (GSI) для остальных; MADT может направить IRQ ISA
+ * на другой вход (например, IRQ0 таймера на GSI 2).
+ */
+
+#include "ioapic.h"
+#include "acpi.h"
+#include "cpu.h"
+#include "terminal.h"
+#include <stddef.h>
+
+// Биты элемента перенаправления (младшее слово)
+#define IOAPIC_REDIR_LEVEL      (1 << 15)
+#define IOAPIC_REDIR_ACTIVE_LOW (1 << 13)
+#define IOAPIC_REDIR_MASKED     (1 << 16)
+
+// Полярность и режим из флагов переопределения MADT
+#define MADT_POLARITY_MASK   0x3
+#define MADT_POLARITY_LOW    0x3
+#define MADT_TRIGGER_MASK    0xC
+#define MADT_TRIGGER_LEVEL   0xC
+
+// Регистр IMCR: переключение с 8259 на APIC на старых платах
+#define IMCR_SELECT_PORT 0x22
+#define IMCR_DATA_PORT   0x23
+
+// Описание одного IOAPIC
+typedef struct {
+    volatile uint32_t* base;
+    uint32_t gsi_base;
+    uint32_t gsi_count;
+} ioapic_t;
+
+static ioapic_t ioapics[IOAPIC_MAX];
+static uint32_t ioapic_count = 0;
+
+// Переопределения IRQ ISA: GSI и флаги полярности/режима
+static uint32_t isa_gsi[16];
+static uint16_t isa_flags[16];
+
+/**
+ * Чтение регистра IOAPIC
+ */
+static uint32_t ioapic_read(const ioapic_t* io, uint8_t reg) {
+    io->base[0] = reg;
+    return io->base[4];
+}
+
+/**
+ * Запись регистра IOAPIC
+ */
+static void ioapic_write(const ioapic_t* io, uint8_t reg, uint32_t value) {
+    io->base[0] = reg;
+    io->base[4] = value;
+}
+
+/**
+ * Поиск IOAPIC, обслуживающего GSI
+ * @param gsi Глобальный номер прерывания
+ * @param pin Номер входа внутри IOAPIC
+ * @return IOAPIC или NULL
+ */
+static const ioapic_t* ioapic_for_gsi(uint32_t gsi, uint32_t* pin) {
+    for (uint32_t i = 0; i < ioapic_count; i++) {
+        const ioapic_t* io = &ioapics[i];
+        if (gsi >= io->gsi_base && gsi < io->gsi_base + io->gsi_count) {
+            *pin = gsi - io->gsi_base;
+            return io;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Поиск IOAPIC по таблице MADT и маскирование всех входов
+ * @return true, если найден хотя бы один IOAPIC
+ */
+bool ioapic_init(void) {
+    const acpi_madt_t* madt = (const acpi_madt_t*)acpi_find_table("APIC");
+    if (madt == NULL) {
+        #ifdef DEBUG
+        terminal_printf("IOAPIC: no MADT\n");
+        #endif
+        return false;
+    }
+    
+    // По умолчанию IRQ ISA идут на одноименный GSI, фронт, высокий уровень
+    for (int i = 0; i < 16; i++) {
+        isa_gsi[i] = i;
+        isa_flags[i] = 0;
+    }
+    
+    ioapic_count = 0;
+    for (const acpi_madt_entry_t* e = acpi_madt_next(madt, NULL); e != NULL; e = acpi_madt_next(madt, e)) {
+        if (e->type == ACPI_MADT_IOAPIC && ioapic_count < IOAPIC_MAX) {
+            const acpi_madt_ioapic_t* entry = (const acpi_madt_ioapic_t*)e;
+            ioapic_t* io = &ioapics[ioapic_count++];
+            
+            io->base = (volatile uint32_t*)entry->address;
+            io->gsi_base = entry->gsi_base;
+            io->gsi_count = ((ioapic_read(io, IOAPIC_REG_VERSION) >> 16) & 0xFF) + 1;
+        } else if (e->type == ACPI_MADT_OVERRIDE) {
+            const acpi_madt_override_t* entry = (const acpi_madt_override_t*)e;
+            if (entry->bus == 0 && entry->source < 16) {
+                isa_gsi[entry->source] = entry->gsi;
+                isa_flags[entry->source] = entry->flags;
+            }
+        }
+    }
+    
+    if (ioapic_count == 0) return false;
+    
+    // Все входы замаскированы до регистрации обработчиков
+    for (uint32_t i = 0; i < ioapic_count; i++) {
+        for (uint32_t pin = 0; pin < ioapics[i].gsi_count; pin++) {
+            ioapic_write(&ioapics[i], IOAPIC_REG_REDIR(pin), IOAPIC_REDIR_MASKED);
+            ioapic_write(&ioapics[i], IOAPIC_REG_REDIR(pin) + 1, 0);
+        }
+    }
+    
+    // Плата с совместимостью PC/AT: переводим IMCR в режим APIC
+    if (madt->flags & ACPI_MADT_PCAT_COMPAT) {
+        outb(IMCR_SELECT_PORT, 0x70);
+        outb(IMCR_DATA_PORT, inb(IMCR_DATA_PORT) | 0x01);
+    }
+    
+    #ifdef DEBUG
+    terminal_printf("IOAPIC: %d controller(s), %d inputs\n", ioapic_count, ioapic_get_gsi_count());
+    #endif
+    
+    return true;
+}
+
+/**
+ * Общее количество входов всех IOAPIC
+ */
+uint32_t ioapic_get_gsi_count(void) {
+    uint32_t max = 0;
+    
+    for (uint32_t i = 0; i < ioapic_count; i++) {
+        uint32_t end = ioapics[i].gsi_base + ioapics[i].gsi_count;
+        if (end > max) max = end;
+    }
+    
+    return max;
+}
+
+/**
+ * GSI для IRQ ядра с учетом переопределений ISA
+ */
+uint32_t ioapic_irq_to_gsi(uint8_t irq) {
+    return irq < 16 ? isa_gsi[irq] : irq;
+}
+
+/**
+ * Проверка, занят ли GSI линии переопределением другой линии ISA
+ * При обычном переопределении IRQ0 -> GSI2 линия 2 (каскад 8259) своего
+ * входа не имеет: настройка GSI2 для нее перебила бы вход таймера.
+ * @param irq IRQ ядра
+ */
+static bool ioapic_irq_shadowed(uint8_t irq) {
+    uint32_t gsi = ioapic_irq_to_gsi(irq);
+    
+    for (uint8_t other = 0; other < 16; other++) {
+        if (other != irq && isa_gsi[other] != other && isa_gsi[other] == gsi) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+/**
+ * Настройка элемента перенаправления (вход остается замаскированным)
+ * Линии ISA по умолчанию срабатывают по фронту высокого уровня,
+ * линии PCI (GSI 16 и выше) - по низкому уровню.
+ * @param irq IRQ ядра
+ * @param vector Вектор прерывания
+ * @param dest_apic_id LAPIC процессора-получателя
+ * @return false, если у IRQ нет своего входа IOAPIC
+ */
+bool ioapic_route_irq(uint8_t irq, uint8_t vector, uint8_t dest_apic_id) {
+    if (ioapic_irq_shadowed(irq)) return false;
+    
+    uint32_t pin;
+    const ioapic_t* io = ioapic_for_gsi(ioapic_irq_to_gsi(irq), &pin);
+    if (io == NULL) return false;
+    
+    uint32_t low = vector | IOAPIC_REDIR_MASKED;
+    
+    if (irq < 16) {
+        uint16_t flags = isa_flags[irq];
+        if ((flags & MADT_POLARITY_MASK) == MADT_POLARITY_LOW) low |= IOAPIC_REDIR_ACTIVE_LOW;
+        if ((flags & MADT_TRIGGER_MASK) == MADT_TRIGGER_LEVEL) low |= IOAPIC_REDIR_LEVEL;
+    } else {
+        low |= IOAPIC_REDIR_ACTIVE_LOW | IOAPIC_REDIR_LEVEL;
+    }
+    
+    // Фиксированная доставка, физический адрес получателя
+    ioapic_write(io, IOAPIC_REG_REDIR(pin) + 1, (uint32_t)dest_apic_id << 24);
+    ioapic_write(io, IOAPIC_REG_REDIR(pin), low);
+    
+    return true;
+}
+
+/**
+ * Изменение маски входа IRQ
+ */
+static void ioapic_set_mask(uint8_t irq, bool masked) {
+    if (ioapic_irq_shadowed(irq)) return;
+    
+    uint32_t pin;
+    const ioapic_t* io = ioapic_for_gsi(ioapic_irq_to_gsi(irq), &pin);
+    if (io == NULL) return;
+    
+    uint32_t low = ioapic_read(io, IOAPIC_REG_REDIR(pin));
+    if (masked) {
+        low |= IOAPIC_REDIR_MASKED;
+    } else {
+        low &= ~IOAPIC_REDIR_MASKED;
+    }
+    ioapic_write(io, IOAPIC_REG_REDIR(pin), low);
+}
+
+/**
+ * Маскирование входа IRQ
+ */
+void ioapic_mask_irq(uint8_t irq) {
+    ioapic_set_mask(irq, true);
+}
+
+/**
+ * Снятие маски со входа IRQ
+ */
+void ioapic_unmask_irq(uint8_t irq) {
+    ioapic_set_mask(irq, false);
+}
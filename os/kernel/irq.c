@@ -1,17 +1,34 @@
 /**
  * kernel/irq.c - Обработчики аппаратных прерываний (IRQ)
+ *
+ * При загрузке прерывания идут через пару 8259. Если найдены LAPIC и
+ * IOAPIC, irq_enable_apic() маскирует 8259 и переводит линии на IOAPIC:
+ * EOI становится одной записью в MMIO LAPIC, а линий становится больше 16.
  */
 
 #include "irq.h"
 #include "idt.h"
+#include "lapic.h"
+#include "ioapic.h"
 #include "timer.h"
 #include "keyboard.h"
 #include "mouse.h"
 #include "terminal.h"
+#include "softirq.h"
+#include "irqstat.h"
 #include <stddef.h>
 
 // Массив обработчиков IRQ
-irq_handler_t irq_handlers[16];
+irq_handler_t irq_handlers[IRQ_LINES];
+
+// Уведомление о прерываниях (ожидающие сопрограммы)
+static volatile irq_notify_t irq_notifier = NULL;
+
+// Прерывания доставляются через IOAPIC и LAPIC
+static bool irq_apic_mode = false;
+
+// Показание TSC на входе в текущий обработчик
+static uint64_t irq_entry_cycles = 0;
 
 // Порт контроллера прерываний для отправки EOI
 #define PIC1_CMD  0x20
@@ -27,23 +44,42 @@ irq_handler_t irq_handlers[16];
  * @param regs Регистры на момент прерывания
  */
 void irq_handler(struct registers* regs) {
+    irq_enter();
+    uint64_t start = irqstat_begin();
+    irq_entry_cycles = start;
+    
+    uint32_t irq = regs->int_no - IRQ_VECTOR_BASE;
+    
     // Проверяем, есть ли зарегистрированный обработчик для этого IRQ
-    if (irq_handlers[regs->int_no - 32] != NULL) {
-        irq_handlers[regs->int_no - 32](regs);
+    if (irq < IRQ_LINES && irq_handlers[irq] != NULL) {
+        irq_handlers[irq](regs);
     } else {
         // Если обработчика нет, выводим предупреждение (только для отладки)
         // В реальной системе лучше игнорировать
         #ifdef DEBUG
-        terminal_printf("Unhandled IRQ: %d\n", regs->int_no - 32);
+        terminal_printf("Unhandled IRQ: %d\n", irq);
         #endif
     }
     
+    if (irq < IRQ_LINES && irq_notifier != NULL) {
+        irq_notifier((int)irq);
+    }
+    
     // Отправляем End Of Interrupt контроллеру прерываний
-    if (regs->int_no >= 40) {
-        // Если прерывание от ведомого контроллера
-        outb(PIC2_CMD, PIC_EOI);
+    if (irq_apic_mode) {
+        lapic_eoi();
+    } else {
+        if (irq >= 8) {
+            // Если прерывание от ведомого контроллера
+            outb(PIC2_CMD, PIC_EOI);
+        }
+        outb(PIC1_CMD, PIC_EOI);
     }
-    outb(PIC1_CMD, PIC_EOI);
+    
+    irqstat_end(regs->int_no, start);
+    
+    // Отложенная работа выполняется уже при разрешенных прерываниях
+    irq_exit();
 }
 
 /**
@@ -72,46 +108,130 @@ static void pic_remap(void) {
 }
 
 /**
- * Регистрация обработчика IRQ
+ * Изменение маски линии 8259
  * @param irq Номер IRQ (0-15)
+ * @param masked true - замаскировать
+ */
+static void pic_set_mask(int irq, bool masked) {
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    uint8_t bit = 1 << (irq & 7);
+    uint8_t mask = inb(port);
+    
+    mask = masked ? (mask | bit) : (mask & ~bit);
+    outb(port, mask);
+    
+    // Линии ведомого контроллера приходят через каскад IRQ2
+    if (irq >= 8 && !masked) {
+        outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << 2));
+    }
+}
+
+/**
+ * Регистрация обработчика IRQ
+ * @param irq Номер IRQ (0-15, в режиме APIC - до IRQ_LINES-1)
  * @param handler Указатель на функцию-обработчик
  */
 void irq_register_handler(int irq, irq_handler_t handler) {
-    if (irq >= 0 && irq < 16) {
-        irq_handlers[irq] = handler;
-        
-        // Снимаем маску с этого прерывания
-        if (irq < 8) {
-            uint8_t mask = inb(PIC1_DATA);
-            mask &= ~(1 << irq);
-            outb(PIC1_DATA, mask);
-        } else {
-            uint8_t mask = inb(PIC2_DATA);
-            mask &= ~(1 << (irq - 8));
-            outb(PIC2_DATA, mask);
-        }
+    if (irq < 0 || irq >= IRQ_LINES) return;
+    if (!irq_apic_mode && irq >= IRQ_LEGACY_LINES) return;
+    
+    uint32_t flags = cpu_irq_save();
+    
+    irq_handlers[irq] = handler;
+    
+    // Снимаем маску с этого прерывания
+    if (irq_apic_mode) {
+        ioapic_unmask_irq(irq);
+    } else {
+        pic_set_mask(irq, false);
     }
+    
+    cpu_irq_restore(flags);
 }
 
 /**
  * Удаление обработчика IRQ
- * @param irq Номер IRQ (0-15)
+ * @param irq Номер IRQ
  */
 void irq_unregister_handler(int irq) {
-    if (irq >= 0 && irq < 16) {
-        irq_handlers[irq] = NULL;
-        
-        // Устанавливаем маску на это прерывание
-        if (irq < 8) {
-            uint8_t mask = inb(PIC1_DATA);
-            mask |= (1 << irq);
-            outb(PIC1_DATA, mask);
-        } else {
-            uint8_t mask = inb(PIC2_DATA);
-            mask |= (1 << (irq - 8));
-            outb(PIC2_DATA, mask);
+    if (irq < 0 || irq >= IRQ_LINES) return;
+    
+    uint32_t flags = cpu_irq_save();
+    
+    irq_handlers[irq] = NULL;
+    
+    // Устанавливаем маску на это прерывание
+    if (irq_apic_mode) {
+        ioapic_mask_irq(irq);
+    } else if (irq < IRQ_LEGACY_LINES) {
+        pic_set_mask(irq, true);
+    }
+    
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Установка уведомления о прерываниях
+ * Вызывается на каждое прерывание до EOI, поэтому должно быть коротким.
+ * @param notify Функция или NULL
+ */
+void irq_set_notifier(irq_notify_t notify) {
+    irq_notifier = notify;
+}
+
+/**
+ * Переход на доставку прерываний через IOAPIC
+ * Требует включенного LAPIC и acpi_init(). Все линии направляются на
+ * текущий процессор с векторами IRQ_VECTOR_BASE + n; линии с уже
+ * зарегистрированными обработчиками остаются размаскированными.
+ * Линия, чей GSI занят переопределением другой линии ISA (IRQ2 при
+ * IRQ0 -> GSI2), не настраивается (см. ioapic_route_irq).
+ * @return true, если режим APIC включен
+ */
+bool irq_enable_apic(void) {
+    if (!lapic_is_enabled() || !ioapic_init()) return false;
+    
+    uint32_t flags = cpu_irq_save();
+    
+    // 8259 больше не используется
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+    
+    uint8_t dest = lapic_id();
+    for (int irq = 0; irq < IRQ_LINES; irq++) {
+        if (ioapic_route_irq(irq, IRQ_VECTOR_BASE + irq, dest) && irq_handlers[irq] != NULL) {
+            ioapic_unmask_irq(irq);
         }
     }
+    
+    // LINT0 (ExtINT от 8259) отключаем, LINT1 - NMI
+    lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_NMI);
+    
+    irq_apic_mode = true;
+    
+    cpu_irq_restore(flags);
+    
+    #ifdef DEBUG
+    terminal_printf("IRQ: APIC mode, %d lines\n", IRQ_LINES);
+    #endif
+    
+    return true;
+}
+
+/**
+ * Проверка, доставляются ли прерывания через APIC
+ */
+bool irq_is_apic(void) {
+    return irq_apic_mode;
+}
+
+/**
+ * Показание TSC на входе в текущий обработчик IRQ
+ * Драйверы ставят его меткой времени на события устройства.
+ */
+uint64_t irq_entry_time(void) {
+    return irq_entry_cycles;
 }
 
 /**
@@ -119,7 +239,7 @@ void irq_unregister_handler(int irq) {
  */
 void irq_init(void) {
     // Очищаем массив обработчиков
-    for (int i = 0; i < 16; i++) {
+    for (int i = 0; i < IRQ_LINES; i++) {
         irq_handlers[i] = NULL;
     }
     
@@ -0,0 +1,266 @@
+/**
+ * kernel/irqstat.c - Статистика задержек и частоты прерываний
+ *
+ * Диспетчеры прерываний отмечают TSC на входе и выходе обработчика.
+ * Счетчики хранятся отдельно для каждого процессора: блок процессора
+ * выровнен по строке кэша, и запись идет без блокировок.
+ */
+
+#include "irqstat.h"
+#include "irq.h"
+#include "lapic.h"
+#include "smp.h"
+#include "clock.h"
+#include "input.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Размер строки кэша
+#define CACHE_LINE 64
+
+// Счетчики одного процессора
+typedef struct {
+    irqstat_entry_t vectors[IDT_ENTRIES];
+    irqstat_entry_t softirqs[SOFTIRQ_COUNT];
+} __attribute__((aligned(CACHE_LINE))) irqstat_cpu_t;
+
+static irqstat_cpu_t irqstat_cpus[CPU_MAX];
+
+// Момент последнего сброса (для расчета частоты)
+static uint64_t irqstat_since_ns = 0;
+
+// Имена softirq для вывода
+static const char* softirq_names[SOFTIRQ_COUNT] = {
+    "timer", "tasklet"
+};
+
+/**
+ * Учет одного выполнения обработчика
+ * @param e Счетчики
+ * @param start Значение TSC на входе
+ */
+static inline void irqstat_account(irqstat_entry_t* e, uint64_t start) {
+    uint32_t cycles = (uint32_t)(cpu_rdtsc() - start);
+    
+    e->count++;
+    e->total_cycles += cycles;
+    if (cycles > e->max_cycles) e->max_cycles = cycles;
+    
+    uint32_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+    if (bucket >= IRQSTAT_HIST_BUCKETS) bucket = IRQSTAT_HIST_BUCKETS - 1;
+    e->hist[bucket]++;
+}
+
+/**
+ * Отметка выхода из обработчика вектора (прерывания запрещены)
+ * @param vector Вектор прерывания
+ * @param start Значение, возвращенное irqstat_begin
+ */
+void irqstat_end(uint32_t vector, uint64_t start) {
+    irqstat_account(&irqstat_cpus[cpu_current()].vectors[vector & 0xFF], start);
+}
+
+/**
+ * Отметка выхода из обработчика softirq
+ * @param nr Номер softirq
+ * @param start Значение, возвращенное irqstat_begin
+ */
+void irqstat_softirq_end(softirq_nr_t nr, uint64_t start) {
+    uint32_t flags = cpu_irq_save();
+    irqstat_account(&irqstat_cpus[cpu_current()].softirqs[nr], start);
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Сброс всех счетчиков
+ */
+void irqstat_reset(void) {
+    uint32_t flags = cpu_irq_save();
+    memset(irqstat_cpus, 0, sizeof(irqstat_cpus));
+    irqstat_since_ns = clock_ns();
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Сумма счетчиков по всем процессорам
+ * @param out Результат
+ * @param vector Вектор или -1 - номер softirq в nr
+ * @param nr Номер softirq (если vector < 0)
+ */
+static void irqstat_sum(irqstat_entry_t* out, int vector, int nr) {
+    memset(out, 0, sizeof(*out));
+    
+    for (int cpu = 0; cpu < CPU_MAX; cpu++) {
+        const irqstat_entry_t* e = vector >= 0 ? &irqstat_cpus[cpu].vectors[vector]
+                                               : &irqstat_cpus[cpu].softirqs[nr];
+        
+        out->count += e->count;
+        out->total_cycles += e->total_cycles;
+        if (e->max_cycles > out->max_cycles) out->max_cycles = e->max_cycles;
+        for (int b = 0; b < IRQSTAT_HIST_BUCKETS; b++) {
+            out->hist[b] += e->hist[b];
+        }
+    }
+}
+
+/**
+ * Перевод циклов TSC в наносекунды
+ */
+static uint32_t irqstat_cycles_to_ns(uint64_t cycles) {
+    uint32_t khz = clock_get_tsc_khz();
+    if (khz == 0) return 0;
+    return (uint32_t)((cycles * 1000000ull) / khz);
+}
+
+/**
+ * Имя вектора для вывода
+ * @param vector Вектор
+ * @param buffer Буфер (минимум 16 символов)
+ */
+static const char* irqstat_vector_name(int vector, char* buffer) {
+    if (vector == LAPIC_TIMER_VECTOR) return "lapic-timer";
+    if (vector == LAPIC_SPURIOUS_VECTOR) return "spurious";
+    if (vector == SMP_RESCHED_VECTOR) return "resched";
+    
+    if (vector >= IRQ_VECTOR_BASE && vector < IRQ_VECTOR_BASE + IRQ_LINES) {
+        int irq = vector - IRQ_VECTOR_BASE;
+        buffer[0] = 'I';
+        buffer[1] = 'R';
+        buffer[2] = 'Q';
+        if (irq >= 10) {
+            buffer[3] = '0' + irq / 10;
+            buffer[4] = '0' + irq % 10;
+            buffer[5] = '\0';
+        } else {
+            buffer[3] = '0' + irq;
+            buffer[4] = '\0';
+        }
+        return buffer;
+    }
+    
+    return "vector";
+}
+
+/**
+ * Вывод одной строки таблицы
+ */
+static void irqstat_print_row(int vector, const char* name, const irqstat_entry_t* e,
+                              uint32_t seconds) {
+    uint32_t avg = e->count ? irqstat_cycles_to_ns(e->total_cycles / e->count) : 0;
+    uint32_t rate = seconds ? e->count / seconds : e->count;
+    
+    if (vector >= 0) {
+        terminal_printf("%x %s: %d, %d/s, avg %d ns, max %d ns\n",
+                        vector, name, e->count, rate, avg,
+                        irqstat_cycles_to_ns(e->max_cycles));
+    } else {
+        terminal_printf("softirq %s: %d, %d/s, avg %d ns, max %d ns\n",
+                        name, e->count, rate, avg,
+                        irqstat_cycles_to_ns(e->max_cycles));
+    }
+}
+
+/**
+ * Вывод гистограммы
+ */
+static void irqstat_print_hist(const irqstat_entry_t* e) {
+    for (int b = 0; b < IRQSTAT_HIST_BUCKETS; b++) {
+        if (e->hist[b] == 0) continue;
+        
+        if (b == IRQSTAT_HIST_BUCKETS - 1) {
+            terminal_printf("  >= %d ns: %d\n", irqstat_cycles_to_ns(1ull << b), e->hist[b]);
+        } else {
+            terminal_printf("  %d-%d ns: %d\n", irqstat_cycles_to_ns(1ull << b),
+                            irqstat_cycles_to_ns(2ull << b), e->hist[b]);
+        }
+    }
+}
+
+/**
+ * Разбор номера вектора (десятичного или 0x...)
+ * @return Вектор или -1
+ */
+static int irqstat_parse_vector(const char* s) {
+    int value = 0;
+    int base = 10;
+    
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        base = 16;
+        s += 2;
+    }
+    if (*s == '\0') return -1;
+    
+    for (; *s != '\0'; s++) {
+        int digit;
+        if (*s >= '0' && *s <= '9') digit = *s - '0';
+        else if (base == 16 && *s >= 'a' && *s <= 'f') digit = *s - 'a' + 10;
+        else if (base == 16 && *s >= 'A' && *s <= 'F') digit = *s - 'A' + 10;
+        else return -1;
+        
+        value = value * base + digit;
+        if (value >= IDT_ENTRIES) return -1;
+    }
+    
+    return value;
+}
+
+/**
+ * Команда: irqstat [reset | <вектор>] - статистика прерываний
+ */
+static void cmd_irqstat(int argc, char** argv) {
+    irqstat_entry_t e;
+    char name[16];
+    
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        irqstat_reset();
+        terminal_print_line("Interrupt statistics reset");
+        return;
+    }
+    
+    // Гистограмма одного вектора
+    if (argc > 1) {
+        int vector = irqstat_parse_vector(argv[1]);
+        if (vector < 0) {
+            terminal_print_line("Usage: irqstat [reset | <vector>]");
+            return;
+        }
+        
+        irqstat_sum(&e, vector, 0);
+        irqstat_print_row(vector, irqstat_vector_name(vector, name), &e, 0);
+        irqstat_print_hist(&e);
+        return;
+    }
+    
+    if (clock_get_tsc_khz() == 0) {
+        terminal_print_line("No TSC: only counts are recorded");
+    }
+    
+    uint32_t seconds = (uint32_t)((clock_ns() - irqstat_since_ns) / NSEC_PER_SEC);
+    
+    for (int vector = 0; vector < IDT_ENTRIES; vector++) {
+        irqstat_sum(&e, vector, 0);
+        if (e.count == 0) continue;
+        irqstat_print_row(vector, irqstat_vector_name(vector, name), &e, seconds);
+    }
+    
+    for (int nr = 0; nr < SOFTIRQ_COUNT; nr++) {
+        irqstat_sum(&e, -1, nr);
+        if (e.count == 0) continue;
+        irqstat_print_row(-1, softirq_names[nr], &e, seconds);
+    }
+    
+    input_stats_t input;
+    input_get_stats(&input);
+    terminal_printf("input: %d events, %d coalesced, %d dropped, max depth %d/%d\n",
+                    input.events, input.coalesced, input.dropped, input.max_depth, INPUT_RING_SIZE);
+}
+
+/**
+ * Инициализация статистики и регистрация команды irqstat
+ */
+void irqstat_init(void) {
+    irqstat_reset();
+    cmdreg_register("irqstat", "Show interrupt latency statistics", cmd_irqstat);
+}
@@ -6,6 +6,8 @@
 #include "idt.h"
 #include "terminal.h"
 #include "framebuffer.h"
+#include "proc.h"
+#include "sched.h"
 #include <stddef.h>
 
 // Массив обработчиков исключений
@@ -52,6 +54,17 @@ static const char* exception_messages[] = {
  * @param regs Регистры на момент исключения
  */
 void isr_handler(struct registers* regs) {
+    // #NM: поток впервые после переключения обратился к FPU -
+    // загружаем его состояние (в любом кольце)
+    if (regs->int_no == EXCEPTION_DEVICE_NOT_AVAILABLE && sched_fpu_trap()) {
+        return;
+    }
+    
+    // Исключение в кольце 3 завершает процесс, а не систему
+    if ((regs->cs & 3) == 3) {
+        proc_fault(regs);
+    }
+    
     // Проверяем, есть ли зарегистрированный обработчик
     if (exception_handlers[regs->int_no] != NULL) {
         exception_handlers[regs->int_no](regs);
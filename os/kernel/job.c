@@ -0,0 +1,488 @@
+/**
+ * kernel/job.c - Система заданий с перехватом работы (work stealing)
+ *
+ * У каждого работающего процессора есть поток-исполнитель и очередь
+ * Chase-Lev: владелец кладет и забирает задания с нижнего конца без
+ * блокировок, остальные перехватывают их с верхнего конца через CAS.
+ * Владелец очереди - процессор: потоки к процессору привязаны, и
+ * операции владельца выполняются при запрещенном вытеснении.
+ *
+ * Задание с потомками завершается, когда счетчик незавершенных (само
+ * задание плюс потомки) доходит до нуля. Ожидающий в job_wait() не спит,
+ * а сам выполняет задания из своей и чужих очередей.
+ *
+ * Задания не должны трогать драйверы, терминал и GUI: те не защищены
+ * блокировками. Подходит работа над памятью - заливка и копирование
+ * полос framebuffer.
+ */
+
+#include "job.h"
+#include "sched.h"
+#include "smp.h"
+#include "softirq.h"
+#include "framebuffer.h"
+#include "clock.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Размер строки кэша
+#define CACHE_LINE 64
+
+// Повторов заливки экрана в "jobs bench"
+#define JOB_BENCH_ITERATIONS 16
+
+// Очередь Chase-Lev фиксированного размера
+typedef struct {
+    volatile uint32_t top;              // Сюда приходят перехватчики
+    uint8_t pad[CACHE_LINE - sizeof(uint32_t)];
+    volatile uint32_t bottom;           // Конец владельца
+    job_t* volatile buffer[JOB_DEQUE_SIZE];
+} __attribute__((aligned(CACHE_LINE))) job_deque_t;
+
+// Данные процессора
+typedef struct {
+    job_t pool[JOB_POOL_SIZE];
+    uint32_t cursor;                    // Откуда искать свободный слот
+    thread_t* worker;
+    uint32_t executed;                  // Выполнено заданий на процессоре
+    uint32_t stolen;                    // Из них перехвачено у других
+} __attribute__((aligned(CACHE_LINE))) job_cpu_t;
+
+static job_deque_t job_deques[CPU_MAX];
+static job_cpu_t job_cpus[CPU_MAX];
+
+// Исполнители, ушедшие в sched_block() (бит на процессор)
+static volatile uint32_t job_idle_mask = 0;
+
+static uint32_t job_workers = 0;
+static bool job_ready = false;
+static bool job_enabled = true;
+
+// Описание цикла parallel_for (живет на стеке вызывающего)
+typedef struct {
+    job_range_func_t func;
+    void* data;
+    uint32_t grain;
+} job_range_t;
+
+/**
+ * Добавление задания владельцем очереди
+ * @return false, если очередь заполнена
+ */
+static bool job_deque_push(job_deque_t* d, job_t* job) {
+    uint32_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    uint32_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    
+    if (b - t >= JOB_DEQUE_SIZE) return false;
+    
+    __atomic_store_n(&d->buffer[b & (JOB_DEQUE_SIZE - 1)], job, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Извлечение последнего задания владельцем очереди
+ * За последнее задание владелец соревнуется с перехватчиками через CAS.
+ * @return Задание или NULL
+ */
+static job_t* job_deque_pop(job_deque_t* d) {
+    uint32_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint32_t t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    
+    if ((int32_t)(b - t) < 0) {
+        // Очередь пуста
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    
+    job_t* job = __atomic_load_n(&d->buffer[b & (JOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (b != t) return job;
+    
+    // Последнее задание
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        job = NULL;
+    }
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    return job;
+}
+
+/**
+ * Перехват первого задания чужой очереди
+ * @return Задание или NULL (очередь пуста или проигран CAS)
+ */
+static job_t* job_deque_steal(job_deque_t* d) {
+    uint32_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint32_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    
+    if ((int32_t)(b - t) <= 0) return NULL;
+    
+    job_t* job = __atomic_load_n(&d->buffer[t & (JOB_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return job;
+}
+
+/**
+ * Проверка, есть ли задания хотя бы в одной очереди
+ */
+static bool job_pending(void) {
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        job_deque_t* d = &job_deques[cpu];
+        uint32_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+        uint32_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+        if ((int32_t)(b - t) > 0) return true;
+    }
+    return false;
+}
+
+/**
+ * Выделение задания из пула текущего процессора
+ * Освобождать задание может любой процессор (in_use = 0).
+ * @return Задание или NULL, если пул исчерпан
+ */
+static job_t* job_alloc(job_func_t func, void* data) {
+    sched_preempt_disable();
+    job_cpu_t* jc = &job_cpus[cpu_current()];
+    job_t* job = NULL;
+    
+    for (uint32_t i = 0; i < JOB_POOL_SIZE; i++) {
+        job_t* candidate = &jc->pool[(jc->cursor + i) & (JOB_POOL_SIZE - 1)];
+        if (__atomic_load_n(&candidate->in_use, __ATOMIC_ACQUIRE)) continue;
+        
+        candidate->in_use = 1;
+        jc->cursor = (jc->cursor + i + 1) & (JOB_POOL_SIZE - 1);
+        job = candidate;
+        break;
+    }
+    
+    sched_preempt_enable();
+    
+    if (job == NULL) return NULL;
+    
+    job->func = func;
+    job->data = data;
+    job->parent = NULL;
+    job->unfinished = 1;
+    job->begin = 0;
+    job->end = 0;
+    return job;
+}
+
+/**
+ * Возврат задания в пул
+ */
+static void job_free(job_t* job) {
+    __atomic_store_n(&job->in_use, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Создание корневого задания
+ * @param func Функция задания
+ * @param data Аргумент
+ * @return Задание или NULL, если пул исчерпан
+ */
+job_t* job_create(job_func_t func, void* data) {
+    return job_alloc(func, data);
+}
+
+/**
+ * Создание потомка: родитель не завершится раньше него
+ * @param parent Родительское задание (еще не завершенное)
+ * @param func Функция задания
+ * @param data Аргумент
+ * @return Задание или NULL, если пул исчерпан
+ */
+job_t* job_create_child(job_t* parent, job_func_t func, void* data) {
+    job_t* job = job_alloc(func, data);
+    if (job == NULL) return NULL;
+    
+    __atomic_add_fetch(&parent->unfinished, 1, __ATOMIC_RELAXED);
+    job->parent = parent;
+    return job;
+}
+
+/**
+ * Завершение задания и, по цепочке, его предков
+ * Корень не освобождается: его освобождает job_wait().
+ */
+static void job_finish(job_t* job) {
+    while (job != NULL) {
+        job_t* parent = job->parent;
+        
+        if (__atomic_sub_fetch(&job->unfinished, 1, __ATOMIC_ACQ_REL) != 0) return;
+        
+        if (parent != NULL) job_free(job);
+        job = parent;
+    }
+}
+
+/**
+ * Выполнение задания
+ */
+static void job_execute(job_t* job) {
+    job->func(job, job->data);
+    job_finish(job);
+}
+
+/**
+ * Следующее задание для текущего процессора
+ * Сначала своя очередь (последнее добавленное - данные еще в кэше),
+ * затем перехват у остальных, начиная со следующего процессора.
+ * @return Задание или NULL
+ */
+static job_t* job_next(void) {
+    sched_preempt_disable();
+    uint32_t self = cpu_current();
+    job_t* job = job_deque_pop(&job_deques[self]);
+    sched_preempt_enable();
+    
+    if (job != NULL) return job;
+    
+    for (uint32_t i = 1; i < CPU_MAX; i++) {
+        uint32_t victim = (self + i) % CPU_MAX;
+        job = job_deque_steal(&job_deques[victim]);
+        if (job != NULL) {
+            job_cpus[self].stolen++;
+            return job;
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Пробуждение одного простаивающего исполнителя на другом процессоре
+ * Свой процессор не будим: вызвавший сам выполнит свою очередь.
+ */
+static void job_wake_one(void) {
+    // Задание уже в очереди; маску читаем строго после этой записи
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    
+    uint32_t self_bit = 1u << cpu_current();
+    uint32_t mask = __atomic_load_n(&job_idle_mask, __ATOMIC_ACQUIRE) & ~self_bit;
+    
+    while (mask) {
+        uint32_t cpu = __builtin_ctz(mask);
+        uint32_t bit = 1u << cpu;
+        
+        // Бит снимает тот, кто будит: второго пробуждения не будет
+        if (__atomic_fetch_and(&job_idle_mask, ~bit, __ATOMIC_ACQ_REL) & bit) {
+            sched_wake(job_cpus[cpu].worker);
+            return;
+        }
+        mask &= ~bit;
+    }
+}
+
+/**
+ * Постановка задания в очередь текущего процессора
+ * Если очередь заполнена, задание выполняется сразу.
+ * @param job Задание из job_create или job_create_child
+ */
+void job_run(job_t* job) {
+    sched_preempt_disable();
+    bool queued = job_deque_push(&job_deques[cpu_current()], job);
+    sched_preempt_enable();
+    
+    if (!queued) {
+        job_execute(job);
+        return;
+    }
+    
+    job_wake_one();
+}
+
+/**
+ * Ожидание завершения корневого задания и его освобождение
+ * Пока задание не завершено, вызывающий выполняет чужую работу.
+ * @param job Корневое задание
+ */
+void job_wait(job_t* job) {
+    while (__atomic_load_n(&job->unfinished, __ATOMIC_ACQUIRE) != 0) {
+        job_t* next = job_next();
+        if (next != NULL) {
+            job_cpus[cpu_current()].executed++;
+            job_execute(next);
+        } else {
+            cpu_relax();
+        }
+    }
+    
+    job_free(job);
+}
+
+/**
+ * Поток-исполнитель процессора
+ * @param arg Индекс процессора
+ */
+static void job_worker(void* arg) {
+    uint32_t cpu = (uint32_t)arg;
+    uint32_t bit = 1u << cpu;
+    
+    for (;;) {
+        job_t* job = job_next();
+        if (job != NULL) {
+            job_cpus[cpu].executed++;
+            job_execute(job);
+            continue;
+        }
+        
+        // Сначала объявляем простой, потом проверяем очереди еще раз:
+        // задание, добавленное между проверками, разбудит нас через маску
+        __atomic_fetch_or(&job_idle_mask, bit, __ATOMIC_ACQ_REL);
+        if (job_pending()) {
+            __atomic_fetch_and(&job_idle_mask, ~bit, __ATOMIC_ACQ_REL);
+            continue;
+        }
+        
+        // Пробуждение до блокировки не теряется (sched_wake запоминает его)
+        sched_block();
+    }
+}
+
+/**
+ * Задание parallel_for: делит диапазон пополам, пока он крупнее grain
+ * Правые половины уходят потомкам, левую выполняет само задание.
+ */
+static void job_range(job_t* job, void* data) {
+    job_range_t* range = (job_range_t*)data;
+    uint32_t begin = job->begin;
+    uint32_t end = job->end;
+    
+    while (end - begin > range->grain) {
+        uint32_t mid = begin + (end - begin) / 2;
+        
+        job_t* child = job_create_child(job, job_range, range);
+        if (child == NULL) break;
+        
+        child->begin = mid;
+        child->end = end;
+        job_run(child);
+        end = mid;
+    }
+    
+    range->func(begin, end, range->data);
+}
+
+/**
+ * Параллельный цикл по полуинтервалу [begin, end)
+ * Возвращается, когда обработан весь диапазон. Без исполнителей, из
+ * прерывания или при исчерпании пула работа выполняется на месте.
+ * @param begin Начало диапазона
+ * @param end Конец диапазона (не включая)
+ * @param grain Наибольший кусок, который не делится дальше
+ * @param func Обработчик куска
+ * @param data Аргумент обработчика
+ */
+void parallel_for(uint32_t begin, uint32_t end, uint32_t grain,
+                  job_range_func_t func, void* data) {
+    if (begin >= end) return;
+    if (grain == 0) grain = 1;
+    
+    if (!job_is_ready() || end - begin <= grain) {
+        func(begin, end, data);
+        return;
+    }
+    
+    job_range_t range = { func, data, grain };
+    
+    job_t* root = job_create(job_range, &range);
+    if (root == NULL) {
+        func(begin, end, data);
+        return;
+    }
+    
+    root->begin = begin;
+    root->end = end;
+    job_execute(root);
+    job_wait(root);
+}
+
+/**
+ * Проверка, стоит ли раздавать работу исполнителям
+ * Из прерывания ждать нельзя, а с одним процессором делить незачем.
+ */
+bool job_is_ready(void) {
+    return job_ready && job_enabled && job_workers > 1 &&
+           sched_is_running() && !in_interrupt();
+}
+
+/**
+ * Время одной заливки экрана в микросекундах
+ */
+static uint32_t job_bench_clear(void) {
+    uint64_t start = clock_ns();
+    
+    for (int i = 0; i < JOB_BENCH_ITERATIONS; i++) {
+        framebuffer_clear(0);
+    }
+    
+    return (uint32_t)((clock_ns() - start) / NSEC_PER_USEC / JOB_BENCH_ITERATIONS);
+}
+
+/**
+ * Команда: jobs [bench] - статистика исполнителей
+ */
+static void cmd_jobs(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        if (!framebuffer_is_initialized()) {
+            terminal_print_line("No framebuffer");
+            return;
+        }
+        
+        job_enabled = false;
+        uint32_t serial = job_bench_clear();
+        job_enabled = true;
+        uint32_t parallel = job_bench_clear();
+        
+        terminal_printf("framebuffer clear: %d us serial, %d us with %d workers\n",
+                        serial, parallel, job_workers);
+        return;
+    }
+    
+    if (argc > 1) {
+        terminal_print_line("Usage: jobs [bench]");
+        return;
+    }
+    
+    terminal_printf("%d workers\n", job_workers);
+    
+    for (uint32_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        if (job_cpus[cpu].worker == NULL) continue;
+        
+        job_deque_t* d = &job_deques[cpu];
+        terminal_printf("cpu %d: %d executed, %d stolen, %d queued%s\n", cpu,
+                        job_cpus[cpu].executed, job_cpus[cpu].stolen,
+                        (int32_t)(d->bottom - d->top),
+                        (job_idle_mask & (1u << cpu)) ? ", idle" : "");
+    }
+}
+
+/**
+ * Запуск исполнителей на всех работающих процессорах
+ * Вызывается после smp_init().
+ */
+void job_init(void) {
+    for (uint32_t cpu = 0; cpu < smp_cpu_count(); cpu++) {
+        if (!smp_cpu_online(cpu)) continue;
+        
+        job_cpus[cpu].worker = sched_create_on("job", job_worker, (void*)cpu, cpu);
+        if (job_cpus[cpu].worker != NULL) job_workers++;
+    }
+    
+    cmdreg_register("jobs", "Job system statistics (jobs bench)", cmd_jobs);
+    
+    job_ready = true;
+    
+    #ifdef DEBUG
+    terminal_printf("Jobs: %d workers\n", job_workers);
+    #endif
+}
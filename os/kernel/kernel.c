@@ -12,7 +12,28 @@
 #include "idt.h"
 #include "isr.h"
 #include "irq.h"
+#include "syscall.h"
+#include "multiboot.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "proc.h"
+#include "surface.h"
+#include "uring.h"
 #include "timer.h"
+#include "softirq.h"
+#include "sched.h"
+#include "smp.h"
+#include "job.h"
+#include "coro.h"
+#include "input.h"
+#include "irqstat.h"
+#include "lockstat.h"
+#include "latency.h"
+#include "clock.h"
+#include "acpi.h"
+#include "hpet.h"
+#include "lapic.h"
+#include "ps2.h"
 #include "keyboard.h"
 #include "mouse.h"
 #include "vbe.h"
@@ -21,12 +42,6 @@
 #include "terminal.h"
 #include "commands.h"
 
-// Размер стека ядра
-#define KERNEL_STACK_SIZE 8192
-
-// Глобальные переменные ядра
-uint32_t kernel_stack[KERNEL_STACK_SIZE];
-
 // Внешние переменные из загрузчика
 extern uint32_t framebuffer_addr;
 extern uint16_t screen_width;
@@ -34,37 +49,20 @@ extern uint16_t screen_height;
 extern uint8_t screen_bpp;
 
 // Прототипы функций
-void kernel_main(void);
+void kernel_main(uint32_t magic, uint32_t info);
 void kernel_panic(const char* message);
-void init_system(void);
+void init_system(uint32_t magic, uint32_t info);
 void main_loop(void);
+static void shell_thread(void* arg);
 
 /**
- * Точка входа ядра (вызывается из загрузчика)
- */
-void _start(void) {
-    // Инициализируем стек
-    asm volatile(
-        "mov %0, %%esp\n"
-        "mov %%esp, %%ebp"
-        : 
-        : "r" (kernel_stack + KERNEL_STACK_SIZE)
-        : "esp", "ebp"
-    );
-    
-    // Вызываем основную функцию ядра
-    kernel_main();
-    
-    // Если ядро вернулось - паника
-    kernel_panic("Kernel returned!");
-}
-
-/**
- * Основная функция ядра
+ * Основная функция ядра (вызывается из _start в entry_asm.asm)
+ * @param magic Значение EAX от загрузчика Multiboot
+ * @param info Адрес сведений Multiboot (EBX)
  */
-void kernel_main(void) {
+void kernel_main(uint32_t magic, uint32_t info) {
     // Инициализация системы
-    init_system();
+    init_system(magic, info);
     
     // Основной цикл
     main_loop();
@@ -75,18 +73,61 @@ void kernel_main(void) {
 
 /**
  * Инициализация всех подсистем
+ * @param magic Магическое число Multiboot
+ * @param info Адрес сведений Multiboot
  */
-void init_system(void) {
+void init_system(uint32_t magic, uint32_t info) {
     // Инициализация GDT
     gdt_init();
     
+    // Память: сведения загрузчика, физические страницы и страничная
+    // адресация (модули Multiboot - образы программ кольца 3)
+    multiboot_init(magic, info);
+    pmm_init();
+    vmm_init();
+    
     // Инициализация IDT и прерываний
     idt_init();
     isr_init();
     irq_init();
     
+    // Системные вызовы: int 0x80 и SYSENTER
+    syscall_init();
+    proc_init();
+    
+    // Отложенная обработка прерываний (до регистрации драйверов)
+    softirq_init();
+    
+    // Калибровка TSC для монотонных часов
+    clock_init();
+    
+    // Статистика задержек прерываний и блокировок
+    irqstat_init();
+    latency_init();
+    lockstat_init();
+    
     // Инициализация таймера
-    timer_init(100); // 100 Гц
+    timer_init(TIMER_FREQUENCY);
+    
+    // Таблицы ACPI нужны HPET и IOAPIC
+    bool have_acpi = acpi_init();
+    
+    // HPET: источник времени и запасное устройство событий
+    if (have_acpi) {
+        hpet_init();
+    }
+    
+    // Локальный APIC: доставка прерываний через IOAPIC вместо 8259
+    // и однократный таймер вместо периодического PIT
+    if (lapic_init()) {
+        if (have_acpi) {
+            irq_enable_apic();
+        }
+        lapic_timer_init();
+    }
+    
+    // Контроллер PS/2; команды устройствам дальше идут через его очередь
+    ps2_init();
     
     // Инициализация клавиатуры
     keyboard_init();
@@ -107,6 +148,28 @@ void init_system(void) {
     // Инициализация команд
     commands_init();
     
+    // Потоки: загрузочный код становится потоком ввода "main",
+    // команды выполняются в отдельном потоке
+    sched_init();
+    sched_create("shell", shell_thread, NULL);
+    
+    // Дополнительные процессоры: каждый получает свой поток простоя
+    // и выполняет потоки, созданные для него через sched_create_on()
+    smp_init();
+    
+    // Исполнители заданий на всех работающих процессорах
+    job_init();
+    
+    // Исполнитель сопрограмм драйверов и команд (инициализация мыши
+    // уже ждет в его очереди)
+    coro_init();
+    
+    // Поверхности окон процессов и их композитор
+    surface_init();
+    
+    // Кольца пакетных системных вызовов
+    uring_init();
+    
     // Включаем прерывания
     asm volatile("sti");
     
@@ -129,22 +192,38 @@ void main_loop(void) {
         // Получаем текущее время
         current_time = timer_get_ticks();
         
-        // Обработка ввода с клавиатуры (уже в прерываниях)
-        // Обработка мыши (уже в прерываниях)
+        // События клавиатуры и мыши, накопленные прерываниями
+        input_process();
         
         // Обновление курсора мыши
         if (current_time - last_time > 50) { // 20 FPS для курсора
             gui_update_cursor();
+            terminal_blink();
             last_time = current_time;
             frames++;
         }
         
-        // Обработка команд терминала
-        terminal_process_input();
+        // Отложенная работа, не уместившаяся в выход из прерываний
+        softirq_run();
         
-        // Небольшая задержка для экономии процессорного времени
-        // (в реальной ОС здесь будет переключение задач)
-        asm volatile("hlt");
+        // Спим до следующего события (не дольше INPUT_WAIT_MS, чтобы
+        // обновить курсор); процессор тем временем получают поток
+        // команд или поток простоя
+        input_wait();
+    }
+}
+
+/**
+ * Поток команд терминала
+ * Долгая команда выполняется здесь и не останавливает эхо ввода
+ * и движение курсора в главном цикле.
+ */
+static void shell_thread(void* arg) {
+    (void)arg;
+    
+    while (1) {
+        terminal_wait_input();
+        terminal_process_input();
     }
 }
 
@@ -164,12 +243,3 @@ void kernel_panic(const char* message) {
         asm volatile("hlt");
     }
 }
-
-/**
- * Обработчик системных вызовов
- */
-void syscall_handler(registers_t* regs) {
-    // Здесь будут обрабатываться системные вызовы
-    // Пока просто заглушка
-    (void)regs;
-}
\ No newline at end of file
@@ -4,30 +4,27 @@
 
 #include "keyboard.h"
 #include "idt.h"
+#include "irq.h"
 #include "terminal.h"
 #include "gui.h"
+#include "input.h"
+#include "ps2.h"
 #include <stdbool.h>
 #include <string.h>
 
 // Порты клавиатуры
-#define KEYBOARD_DATA_PORT 0x60
-#define KEYBOARD_STATUS_PORT 0x64
-#define KEYBOARD_COMMAND_PORT 0x64
+#define KEYBOARD_DATA_PORT PS2_DATA_PORT
+#define KEYBOARD_COMMAND_PORT PS2_COMMAND_PORT
 
 // Команды клавиатуры
 #define KEYBOARD_CMD_LED 0xED
 #define KEYBOARD_CMD_SET_SCANCODE 0xF0
 
-// Буфер ввода клавиатуры
-#define KEYBOARD_BUFFER_SIZE 256
-
-static char keyboard_buffer[KEYBOARD_BUFFER_SIZE];
-static uint32_t keyboard_buffer_start = 0;
-static uint32_t keyboard_buffer_end = 0;
 static bool keyboard_caps_lock = false;
 static bool keyboard_shift_pressed = false;
 static bool keyboard_ctrl_pressed = false;
 static bool keyboard_alt_pressed = false;
+static bool keyboard_extended = false; // Получен префикс 0xE0
 
 // Таблица скан-кодов (set 2, без расширенных)
 static const char keyboard_scancode_table[] = {
@@ -50,8 +47,74 @@ static const char keyboard_shift_table[] = {
 // Состояния клавиш
 static bool key_states[128] = {0};
 
+// Скан-коды клавиш, которые транслируются в коды редактирования
+#define SC_ESCAPE    0x01
+#define SC_BACKSPACE 0x0E
+#define SC_TAB       0x0F
+#define SC_ENTER     0x1C
+#define SC_CTRL      0x1D
+#define SC_LSHIFT    0x2A
+#define SC_RSHIFT    0x36
+#define SC_ALT       0x38
+#define SC_SPACE     0x39
+#define SC_CAPS      0x3A
+#define SC_F1        0x3B
+#define SC_F6        0x40
+
+// Расширенные скан-коды (после префикса 0xE0)
+#define SC_EXT_HOME   0x47
+#define SC_EXT_UP     0x48
+#define SC_EXT_LEFT   0x4B
+#define SC_EXT_RIGHT  0x4D
+#define SC_EXT_END    0x4F
+#define SC_EXT_DOWN   0x50
+#define SC_EXT_DELETE 0x53
+
+/**
+ * Трансляция расширенного скан-кода в код клавиши
+ * @param keycode Скан-код без префикса 0xE0
+ * @return Код клавиши или 0, если клавиша не используется
+ */
+static int keyboard_extended_key(uint8_t keycode) {
+    switch (keycode) {
+        case SC_EXT_HOME:   return KEY_HOME;
+        case SC_EXT_END:    return KEY_END;
+        case SC_EXT_LEFT:   return KEY_LEFT;
+        case SC_EXT_RIGHT:  return KEY_RIGHT;
+        case SC_EXT_UP:     return KEY_UP;
+        case SC_EXT_DOWN:   return KEY_DOWN;
+        case SC_EXT_DELETE: return KEY_DELETE;
+        default:            return 0;
+    }
+}
+
+/**
+ * Трансляция обычного скан-кода в символ с учетом Shift и Caps Lock
+ * @param keycode Скан-код
+ * @return Символ или 0
+ */
+static char keyboard_translate(uint8_t keycode) {
+    if (keycode >= sizeof(keyboard_scancode_table)) return 0;
+    
+    // Выбираем символ в зависимости от Shift и Caps Lock
+    if (keyboard_shift_pressed) {
+        return keyboard_shift_table[keycode];
+    }
+    
+    char ch = keyboard_scancode_table[keycode];
+    
+    // Caps Lock влияет только на буквы
+    if (keyboard_caps_lock && ch >= 'a' && ch <= 'z') {
+        ch = ch - 'a' + 'A';
+    }
+    
+    return ch;
+}
+
 /**
  * Обработчик прерывания клавиатуры (IRQ1)
+ * Только забирает скан-код из контроллера и кладет его в очередь
+ * ввода; разбор и эхо на экран выполняет главный цикл.
  * @param regs Регистры на момент прерывания (не используется)
  */
 void keyboard_handler(struct registers* regs) {
@@ -60,158 +123,162 @@ void keyboard_handler(struct registers* regs) {
     // Читаем скан-код из порта данных
     uint8_t scancode = inb(KEYBOARD_DATA_PORT);
     
+    // ACK и ответы на команды разбирает драйвер контроллера
+    if (ps2_receive(PS2_PORT_KEYBOARD, scancode)) return;
+    
+    input_report_key(scancode);
+}
+
+/**
+ * Обработка одного скан-кода
+ * @param scancode Скан-код (набор 1)
+ */
+static void keyboard_process_scancode(uint8_t scancode) {
+    // Префикс расширенного скан-кода
+    if (scancode == 0xE0) {
+        keyboard_extended = true;
+        return;
+    }
+    
     // Проверяем, является ли это нажатием (0x80 - отпускание)
     bool pressed = !(scancode & 0x80);
     uint8_t keycode = scancode & 0x7F;
+    bool extended = keyboard_extended;
+    keyboard_extended = false;
+    
+    if (extended) {
+        // Ctrl+Alt+Del (Delete на расширенном блоке)
+        if (pressed && keycode == SC_EXT_DELETE &&
+            keyboard_ctrl_pressed && keyboard_alt_pressed) {
+            keyboard_reboot();
+        }
+        
+        int key = keyboard_extended_key(keycode);
+        if (key != 0) {
+            if (pressed) {
+                terminal_handle_key(key);
+            }
+            return;
+        }
+        
+        // Правые Ctrl/Alt и Enter на цифровом блоке совпадают с обычными,
+        // остальные расширенные клавиши пока игнорируем
+        if (keycode != SC_CTRL && keycode != SC_ALT && keycode != SC_ENTER) {
+            return;
+        }
+    }
     
     // Обновляем состояние клавиши
     key_states[keycode] = pressed;
     
     // Обрабатываем специальные клавиши
     switch (keycode) {
-        case 0x2A: // Левый Shift
-        case 0x36: // Правый Shift
+        case SC_LSHIFT:
+        case SC_RSHIFT:
             keyboard_shift_pressed = pressed;
-            break;
-        case 0x1D: // Ctrl
+            return;
+        case SC_CTRL:
             keyboard_ctrl_pressed = pressed;
-            break;
-        case 0x38: // Alt
+            return;
+        case SC_ALT:
             keyboard_alt_pressed = pressed;
-            break;
-        case 0x3A: // Caps Lock
+            return;
+        case SC_CAPS:
             if (pressed) {
                 keyboard_caps_lock = !keyboard_caps_lock;
                 keyboard_update_leds();
             }
-            break;
-        case 0x0E: // Backspace
-            if (pressed) {
-                keyboard_backspace();
-            }
-            break;
-        case 0x1C: // Enter
-            if (pressed) {
-                keyboard_enter();
-            }
-            break;
-        case 0x0F: // Tab
-            if (pressed) {
-                keyboard_tab();
-            }
-            break;
-        case 0x39: // Space
-            if (pressed) {
-                keyboard_add_char(' ');
-            }
-            break;
+            return;
         default:
-            // Обработка обычных клавиш
-            if (pressed && keycode < sizeof(keyboard_scancode_table)) {
-                char ch = 0;
-                
-                // Выбираем символ в зависимости от Shift и Caps Lock
-                if (keyboard_shift_pressed) {
-                    ch = keyboard_shift_table[keycode];
-                } else {
-                    ch = keyboard_scancode_table[keycode];
-                    
-                    // Caps Lock влияет только на буквы
-                    if (keyboard_caps_lock && ch >= 'a' && ch <= 'z') {
-                        ch = ch - 'a' + 'A';
-                    }
-                }
-                
-                if (ch != 0) {
-                    keyboard_add_char(ch);
-                }
-            }
             break;
     }
     
-    // Обработка Ctrl+Alt+Del (перезагрузка)
-    if (keyboard_ctrl_pressed && keyboard_alt_pressed && keycode == 0x53 && pressed) {
+    if (!pressed) return;
+    
+    // Ctrl+Alt+Del (Delete на цифровом блоке)
+    if (keyboard_ctrl_pressed && keyboard_alt_pressed && keycode == 0x53) {
         keyboard_reboot();
     }
+    
+    // Alt+F1..F6 - переключение виртуальных консолей
+    if (keyboard_alt_pressed && keycode >= SC_F1 && keycode <= SC_F6) {
+        terminal_switch_console(keycode - SC_F1);
+        return;
+    }
+    
+    switch (keycode) {
+        case SC_ESCAPE:
+            terminal_handle_key(KEY_ESCAPE);
+            return;
+        case SC_BACKSPACE:
+            keyboard_backspace();
+            return;
+        case SC_ENTER:
+            keyboard_enter();
+            return;
+        case SC_TAB:
+            keyboard_tab();
+            return;
+        case SC_SPACE:
+            terminal_handle_key(' ');
+            return;
+        default:
+            break;
+    }
+    
+    char ch = keyboard_translate(keycode);
+    if (ch == 0) return;
+    
+    // Ctrl+буква - управляющий код (Ctrl+R = 0x12, Ctrl+U = 0x15, Ctrl+W = 0x17)
+    if (keyboard_ctrl_pressed) {
+        if (ch >= 'A' && ch <= 'Z') ch = ch - 'A' + 'a';
+        if (ch < 'a' || ch > 'z') return;
+        terminal_handle_key(ch - 'a' + 1);
+        return;
+    }
+    
+    terminal_handle_key(ch);
 }
 
 /**
- * Добавление символа в буфер клавиатуры
- * @param ch Символ для добавления
+ * Обработка события клавиатуры из очереди ввода
+ * @param event Событие INPUT_EVENT_KEY
  */
-void keyboard_add_char(char ch) {
-    uint32_t next_end = (keyboard_buffer_end + 1) % KEYBOARD_BUFFER_SIZE;
-    
-    // Проверяем, не переполнен ли буфер
-    if (next_end != keyboard_buffer_start) {
-        keyboard_buffer[keyboard_buffer_end] = ch;
-        keyboard_buffer_end = next_end;
-        
-        // Отображаем символ в терминале
-        terminal_putchar(ch);
-    }
+static void keyboard_input(const input_event_t* event) {
+    keyboard_process_scancode(event->scancode);
 }
 
 /**
- * Удаление последнего символа (Backspace)
+ * Обработка нажатия Backspace
  */
 void keyboard_backspace(void) {
-    if (keyboard_buffer_start != keyboard_buffer_end) {
-        // Удаляем из буфера
-        keyboard_buffer_end = (keyboard_buffer_end - 1 + KEYBOARD_BUFFER_SIZE) % KEYBOARD_BUFFER_SIZE;
-        
-        // Удаляем из терминала
-        terminal_backspace();
-    }
+    terminal_handle_key(KEY_BACKSPACE);
 }
 
 /**
  * Обработка нажатия Enter
  */
 void keyboard_enter(void) {
-    // Добавляем символ новой строки
-    keyboard_add_char('\n');
-    
-    // Завершаем ввод команды
-    terminal_process_command();
+    terminal_handle_key(KEY_ENTER);
 }
 
 /**
  * Обработка нажатия Tab
  */
 void keyboard_tab(void) {
-    // Автодополнение команды (в будущем)
-    keyboard_add_char('\t');
+    terminal_handle_key(KEY_TAB);
 }
 
 /**
  * Обновление светодиодов клавиатуры (Caps Lock, Num Lock, Scroll Lock)
+ * Команда ставится в очередь контроллера; ACK придет в прерывании.
  */
 void keyboard_update_leds(void) {
-    // Ждем, пока клавиатура будет готова принять команду
-    keyboard_wait();
-    
-    // Отправляем команду установки светодиодов
-    outb(KEYBOARD_DATA_PORT, KEYBOARD_CMD_LED);
-    keyboard_wait();
-    
-    // Отправляем байт состояния светодиодов
     uint8_t leds = 0;
     if (keyboard_caps_lock) leds |= 0x04;
     // Можно добавить Num Lock и Scroll Lock при необходимости
     
-    outb(KEYBOARD_DATA_PORT, leds);
-}
-
-/**
- * Ожидание готовности клавиатуры
- */
-void keyboard_wait(void) {
-    // Ждем, пока бит 1 (буфер ввода) не станет 0
-    while (inb(KEYBOARD_STATUS_PORT) & 0x02) {
-        // Пауза
-        asm volatile("pause");
-    }
+    ps2_send(PS2_PORT_KEYBOARD, KEYBOARD_CMD_LED, leds, 0, NULL, NULL);
 }
 
 /**
@@ -227,40 +294,6 @@ void keyboard_reboot(void) {
     }
 }
 
-/**
- * Получение строки из буфера клавиатуры
- * @param buffer Буфер для строки
- * @param size Размер буфера
- * @return Длина строки
- */
-int keyboard_getline(char* buffer, int size) {
-    if (size <= 0) return 0;
-    
-    int i = 0;
-    while (i < size - 1) {
-        // Ждем, пока появятся данные в буфере
-        while (keyboard_buffer_start == keyboard_buffer_end) {
-            asm volatile("hlt");
-        }
-        
-        // Читаем символ из буфера
-        char ch = keyboard_buffer[keyboard_buffer_start];
-        keyboard_buffer_start = (keyboard_buffer_start + 1) % KEYBOARD_BUFFER_SIZE;
-        
-        // Если это конец строки, завершаем
-        if (ch == '\n') {
-            buffer[i] = '\0';
-            return i;
-        }
-        
-        // Добавляем символ в буфер
-        buffer[i++] = ch;
-    }
-    
-    buffer[size - 1] = '\0';
-    return size - 1;
-}
-
 /**
  * Проверка, нажата ли определенная клавиша
  * @param keycode Код клавиши
@@ -284,13 +317,9 @@ bool keyboard_is_caps_lock(void) { return keyboard_caps_lock; }
  */
 void keyboard_init(void) {
     // Регистрируем обработчик прерывания клавиатуры
+    input_set_handler(INPUT_EVENT_KEY, keyboard_input);
     irq_register_handler(1, keyboard_handler);
     
-    // Очищаем буфер
-    keyboard_buffer_start = 0;
-    keyboard_buffer_end = 0;
-    memset(keyboard_buffer, 0, sizeof(keyboard_buffer));
-    
     // Инициализируем состояния клавиш
     memset(key_states, 0, sizeof(key_states));
     
@@ -300,15 +329,8 @@ void keyboard_init(void) {
     keyboard_alt_pressed = false;
     keyboard_caps_lock = false;
     
-    // Включаем клавиатуру (сбрасываем бит отключения)
-    keyboard_wait();
-    outb(KEYBOARD_COMMAND_PORT, 0xAE);
-    
-    // Устанавливаем скан-код set 2
-    keyboard_wait();
-    outb(KEYBOARD_DATA_PORT, KEYBOARD_CMD_SET_SCANCODE);
-    keyboard_wait();
-    outb(KEYBOARD_DATA_PORT, 0x02);
+    // Устанавливаем скан-код set 2 (порт уже включен в ps2_init)
+    ps2_send(PS2_PORT_KEYBOARD, KEYBOARD_CMD_SET_SCANCODE, 0x02, 0, NULL, NULL);
     
     #ifdef DEBUG
     terminal_printf("Keyboard initialized\n");
@@ -0,0 +1,279 @@
+/**
+ * kernel/lapic.c - Локальный APIC и его таймер
+ *
+ * Таймер LAPIC используется как устройство событий (clockevent)
+ * в однократном режиме: прерывание приходит только тогда, когда
+ * истекает ближайший таймер ядра, а не на каждом тике.
+ */
+
+#include "lapic.h"
+#include "clockevent.h"
+#include "timer.h"
+#include "idt.h"
+#include "cpu.h"
+#include "clock.h"
+#include "terminal.h"
+#include <stddef.h>
+
+// MSR базового адреса APIC
+#define MSR_APIC_BASE        0x1B
+#define MSR_APIC_BASE_ENABLE (1 << 11)
+
+// MSR крайнего срока TSC
+#define MSR_TSC_DEADLINE     0x6E0
+
+// Биты регистров
+#define LAPIC_SVR_ENABLE         0x100
+#define LAPIC_TIMER_ONESHOT      0x00000
+#define LAPIC_TIMER_TSC_DEADLINE 0x40000
+
+// Делитель таймера: 0x3 - деление на 16
+#define LAPIC_TIMER_DIV_16   0x3
+
+// Длительность калибровки по каналу 2 PIT
+#define LAPIC_CALIBRATE_US   10000
+
+// Состояние LAPIC
+static volatile uint32_t* lapic_base = NULL;
+static bool lapic_enabled = false;
+
+// Таймер LAPIC
+static uint32_t lapic_timer_per_ms = 0;     // Тиков таймера (после делителя) в 1 мс
+static bool lapic_tsc_deadline = false;
+
+/**
+ * Чтение регистра LAPIC
+ * @param reg Смещение регистра
+ * @return Значение регистра
+ */
+uint32_t lapic_read(uint32_t reg) {
+    return lapic_base[reg / 4];
+}
+
+/**
+ * Запись регистра LAPIC
+ * @param reg Смещение регистра
+ * @param value Значение
+ */
+void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_base[reg / 4] = value;
+}
+
+/**
+ * Сигнал конца прерывания (одна запись в MMIO)
+ */
+void lapic_eoi(void) {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+/**
+ * Идентификатор LAPIC текущего процессора
+ */
+uint8_t lapic_id(void) {
+    return (uint8_t)(lapic_read(LAPIC_REG_ID) >> 24);
+}
+
+/**
+ * Отправка межпроцессорного прерывания
+ * @param apic_id Идентификатор LAPIC получателя
+ * @param command Вектор и тип доставки (LAPIC_ICR_*)
+ */
+void lapic_send_ipi(uint8_t apic_id, uint32_t command) {
+    uint32_t flags = cpu_irq_save();
+    
+    // Запись младшей половины ICR отправляет прерывание
+    lapic_write(LAPIC_REG_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, command);
+    
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING) {
+        cpu_relax();
+    }
+    
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Проверка, включен ли LAPIC
+ */
+bool lapic_is_enabled(void) {
+    return lapic_enabled;
+}
+
+/**
+ * Обработчик ложного прерывания (EOI не требуется)
+ */
+static void lapic_spurious_handler(struct registers* regs) {
+    (void)regs;
+}
+
+/**
+ * Включение LAPIC текущего процессора
+ * Таймер и ошибки замаскированы до настройки.
+ */
+static void lapic_setup(void) {
+    // Включаем APIC глобально и берем адрес регистров из MSR
+    uint64_t base = cpu_rdmsr(MSR_APIC_BASE);
+    base |= MSR_APIC_BASE_ENABLE;
+    cpu_wrmsr(MSR_APIC_BASE, base);
+    lapic_base = (volatile uint32_t*)(uint32_t)(base & 0xFFFFF000);
+    
+    // Разрешаем все приоритеты, маскируем таймер и ошибки до настройки
+    lapic_write(LAPIC_REG_TPR, 0);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_ERROR, LAPIC_LVT_MASKED);
+    
+    // Программное включение с вектором ложных прерываний
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+/**
+ * Инициализация локального APIC
+ * @return true, если LAPIC найден и включен
+ */
+bool lapic_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    
+    if (!(edx & CPUID_EDX_APIC) || !(edx & CPUID_EDX_MSR)) {
+        #ifdef DEBUG
+        terminal_printf("LAPIC: not present\n");
+        #endif
+        return false;
+    }
+    
+    lapic_setup();
+    isr_install_handler(LAPIC_SPURIOUS_VECTOR, lapic_spurious_handler);
+    
+    lapic_enabled = true;
+    
+    #ifdef DEBUG
+    terminal_printf("LAPIC: id %d at %x\n", lapic_id(), (uint32_t)lapic_base);
+    #endif
+    
+    return true;
+}
+
+/**
+ * Включение LAPIC дополнительного процессора
+ * Внешние прерывания IOAPIC направляет только на BSP, поэтому LINT0
+ * замаскирован; AP получает лишь межпроцессорные прерывания.
+ */
+void lapic_init_ap(void) {
+    lapic_setup();
+    lapic_write(LAPIC_REG_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_LVT_LINT1, LAPIC_LVT_NMI);
+}
+
+/**
+ * Программирование следующего события (однократный режим)
+ * @param delta_us Задержка в микросекундах
+ */
+static void lapic_timer_set_next_event(uint32_t delta_us) {
+    uint32_t count = (uint32_t)(((uint64_t)delta_us * lapic_timer_per_ms) / 1000);
+    if (count == 0) count = 1;
+    
+    lapic_write(LAPIC_REG_TIMER_INIT, count);
+}
+
+/**
+ * Программирование следующего события (режим крайнего срока TSC)
+ * @param delta_us Задержка в микросекундах
+ */
+static void lapic_timer_set_deadline(uint32_t delta_us) {
+    cpu_wrmsr(MSR_TSC_DEADLINE, clock_cycles() + clock_ns_to_cycles(delta_us * NSEC_PER_USEC));
+}
+
+/**
+ * Остановка таймера LAPIC
+ */
+static void lapic_timer_shutdown(void) {
+    if (lapic_tsc_deadline) {
+        cpu_wrmsr(MSR_TSC_DEADLINE, 0);
+    } else {
+        lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    }
+}
+
+/**
+ * Обработчик прерывания таймера LAPIC
+ */
+static void lapic_timer_handler(struct registers* regs) {
+    (void)regs;
+    
+    lapic_eoi();
+    timer_event_handler();
+}
+
+// Устройства событий на основе таймера LAPIC
+static clockevent_t lapic_clockevent = {
+    .name = "lapic",
+    .rating = 100,
+    .min_delta_us = 2,
+    .max_delta_us = 0,          // Вычисляется при калибровке
+    .set_next_event = lapic_timer_set_next_event,
+    .shutdown = lapic_timer_shutdown,
+};
+
+static clockevent_t lapic_deadline_clockevent = {
+    .name = "lapic-deadline",
+    .rating = 150,
+    .min_delta_us = 1,
+    .max_delta_us = 1000000000,
+    .set_next_event = lapic_timer_set_deadline,
+    .shutdown = lapic_timer_shutdown,
+};
+
+/**
+ * Калибровка таймера LAPIC по каналу 2 PIT
+ * @return Тиков таймера в 1 мс (0 при ошибке)
+ */
+static uint32_t lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_REG_TIMER_DIV, LAPIC_TIMER_DIV_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_ONESHOT);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0xFFFFFFFF);
+    
+    timer_pit_wait_us(LAPIC_CALIBRATE_US);
+    
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_REG_TIMER_CUR);
+    lapic_write(LAPIC_REG_TIMER_INIT, 0);
+    
+    return elapsed / (LAPIC_CALIBRATE_US / 1000);
+}
+
+/**
+ * Инициализация таймера LAPIC и регистрация его как устройства событий
+ * Если процессор поддерживает TSC-deadline, используется он.
+ * @return true, если устройство зарегистрировано
+ */
+bool lapic_timer_init(void) {
+    if (!lapic_enabled) return false;
+    
+    isr_install_handler(LAPIC_TIMER_VECTOR, lapic_timer_handler);
+    
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    
+    if ((ecx & CPUID_ECX_TSC_DEADLINE) && clock_is_tsc()) {
+        lapic_tsc_deadline = true;
+        lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_TSC_DEADLINE | LAPIC_TIMER_VECTOR);
+        
+        #ifdef DEBUG
+        terminal_printf("LAPIC timer: TSC-deadline mode\n");
+        #endif
+        
+        return timer_register_clockevent(&lapic_deadline_clockevent);
+    }
+    
+    lapic_timer_per_ms = lapic_timer_calibrate();
+    if (lapic_timer_per_ms == 0) return false;
+    
+    // Предел задает 32-битный счетчик
+    lapic_clockevent.max_delta_us = (uint32_t)(((uint64_t)0xFFFFFFFF * 1000) / lapic_timer_per_ms);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_TIMER_ONESHOT | LAPIC_TIMER_VECTOR);
+    
+    #ifdef DEBUG
+    terminal_printf("LAPIC timer: %d ticks/ms (div 16)\n", lapic_timer_per_ms);
+    #endif
+    
+    return timer_register_clockevent(&lapic_clockevent);
+}
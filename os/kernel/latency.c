@@ -0,0 +1,350 @@
+/**
+ * kernel/latency.c - Задержка от ввода до кадра на экране
+ *
+ * Событие ввода несет метку TSC, снятую на входе в обработчик IRQ.
+ * Главный цикл передает метку сюда перед разбором события, а первый
+ * вывод кадра (framebuffer_swap) во время разбора записывает разницу
+ * в гистограмму. События без видимого результата (отпускание клавиши)
+ * не учитываются. Команда latency test подает синтетические события
+ * через ту же очередь ввода (клавиши - мимо редактора строки), поэтому
+ * результаты повторяемы в QEMU, а
+ * latency check проверяет расчет и вывод на известной гистограмме.
+ */
+
+#include "latency.h"
+#include "input.h"
+#include "framebuffer.h"
+#include "cpu.h"
+#include "clock.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Скан-коды синтетических нажатий: 'a' и Backspace (набор 1)
+#define LATENCY_SC_A            0x1E
+#define LATENCY_SC_BACKSPACE    0x0E
+#define LATENCY_SC_RELEASE      0x80
+
+// Количество итераций теста по умолчанию и предел
+#define LATENCY_TEST_DEFAULT    100
+#define LATENCY_TEST_MAX        10000
+
+// Известная гистограмма проверки: 1, 2, ... LATENCY_CHECK_SAMPLES мкс
+#define LATENCY_CHECK_SAMPLES   100
+
+// Гистограмма одного типа событий
+typedef struct {
+    uint32_t count;
+    uint32_t max_ns;
+    uint64_t total_ns;
+    uint32_t hist[LATENCY_BUCKETS];
+} latency_hist_t;
+
+static latency_hist_t latency_hists[INPUT_EVENT_TYPES];
+
+// Разбираемое событие (метка 0 - кадр уже учтен или события нет)
+static uint64_t latency_stamp = 0;
+static uint8_t latency_type = 0;
+
+static const char* latency_names[INPUT_EVENT_TYPES] = {
+    "key", "mouse"
+};
+
+/**
+ * Номер корзины для значения
+ * @param ns Задержка в наносекундах
+ */
+static uint32_t latency_bucket(uint32_t ns) {
+    if (ns < LATENCY_SUB_BUCKETS) return ns;
+    
+    uint32_t exp = 31 - __builtin_clz(ns);
+    uint32_t sub = (ns >> (exp - LATENCY_SUB_BITS)) & (LATENCY_SUB_BUCKETS - 1);
+    return (exp - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+/**
+ * Верхняя граница корзины (включительно)
+ * @param bucket Номер корзины
+ */
+static uint32_t latency_bucket_limit(uint32_t bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) return bucket;
+    
+    uint32_t exp = bucket / LATENCY_SUB_BUCKETS + LATENCY_SUB_BITS - 1;
+    uint32_t sub = bucket % LATENCY_SUB_BUCKETS;
+    uint64_t low = (uint64_t)(LATENCY_SUB_BUCKETS + sub) << (exp - LATENCY_SUB_BITS);
+    uint64_t high = low + (1ull << (exp - LATENCY_SUB_BITS)) - 1;
+    return high > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)high;
+}
+
+/**
+ * Запись значения в гистограмму
+ * @param h Гистограмма
+ * @param value Задержка в наносекундах
+ */
+static void latency_record(latency_hist_t* h, uint32_t value) {
+    h->count++;
+    h->total_ns += value;
+    if (value > h->max_ns) h->max_ns = value;
+    h->hist[latency_bucket(value)]++;
+}
+
+/**
+ * Начало разбора события ввода (главный цикл)
+ * @param type Тип события (input_event_type_t)
+ * @param stamp Метка TSC из прерывания
+ */
+void latency_input_begin(uint8_t type, uint64_t stamp) {
+    latency_type = type;
+    latency_stamp = stamp;
+}
+
+/**
+ * Конец разбора события: если кадра не было, событие не учитывается
+ */
+void latency_input_end(void) {
+    latency_stamp = 0;
+}
+
+/**
+ * Вывод кадра на экран (из framebuffer_swap)
+ * Записывает задержку первого кадра после события ввода.
+ */
+void latency_present(void) {
+    uint64_t stamp = latency_stamp;
+    if (stamp == 0) return;
+    latency_stamp = 0;
+    
+    uint32_t khz = clock_get_tsc_khz();
+    if (khz == 0 || latency_type >= INPUT_EVENT_TYPES) return;
+    
+    uint64_t ns = ((cpu_rdtsc() - stamp) * 1000000ull) / khz;
+    uint32_t value = ns > 0xFFFFFFFFull ? 0xFFFFFFFF : (uint32_t)ns;
+    
+    latency_record(&latency_hists[latency_type], value);
+}
+
+/**
+ * Сброс гистограмм
+ */
+void latency_reset(void) {
+    memset(latency_hists, 0, sizeof(latency_hists));
+}
+
+/**
+ * Перцентиль по гистограмме
+ * @param h Гистограмма
+ * @param permille Перцентиль в десятых долях процента (500 - медиана)
+ * @return Верхняя граница корзины, в которую попал перцентиль
+ */
+static uint32_t latency_percentile(const latency_hist_t* h, uint32_t permille) {
+    if (h->count == 0) return 0;
+    
+    // Номер значения (с 1), округленный вверх
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * permille + 999) / 1000);
+    if (rank == 0) rank = 1;
+    
+    uint32_t seen = 0;
+    for (uint32_t b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += h->hist[b];
+        if (seen >= rank) {
+            uint32_t limit = latency_bucket_limit(b);
+            return limit < h->max_ns ? limit : h->max_ns;
+        }
+    }
+    
+    return h->max_ns;
+}
+
+/**
+ * Вывод одной гистограммы
+ * terminal_printf принимает для %d только 32-битные значения, поэтому
+ * результаты деления на NSEC_PER_USEC (64 бита) приводятся явно.
+ * @param name Название типа событий
+ * @param h Гистограмма
+ */
+static void latency_print_hist(const char* name, const latency_hist_t* h) {
+    if (h->count == 0) {
+        terminal_printf("%s: no samples\n", name);
+        return;
+    }
+    
+    terminal_printf("%s: %d samples, avg %d us, p50 %d us, p99 %d us, max %d us\n",
+                    name, h->count,
+                    (uint32_t)(h->total_ns / h->count / NSEC_PER_USEC),
+                    (uint32_t)(latency_percentile(h, 500) / NSEC_PER_USEC),
+                    (uint32_t)(latency_percentile(h, 990) / NSEC_PER_USEC),
+                    (uint32_t)(h->max_ns / NSEC_PER_USEC));
+}
+
+/**
+ * Вывод статистики
+ */
+static void latency_print(void) {
+    if (clock_get_tsc_khz() == 0) {
+        terminal_print_line("No TSC: latency is not measured");
+        return;
+    }
+    
+    for (int type = 0; type < INPUT_EVENT_TYPES; type++) {
+        latency_print_hist(latency_names[type], &latency_hists[type]);
+    }
+}
+
+/**
+ * Проверка перцентиля: не меньше точного значения и не больше его
+ * на погрешность корзины (1/8)
+ */
+static bool latency_check_percentile(const latency_hist_t* h, uint32_t permille, uint32_t exact) {
+    uint32_t value = latency_percentile(h, permille);
+    return value >= exact && value <= exact + exact / LATENCY_SUB_BUCKETS;
+}
+
+/**
+ * Проверка расчета и вывода на известной гистограмме
+ * Значения 1..100 мкс: среднее 50 мкс, p50 - 50 мкс, p99 - 99 мкс
+ * (с округлением вверх до границы корзины), максимум 100 мкс.
+ * Не зависит от TSC и не трогает накопленную статистику.
+ * @return true, если все значения совпали с ожидаемыми
+ */
+static bool latency_check(void) {
+    static latency_hist_t h;
+    memset(&h, 0, sizeof(h));
+    
+    for (uint32_t i = 1; i <= LATENCY_CHECK_SAMPLES; i++) {
+        latency_record(&h, i * NSEC_PER_USEC);
+    }
+    
+    latency_print_hist("check", &h);
+    
+    return h.count == LATENCY_CHECK_SAMPLES &&
+           h.total_ns / h.count / NSEC_PER_USEC == 50 &&
+           h.max_ns == LATENCY_CHECK_SAMPLES * NSEC_PER_USEC &&
+           latency_check_percentile(&h, 500, 50 * NSEC_PER_USEC) &&
+           latency_check_percentile(&h, 990, 99 * NSEC_PER_USEC);
+}
+
+/**
+ * Обработчик клавиш на время теста
+ * Синтетические нажатия не должны попадать в редактор строки: тест
+ * выполняется как команда, и строка ввода принадлежит ей. Вместо эха
+ * выводится на экран одна ячейка символа - столько же, сколько
+ * выводит эхо нажатия, поэтому кадр и задержка остаются теми же.
+ */
+static void latency_test_key(const input_event_t* event) {
+    if (event->scancode & LATENCY_SC_RELEASE) return;
+    framebuffer_swap_rect(0, 0, 8, 16);
+}
+
+/**
+ * Синтетическое событие через очередь ввода
+ * Производители очереди выполняются при запрещенных прерываниях,
+ * поэтому подача тоже идет под cli.
+ */
+static void latency_inject_key(uint8_t scancode) {
+    uint32_t flags = cpu_irq_save();
+    input_report_key(scancode);
+    cpu_irq_restore(flags);
+}
+
+static void latency_inject_mouse(int dx, int dy) {
+    uint32_t flags = cpu_irq_save();
+    input_report_mouse(dx, dy, 0, 0);
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Прогон синтетических событий
+ * Каждая итерация - символ, Backspace и сдвиг мыши туда и обратно.
+ * Клавиши на время теста получает latency_test_key, поэтому строка
+ * ввода и курсор терминала не меняются; настоящие нажатия в это время
+ * теряются. Очередь разбирается сразу; input_process() не вытесняется,
+ * поэтому поток команд и главный цикл не читают кольцо одновременно.
+ * @param iterations Количество итераций
+ */
+static void latency_run_test(uint32_t iterations) {
+    input_handler_t key_handler = input_set_handler(INPUT_EVENT_KEY, latency_test_key);
+    
+    for (uint32_t i = 0; i < iterations; i++) {
+        latency_inject_key(LATENCY_SC_A);
+        latency_inject_key(LATENCY_SC_A | LATENCY_SC_RELEASE);
+        input_process();
+        
+        latency_inject_key(LATENCY_SC_BACKSPACE);
+        latency_inject_key(LATENCY_SC_BACKSPACE | LATENCY_SC_RELEASE);
+        input_process();
+        
+        latency_inject_mouse((i & 1) ? -1 : 1, 0);
+        input_process();
+    }
+    
+    // Нечетное число итераций оставило бы курсор сдвинутым
+    if (iterations & 1) {
+        latency_inject_mouse(-1, 0);
+        input_process();
+    }
+    
+    input_set_handler(INPUT_EVENT_KEY, key_handler);
+}
+
+/**
+ * Разбор числа итераций
+ * @param s Строка с десятичным числом
+ * @return Число или -1 при ошибке и выходе за LATENCY_TEST_MAX
+ */
+static int latency_parse_count(const char* s) {
+    int value = 0;
+    if (*s == '\0') return -1;
+    
+    for (; *s != '\0'; s++) {
+        if (*s < '0' || *s > '9') return -1;
+        value = value * 10 + (*s - '0');
+        if (value > LATENCY_TEST_MAX) return -1;
+    }
+    
+    return value;
+}
+
+/**
+ * Команда: latency [reset | test [N] | check] - задержка ввода до кадра
+ */
+static void cmd_latency(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        latency_reset();
+        terminal_print_line("Latency statistics reset");
+        return;
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "test") == 0) {
+        int iterations = argc > 2 ? latency_parse_count(argv[2]) : LATENCY_TEST_DEFAULT;
+        if (iterations <= 0) {
+            terminal_printf("Usage: latency test [1-%d]\n", LATENCY_TEST_MAX);
+            return;
+        }
+        
+        latency_reset();
+        latency_run_test((uint32_t)iterations);
+        latency_print();
+        return;
+    }
+    
+    if (argc > 1 && strcmp(argv[1], "check") == 0) {
+        terminal_print_line(latency_check() ? "Latency check: OK" : "Latency check: FAILED");
+        return;
+    }
+    
+    if (argc > 1) {
+        terminal_print_line("Usage: latency [reset | test [N] | check]");
+        return;
+    }
+    
+    latency_print();
+}
+
+/**
+ * Инициализация и регистрация команды latency
+ */
+void latency_init(void) {
+    latency_reset();
+    cmdreg_register("latency", "Show input-to-display latency", cmd_latency);
+}
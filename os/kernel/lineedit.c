@@ -0,0 +1,200 @@
+/**
+ * kernel/lineedit.c - Редактор строки ввода на основе gap buffer
+ *
+ * Вставка и удаление у курсора, а также сдвиг курсора на символ
+ * выполняются за O(1). Функции редактирования возвращают первую
+ * измененную позицию, чтобы терминал перерисовывал только ячейки
+ * от нее до конца строки.
+ */
+
+#include "lineedit.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Инициализация пустой строки
+ * @param le Строка ввода
+ */
+void lineedit_init(lineedit_t* le) {
+    le->gap_start = 0;
+    le->gap_end = LINEEDIT_CAPACITY;
+}
+
+/**
+ * Длина текста
+ */
+int lineedit_length(const lineedit_t* le) {
+    return le->gap_start + (LINEEDIT_CAPACITY - le->gap_end);
+}
+
+/**
+ * Позиция курсора
+ */
+int lineedit_cursor(const lineedit_t* le) {
+    return le->gap_start;
+}
+
+/**
+ * Символ в логической позиции
+ * @param le Строка ввода
+ * @param pos Позиция (0..длина-1)
+ * @return Символ или 0 за пределами текста
+ */
+char lineedit_char_at(const lineedit_t* le, int pos) {
+    if (pos < 0 || pos >= lineedit_length(le)) return 0;
+    if (pos < le->gap_start) return le->buffer[pos];
+    return le->buffer[pos + (le->gap_end - le->gap_start)];
+}
+
+/**
+ * Копирование текста в обычную строку
+ * @param le Строка ввода
+ * @param out Буфер назначения
+ * @param size Размер буфера
+ * @return Длина скопированного текста
+ */
+int lineedit_get(const lineedit_t* le, char* out, int size) {
+    if (out == NULL || size <= 0) return 0;
+
+    int before = le->gap_start;
+    int after = LINEEDIT_CAPACITY - le->gap_end;
+
+    if (before > size - 1) before = size - 1;
+    if (after > size - 1 - before) after = size - 1 - before;
+
+    memcpy(out, le->buffer, before);
+    memcpy(out + before, &le->buffer[le->gap_end], after);
+    out[before + after] = '\0';
+
+    return before + after;
+}
+
+/**
+ * Вставка символа в позицию курсора
+ * @return Первая измененная позиция или -1, если строка заполнена
+ */
+int lineedit_insert(lineedit_t* le, char c) {
+    // Один байт оставляем под завершающий ноль при копировании
+    if (lineedit_length(le) >= LINEEDIT_CAPACITY - 1) return -1;
+
+    le->buffer[le->gap_start++] = c;
+    return le->gap_start - 1;
+}
+
+/**
+ * Удаление символа перед курсором (Backspace)
+ */
+int lineedit_backspace(lineedit_t* le) {
+    if (le->gap_start == 0) return -1;
+
+    le->gap_start--;
+    return le->gap_start;
+}
+
+/**
+ * Удаление символа под курсором (Delete)
+ */
+int lineedit_delete(lineedit_t* le) {
+    if (le->gap_end == LINEEDIT_CAPACITY) return -1;
+
+    le->gap_end++;
+    return le->gap_start;
+}
+
+/**
+ * Удаление слова перед курсором (Ctrl+W)
+ * Как в readline: сначала пробелы, затем символы до следующего пробела.
+ */
+int lineedit_kill_word(lineedit_t* le) {
+    int pos = le->gap_start;
+
+    while (pos > 0 && le->buffer[pos - 1] == ' ') pos--;
+    while (pos > 0 && le->buffer[pos - 1] != ' ') pos--;
+
+    if (pos == le->gap_start) return -1;
+
+    le->gap_start = pos;
+    return pos;
+}
+
+/**
+ * Удаление всего текста перед курсором (Ctrl+U)
+ */
+int lineedit_kill_line(lineedit_t* le) {
+    if (le->gap_start == 0) return -1;
+
+    le->gap_start = 0;
+    return 0;
+}
+
+/**
+ * Замена всего текста (курсор ставится в конец)
+ * @param le Строка ввода
+ * @param text Новый текст
+ */
+int lineedit_set(lineedit_t* le, const char* text) {
+    int len = 0;
+    while (text[len] != '\0' && len < LINEEDIT_CAPACITY - 1) {
+        le->buffer[len] = text[len];
+        len++;
+    }
+
+    le->gap_start = len;
+    le->gap_end = LINEEDIT_CAPACITY;
+    return 0;
+}
+
+/**
+ * Очистка строки
+ */
+int lineedit_clear(lineedit_t* le) {
+    lineedit_init(le);
+    return 0;
+}
+
+/**
+ * Курсор на символ влево
+ * @return true, если курсор сдвинулся
+ */
+bool lineedit_left(lineedit_t* le) {
+    if (le->gap_start == 0) return false;
+
+    le->buffer[--le->gap_end] = le->buffer[--le->gap_start];
+    return true;
+}
+
+/**
+ * Курсор на символ вправо
+ */
+bool lineedit_right(lineedit_t* le) {
+    if (le->gap_end == LINEEDIT_CAPACITY) return false;
+
+    le->buffer[le->gap_start++] = le->buffer[le->gap_end++];
+    return true;
+}
+
+/**
+ * Курсор в начало строки
+ */
+bool lineedit_home(lineedit_t* le) {
+    if (le->gap_start == 0) return false;
+
+    int count = le->gap_start;
+    le->gap_end -= count;
+    memmove(&le->buffer[le->gap_end], le->buffer, count);
+    le->gap_start = 0;
+    return true;
+}
+
+/**
+ * Курсор в конец строки
+ */
+bool lineedit_end(lineedit_t* le) {
+    if (le->gap_end == LINEEDIT_CAPACITY) return false;
+
+    int count = LINEEDIT_CAPACITY - le->gap_end;
+    memmove(&le->buffer[le->gap_start], &le->buffer[le->gap_end], count);
+    le->gap_start += count;
+    le->gap_end = LINEEDIT_CAPACITY;
+    return true;
+}
@@ -0,0 +1,151 @@
+/**
+ * kernel/lockstat.c - Статистика блокировок
+ *
+ * Блокировка со счетчиками попадает в список при первом захвате, так
+ * что регистрировать ее заранее не нужно. Список только растет и
+ * пополняется без блокировок (CAS на голове).
+ */
+
+#include "lockstat.h"
+#include "cpu.h"
+#include "clock.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Голова списка блокировок со счетчиками
+static lockstat_t* volatile lockstat_list = NULL;
+
+/**
+ * Добавление счетчиков в список (один раз)
+ */
+static void lockstat_register(lockstat_t* stat) {
+    uint32_t expected = 0;
+    if (!__atomic_compare_exchange_n(&stat->registered, &expected, 1, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    
+    lockstat_t* head = __atomic_load_n(&lockstat_list, __ATOMIC_ACQUIRE);
+    do {
+        stat->next = head;
+    } while (!__atomic_compare_exchange_n(&lockstat_list, &head, stat, false,
+                                          __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+/**
+ * Учет захвата (вызывается владельцем сразу после захвата)
+ * @param stat Счетчики
+ * @param start TSC до начала ожидания
+ * @param contended Пришлось ли ждать
+ */
+void lockstat_acquired(lockstat_t* stat, uint64_t start, bool contended) {
+    if (!stat->registered) lockstat_register(stat);
+    
+    uint64_t now = cpu_rdtsc();
+    
+    stat->acquisitions++;
+    if (contended) {
+        stat->contended++;
+        stat->wait_cycles += now - start;
+    }
+    stat->acquired_at = now;
+}
+
+/**
+ * Учет освобождения (вызывается владельцем до освобождения)
+ * @param stat Счетчики
+ */
+void lockstat_released(lockstat_t* stat) {
+    uint32_t held = (uint32_t)(cpu_rdtsc() - stat->acquired_at);
+    
+    stat->hold_cycles += held;
+    if (held > stat->max_hold_cycles) stat->max_hold_cycles = held;
+}
+
+/**
+ * Учет захвата на чтение (читателей может быть несколько)
+ * @param stat Счетчики
+ * @param contended Пришлось ли ждать писателя
+ */
+void lockstat_read_acquired(lockstat_t* stat, bool contended) {
+    if (!stat->registered) lockstat_register(stat);
+    
+    __atomic_add_fetch(&stat->read_acquisitions, 1, __ATOMIC_RELAXED);
+    if (contended) __atomic_add_fetch(&stat->read_contended, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Сброс счетчиков всех блокировок
+ * Захват, идущий в этот момент, может попасть в счетчики частично.
+ */
+void lockstat_reset(void) {
+    for (lockstat_t* s = lockstat_list; s != NULL; s = s->next) {
+        uint32_t flags = cpu_irq_save();
+        s->acquisitions = 0;
+        s->contended = 0;
+        s->wait_cycles = 0;
+        s->hold_cycles = 0;
+        s->max_hold_cycles = 0;
+        s->read_acquisitions = 0;
+        s->read_contended = 0;
+        cpu_irq_restore(flags);
+    }
+}
+
+/**
+ * Перевод циклов TSC в наносекунды для вывода
+ */
+static uint32_t lockstat_cycles_to_ns(uint64_t cycles) {
+    uint32_t khz = clock_get_tsc_khz();
+    if (khz == 0) return 0;
+    return (uint32_t)((cycles * 1000000ull) / khz);
+}
+
+/**
+ * Команда: lockstat [reset] - статистика блокировок
+ */
+static void cmd_lockstat(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        lockstat_reset();
+        terminal_print_line("Lock statistics reset");
+        return;
+    }
+    
+    if (argc > 1) {
+        terminal_print_line("Usage: lockstat [reset]");
+        return;
+    }
+    
+    if (lockstat_list == NULL) {
+        terminal_print_line("No locks taken yet");
+        return;
+    }
+    
+    for (lockstat_t* s = lockstat_list; s != NULL; s = s->next) {
+        uint32_t avg_hold = s->acquisitions ? lockstat_cycles_to_ns(s->hold_cycles / s->acquisitions) : 0;
+        uint32_t avg_wait = s->contended ? lockstat_cycles_to_ns(s->wait_cycles / s->contended) : 0;
+        
+        if (s->instance >= 0) {
+            terminal_printf("%s/%d: ", s->name, s->instance);
+        } else {
+            terminal_printf("%s: ", s->name);
+        }
+        terminal_printf("%d taken, %d contended, wait %d ns, hold avg %d ns, max %d ns\n",
+                        s->acquisitions, s->contended, avg_wait, avg_hold,
+                        lockstat_cycles_to_ns(s->max_hold_cycles));
+        
+        if (s->read_acquisitions) {
+            terminal_printf("  read: %d taken, %d contended\n",
+                            s->read_acquisitions, s->read_contended);
+        }
+    }
+}
+
+/**
+ * Регистрация команды lockstat
+ */
+void lockstat_init(void) {
+    cmdreg_register("lockstat", "Lock contention statistics (lockstat reset)", cmd_lockstat);
+}
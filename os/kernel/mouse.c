@@ -4,14 +4,17 @@
 
 #include "mouse.h"
 #include "idt.h"
+#include "irq.h"
 #include "framebuffer.h"
 #include "gui.h"
+#include "input.h"
+#include "ps2.h"
+#include "coro.h"
+#include "spinlock.h"
 #include <stdbool.h>
 
-// Порты мыши
-#define MOUSE_DATA_PORT    0x60
-#define MOUSE_STATUS_PORT  0x64
-#define MOUSE_COMMAND_PORT 0x64
+// Порт данных мыши (общий с клавиатурой)
+#define MOUSE_DATA_PORT    PS2_DATA_PORT
 
 // Команды мыши
 #define MOUSE_CMD_RESET          0xFF
@@ -34,11 +37,12 @@
 // Глобальные переменные мыши
 static int mouse_x = 400;  // Начальная позиция X (центр экрана)
 static int mouse_y = 300;  // Начальная позиция Y (центр экрана)
+static lockstat_t mouse_pos_stat = LOCKSTAT_INIT("mouse-pos");
+static seqlock_t mouse_pos_lock = SEQLOCK_INIT_STAT(&mouse_pos_stat); // Пара X, Y
 static int mouse_z = 0;    // Положение колеса
 static uint8_t mouse_buttons = 0;
 static uint8_t mouse_packet[4];
 static uint8_t mouse_packet_index = 0;
-static bool mouse_waiting_for_ack = false;
 static bool mouse_initialized = false;
 static bool mouse_is_wheel = false;
 
@@ -72,11 +76,13 @@ void mouse_handler(struct registers* regs) {
     // Читаем данные из порта мыши
     uint8_t data = inb(MOUSE_DATA_PORT);
     
-    // Если мы ждем подтверждение
-    if (mouse_waiting_for_ack) {
-        if (data == 0xFA) { // ACK
-            mouse_waiting_for_ack = false;
-        }
+    // ACK и ответы на команды разбирает драйвер контроллера
+    if (ps2_receive(PS2_PORT_MOUSE, data)) {
+        return;
+    }
+    
+    // До завершения инициализации пакетов нет
+    if (!mouse_initialized) {
         return;
     }
     
@@ -102,6 +108,8 @@ void mouse_handler(struct registers* regs) {
 
 /**
  * Обработка собранного пакета мыши
+ * Пакет разбирается в прерывании и уходит в очередь ввода; позицию
+ * курсора обновляет главный цикл.
  */
 void mouse_process_packet(void) {
     uint8_t flags = mouse_packet[0];
@@ -111,9 +119,6 @@ void mouse_process_packet(void) {
         return;
     }
     
-    // Обновляем состояние кнопок
-    mouse_buttons = flags & 0x07;
-    
     // Получаем перемещение по X
     int32_t delta_x = mouse_packet[1];
     if (flags & MOUSE_X_SIGN) {
@@ -130,14 +135,29 @@ void mouse_process_packet(void) {
     delta_y = -delta_y;
     
     // Получаем перемещение колеса (если есть)
+    int32_t delta_z = 0;
     if (mouse_is_wheel) {
-        int8_t delta_z = (int8_t)mouse_packet[3];
-        mouse_z += delta_z;
+        delta_z = (int8_t)mouse_packet[3];
     }
     
+    input_report_mouse(delta_x, delta_y, delta_z, flags & 0x07);
+}
+
+/**
+ * Обработка события мыши из очереди ввода
+ * Несколько пакетов, накопившихся в очереди, дают одну перерисовку.
+ * @param event Событие INPUT_EVENT_MOUSE
+ */
+static void mouse_input(const input_event_t* event) {
+    // Обновляем состояние кнопок
+    mouse_buttons = event->buttons;
+    mouse_z += event->dz;
+    
     // Обновляем позицию мыши
-    mouse_x += delta_x;
-    mouse_y += delta_y;
+    uint32_t flags = write_seqlock_irqsave(&mouse_pos_lock);
+    
+    mouse_x += event->dx;
+    mouse_y += event->dy;
     
     // Ограничиваем позицию границами экрана
     if (mouse_x < 0) mouse_x = 0;
@@ -145,68 +165,26 @@ void mouse_process_packet(void) {
     if (mouse_x >= SCREEN_WIDTH - 16) mouse_x = SCREEN_WIDTH - 17;
     if (mouse_y >= SCREEN_HEIGHT - 16) mouse_y = SCREEN_HEIGHT - 17;
     
-    // Обновляем курсор
+    write_sequnlock_irqrestore(&mouse_pos_lock, flags);
+    
     gui_update_cursor();
 }
 
 /**
- * Отправка команды мыши
- * @param command Команда для отправки
- * @return Ответ мыши
+ * Получение согласованной позиции мыши
+ * Пара X, Y читается без блокировки и перечитывается, если ее
+ * в это время обновили.
+ * @param x Позиция X
+ * @param y Позиция Y
  */
-uint8_t mouse_send_command(uint8_t command) {
-    mouse_waiting_for_ack = true;
-    
-    // Ждем, пока контроллер будет готов принять команду
-    mouse_wait_for_write();
+void mouse_get_position(int* x, int* y) {
+    uint32_t seq;
     
-    // Отправляем команду на порт мыши
-    outb(MOUSE_COMMAND_PORT, 0xD4);
-    mouse_wait_for_write();
-    outb(MOUSE_DATA_PORT, command);
-    
-    // Ждем подтверждения
-    uint32_t timeout = 100000;
-    while (mouse_waiting_for_ack && timeout > 0) {
-        timeout--;
-        asm volatile("pause");
-    }
-    
-    if (timeout == 0) {
-        return 0xFF; // Таймаут
-    }
-    
-    // Читаем ответ
-    mouse_wait_for_read();
-    return inb(MOUSE_DATA_PORT);
-}
-
-/**
- * Ожидание возможности чтения из порта мыши
- */
-void mouse_wait_for_read(void) {
-    uint32_t timeout = 100000;
-    while (timeout > 0) {
-        if (inb(MOUSE_STATUS_PORT) & 0x01) {
-            return;
-        }
-        timeout--;
-        asm volatile("pause");
-    }
-}
-
-/**
- * Ожидание возможности записи в порт мыши
- */
-void mouse_wait_for_write(void) {
-    uint32_t timeout = 100000;
-    while (timeout > 0) {
-        if (!(inb(MOUSE_STATUS_PORT) & 0x02)) {
-            return;
-        }
-        timeout--;
-        asm volatile("pause");
-    }
+    do {
+        seq = read_seqbegin(&mouse_pos_lock);
+        *x = mouse_x;
+        *y = mouse_y;
+    } while (read_seqretry(&mouse_pos_lock, seq));
 }
 
 /**
@@ -263,6 +241,8 @@ bool mouse_is_middle_pressed(void) {
  * @param y Новая позиция Y
  */
 void mouse_set_position(int x, int y) {
+    uint32_t flags = write_seqlock_irqsave(&mouse_pos_lock);
+    
     mouse_x = x;
     mouse_y = y;
     
@@ -271,88 +251,107 @@ void mouse_set_position(int x, int y) {
     if (mouse_y < 0) mouse_y = 0;
     if (mouse_x >= SCREEN_WIDTH - 16) mouse_x = SCREEN_WIDTH - 17;
     if (mouse_y >= SCREEN_HEIGHT - 16) mouse_y = SCREEN_HEIGHT - 17;
+    
+    write_sequnlock_irqrestore(&mouse_pos_lock, flags);
 }
 
 /**
  * Рисование курсора мыши
  */
 void mouse_draw_cursor(void) {
+    int cursor_x, cursor_y;
+    mouse_get_position(&cursor_x, &cursor_y);
+    
     for (int y = 0; y < 16; y++) {
         for (int x = 0; x < 16; x++) {
             uint32_t color = mouse_cursor[y][x];
             if (color != 0xFF000000) { // Пропускаем полностью прозрачные пиксели
-                framebuffer_put_pixel(mouse_x + x, mouse_y + y, color);
+                framebuffer_put_pixel(cursor_x + x, cursor_y + y, color);
             }
         }
     }
 }
 
+// Шаги инициализации мыши: сброс, последовательность частот 200-100-80
+// для включения колеса (Intellimouse), запрос ID, потоковый режим
+typedef struct {
+    uint8_t command;
+    int16_t arg;
+    uint8_t response_length;
+} mouse_init_step_t;
+
+static const mouse_init_step_t mouse_init_steps[] = {
+    { MOUSE_CMD_RESET,           PS2_NO_ARG, 2 },   // 0xAA и ID
+    { MOUSE_CMD_SET_SAMPLE,      200,        0 },
+    { MOUSE_CMD_SET_SAMPLE,      100,        0 },
+    { MOUSE_CMD_SET_SAMPLE,      80,         0 },
+    { MOUSE_CMD_GET_DEVICE_ID,   PS2_NO_ARG, 1 },
+    { MOUSE_CMD_SET_STREAM_MODE, PS2_NO_ARG, 0 },
+    { MOUSE_CMD_ENABLE,          PS2_NO_ARG, 0 },
+};
+
+#define MOUSE_INIT_STEPS (sizeof(mouse_init_steps) / sizeof(mouse_init_steps[0]))
+
+// Текущий шаг (локальные переменные сопрограммы не сохраняются)
+static uint32_t mouse_init_step = 0;
+
 /**
- * Инициализация мыши
+ * Инициализация мыши по шагам (сопрограмма)
+ * Каждая команда отправляется после завершения предыдущей; между
+ * ними исполнитель свободен для других сопрограмм.
+ * @param co Сопрограмма
+ * @return CORO_WAITING или CORO_DONE
  */
-void mouse_init(void) {
-    // Регистрируем обработчик прерывания мыши
-    irq_register_handler(12, mouse_handler);
-    
-    // Включаем мышь
-    mouse_wait_for_write();
-    outb(MOUSE_COMMAND_PORT, 0xA8); // Включаем второй порт PS/2
-    
-    // Сбрасываем мышь
-    mouse_send_command(MOUSE_CMD_RESET);
-    
-    // Устанавливаем стримовый режим
-    mouse_send_command(MOUSE_CMD_SET_STREAM_MODE);
-    mouse_send_command(MOUSE_CMD_ENABLE);
-    
-    // Пробуем включить колесо (Intellimouse)
-    mouse_send_command(0xF3);
-    mouse_send_command(200); // 200 отсчетов в секунду
-    mouse_send_command(0xF3);
-    mouse_send_command(100);
-    mouse_send_command(0xF3);
-    mouse_send_command(80);
-    
-    // Пробуем получить ID устройства
-    mouse_send_command(MOUSE_CMD_GET_DEVICE_ID);
-    mouse_wait_for_read();
-    uint8_t device_id = inb(MOUSE_DATA_PORT);
+static int mouse_init_coro(coro_t* co) {
+    CORO_BEGIN(co);
     
-    if (device_id == 0x00) {
-        // Обычная мышь без колеса
-        mouse_is_wheel = false;
-        #ifdef DEBUG
-        terminal_printf("Standard PS/2 mouse detected\n");
-        #endif
-    } else if (device_id == 0x03) {
-        // Мышь с колесом (Intellimouse)
-        mouse_is_wheel = true;
-        #ifdef DEBUG
-        terminal_printf("Intellimouse (wheel) detected\n");
-        #endif
+    for (mouse_init_step = 0; mouse_init_step < MOUSE_INIT_STEPS; mouse_init_step++) {
+        CORO_AWAIT_PS2(co, PS2_PORT_MOUSE,
+                       mouse_init_steps[mouse_init_step].command,
+                       mouse_init_steps[mouse_init_step].arg,
+                       mouse_init_steps[mouse_init_step].response_length);
+        
+        if (co->status != PS2_OK) {
+            #ifdef DEBUG
+            terminal_printf("Mouse: init step %d failed, no mouse\n", mouse_init_step);
+            #endif
+            CORO_EXIT(co);
+        }
+        
+        if (mouse_init_steps[mouse_init_step].command == MOUSE_CMD_GET_DEVICE_ID &&
+            co->response_length > 0) {
+            // 0x00 - обычная мышь, 0x03 - мышь с колесом
+            mouse_is_wheel = co->response[0] == 0x03;
+            
+            #ifdef DEBUG
+            terminal_printf(mouse_is_wheel ? "Intellimouse (wheel) detected\n"
+                                           : "Standard PS/2 mouse detected\n");
+            #endif
+        }
     }
     
-    // Включаем прерывания мыши
-    mouse_wait_for_write();
-    outb(MOUSE_COMMAND_PORT, 0x20);
-    mouse_wait_for_read();
-    uint8_t status = inb(MOUSE_DATA_PORT);
-    status |= 0x02; // Включаем прерывания мыши
-    status &= 0xDF; // Очищаем бит 5
-    mouse_wait_for_write();
-    outb(MOUSE_COMMAND_PORT, 0x60);
-    mouse_wait_for_write();
-    outb(MOUSE_DATA_PORT, status);
-    
-    // Включаем стримовый режим
-    mouse_send_command(MOUSE_CMD_SET_STREAM_MODE);
-    mouse_send_command(MOUSE_CMD_ENABLE);
-    
+    mouse_packet_index = 0;
     mouse_initialized = true;
     
     #ifdef DEBUG
     terminal_printf("Mouse initialized\n");
     #endif
+    
+    CORO_END(co);
+}
+
+/**
+ * Инициализация мыши
+ * Команды выполняет сопрограмма: загрузка не ждет ответов мыши,
+ * пакеты начинают приниматься после последнего шага.
+ */
+void mouse_init(void) {
+    // Регистрируем обработчик прерывания мыши
+    input_set_handler(INPUT_EVENT_MOUSE, mouse_input);
+    irq_register_handler(12, mouse_handler);
+    
+    mouse_initialized = false;
+    coro_spawn("mouse-init", mouse_init_coro, NULL);
 }
 
 /**
@@ -0,0 +1,113 @@
+/**
+ * kernel/multiboot.c - Сведения от загрузчика Multiboot (GRUB)
+ *
+ * Заголовок в секции .multiboot просит GRUB выровнять модули по
+ * границе страницы (их страницы отображаются в процессы как есть) и
+ * передать карту памяти. Сведения копируются при входе: структуры
+ * загрузчика лежат в памяти, которую потом раздает pmm.
+ */
+
+#include "multiboot.h"
+#include <stddef.h>
+#include <string.h>
+
+#define MULTIBOOT_HEADER_FLAGS (MULTIBOOT_PAGE_ALIGN | MULTIBOOT_MEMORY_INFO)
+
+// Заголовок, по которому GRUB узнает ядро
+__attribute__((section(".multiboot"), aligned(4), used))
+static const uint32_t multiboot_header[3] = {
+    MULTIBOOT_HEADER_MAGIC,
+    MULTIBOOT_HEADER_FLAGS,
+    (uint32_t)-(MULTIBOOT_HEADER_MAGIC + MULTIBOOT_HEADER_FLAGS)
+};
+
+// Копия сведений загрузчика
+static multiboot_info_t multiboot_info;
+static bool multiboot_valid = false;
+
+// Копии описаний модулей; имена остаются в памяти загрузчика,
+// которую pmm не раздает
+static multiboot_module_t multiboot_modules[MULTIBOOT_MAX_MODULES];
+static uint32_t multiboot_modules_count = 0;
+
+/**
+ * Сохранение сведений загрузчика (первым делом при входе в ядро)
+ * @param magic Значение EAX при входе
+ * @param info Значение EBX при входе
+ * @return false, если ядро загружено не через Multiboot
+ */
+bool multiboot_init(uint32_t magic, uint32_t info) {
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC || info == 0) {
+        return false;
+    }
+    
+    memcpy(&multiboot_info, (const void*)info, sizeof(multiboot_info_t));
+    multiboot_valid = true;
+    
+    if (multiboot_info.flags & MULTIBOOT_INFO_MODS) {
+        const multiboot_module_t* mods = (const multiboot_module_t*)multiboot_info.mods_addr;
+        uint32_t count = multiboot_info.mods_count;
+        if (count > MULTIBOOT_MAX_MODULES) count = MULTIBOOT_MAX_MODULES;
+        
+        memcpy(multiboot_modules, mods, count * sizeof(multiboot_module_t));
+        multiboot_modules_count = count;
+    }
+    
+    return true;
+}
+
+/**
+ * Сведения загрузчика
+ * @return Копия структуры или NULL
+ */
+const multiboot_info_t* multiboot_get_info(void) {
+    return multiboot_valid ? &multiboot_info : NULL;
+}
+
+/**
+ * Количество загруженных модулей
+ */
+uint32_t multiboot_module_count(void) {
+    return multiboot_modules_count;
+}
+
+/**
+ * Модуль по номеру
+ * @return Описание или NULL
+ */
+const multiboot_module_t* multiboot_get_module(uint32_t index) {
+    if (index >= multiboot_modules_count) return NULL;
+    return &multiboot_modules[index];
+}
+
+/**
+ * Имя модуля: последний компонент пути из командной строки модуля
+ * ("/boot/hello.elf arg" - "hello.elf arg")
+ */
+const char* multiboot_module_name(const multiboot_module_t* mod) {
+    if (mod == NULL || mod->string == 0) return "";
+    
+    const char* name = (const char*)mod->string;
+    for (const char* p = name; *p != '\0' && *p != ' '; p++) {
+        if (*p == '/') name = p + 1;
+    }
+    return name;
+}
+
+/**
+ * Поиск модуля по имени (до первого пробела)
+ * @return Описание или NULL
+ */
+const multiboot_module_t* multiboot_find_module(const char* name) {
+    size_t length = strlen(name);
+    
+    for (uint32_t i = 0; i < multiboot_modules_count; i++) {
+        const char* mod_name = multiboot_module_name(&multiboot_modules[i]);
+        if (strncmp(mod_name, name, length) == 0 &&
+            (mod_name[length] == '\0' || mod_name[length] == ' ')) {
+            return &multiboot_modules[i];
+        }
+    }
+    
+    return NULL;
+}
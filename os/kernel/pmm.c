@@ -0,0 +1,238 @@
+/**
+ * kernel/pmm.c - Менеджер физических страниц
+ *
+ * Битовая карта страниц ниже PMM_LIMIT: бит установлен - страница
+ * занята или не является ОЗУ. Свободной память становится только по
+ * карте памяти загрузчика; затем занимаются первый мегабайт (BIOS,
+ * стартовый код AP), образ ядра и модули Multiboot.
+ */
+
+#include "pmm.h"
+#include "multiboot.h"
+#include "spinlock.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Конец образа ядра (linker.ld)
+extern uint8_t _kernel_end[];
+
+// Память ниже этого адреса не раздается
+#define PMM_LOW_MEMORY      0x100000
+
+static uint32_t pmm_bitmap[PMM_PAGES / 32];
+static uint32_t pmm_total = 0;
+static uint32_t pmm_free_count = 0;
+
+// Поиск свободной страницы начинается с последнего освобожденного слова
+static uint32_t pmm_hint = 0;
+
+SPINLOCK_DEFINE(pmm_lock, "pmm");
+
+/**
+ * Пометка диапазона свободным (при разборе карты памяти)
+ */
+static void pmm_release_range(uint64_t start, uint64_t end) {
+    if (end > PMM_LIMIT) end = PMM_LIMIT;
+    if (start >= end) return;
+    
+    for (uint32_t page = PAGE_ALIGN_UP((uint32_t)start) / PAGE_SIZE;
+         page < (uint32_t)end / PAGE_SIZE; page++) {
+        if (pmm_bitmap[page / 32] & (1u << (page % 32))) {
+            pmm_bitmap[page / 32] &= ~(1u << (page % 32));
+            pmm_free_count++;
+            pmm_total++;
+        }
+    }
+}
+
+/**
+ * Пометка диапазона занятым
+ */
+static void pmm_reserve_range(uint32_t start, uint32_t end) {
+    if (end > PMM_LIMIT) end = PMM_LIMIT;
+    
+    for (uint32_t page = start / PAGE_SIZE; page < PAGE_ALIGN_UP(end) / PAGE_SIZE; page++) {
+        if (!(pmm_bitmap[page / 32] & (1u << (page % 32)))) {
+            pmm_bitmap[page / 32] |= 1u << (page % 32);
+            pmm_free_count--;
+        }
+    }
+}
+
+/**
+ * Инициализация по сведениям загрузчика
+ * @return false, если карты памяти нет
+ */
+bool pmm_init(void) {
+    const multiboot_info_t* info = multiboot_get_info();
+    if (info == NULL) return false;
+    
+    // Все занято, пока карта памяти не скажет обратного
+    memset(pmm_bitmap, 0xFF, sizeof(pmm_bitmap));
+    
+    if (info->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uint32_t addr = info->mmap_addr;
+        uint32_t end = info->mmap_addr + info->mmap_length;
+        
+        while (addr < end) {
+            const multiboot_mmap_entry_t* e = (const multiboot_mmap_entry_t*)addr;
+            if (e->type == MULTIBOOT_MEMORY_AVAILABLE) {
+                pmm_release_range(e->addr, e->addr + e->len);
+            }
+            addr += e->size + sizeof(e->size);
+        }
+    } else if (info->flags & MULTIBOOT_INFO_MEMORY) {
+        // Без карты: непрерывная память выше 1 МБ
+        pmm_release_range(PMM_LOW_MEMORY, PMM_LOW_MEMORY + (uint64_t)info->mem_upper * 1024);
+    } else {
+        return false;
+    }
+    
+    pmm_reserve_range(0, PMM_LOW_MEMORY);
+    pmm_reserve_range(PMM_LOW_MEMORY, (uint32_t)_kernel_end);
+    
+    // Модули отображаются в процессы прямо из памяти загрузчика
+    for (uint32_t i = 0; i < multiboot_module_count(); i++) {
+        const multiboot_module_t* mod = multiboot_get_module(i);
+        pmm_reserve_range(PAGE_ALIGN_DOWN(mod->mod_start), mod->mod_end);
+        if (mod->string != 0) {
+            pmm_reserve_range(PAGE_ALIGN_DOWN(mod->string), mod->string + PAGE_SIZE);
+        }
+    }
+    
+    #ifdef DEBUG
+    terminal_printf("PMM: %d KB free of %d KB\n",
+                    pmm_free_count * (PAGE_SIZE / 1024), pmm_total * (PAGE_SIZE / 1024));
+    #endif
+    
+    return pmm_total > 0;
+}
+
+/**
+ * Выделение физической страницы
+ * @return Физический адрес или 0, если память кончилась
+ */
+uint32_t pmm_alloc(void) {
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    
+    uint32_t words = PMM_PAGES / 32;
+    uint32_t page = 0;
+    
+    for (uint32_t n = 0; n < words; n++) {
+        uint32_t w = (pmm_hint + n) % words;
+        if (pmm_bitmap[w] == 0xFFFFFFFF) continue;
+        
+        uint32_t bit = __builtin_ctz(~pmm_bitmap[w]);
+        pmm_bitmap[w] |= 1u << bit;
+        pmm_free_count--;
+        pmm_hint = w;
+        page = (w * 32 + bit) * PAGE_SIZE;
+        break;
+    }
+    
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return page;
+}
+
+/**
+ * Выделение нескольких физически смежных страниц
+ * Нужно для буферов, которые ядро читает одним куском (поверхности
+ * окон): ниже PMM_LIMIT такой буфер непрерывен и по адресу ядра.
+ * @param count Количество страниц
+ * @return Физический адрес первой страницы или 0
+ */
+uint32_t pmm_alloc_range(uint32_t count) {
+    if (count == 0) return 0;
+    
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    
+    uint32_t start = 0;
+    uint32_t run = 0;
+    uint32_t found = 0;
+    
+    for (uint32_t page = PMM_LOW_MEMORY / PAGE_SIZE; page < PMM_PAGES; page++) {
+        // Целиком занятые слова пропускаются
+        if ((page % 32) == 0 && pmm_bitmap[page / 32] == 0xFFFFFFFF) {
+            run = 0;
+            page += 31;
+            continue;
+        }
+        
+        if (pmm_bitmap[page / 32] & (1u << (page % 32))) {
+            run = 0;
+            continue;
+        }
+        
+        if (run == 0) start = page;
+        if (++run == count) {
+            found = start * PAGE_SIZE;
+            break;
+        }
+    }
+    
+    if (found != 0) {
+        for (uint32_t page = start; page < start + count; page++) {
+            pmm_bitmap[page / 32] |= 1u << (page % 32);
+        }
+        pmm_free_count -= count;
+    }
+    
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return found;
+}
+
+/**
+ * Выделение обнуленной физической страницы
+ * @return Физический адрес или 0
+ */
+uint32_t pmm_alloc_zeroed(void) {
+    uint32_t page = pmm_alloc();
+    if (page != 0) {
+        memset((void*)page, 0, PAGE_SIZE);
+    }
+    return page;
+}
+
+/**
+ * Освобождение физической страницы
+ * @param page Физический адрес (выровнен по странице)
+ */
+void pmm_free(uint32_t page) {
+    if (page < PMM_LOW_MEMORY || page >= PMM_LIMIT) return;
+    
+    uint32_t index = page / PAGE_SIZE;
+    
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    if (pmm_bitmap[index / 32] & (1u << (index % 32))) {
+        pmm_bitmap[index / 32] &= ~(1u << (index % 32));
+        pmm_free_count++;
+        pmm_hint = index / 32;
+    }
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+/**
+ * Освобождение смежных страниц (pmm_alloc_range)
+ * @param start Физический адрес первой страницы
+ * @param count Количество страниц
+ */
+void pmm_free_range(uint32_t start, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        pmm_free(start + i * PAGE_SIZE);
+    }
+}
+
+/**
+ * Количество свободных страниц
+ */
+uint32_t pmm_free_pages(void) {
+    return pmm_free_count;
+}
+
+/**
+ * Количество страниц ОЗУ под управлением pmm
+ */
+uint32_t pmm_total_pages(void) {
+    return pmm_total;
+}
@@ -0,0 +1,384 @@
+/**
+ * kernel/proc.c - Процессы кольца 3
+ *
+ * Процесс - поток ядра со своим адресным пространством, который после
+ * загрузки образа переходит в кольцо 3. Образ берется из модуля
+ * Multiboot по имени. Системные вызовы и прерывания выполняются на
+ * стеке ядра этого потока; выводом служит терминал (SYS_WRITE).
+ *
+ * Завершение (SYS_EXIT или исключение в кольце 3) освобождает
+ * адресное пространство сразу, а слот остается до proc_wait(), который
+ * забирает код завершения. Если родитель завершился, не дождавшись,
+ * слот освобождается при завершении самого процесса.
+ */
+
+#include "proc.h"
+#include "vmm.h"
+#include "pmm.h"
+#include "elf.h"
+#include "surface.h"
+#include "uring.h"
+#include "multiboot.h"
+#include "syscall.h"
+#include "spinlock.h"
+#include "wait.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+static proc_t proc_table[PROC_MAX];
+static uint32_t proc_next_pid = 1;
+
+SPINLOCK_DEFINE(proc_lock, "proc");
+
+// Здесь ждут завершения процессов
+static wait_queue_t proc_exit_wait = WAIT_QUEUE_INIT;
+
+static const char* proc_state_names[] = {
+    "free", "starting", "running", "zombie"
+};
+
+/**
+ * Процесс текущего потока (его собственного или потока опроса кольца)
+ * @return Процесс или NULL для потоков ядра
+ */
+proc_t* proc_current(void) {
+    thread_t* self = sched_current();
+    
+    for (int i = 0; i < PROC_MAX; i++) {
+        proc_t* p = &proc_table[i];
+        if ((p->thread == self || p->poller == self) &&
+            (p->state == PROC_STARTING || p->state == PROC_RUNNING)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Проверка буфера системного вызова
+ * Потоки ядра (и код ядра в кольце 3) передают адреса ядра - для них
+ * проверки нет.
+ * @return true, если буфер доступен процессу
+ */
+bool proc_check_user(uint32_t addr, uint32_t length, bool write) {
+    proc_t* p = proc_current();
+    if (p == NULL) return true;
+    
+    return vmm_check_user(p->directory, addr, length, write);
+}
+
+/**
+ * Копирование строки из памяти процесса
+ * @return false, если строка не отображена или длиннее буфера
+ */
+static bool proc_copy_string(uint32_t addr, char* buffer, uint32_t size) {
+    for (uint32_t i = 0; i < size; i++) {
+        if (!proc_check_user(addr + i, 1, false)) return false;
+        
+        buffer[i] = ((const char*)addr)[i];
+        if (buffer[i] == '\0') return true;
+    }
+    return false;
+}
+
+/**
+ * Поток процесса: адресное пространство и переход в кольцо 3
+ */
+static void proc_thread(void* arg) {
+    proc_t* p = (proc_t*)arg;
+    thread_t* self = sched_current();
+    
+    // Планировщик загружает каталог потока при каждом переключении
+    uint32_t flags = cpu_irq_save();
+    p->thread = self;
+    self->page_directory = p->directory;
+    vmm_switch(p->directory);
+    p->state = PROC_RUNNING;
+    cpu_irq_restore(flags);
+    
+    syscall_enter_user(p->entry, VMM_USER_STACK_TOP);
+}
+
+/**
+ * Освобождение слота (под proc_lock)
+ */
+static void proc_release(proc_t* p) {
+    p->state = PROC_FREE;
+    p->thread = NULL;
+    p->parent = NULL;
+}
+
+/**
+ * Запуск процесса из модуля Multiboot
+ * @param name Имя модуля
+ * @param parent Родитель (NULL - ядро)
+ * @return pid или -1
+ */
+int32_t proc_spawn(const char* name, proc_t* parent) {
+    if (!vmm_is_enabled()) return -1;
+    
+    const multiboot_module_t* mod = multiboot_find_module(name);
+    if (mod == NULL) return -1;
+    
+    uint32_t flags = spin_lock_irqsave(&proc_lock);
+    
+    proc_t* p = NULL;
+    for (int i = 0; i < PROC_MAX; i++) {
+        if (proc_table[i].state == PROC_FREE) {
+            p = &proc_table[i];
+            p->state = PROC_STARTING;
+            p->pid = proc_next_pid++;
+            break;
+        }
+    }
+    
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    if (p == NULL) return -1;
+    
+    strncpy(p->name, name, PROC_NAME_LENGTH - 1);
+    p->name[PROC_NAME_LENGTH - 1] = '\0';
+    p->parent = parent;
+    p->orphan = false;
+    p->exit_code = 0;
+    p->thread = NULL;
+    p->poller = NULL;
+    
+    // Адресное пространство: образ и стек
+    p->directory = vmm_create(false);
+    bool ok = p->directory != 0 &&
+              elf_load(p->directory, mod->mod_start, mod->mod_end - mod->mod_start, &p->entry);
+    
+    for (uint32_t i = 0; ok && i < PROC_STACK_PAGES; i++) {
+        uint32_t frame = pmm_alloc_zeroed();
+        ok = frame != 0 &&
+             vmm_map(p->directory, VMM_USER_STACK_TOP - (i + 1) * PAGE_SIZE, frame, VMM_WRITABLE);
+        if (!ok && frame != 0) pmm_free(frame);
+    }
+    
+    if (ok) {
+        ok = sched_create(p->name, proc_thread, p) != NULL;
+    }
+    
+    if (!ok) {
+        vmm_destroy(p->directory);
+        p->directory = 0;
+        
+        flags = spin_lock_irqsave(&proc_lock);
+        proc_release(p);
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return -1;
+    }
+    
+    #ifdef DEBUG
+    terminal_printf("Proc: %d (%s) entry %x\n", p->pid, p->name, p->entry);
+    #endif
+    
+    return (int32_t)p->pid;
+}
+
+/**
+ * Ожидание завершения процесса
+ * Процесс может ждать только своих потомков, ядро - любой процесс.
+ * @param pid Идентификатор
+ * @return Код завершения или -1
+ */
+int32_t proc_wait(uint32_t pid) {
+    proc_t* self = proc_current();
+    proc_t* p = NULL;
+    
+    uint32_t flags = spin_lock_irqsave(&proc_lock);
+    for (int i = 0; i < PROC_MAX; i++) {
+        if (proc_table[i].state != PROC_FREE && proc_table[i].pid == pid) {
+            p = &proc_table[i];
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    if (p == NULL || p == self || (self != NULL && p->parent != self)) return -1;
+    
+    wait_event(&proc_exit_wait, p->state == PROC_ZOMBIE || p->pid != pid);
+    
+    int32_t code = -1;
+    
+    flags = spin_lock_irqsave(&proc_lock);
+    if (p->pid == pid && p->state == PROC_ZOMBIE) {
+        code = p->exit_code;
+        proc_release(p);
+    }
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    return code;
+}
+
+/**
+ * Завершение текущего процесса (или потока ядра)
+ * @param code Код завершения
+ */
+void proc_exit(int32_t code) {
+    proc_t* p = proc_current();
+    if (p == NULL) sched_exit();
+    
+    #ifdef DEBUG
+    terminal_printf("Proc: %d exited with code %d\n", p->pid, code);
+    #endif
+    
+    // Уходим с каталога процесса, чтобы его можно было освободить
+    uint32_t flags = cpu_irq_save();
+    sched_current()->page_directory = 0;
+    vmm_switch(0);
+    cpu_irq_restore(flags);
+    
+    // Поток опроса кольца останавливается до освобождения каталога,
+    // страницы поверхностей освобождает композитор
+    uring_release(p);
+    surface_release(p);
+    vmm_destroy(p->directory);
+    p->directory = 0;
+    
+    flags = spin_lock_irqsave(&proc_lock);
+    
+    for (int i = 0; i < PROC_MAX; i++) {
+        proc_t* child = &proc_table[i];
+        if (child->state == PROC_FREE || child->parent != p) continue;
+        
+        child->parent = NULL;
+        if (child->state == PROC_ZOMBIE) {
+            proc_release(child);
+        } else {
+            child->orphan = true;
+        }
+    }
+    
+    p->exit_code = code;
+    if (p->orphan) {
+        proc_release(p);
+    } else {
+        p->state = PROC_ZOMBIE;
+    }
+    
+    spin_unlock_irqrestore(&proc_lock, flags);
+    
+    wake_up_all(&proc_exit_wait);
+    
+    sched_exit();
+}
+
+/**
+ * Исключение в кольце 3 (из isr_handler): процесс завершается
+ * @param regs Регистры на момент исключения
+ */
+void proc_fault(struct registers* regs) {
+    proc_t* p = proc_current();
+    
+    if (regs->int_no == EXCEPTION_PAGE_FAULT) {
+        terminal_printf("%s: page fault at %x (eip %x)\n",
+                        p != NULL ? p->name : sched_current()->name,
+                        cpu_read_cr2(), regs->eip);
+    } else {
+        terminal_printf("%s: exception %d at eip %x\n",
+                        p != NULL ? p->name : sched_current()->name,
+                        regs->int_no, regs->eip);
+    }
+    
+    proc_exit(-1);
+}
+
+/**
+ * SYS_EXIT - завершение процесса
+ */
+static int32_t sys_proc_exit(uint32_t code, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    proc_exit((int32_t)code);
+}
+
+/**
+ * SYS_SPAWN - запуск процесса из модуля
+ * @param name Адрес имени модуля
+ * @return pid или -1
+ */
+static int32_t sys_spawn(uint32_t name, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    
+    char buffer[PROC_NAME_LENGTH];
+    if (!proc_copy_string(name, buffer, sizeof(buffer))) return -1;
+    
+    return proc_spawn(buffer, proc_current());
+}
+
+/**
+ * SYS_WAIT - ожидание завершения потомка
+ * @param pid Идентификатор
+ * @return Код завершения или -1
+ */
+static int32_t sys_wait(uint32_t pid, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return proc_wait(pid);
+}
+
+/**
+ * SYS_GETPID - идентификатор процесса (0 - поток ядра)
+ */
+static int32_t sys_getpid(uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    
+    proc_t* p = proc_current();
+    return p != NULL ? (int32_t)p->pid : 0;
+}
+
+/**
+ * Команда: run <модуль> - запуск процесса и ожидание его завершения
+ */
+static void cmd_run(int argc, char** argv) {
+    if (argc < 2) {
+        terminal_print_line("Usage: run <module>");
+        return;
+    }
+    
+    int32_t pid = proc_spawn(argv[1], NULL);
+    if (pid < 0) {
+        terminal_printf("Cannot start %s\n", argv[1]);
+        return;
+    }
+    
+    int32_t code = proc_wait((uint32_t)pid);
+    terminal_printf("%s (pid %d) exited with code %d\n", argv[1], pid, code);
+}
+
+/**
+ * Команда: ps - процессы и модули
+ */
+static void cmd_ps(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    for (int i = 0; i < PROC_MAX; i++) {
+        proc_t* p = &proc_table[i];
+        if (p->state == PROC_FREE) continue;
+        
+        terminal_printf("%d %s: %s\n", p->pid, p->name, proc_state_names[p->state]);
+    }
+    
+    uint32_t count = multiboot_module_count();
+    terminal_printf("%d modules:", count);
+    for (uint32_t i = 0; i < count; i++) {
+        terminal_printf(" %s", multiboot_module_name(multiboot_get_module(i)));
+    }
+    terminal_putchar('\n');
+}
+
+/**
+ * Инициализация процессов (после syscall_init)
+ */
+void proc_init(void) {
+    syscall_register(SYS_EXIT, sys_proc_exit);
+    syscall_register(SYS_SPAWN, sys_spawn);
+    syscall_register(SYS_WAIT, sys_wait);
+    syscall_register(SYS_GETPID, sys_getpid);
+    
+    cmdreg_register("run", "Run a user program (run <module>)", cmd_run);
+    cmdreg_register("ps", "List processes and boot modules", cmd_ps);
+}
@@ -0,0 +1,373 @@
+/**
+ * kernel/ps2.c - Контроллер PS/2 (8042)
+ *
+ * Команды устройствам (клавиатуре и мыши) ставятся в очередь своего
+ * порта и выполняются асинхронно: байт команды записывается в
+ * контроллер, а ACK, RESEND и байты ответа разбирает обработчик
+ * прерывания устройства через ps2_receive(). Если устройство молчит,
+ * команду завершает таймер. Ожидание готовности контроллера осталось
+ * только на запись одного байта во входной буфер 8042 - это
+ * микросекунды, а не ответ устройства.
+ */
+
+#include "ps2.h"
+#include "irq.h"
+#include "cpu.h"
+#include "timer.h"
+#include "terminal.h"
+#include <stddef.h>
+
+// Команды контроллера
+#define PS2_CTRL_READ_CONFIG    0x20
+#define PS2_CTRL_WRITE_CONFIG   0x60
+#define PS2_CTRL_DISABLE_AUX    0xA7
+#define PS2_CTRL_ENABLE_AUX     0xA8
+#define PS2_CTRL_DISABLE_KBD    0xAD
+#define PS2_CTRL_ENABLE_KBD     0xAE
+#define PS2_CTRL_WRITE_AUX      0xD4    // Следующий байт данных - мыши
+
+// Биты байта конфигурации
+#define PS2_CONFIG_KBD_IRQ      0x01
+#define PS2_CONFIG_AUX_IRQ      0x02
+#define PS2_CONFIG_KBD_CLOCK    0x10    // 1 - тактирование отключено
+#define PS2_CONFIG_AUX_CLOCK    0x20
+
+// Команда сброса устройства (отвечает после самотестирования)
+#define PS2_CMD_RESET           0xFF
+
+// Предел опроса регистра состояния
+#define PS2_WAIT_LIMIT          100000
+
+// Повторы после RESEND и время ожидания ответа
+#define PS2_MAX_RETRIES         3
+#define PS2_TIMEOUT_MS          100
+#define PS2_RESET_TIMEOUT_MS    1000
+
+// Состояния порта
+#define PS2_STATE_IDLE          0
+#define PS2_STATE_ACK           1   // Ждем ACK на байт sent
+#define PS2_STATE_RESPONSE      2   // Собираем ответ
+
+// Команда в очереди
+typedef struct {
+    uint8_t bytes[2];           // Команда и аргумент
+    uint8_t length;
+    uint8_t response_length;
+    ps2_done_t done;
+    void* data;
+} ps2_cmd_t;
+
+// Порт устройства (текущая команда - queue[tail], пока порт не IDLE)
+typedef struct {
+    ps2_cmd_t queue[PS2_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint8_t state;
+    uint8_t sent;
+    uint8_t retries;
+    uint8_t received;
+    uint8_t response[PS2_MAX_RESPONSE];
+    uint32_t seq;               // Номер попытки для проверки таймаута
+    timer_handle_t timeout;
+} ps2_port_t;
+
+static ps2_port_t ps2_ports[PS2_PORTS];
+static bool ps2_dual = false;   // Есть второй порт (мышь)
+
+/**
+ * Ожидание, пока контроллер заберет записанный байт
+ * @return false при таймауте
+ */
+static bool ps2_wait_write(void) {
+    for (uint32_t i = 0; i < PS2_WAIT_LIMIT; i++) {
+        if (!(inb(PS2_STATUS_PORT) & PS2_STATUS_INPUT)) return true;
+        cpu_relax();
+    }
+    return false;
+}
+
+/**
+ * Ожидание байта от контроллера (только при инициализации)
+ * @return false при таймауте
+ */
+static bool ps2_wait_read(void) {
+    for (uint32_t i = 0; i < PS2_WAIT_LIMIT; i++) {
+        if (inb(PS2_STATUS_PORT) & PS2_STATUS_OUTPUT) return true;
+        cpu_relax();
+    }
+    return false;
+}
+
+/**
+ * Команда контроллеру
+ * @param command Команда
+ */
+static void ps2_controller_command(uint8_t command) {
+    ps2_wait_write();
+    outb(PS2_COMMAND_PORT, command);
+}
+
+/**
+ * Передача байта устройству
+ * @param port Порт устройства
+ * @param value Байт
+ */
+static void ps2_transmit(int port, uint8_t value) {
+    if (port == PS2_PORT_MOUSE) {
+        ps2_controller_command(PS2_CTRL_WRITE_AUX);
+    }
+    ps2_wait_write();
+    outb(PS2_DATA_PORT, value);
+}
+
+static void ps2_timeout(void* data);
+
+/**
+ * Взвод таймаута ожидания ответа
+ * Старый таймер отменяется; номер попытки отличает устаревшие срабатывания.
+ * @param port Порт устройства
+ */
+static void ps2_arm_timeout(int port) {
+    ps2_port_t* p = &ps2_ports[port];
+    const ps2_cmd_t* cmd = &p->queue[p->tail % PS2_QUEUE_SIZE];
+    
+    timer_unregister_callback(p->timeout);
+    p->seq++;
+    
+    uint32_t ms = cmd->bytes[0] == PS2_CMD_RESET ? PS2_RESET_TIMEOUT_MS : PS2_TIMEOUT_MS;
+    p->timeout = timer_register_oneshot(ps2_timeout, (void*)(uintptr_t)((p->seq << 1) | port), ms);
+}
+
+/**
+ * Запуск следующей команды из очереди (прерывания запрещены)
+ * @param port Порт устройства
+ */
+static void ps2_start(int port) {
+    ps2_port_t* p = &ps2_ports[port];
+    if (p->state != PS2_STATE_IDLE || p->head == p->tail) return;
+    
+    p->state = PS2_STATE_ACK;
+    p->sent = 0;
+    p->retries = 0;
+    p->received = 0;
+    
+    ps2_transmit(port, p->queue[p->tail % PS2_QUEUE_SIZE].bytes[0]);
+    ps2_arm_timeout(port);
+}
+
+/**
+ * Завершение текущей команды и запуск следующей (прерывания запрещены)
+ * @param port Порт устройства
+ * @param status Результат
+ */
+static void ps2_complete(int port, ps2_status_t status) {
+    ps2_port_t* p = &ps2_ports[port];
+    ps2_cmd_t cmd = p->queue[p->tail % PS2_QUEUE_SIZE];
+    uint8_t response[PS2_MAX_RESPONSE];
+    int length = p->received;
+    
+    for (int i = 0; i < length; i++) {
+        response[i] = p->response[i];
+    }
+    
+    timer_unregister_callback(p->timeout);
+    p->timeout = TIMER_INVALID_HANDLE;
+    p->tail++;
+    p->state = PS2_STATE_IDLE;
+    
+    #ifdef DEBUG
+    if (status != PS2_OK) {
+        terminal_printf("PS/2: port %d command %x failed (%d)\n", port, cmd.bytes[0], status);
+    }
+    #endif
+    
+    // Обработчик может поставить следующую команду сам
+    if (cmd.done != NULL) {
+        cmd.done(port, status, response, length, cmd.data);
+    }
+    
+    ps2_start(port);
+}
+
+/**
+ * Истечение времени ожидания ответа (из таймера)
+ * @param data Порт и номер попытки
+ */
+static void ps2_timeout(void* data) {
+    uint32_t value = (uint32_t)(uintptr_t)data;
+    int port = value & 1;
+    ps2_port_t* p = &ps2_ports[port];
+    
+    uint32_t flags = cpu_irq_save();
+    
+    if (p->state != PS2_STATE_IDLE && (p->seq << 1) == (value & ~1u)) {
+        p->timeout = TIMER_INVALID_HANDLE;
+        ps2_complete(port, PS2_TIMEOUT);
+    }
+    
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Постановка команды устройству в очередь
+ * @param port PS2_PORT_KEYBOARD или PS2_PORT_MOUSE
+ * @param command Байт команды
+ * @param arg Байт аргумента или PS2_NO_ARG
+ * @param response_length Сколько байтов ответа ждать после ACK
+ * @param done Обработчик завершения (может быть NULL)
+ * @param data Данные для обработчика
+ * @return false, если порт отсутствует или очередь заполнена
+ */
+bool ps2_send(int port, uint8_t command, int arg, int response_length,
+              ps2_done_t done, void* data) {
+    if (port < 0 || port >= PS2_PORTS) return false;
+    if (port == PS2_PORT_MOUSE && !ps2_dual) return false;
+    if (response_length < 0 || response_length > PS2_MAX_RESPONSE) return false;
+    
+    ps2_port_t* p = &ps2_ports[port];
+    uint32_t flags = cpu_irq_save();
+    
+    if (p->head - p->tail >= PS2_QUEUE_SIZE) {
+        cpu_irq_restore(flags);
+        return false;
+    }
+    
+    ps2_cmd_t* cmd = &p->queue[p->head % PS2_QUEUE_SIZE];
+    cmd->bytes[0] = command;
+    cmd->bytes[1] = (uint8_t)arg;
+    cmd->length = arg == PS2_NO_ARG ? 1 : 2;
+    cmd->response_length = (uint8_t)response_length;
+    cmd->done = done;
+    cmd->data = data;
+    p->head++;
+    
+    ps2_start(port);
+    
+    cpu_irq_restore(flags);
+    return true;
+}
+
+/**
+ * Разбор байта от устройства (из обработчика IRQ1 или IRQ12)
+ * @param port Порт устройства
+ * @param data Принятый байт
+ * @return true, если байт относится к команде и драйверу не нужен
+ */
+bool ps2_receive(int port, uint8_t data) {
+    if (port < 0 || port >= PS2_PORTS) return false;
+    
+    ps2_port_t* p = &ps2_ports[port];
+    const ps2_cmd_t* cmd = &p->queue[p->tail % PS2_QUEUE_SIZE];
+    
+    switch (p->state) {
+        case PS2_STATE_ACK:
+            if (data == PS2_ACK) {
+                p->sent++;
+                if (p->sent < cmd->length) {
+                    ps2_transmit(port, cmd->bytes[p->sent]);
+                    ps2_arm_timeout(port);
+                } else if (cmd->response_length > 0) {
+                    p->state = PS2_STATE_RESPONSE;
+                    ps2_arm_timeout(port);
+                } else {
+                    ps2_complete(port, PS2_OK);
+                }
+                return true;
+            }
+            
+            if (data == PS2_RESEND) {
+                if (p->retries++ < PS2_MAX_RETRIES) {
+                    ps2_transmit(port, cmd->bytes[p->sent]);
+                    ps2_arm_timeout(port);
+                } else {
+                    ps2_complete(port, PS2_ERROR);
+                }
+                return true;
+            }
+            
+            // Обычные данные устройства (например, нажатие клавиши
+            // во время обновления светодиодов)
+            return false;
+            
+        case PS2_STATE_RESPONSE:
+            p->response[p->received++] = data;
+            if (p->received == cmd->response_length) {
+                ps2_complete(port, PS2_OK);
+            }
+            return true;
+            
+        default:
+            return false;
+    }
+}
+
+/**
+ * Проверка, выполняет ли порт команду или есть ли команды в очереди
+ */
+bool ps2_is_busy(int port) {
+    if (port < 0 || port >= PS2_PORTS) return false;
+    return ps2_ports[port].state != PS2_STATE_IDLE ||
+           ps2_ports[port].head != ps2_ports[port].tail;
+}
+
+/**
+ * Настройка контроллера
+ * Выполняется один раз при загрузке с запрещенными прерываниями;
+ * команды контроллеру отрабатывают за микросекунды.
+ * @return true, если контроллер отвечает
+ */
+bool ps2_init(void) {
+    uint32_t flags = cpu_irq_save();
+    
+    for (int port = 0; port < PS2_PORTS; port++) {
+        ps2_ports[port].head = 0;
+        ps2_ports[port].tail = 0;
+        ps2_ports[port].state = PS2_STATE_IDLE;
+        ps2_ports[port].timeout = TIMER_INVALID_HANDLE;
+    }
+    
+    // Отключаем устройства на время настройки и сбрасываем буфер вывода
+    ps2_controller_command(PS2_CTRL_DISABLE_KBD);
+    ps2_controller_command(PS2_CTRL_DISABLE_AUX);
+    while (inb(PS2_STATUS_PORT) & PS2_STATUS_OUTPUT) {
+        inb(PS2_DATA_PORT);
+    }
+    
+    ps2_controller_command(PS2_CTRL_READ_CONFIG);
+    if (!ps2_wait_read()) {
+        cpu_irq_restore(flags);
+        #ifdef DEBUG
+        terminal_printf("PS/2: controller not responding\n");
+        #endif
+        return false;
+    }
+    uint8_t config = inb(PS2_DATA_PORT);
+    
+    // Если после отключения второго порта его тактирование выключено,
+    // порт существует
+    ps2_dual = (config & PS2_CONFIG_AUX_CLOCK) != 0;
+    
+    config |= PS2_CONFIG_KBD_IRQ;
+    config &= ~PS2_CONFIG_KBD_CLOCK;
+    if (ps2_dual) {
+        config |= PS2_CONFIG_AUX_IRQ;
+        config &= ~PS2_CONFIG_AUX_CLOCK;
+    }
+    
+    ps2_controller_command(PS2_CTRL_WRITE_CONFIG);
+    ps2_wait_write();
+    outb(PS2_DATA_PORT, config);
+    
+    ps2_controller_command(PS2_CTRL_ENABLE_KBD);
+    if (ps2_dual) {
+        ps2_controller_command(PS2_CTRL_ENABLE_AUX);
+    }
+    
+    cpu_irq_restore(flags);
+    
+    #ifdef DEBUG
+    terminal_printf("PS/2: controller ready, %d port(s)\n", ps2_dual ? 2 : 1);
+    #endif
+    
+    return true;
+}
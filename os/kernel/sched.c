@@ -0,0 +1,835 @@
+/**
+ * kernel/sched.c - Потоки ядра и вытесняющий планировщик
+ *
+ * Каждый поток имеет свой стек ядра. Переключение (sched_switch)
+ * сохраняет на стеке EFLAGS и регистры, которые должна сохранять
+ * вызываемая функция. Состояние FPU/SSE переключается лениво: в
+ * регистрах остается состояние последнего, кто пользовался FPU на этом
+ * процессоре (fpu_owner), а любому другому потоку при переключении
+ * выставляется CR0.TS. Первое обращение к FPU дает #NM, и только тогда
+ * состояние владельца сохраняется, а свое загружается (sched_fpu_trap).
+ * Поток не переходит между процессорами, поэтому его состояние всегда
+ * либо в структуре, либо в регистрах своего процессора.
+ * Готовые потоки обслуживаются по кругу. Пока в очереди кто-то ждет,
+ * взведен таймер кванта; его истечение выставляет флаг перепланирования,
+ * и переключение происходит на выходе из прерывания (irq_exit). Если
+ * готовых потоков нет, выполняется поток простоя.
+ *
+ * У каждого процессора своя очередь, свой поток простоя и своя
+ * блокировка. Поток всегда выполняется на процессоре, для которого
+ * создан; пробуждение с другого процессора ставит его в очередь
+ * владельца и будит того межпроцессорным прерыванием. Блокировка
+ * очереди удерживается на время переключения и снимается уже новым
+ * потоком, поэтому чужой процессор не увидит поток заблокированным,
+ * пока тот еще не ушел со своего стека.
+ */
+
+#include "sched.h"
+#include "gdt.h"
+#include "cpu.h"
+#include "clock.h"
+#include "timer.h"
+#include "softirq.h"
+#include "spinlock.h"
+#include "smp.h"
+#include "vmm.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Начальное значение EFLAGS нового потока (прерывания запрещены
+// до sched_thread_entry, бит 1 всегда установлен)
+#define SCHED_INITIAL_EFLAGS 0x002
+
+// Размер строки кэша
+#define CACHE_LINE 64
+
+// Состояние планировщика одного процессора
+typedef struct {
+    spinlock_t lock;                    // Очередь и состояния потоков процессора
+    thread_t* current;
+    thread_t* idle;
+    thread_t* run_head;                 // Очередь готовых потоков
+    thread_t* run_tail;
+    volatile bool need_resched;
+    volatile uint32_t preempt_count;
+    bool running;
+    bool slice_wanted;                  // В очереди есть кому отдать процессор
+    thread_t* fpu_owner;                // Чье состояние в регистрах FPU (NULL - ничье)
+    timer_handle_t slice_timer;
+} __attribute__((aligned(CACHE_LINE))) sched_cpu_t;
+
+static sched_cpu_t sched_cpus[CPU_MAX];
+static lockstat_t sched_rq_stats[CPU_MAX];
+
+// Пул потоков и их стеки (поток 0 работает на загрузочном стеке)
+static thread_t sched_threads[SCHED_MAX_THREADS];
+static uint8_t sched_stacks[SCHED_MAX_THREADS][SCHED_STACK_SIZE] __attribute__((aligned(16)));
+SPINLOCK_DEFINE(sched_pool_lock, "sched-pool");
+
+// Потоки простоя; у AP это загрузочный контекст на стеке из smp.c
+static thread_t sched_idle_threads[CPU_MAX];
+static uint8_t sched_idle_stack[SCHED_STACK_SIZE] __attribute__((aligned(16)));
+
+static uint32_t sched_next_id = 0;
+
+// FPU: способ сохранения и начальное состояние для новых потоков
+static bool sched_has_fpu = false;
+static bool sched_fxsr = false;
+static bool sched_simd = false;         // SSE2 для kernel_fpu_begin()
+static uint8_t sched_fpu_initial[SCHED_FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+static const char* sched_state_names[] = {
+    "free", "ready", "running", "blocked", "dead"
+};
+
+/**
+ * Планировщик текущего процессора
+ */
+static inline sched_cpu_t* sched_this(void) {
+    return &sched_cpus[cpu_current()];
+}
+
+/**
+ * Добавление потока в конец очереди готовых (под блокировкой очереди)
+ */
+static void sched_enqueue(sched_cpu_t* cpu, thread_t* t) {
+    t->next = NULL;
+    if (cpu->run_tail != NULL) {
+        cpu->run_tail->next = t;
+    } else {
+        cpu->run_head = t;
+    }
+    cpu->run_tail = t;
+}
+
+/**
+ * Извлечение потока из начала очереди готовых (под блокировкой очереди)
+ * @return Поток или NULL, если очередь пуста
+ */
+static thread_t* sched_dequeue(sched_cpu_t* cpu) {
+    thread_t* t = cpu->run_head;
+    if (t != NULL) {
+        cpu->run_head = t->next;
+        if (cpu->run_head == NULL) {
+            cpu->run_tail = NULL;
+        }
+        t->next = NULL;
+    }
+    return t;
+}
+
+/**
+ * Сохранение состояния FPU потока
+ */
+static inline void sched_fpu_save(thread_t* t) {
+    if (sched_fxsr) {
+        asm volatile("fxsave (%0)" : : "r"(t->fpu_state) : "memory");
+    } else {
+        asm volatile("fnsave (%0)" : : "r"(t->fpu_state) : "memory");
+    }
+}
+
+/**
+ * Восстановление состояния FPU потока
+ */
+static inline void sched_fpu_restore(thread_t* t) {
+    if (sched_fxsr) {
+        asm volatile("fxrstor (%0)" : : "r"(t->fpu_state) : "memory");
+    } else {
+        asm volatile("frstor (%0)" : : "r"(t->fpu_state) : "memory");
+    }
+}
+
+/**
+ * Включение FPU на текущем процессоре
+ * Без эмуляции, ошибки через исключение #MF.
+ */
+static void sched_fpu_enable(void) {
+    uint32_t cr0 = cpu_read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    cpu_write_cr0(cr0);
+    
+    if (sched_fxsr) {
+        cpu_write_cr4(cpu_read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+    }
+    
+    asm volatile("fninit");
+}
+
+/**
+ * Включение FPU и снимок его начального состояния
+ */
+static void sched_fpu_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    
+    if (!(edx & CPUID_EDX_FPU)) return;
+    
+    sched_fxsr = (edx & CPUID_EDX_FXSR) != 0;
+    sched_simd = sched_fxsr && (edx & CPUID_EDX_SSE) && (edx & CPUID_EDX_SSE2);
+    sched_fpu_enable();
+    sched_has_fpu = true;
+    
+    thread_t* boot = &sched_threads[0];
+    sched_fpu_save(boot);
+    memcpy(sched_fpu_initial, boot->fpu_state, SCHED_FPU_STATE_SIZE);
+    
+    // FNSAVE сбрасывает FPU - возвращаем сохраненное состояние
+    sched_fpu_restore(boot);
+    sched_cpus[SMP_BSP].fpu_owner = boot;
+}
+
+/**
+ * Установка или сброс CR0.TS (запись CR0 только при изменении)
+ */
+static inline void sched_fpu_set_ts(bool ts) {
+    uint32_t cr0 = cpu_read_cr0();
+    uint32_t value = ts ? (cr0 | CR0_TS) : (cr0 & ~CR0_TS);
+    
+    if (value != cr0) {
+        cpu_write_cr0(value);
+    }
+}
+
+/**
+ * Обработка #NM: загрузка состояния FPU текущего потока
+ * Вызывается из isr_handler до остальной обработки исключений.
+ * @return false, если FPU нет (исключение настоящее)
+ */
+bool sched_fpu_trap(void) {
+    if (!sched_has_fpu) return false;
+    
+    uint32_t flags = cpu_irq_save();
+    sched_cpu_t* cpu = sched_this();
+    thread_t* t = cpu->current;
+    
+    cpu_clts();
+    
+    if (cpu->fpu_owner != t) {
+        if (cpu->fpu_owner != NULL) {
+            sched_fpu_save(cpu->fpu_owner);
+        }
+        sched_fpu_restore(t);
+        cpu->fpu_owner = t;
+        t->fpu_loads++;
+    }
+    
+    cpu_irq_restore(flags);
+    return true;
+}
+
+/**
+ * Начало участка ядра, использующего SSE
+ * Состояние владельца FPU сохраняется, регистры получают начальное
+ * состояние, вытеснение запрещается до kernel_fpu_end(). Внутри участка
+ * нельзя спать; вложенные участки и обработчики прерываний не
+ * поддерживаются.
+ * @return false, если SSE2 нет или вызов из прерывания - нужен
+ *         обычный код
+ */
+bool kernel_fpu_begin(void) {
+    if (!sched_simd || in_interrupt()) return false;
+    
+    sched_preempt_disable();
+    
+    uint32_t flags = cpu_irq_save();
+    sched_cpu_t* cpu = sched_this();
+    
+    cpu_clts();
+    if (cpu->fpu_owner != NULL) {
+        sched_fpu_save(cpu->fpu_owner);
+        cpu->fpu_owner = NULL;
+    }
+    asm volatile("fxrstor (%0)" : : "r"(sched_fpu_initial) : "memory");
+    
+    cpu_irq_restore(flags);
+    return true;
+}
+
+/**
+ * Конец участка ядра, использующего SSE
+ * Регистры ничьи: следующее обращение потока к FPU загрузит его
+ * состояние через #NM.
+ */
+void kernel_fpu_end(void) {
+    uint32_t flags = cpu_irq_save();
+    sched_fpu_set_ts(true);
+    cpu_irq_restore(flags);
+    
+    sched_preempt_enable();
+}
+
+/**
+ * Истечение кванта (из таймера на BSP)
+ * @param data Индекс процессора
+ */
+static void sched_slice_expired(void* data) {
+    uint32_t index = (uint32_t)data;
+    
+    sched_cpus[index].need_resched = true;
+    smp_send_reschedule(index);
+}
+
+/**
+ * Новый квант для потока, получившего процессор
+ * Таймер нужен, только если в очереди есть другие потоки.
+ * Дескриптор меняет только свой процессор; отмена сработавшего
+ * таймера безопасна.
+ */
+static void sched_restart_slice(sched_cpu_t* cpu) {
+    timer_unregister_callback(cpu->slice_timer);
+    cpu->slice_timer = TIMER_INVALID_HANDLE;
+    
+    if (cpu->slice_wanted) {
+        cpu->slice_timer = timer_register_oneshot(sched_slice_expired,
+                                                  (void*)cpu_current(), SCHED_SLICE_MS);
+    }
+}
+
+/**
+ * Завершение переключения в новом потоке
+ * Снимает блокировку очереди, взятую до sched_switch.
+ */
+static void sched_finish_switch(void) {
+    sched_cpu_t* cpu = sched_this();
+    
+    spin_unlock(&cpu->lock);
+    sched_restart_slice(cpu);
+}
+
+/**
+ * Выбор следующего потока и переключение на него
+ * Вызывается при запрещенных прерываниях с захваченной блокировкой
+ * очереди; возвращается без нее. Текущий поток, если он еще может
+ * выполняться, встает в конец очереди.
+ */
+static void schedule(sched_cpu_t* cpu) {
+    thread_t* prev = cpu->current;
+    
+    if (prev->state == THREAD_RUNNING) {
+        prev->state = THREAD_READY;
+        if (prev != cpu->idle) {
+            sched_enqueue(cpu, prev);
+        }
+    }
+    
+    thread_t* next = sched_dequeue(cpu);
+    if (next == NULL) {
+        next = cpu->idle;
+    }
+    
+    cpu->need_resched = false;
+    cpu->slice_wanted = cpu->run_head != NULL;
+    next->state = THREAD_RUNNING;
+    
+    if (next != prev) {
+        uint64_t now = clock_ns();
+        prev->runtime_ns += now - prev->start_ns;
+        next->start_ns = now;
+        next->switches++;
+        
+        // Регистры FPU остаются владельцу; остальным - #NM при первом
+        // обращении. Состояние завершенного потока больше не нужно.
+        if (sched_has_fpu) {
+            if (prev->state == THREAD_DEAD && cpu->fpu_owner == prev) {
+                cpu->fpu_owner = NULL;
+            }
+            sched_fpu_set_ts(next != cpu->fpu_owner);
+        }
+        
+        // Адресное пространство процесса; потоки ядра его не меняют
+        if (next->page_directory != prev->page_directory) {
+            vmm_switch(next->page_directory);
+        }
+        
+        tss_set_stack(next->stack_top);
+        cpu->current = next;
+        
+        sched_switch(&prev->esp, next->esp);
+    }
+    
+    sched_finish_switch();
+}
+
+/**
+ * Точка входа нового потока (сюда возвращается первый sched_switch)
+ * @param func Функция потока
+ * @param arg Аргумент
+ */
+static void sched_thread_entry(thread_func_t func, void* arg) {
+    sched_finish_switch();
+    cpu_irq_enable();
+    func(arg);
+    sched_exit();
+}
+
+/**
+ * Подготовка потока к первому запуску
+ * @param t Поток
+ * @param stack_top Вершина его стека
+ */
+static void sched_prepare(thread_t* t, const char* name, uint8_t* stack_top,
+                          thread_func_t func, void* arg) {
+    t->next = NULL;
+    t->wake_pending = false;
+    t->switches = 0;
+    t->fpu_loads = 0;
+    t->runtime_ns = 0;
+    t->page_directory = 0;
+    strncpy(t->name, name, SCHED_NAME_LENGTH - 1);
+    t->name[SCHED_NAME_LENGTH - 1] = '\0';
+    memcpy(t->fpu_state, sched_fpu_initial, SCHED_FPU_STATE_SIZE);
+    
+    // Кадр, который снимет sched_switch: регистры, EFLAGS и адрес
+    // возврата в sched_thread_entry с ее аргументами
+    uint32_t* sp = (uint32_t*)stack_top;
+    t->stack_top = (uint32_t)sp;
+    
+    *--sp = (uint32_t)arg;
+    *--sp = (uint32_t)func;
+    *--sp = 0;                              // Адрес возврата sched_thread_entry
+    *--sp = (uint32_t)sched_thread_entry;
+    *--sp = SCHED_INITIAL_EFLAGS;
+    *--sp = 0;                              // ebp
+    *--sp = 0;                              // ebx
+    *--sp = 0;                              // esi
+    *--sp = 0;                              // edi
+    t->esp = (uint32_t)sp;
+    
+    t->state = THREAD_READY;
+}
+
+/**
+ * Проверка, можно ли занять слот потока (под sched_pool_lock)
+ * Завершившийся поток мог еще не уйти со своего стека: его процессор
+ * держит блокировку очереди до конца переключения.
+ */
+static bool sched_slot_free(thread_t* t) {
+    if (t->state == THREAD_FREE) return true;
+    if (t->state != THREAD_DEAD) return false;
+    
+    sched_cpu_t* home = &sched_cpus[t->cpu];
+    spin_lock(&home->lock);
+    bool free = t->state == THREAD_DEAD && home->current != t;
+    spin_unlock(&home->lock);
+    
+    return free;
+}
+
+/**
+ * Подготовка потока в свободном слоте (под sched_pool_lock)
+ * @return Поток или NULL, если свободных слотов нет
+ */
+static thread_t* sched_setup(const char* name, thread_func_t func, void* arg, uint32_t cpu) {
+    // Слот 0 - загрузочный поток со своим стеком
+    for (int slot = 1; slot < SCHED_MAX_THREADS; slot++) {
+        thread_t* t = &sched_threads[slot];
+        if (!sched_slot_free(t)) continue;
+        
+        t->id = sched_next_id++;
+        t->cpu = cpu;
+        sched_prepare(t, name, sched_stacks[slot] + SCHED_STACK_SIZE, func, arg);
+        return t;
+    }
+    
+    return NULL;
+}
+
+/**
+ * Создание потока ядра на заданном процессоре
+ * Поток выполняется только на этом процессоре.
+ * @param name Имя (для вывода)
+ * @param func Функция потока; возврат из нее завершает поток
+ * @param arg Аргумент функции
+ * @param cpu Индекс процессора
+ * @return Поток или NULL, если пул исчерпан или процессор не работает
+ */
+thread_t* sched_create_on(const char* name, thread_func_t func, void* arg, uint32_t cpu) {
+    if (func == NULL || cpu >= CPU_MAX || !sched_cpus[cpu].running) return NULL;
+    
+    uint32_t flags = cpu_irq_save();
+    
+    spin_lock(&sched_pool_lock);
+    thread_t* t = sched_setup(name, func, arg, cpu);
+    spin_unlock(&sched_pool_lock);
+    
+    bool remote = cpu != cpu_current();
+    if (t != NULL) {
+        sched_cpu_t* target = &sched_cpus[cpu];
+        spin_lock(&target->lock);
+        sched_enqueue(target, t);
+        if (remote) {
+            target->need_resched = true;
+        }
+        spin_unlock(&target->lock);
+    }
+    
+    cpu_irq_restore(flags);
+    
+    if (t != NULL && remote) {
+        smp_send_reschedule(cpu);
+    }
+    
+    #ifdef DEBUG
+    if (t != NULL) {
+        terminal_printf("Sched: thread %d (%s) created on cpu %d\n", t->id, t->name, cpu);
+    }
+    #endif
+    
+    return t;
+}
+
+/**
+ * Создание потока ядра на текущем процессоре
+ * @param name Имя (для вывода)
+ * @param func Функция потока; возврат из нее завершает поток
+ * @param arg Аргумент функции
+ * @return Поток или NULL, если пул исчерпан
+ */
+thread_t* sched_create(const char* name, thread_func_t func, void* arg) {
+    return sched_create_on(name, func, arg, cpu_current());
+}
+
+/**
+ * Завершение текущего потока
+ * Слот освобождается, когда процессор уже отдан другому потоку.
+ */
+void sched_exit(void) {
+    cpu_irq_disable();
+    
+    sched_cpu_t* cpu = sched_this();
+    spin_lock(&cpu->lock);
+    cpu->current->state = THREAD_DEAD;
+    schedule(cpu);
+    
+    for (;;) {
+        asm volatile("hlt");
+    }
+}
+
+/**
+ * Текущий поток
+ */
+thread_t* sched_current(void) {
+    return sched_this()->current;
+}
+
+/**
+ * Проверка, запущен ли планировщик
+ */
+bool sched_is_running(void) {
+    return sched_this()->running;
+}
+
+/**
+ * Добровольная отдача процессора
+ */
+void sched_yield(void) {
+    sched_cpu_t* cpu = sched_this();
+    if (!cpu->running) return;
+    
+    uint32_t flags = spin_lock_irqsave(&cpu->lock);
+    schedule(cpu);
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Блокировка текущего потока до sched_wake()
+ * Пробуждение, пришедшее между проверкой условия и блокировкой (в том
+ * числе с другого процессора), не теряется: sched_block() тогда сразу
+ * возвращается. Возврат возможен и без выполнения условия - его нужно
+ * проверить снова.
+ */
+void sched_block(void) {
+    sched_cpu_t* cpu = sched_this();
+    uint32_t flags = spin_lock_irqsave(&cpu->lock);
+    thread_t* t = cpu->current;
+    
+    if (t->wake_pending) {
+        t->wake_pending = false;
+        spin_unlock_irqrestore(&cpu->lock, flags);
+        return;
+    }
+    
+    t->state = THREAD_BLOCKED;
+    schedule(cpu);
+    
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Пробуждение заблокированного потока
+ * Можно вызывать из прерываний и с любого процессора; переключение
+ * произойдет на выходе из прерывания или при следующем
+ * sched_preempt_enable() на процессоре потока.
+ * @param t Поток
+ */
+void sched_wake(thread_t* t) {
+    if (t == NULL) return;
+    
+    sched_cpu_t* home = &sched_cpus[t->cpu];
+    bool woken = false;
+    
+    uint32_t flags = spin_lock_irqsave(&home->lock);
+    
+    if (t->state == THREAD_BLOCKED) {
+        t->state = THREAD_READY;
+        sched_enqueue(home, t);
+        home->need_resched = true;
+        woken = true;
+    } else if (t->state == THREAD_RUNNING || t->state == THREAD_READY) {
+        // Поток еще не заснул - следующий sched_block() вернется сразу
+        t->wake_pending = true;
+    }
+    
+    spin_unlock_irqrestore(&home->lock, flags);
+    
+    if (woken) {
+        smp_send_reschedule(t->cpu);
+    }
+}
+
+/**
+ * Вытеснение на выходе из прерывания (прерывания запрещены)
+ * Поток простоя переключается сам после выхода из hlt.
+ */
+void sched_preempt(void) {
+    sched_cpu_t* cpu = sched_this();
+    
+    if (!cpu->running || !cpu->need_resched || cpu->preempt_count != 0) return;
+    if (in_interrupt() || cpu->current == cpu->idle) return;
+    
+    spin_lock(&cpu->lock);
+    schedule(cpu);
+}
+
+/**
+ * Проверка, может ли текущий код заблокироваться
+ */
+bool sched_can_block(void) {
+    sched_cpu_t* cpu = sched_this();
+    
+    return cpu->running && !in_interrupt() && cpu->preempt_count == 0 &&
+           cpu->current != cpu->idle;
+}
+
+/**
+ * Пробуждение спящего потока (из таймера)
+ */
+static void sched_sleep_wakeup(void* data) {
+    sched_wake((thread_t*)data);
+}
+
+/**
+ * Сон текущего потока
+ * Процессор на это время получают другие потоки.
+ * @param ms Длительность в миллисекундах
+ */
+void sched_sleep_ms(uint32_t ms) {
+    uint64_t deadline = clock_ns() + (uint64_t)ms * NSEC_PER_MSEC;
+    
+    sched_cpu_t* cpu = sched_this();
+    uint32_t flags = cpu_irq_save();
+    
+    for (;;) {
+        uint64_t now = clock_ns();
+        if (now >= deadline) break;
+        
+        // Таймер взводится под блокировкой очереди: пробуждение с BSP
+        // дождется, пока поток действительно заблокируется
+        spin_lock(&cpu->lock);
+        
+        uint32_t left = (uint32_t)((deadline - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC);
+        timer_handle_t handle = timer_register_oneshot(sched_sleep_wakeup, cpu->current, left);
+        
+        if (handle == TIMER_INVALID_HANDLE) {
+            // Таймеров нет - просто уступаем процессор до срока
+            schedule(cpu);
+            continue;
+        }
+        
+        cpu->current->state = THREAD_BLOCKED;
+        schedule(cpu);
+        timer_unregister_callback(handle);
+    }
+    
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Запрет вытеснения текущего потока (вложенный)
+ */
+void sched_preempt_disable(void) {
+    sched_this()->preempt_count++;
+    asm volatile("" : : : "memory");
+}
+
+/**
+ * Снятие запрета вытеснения
+ * Если за время запрета кто-то проснулся, переключение происходит сразу.
+ */
+void sched_preempt_enable(void) {
+    sched_cpu_t* cpu = sched_this();
+    
+    asm volatile("" : : : "memory");
+    if (cpu->preempt_count == 0) return;
+    
+    if (--cpu->preempt_count == 0 && cpu->need_resched && !in_interrupt()) {
+        uint32_t flags = cpu_irq_save();
+        if (flags & EFLAGS_IF) {
+            sched_preempt();
+        }
+        cpu_irq_restore(flags);
+    }
+}
+
+/**
+ * Поток простоя: выполняет отложенную работу и ждет прерывания
+ * Устройство событий таймера есть только у BSP; AP просто спят до
+ * межпроцессорного прерывания.
+ */
+static void sched_idle(void* arg) {
+    (void)arg;
+    sched_cpu_t* cpu = sched_this();
+    bool bsp = cpu_current() == SMP_BSP;
+    
+    for (;;) {
+        softirq_run();
+        
+        cpu_irq_disable();
+        if (!cpu->need_resched && cpu->run_head == NULL) {
+            if (bsp) {
+                timer_idle();
+            } else {
+                asm volatile("sti; hlt; cli" : : : "memory");
+            }
+        }
+        cpu_irq_enable();
+        
+        sched_yield();
+    }
+}
+
+/**
+ * Вывод одного потока
+ */
+static void sched_print_thread(thread_t* t) {
+    uint64_t runtime = t->runtime_ns;
+    if (t == sched_cpus[t->cpu].current) {
+        runtime += clock_ns() - t->start_ns;
+    }
+    
+    terminal_printf("%d %s: cpu %d, %s, %d switches, %d FPU loads, %d ms\n",
+                    t->id, t->name, t->cpu, sched_state_names[t->state], t->switches,
+                    t->fpu_loads, (uint32_t)(runtime / NSEC_PER_MSEC));
+}
+
+/**
+ * Команда: threads - список потоков
+ */
+static void cmd_threads(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    for (int i = 0; i < SCHED_MAX_THREADS; i++) {
+        thread_t* t = &sched_threads[i];
+        if (t->state == THREAD_FREE || t->state == THREAD_DEAD) continue;
+        sched_print_thread(t);
+    }
+    
+    for (int cpu = 0; cpu < CPU_MAX; cpu++) {
+        if (sched_cpus[cpu].running) {
+            sched_print_thread(sched_cpus[cpu].idle);
+        }
+    }
+}
+
+/**
+ * Инициализация планировщика
+ * Загрузочный код становится потоком "main", создается поток простоя.
+ * Вызывается после timer_init() и clock_init(), до разрешения прерываний.
+ */
+void sched_init(void) {
+    uint32_t flags = cpu_irq_save();
+    sched_cpu_t* cpu = &sched_cpus[SMP_BSP];
+    
+    for (uint32_t i = 0; i < CPU_MAX; i++) {
+        sched_rq_stats[i].name = "runqueue";
+        sched_rq_stats[i].instance = i;
+        spin_init_stat(&sched_cpus[i].lock, &sched_rq_stats[i]);
+    }
+    
+    thread_t* boot = &sched_threads[0];
+    boot->id = sched_next_id++;
+    boot->cpu = SMP_BSP;
+    boot->state = THREAD_RUNNING;
+    boot->stack_top = tss_get_stack();
+    boot->start_ns = clock_ns();
+    strncpy(boot->name, "main", SCHED_NAME_LENGTH - 1);
+    cpu->current = boot;
+    
+    sched_fpu_init();
+    
+    thread_t* idle = &sched_idle_threads[SMP_BSP];
+    idle->id = sched_next_id++;
+    idle->cpu = SMP_BSP;
+    sched_prepare(idle, "idle", sched_idle_stack + SCHED_STACK_SIZE, sched_idle, NULL);
+    cpu->idle = idle;
+    cpu->running = true;
+    
+    cpu_irq_restore(flags);
+    
+    cmdreg_register("threads", "List kernel threads", cmd_threads);
+    
+    #ifdef DEBUG
+    terminal_printf("Sched: lazy %s FPU state, %d ms slice\n",
+                    sched_fxsr ? "FXSAVE" : (sched_has_fpu ? "FNSAVE" : "no"), SCHED_SLICE_MS);
+    #endif
+}
+
+/**
+ * Запуск планировщика на дополнительном процессоре (из smp.c)
+ * Загрузочный контекст AP становится его потоком простоя.
+ */
+void sched_start_cpu(void) {
+    cpu_irq_disable();
+    
+    uint32_t index = cpu_current();
+    sched_cpu_t* cpu = &sched_cpus[index];
+    thread_t* idle = &sched_idle_threads[index];
+    
+    if (sched_has_fpu) {
+        sched_fpu_enable();
+    }
+    
+    spin_lock(&sched_pool_lock);
+    idle->id = sched_next_id++;
+    spin_unlock(&sched_pool_lock);
+    
+    idle->cpu = index;
+    idle->state = THREAD_RUNNING;
+    idle->stack_top = tss_get_stack();
+    idle->start_ns = clock_ns();
+    memcpy(idle->fpu_state, sched_fpu_initial, SCHED_FPU_STATE_SIZE);
+    strncpy(idle->name, "idle", SCHED_NAME_LENGTH - 1);
+    
+    // После FNINIT в регистрах начальное состояние - как у idle
+    if (sched_has_fpu) {
+        cpu->fpu_owner = idle;
+    }
+    
+    cpu->current = idle;
+    cpu->idle = idle;
+    cpu->slice_timer = TIMER_INVALID_HANDLE;
+    cpu->running = true;
+    
+    cpu_irq_enable();
+    sched_idle(NULL);
+    
+    for (;;) {
+        asm volatile("hlt");
+    }
+}
@@ -0,0 +1,28 @@
+; kernel/sched_asm.asm - Переключение контекста потоков ядра
+
+section .text
+    global sched_switch
+
+; Переключение на другой поток
+; Сигнатура: void sched_switch(uint32_t* old_esp, uint32_t new_esp)
+; Сохраняет EFLAGS и регистры, которые по соглашению cdecl должна
+; сохранять вызываемая функция; остальные уже сохранил вызывающий код.
+sched_switch:
+    mov eax, [esp + 4]   ; Куда сохранить esp текущего потока
+    mov edx, [esp + 8]   ; esp нового потока
+
+    pushfd
+    push ebp
+    push ebx
+    push esi
+    push edi
+
+    mov [eax], esp       ; Стек текущего потока сохранен
+    mov esp, edx         ; Дальше - стек нового потока
+
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    popfd
+    ret                  ; В точку, где новый поток вызвал sched_switch
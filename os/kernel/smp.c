@@ -0,0 +1,222 @@
+/**
+ * kernel/smp.c - Запуск дополнительных процессоров (SMP)
+ *
+ * Процессоры перечислены в MADT. BSP копирует стартовый код ниже 1 МБ
+ * и будит каждый AP последовательностью INIT-SIPI-SIPI. AP проходит
+ * реальный режим, получает свою GDT, TSS, стек и область данных (GS),
+ * включает LAPIC и становится потоком простоя своего процессора.
+ *
+ * Внешние прерывания, колесо таймеров и softirq остаются на BSP.
+ * Драйверы, терминал и GUI не защищены блокировками, поэтому потоки,
+ * которые их используют, создаются на BSP; AP выполняют потоки,
+ * созданные для них через sched_create_on().
+ */
+
+#include "smp.h"
+#include "gdt.h"
+#include "idt.h"
+#include "lapic.h"
+#include "acpi.h"
+#include "timer.h"
+#include "sched.h"
+#include "syscall.h"
+#include "vmm.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Задержки последовательности запуска (Intel MP Specification)
+#define SMP_INIT_DELAY_US   10000
+#define SMP_SIPI_DELAY_US   200
+
+// Сколько ждать, пока AP отметится
+#define SMP_START_TIMEOUT_MS 100
+
+// Стартовый код (smp_asm.asm) и его параметры
+extern uint8_t smp_trampoline_start[];
+extern uint8_t smp_trampoline_end[];
+extern uint8_t smp_trampoline_stack[];
+extern uint8_t smp_trampoline_entry[];
+extern uint8_t smp_trampoline_cpu[];
+
+// Области данных процессоров и стеки AP
+static percpu_t smp_percpu[CPU_MAX];
+static uint8_t smp_stacks[CPU_MAX - 1][SMP_STACK_SIZE] __attribute__((aligned(16)));
+
+static uint32_t smp_cpus = 1;
+
+/**
+ * Подготовка области данных процессора
+ * @param cpu Индекс процессора
+ * @return Адрес области для сегмента GS
+ */
+percpu_t* smp_percpu_setup(uint32_t cpu) {
+    percpu_t* pc = &smp_percpu[cpu];
+    
+    pc->self = pc;
+    pc->index = cpu;
+    return pc;
+}
+
+/**
+ * Индекс текущего процессора (из его области данных)
+ */
+uint32_t cpu_current(void) {
+    uint32_t index;
+    asm volatile("movl %%gs:%c1, %0" : "=r"(index) : "i"(offsetof(percpu_t, index)));
+    return index;
+}
+
+/**
+ * Область данных текущего процессора
+ */
+percpu_t* smp_this_cpu(void) {
+    percpu_t* pc;
+    asm volatile("movl %%gs:%c1, %0" : "=r"(pc) : "i"(offsetof(percpu_t, self)));
+    return pc;
+}
+
+/**
+ * Количество процессоров, которые пытались запустить (включая BSP)
+ * Работают из них те, для кого smp_cpu_online() возвращает true.
+ */
+uint32_t smp_cpu_count(void) {
+    return smp_cpus;
+}
+
+/**
+ * Проверка, работает ли процессор
+ * @param cpu Индекс процессора
+ */
+bool smp_cpu_online(uint32_t cpu) {
+    return cpu < CPU_MAX && smp_percpu[cpu].online;
+}
+
+/**
+ * Межпроцессорное прерывание "перепланируй"
+ * Процессор выйдет из hlt и на выходе из прерывания выполнит
+ * отложенную работу и переключение потоков.
+ * @param cpu Индекс процессора
+ */
+void smp_send_reschedule(uint32_t cpu) {
+    if (cpu == cpu_current() || !smp_cpu_online(cpu)) return;
+    
+    lapic_send_ipi((uint8_t)smp_percpu[cpu].apic_id, LAPIC_ICR_FIXED | SMP_RESCHED_VECTOR);
+}
+
+/**
+ * Обработчик прерывания перепланирования
+ * Сама работа выполняется в irq_exit().
+ */
+static void smp_resched_handler(struct registers* regs) {
+    (void)regs;
+    lapic_eoi();
+}
+
+/**
+ * Точка входа AP в защищенном режиме (из стартового кода)
+ * @param cpu Индекс процессора
+ */
+static void smp_ap_entry(uint32_t cpu) {
+    percpu_t* pc = &smp_percpu[cpu];
+    
+    gdt_init_cpu(cpu, (uint32_t)pc, sizeof(percpu_t), pc->stack_top);
+    vmm_init_cpu();
+    idt_load((uint32_t)&idtp);
+    syscall_init_cpu();
+    lapic_init_ap();
+    
+    pc->online = true;
+    
+    // Загрузочный контекст становится потоком простоя
+    sched_start_cpu();
+}
+
+/**
+ * Запуск одного AP
+ * @param cpu Индекс, который получит процессор
+ * @param apic_id Идентификатор его LAPIC
+ * @return true, если процессор отметился
+ */
+static bool smp_start_ap(uint32_t cpu, uint8_t apic_id) {
+    percpu_t* pc = smp_percpu_setup(cpu);
+    pc->apic_id = apic_id;
+    pc->stack_top = (uint32_t)(smp_stacks[cpu - 1] + SMP_STACK_SIZE);
+    
+    // Параметры в копии стартового кода
+    uint8_t* base = (uint8_t*)SMP_TRAMPOLINE_BASE;
+    *(volatile uint32_t*)(base + (smp_trampoline_stack - smp_trampoline_start)) = pc->stack_top;
+    *(volatile uint32_t*)(base + (smp_trampoline_entry - smp_trampoline_start)) = (uint32_t)smp_ap_entry;
+    *(volatile uint32_t*)(base + (smp_trampoline_cpu - smp_trampoline_start)) = cpu;
+    
+    lapic_send_ipi(apic_id, LAPIC_ICR_INIT | LAPIC_ICR_ASSERT);
+    timer_pit_wait_us(SMP_INIT_DELAY_US);
+    
+    for (int i = 0; i < 2 && !pc->online; i++) {
+        lapic_send_ipi(apic_id, LAPIC_ICR_STARTUP | (SMP_TRAMPOLINE_BASE >> 12));
+        timer_pit_wait_us(SMP_SIPI_DELAY_US);
+    }
+    
+    for (int ms = 0; ms < SMP_START_TIMEOUT_MS && !pc->online; ms++) {
+        timer_pit_wait_us(1000);
+    }
+    
+    return pc->online;
+}
+
+/**
+ * Команда: cpus - список процессоров
+ */
+static void cmd_cpus(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+    
+    for (uint32_t cpu = 0; cpu < smp_cpus; cpu++) {
+        terminal_printf("cpu %d: apic %d, %s\n", cpu, smp_percpu[cpu].apic_id,
+                        cpu == SMP_BSP ? "bsp" : (smp_percpu[cpu].online ? "online" : "offline"));
+    }
+}
+
+/**
+ * Запуск всех процессоров из MADT
+ * Вызывается на BSP после sched_init() и lapic_init(), до разрешения
+ * прерываний. Без LAPIC или MADT система остается однопроцессорной.
+ */
+void smp_init(void) {
+    percpu_t* bsp = &smp_percpu[SMP_BSP];
+    bsp->online = true;
+    bsp->stack_top = tss_get_stack();
+    
+    cmdreg_register("cpus", "List processors", cmd_cpus);
+    
+    if (!lapic_is_enabled()) return;
+    bsp->apic_id = lapic_id();
+    
+    const acpi_madt_t* madt = (const acpi_madt_t*)acpi_find_table("APIC");
+    if (madt == NULL) return;
+    
+    isr_install_handler(SMP_RESCHED_VECTOR, smp_resched_handler);
+    memcpy((void*)SMP_TRAMPOLINE_BASE, smp_trampoline_start,
+           smp_trampoline_end - smp_trampoline_start);
+    
+    for (const acpi_madt_entry_t* e = acpi_madt_next(madt, NULL); e != NULL; e = acpi_madt_next(madt, e)) {
+        if (e->type != ACPI_MADT_LAPIC) continue;
+        
+        const acpi_madt_lapic_t* entry = (const acpi_madt_lapic_t*)e;
+        if (!(entry->flags & 1) || entry->apic_id == bsp->apic_id) continue;
+        if (smp_cpus >= CPU_MAX) break;
+        
+        // Индекс занимается и при неудаче: опоздавший AP не займет чужой
+        uint32_t cpu = smp_cpus++;
+        if (!smp_start_ap(cpu, entry->apic_id)) {
+            #ifdef DEBUG
+            terminal_printf("SMP: APIC %d did not start\n", entry->apic_id);
+            #endif
+        }
+    }
+    
+    #ifdef DEBUG
+    terminal_printf("SMP: %d processors\n", smp_cpus);
+    #endif
+}
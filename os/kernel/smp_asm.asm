@@ -0,0 +1,73 @@
+; kernel/smp_asm.asm - Стартовый код дополнительных процессоров (AP)
+;
+; smp_init() копирует код между smp_trampoline_start и smp_trampoline_end
+; по адресу SMP_TRAMPOLINE_BASE и заполняет параметры в его конце.
+; Процессор после SIPI начинает в реальном режиме с CS = BASE >> 4, IP = 0.
+
+SMP_TRAMPOLINE_BASE equ 0x8000
+
+; Адрес метки в скопированном коде
+%define TRAMPOLINE(label) (SMP_TRAMPOLINE_BASE + (label - smp_trampoline_start))
+
+section .text
+    global smp_trampoline_start
+    global smp_trampoline_end
+    global smp_trampoline_stack
+    global smp_trampoline_entry
+    global smp_trampoline_cpu
+
+bits 16
+smp_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+
+    ; Временная плоская GDT, затем защищенный режим
+    lgdt [TRAMPOLINE(trampoline_gdt_ptr)]
+    mov eax, cr0
+    or eax, 1
+    mov cr0, eax
+
+    jmp dword 0x08:TRAMPOLINE(trampoline_32)
+
+bits 32
+trampoline_32:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    ; Стек ядра этого процессора и вызов entry(cpu)
+    mov esp, [TRAMPOLINE(smp_trampoline_stack)]
+    push dword [TRAMPOLINE(smp_trampoline_cpu)]
+    mov eax, [TRAMPOLINE(smp_trampoline_entry)]
+    call eax
+
+    ; Точка входа не возвращается
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; Временная GDT: код и данные ядра с теми же селекторами, что и в gdt.c
+align 8
+trampoline_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF   ; 0x08: код, база 0, лимит 4 ГБ
+    dq 0x00CF92000000FFFF   ; 0x10: данные, база 0, лимит 4 ГБ
+trampoline_gdt_ptr:
+    dw trampoline_gdt_ptr - trampoline_gdt - 1
+    dd TRAMPOLINE(trampoline_gdt)
+
+; Параметры (заполняет smp_init перед каждым запуском)
+align 4
+smp_trampoline_stack:
+    dd 0                    ; Вершина стека
+smp_trampoline_entry:
+    dd 0                    ; void entry(uint32_t cpu)
+smp_trampoline_cpu:
+    dd 0                    ; Индекс процессора
+smp_trampoline_end:
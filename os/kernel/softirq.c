@@ -0,0 +1,221 @@
+/**
+ * kernel/softirq.c - Отложенная обработка прерываний (softirq и tasklet)
+ *
+ * Обработчик IRQ только подтверждает устройство и поднимает бит
+ * softirq. Сама работа выполняется при разрешенных прерываниях:
+ * на выходе из внешнего (не вложенного) прерывания или в главном
+ * цикле, если на выходе ее оказалось слишком много.
+ *
+ * softirq выполняются только на BSP: туда приходят внешние прерывания
+ * и там работает колесо таймеров. Запрос с другого процессора будит
+ * BSP межпроцессорным прерыванием.
+ */
+
+#include "softirq.h"
+#include "cpu.h"
+#include "irqstat.h"
+#include "sched.h"
+#include "smp.h"
+#include "spinlock.h"
+#include <stddef.h>
+
+// Поднятые биты softirq
+static volatile uint32_t softirq_mask = 0;
+
+// Обработчики и счетчики выполнений
+static softirq_func_t softirq_handlers[SOFTIRQ_COUNT];
+static uint32_t softirq_counts[SOFTIRQ_COUNT];
+
+// Глубина вложенности аппаратных прерываний (по процессорам)
+static volatile uint32_t irq_nesting[CPU_MAX];
+
+// softirq уже выполняются (повторный вход запрещен)
+static volatile bool softirq_active = false;
+
+// Очередь tasklet
+static tasklet_t* tasklet_head = NULL;
+static tasklet_t* tasklet_tail = NULL;
+SPINLOCK_DEFINE(tasklet_lock, "tasklet");
+
+/**
+ * Выполнение запланированных tasklet
+ */
+static void tasklet_action(void) {
+    // Забираем всю очередь: tasklet может запланировать себя снова
+    uint32_t flags = spin_lock_irqsave(&tasklet_lock);
+    tasklet_t* t = tasklet_head;
+    tasklet_head = NULL;
+    tasklet_tail = NULL;
+    spin_unlock_irqrestore(&tasklet_lock, flags);
+    
+    while (t != NULL) {
+        tasklet_t* next = t->next;
+        
+        t->scheduled = false;
+        t->func(t->data);
+        
+        t = next;
+    }
+}
+
+/**
+ * Инициализация отложенной обработки
+ */
+void softirq_init(void) {
+    for (int i = 0; i < SOFTIRQ_COUNT; i++) {
+        softirq_handlers[i] = NULL;
+        softirq_counts[i] = 0;
+    }
+    
+    softirq_mask = 0;
+    softirq_open(SOFTIRQ_TASKLET, tasklet_action);
+}
+
+/**
+ * Установка обработчика softirq
+ * @param nr Номер softirq
+ * @param func Обработчик
+ */
+void softirq_open(softirq_nr_t nr, softirq_func_t func) {
+    if (nr < SOFTIRQ_COUNT) {
+        softirq_handlers[nr] = func;
+    }
+}
+
+/**
+ * Запрос на выполнение softirq (безопасно из обработчика IRQ)
+ * @param nr Номер softirq
+ */
+void softirq_raise(softirq_nr_t nr) {
+    __atomic_fetch_or(&softirq_mask, 1u << nr, __ATOMIC_SEQ_CST);
+    
+    if (cpu_current() != SMP_BSP) {
+        smp_send_reschedule(SMP_BSP);
+    }
+}
+
+/**
+ * Проверка наличия отложенной работы
+ */
+bool softirq_pending(void) {
+    return softirq_mask != 0;
+}
+
+/**
+ * Выполнение поднятых softirq при разрешенных прерываниях
+ * Новые запросы, пришедшие во время работы, обрабатываются в
+ * следующих проходах (не более SOFTIRQ_MAX_RESTART).
+ * На AP ничего не делает.
+ */
+void softirq_run(void) {
+    if (cpu_current() != SMP_BSP) return;
+    
+    uint32_t flags = cpu_irq_save();
+    
+    if (softirq_active || softirq_mask == 0) {
+        cpu_irq_restore(flags);
+        return;
+    }
+    softirq_active = true;
+    
+    for (int restart = 0; restart < SOFTIRQ_MAX_RESTART && softirq_mask != 0; restart++) {
+        uint32_t pending = __atomic_exchange_n(&softirq_mask, 0, __ATOMIC_SEQ_CST);
+        
+        cpu_irq_enable();
+        
+        for (uint32_t nr = 0; pending != 0; nr++, pending >>= 1) {
+            if ((pending & 1) && softirq_handlers[nr] != NULL) {
+                uint64_t start = irqstat_begin();
+                softirq_handlers[nr]();
+                irqstat_softirq_end(nr, start);
+                softirq_counts[nr]++;
+            }
+        }
+        
+        cpu_irq_disable();
+    }
+    
+    softirq_active = false;
+    cpu_irq_restore(flags);
+}
+
+/**
+ * Количество выполнений softirq
+ */
+uint32_t softirq_get_count(softirq_nr_t nr) {
+    return nr < SOFTIRQ_COUNT ? softirq_counts[nr] : 0;
+}
+
+/**
+ * Вход в обработчик аппаратного прерывания (прерывания запрещены)
+ */
+void irq_enter(void) {
+    irq_nesting[cpu_current()]++;
+}
+
+/**
+ * Выход из обработчика аппаратного прерывания (после EOI)
+ * На выходе из внешнего прерывания выполняется отложенная работа.
+ */
+void irq_exit(void) {
+    uint32_t cpu = cpu_current();
+    irq_nesting[cpu]--;
+    
+    if (irq_nesting[cpu] == 0 && softirq_mask != 0) {
+        softirq_run();
+    }
+    
+    // Квант истек или проснулся поток - переключаемся до возврата
+    if (irq_nesting[cpu] == 0) {
+        sched_preempt();
+    }
+}
+
+/**
+ * Проверка, выполняется ли код в контексте прерывания или softirq
+ */
+bool in_interrupt(void) {
+    uint32_t cpu = cpu_current();
+    return irq_nesting[cpu] != 0 || (cpu == SMP_BSP && softirq_active);
+}
+
+/**
+ * Инициализация tasklet
+ * @param t Tasklet
+ * @param func Функция
+ * @param data Данные для функции
+ */
+void tasklet_init(tasklet_t* t, void (*func)(void* data), void* data) {
+    t->next = NULL;
+    t->func = func;
+    t->data = data;
+    t->scheduled = false;
+}
+
+/**
+ * Планирование tasklet (безопасно из обработчика IRQ)
+ * @param t Tasklet
+ * @return false, если tasklet уже запланирован
+ */
+bool tasklet_schedule(tasklet_t* t) {
+    uint32_t flags = spin_lock_irqsave(&tasklet_lock);
+    
+    if (t->scheduled) {
+        spin_unlock_irqrestore(&tasklet_lock, flags);
+        return false;
+    }
+    
+    t->scheduled = true;
+    t->next = NULL;
+    if (tasklet_tail != NULL) {
+        tasklet_tail->next = t;
+    } else {
+        tasklet_head = t;
+    }
+    tasklet_tail = t;
+    
+    spin_unlock_irqrestore(&tasklet_lock, flags);
+    
+    softirq_raise(SOFTIRQ_TASKLET);
+    return true;
+}
@@ -0,0 +1,597 @@
+/**
+ * kernel/surface.c - Разделяемые поверхности окон
+ *
+ * Клиент (процесс или поток ядра) рисует в страницы поверхности и
+ * отправляет прямоугольник повреждения. Повреждения, пришедшие до
+ * вывода предыдущего, объединяются, поэтому клиент никогда не ждет
+ * композитора и может выдавать кадры с любой частотой.
+ *
+ * Пиксели поверхности читает поток "compositor", а рисуют, кроме
+ * клиента, операции кольца (surface_fill, surface_copy). Поэтому
+ * закрытая поверхность (SYS_SURFACE_DESTROY или завершение процесса)
+ * освобождается композитором на следующем проходе и только когда
+ * с ней не работает ни одна операция ядра (счетчик users).
+ */
+
+#include "surface.h"
+#include "framebuffer.h"
+#include "gui.h"
+#include "pmm.h"
+#include "vmm.h"
+#include "proc.h"
+#include "sched.h"
+#include "smp.h"
+#include "syscall.h"
+#include "spinlock.h"
+#include "wait.h"
+#include "timer.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+// Состояния поверхности
+typedef enum {
+    SURFACE_FREE = 0,
+    SURFACE_LIVE,
+    SURFACE_CLOSING,        // Закрыта, страницы освободит композитор
+} surface_state_t;
+
+typedef struct {
+    surface_state_t state;
+    proc_t* owner;          // NULL - поток ядра
+    uint16_t x;             // Положение на экране
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    uint32_t* pixels;       // Физический адрес = адрес ядра
+    uint32_t pages;
+    
+    // Повреждение, ожидающее вывода: [x0, x1) x [y0, y1)
+    bool damaged;
+    uint16_t damage_x0;
+    uint16_t damage_y0;
+    uint16_t damage_x1;
+    uint16_t damage_y1;
+    
+    uint32_t submits;       // Вызовов surface_damage
+    uint32_t frames;        // Выводов на экран
+    uint32_t users;         // Операций ядра, рисующих в поверхности
+} surface_t;
+
+static surface_t surfaces[SURFACE_MAX];
+
+SPINLOCK_DEFINE(surface_lock, "surface");
+
+// Композитор спит здесь, пока нет повреждений
+static wait_queue_t surface_wait = WAIT_QUEUE_INIT;
+static volatile bool surface_pending = false;
+
+static const char* surface_state_names[] = {
+    "free", "live", "closing"
+};
+
+/**
+ * Поверхность по номеру, если вызывающий - ее владелец (под surface_lock)
+ */
+static surface_t* surface_get_owned(int32_t id) {
+    if (id < 0 || id >= SURFACE_MAX) return NULL;
+    
+    surface_t* s = &surfaces[id];
+    if (s->state != SURFACE_LIVE || s->owner != proc_current()) return NULL;
+    
+    return s;
+}
+
+/**
+ * Пробуждение композитора
+ */
+static void surface_kick(void) {
+    surface_pending = true;
+    wake_up(&surface_wait);
+}
+
+/**
+ * Удаление страниц поверхности из каталога процесса
+ * @param count Сколько первых страниц было отображено
+ */
+static void surface_unmap(uint32_t directory, int32_t id, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        vmm_unmap(directory, SURFACE_USER_ADDR(id) + i * PAGE_SIZE);
+    }
+}
+
+/**
+ * Создание поверхности для текущего процесса (или потока ядра)
+ * Процесс получает ее по адресу SURFACE_USER_ADDR(id).
+ * @param x Координата X на экране
+ * @param y Координата Y на экране
+ * @param width Ширина (не больше экрана)
+ * @param height Высота (не больше экрана)
+ * @return Номер поверхности или -1
+ */
+int32_t surface_create(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (!framebuffer_is_initialized() || width == 0 || height == 0 ||
+        width > framebuffer_get_width() || height > framebuffer_get_height()) {
+        return -1;
+    }
+    
+    proc_t* owner = proc_current();
+    int32_t id = -1;
+    
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    for (int32_t i = 0; i < SURFACE_MAX; i++) {
+        if (surfaces[i].state == SURFACE_FREE) {
+            // Слот занят, но композитор его не выводит, пока нет страниц
+            surfaces[i].state = SURFACE_CLOSING;
+            surfaces[i].pixels = NULL;
+            surfaces[i].pages = 0;
+            id = i;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    if (id < 0) return -1;
+    
+    surface_t* s = &surfaces[id];
+    uint32_t pages = PAGE_ALIGN_UP((uint32_t)width * height * sizeof(uint32_t)) / PAGE_SIZE;
+    uint32_t base = pmm_alloc_range(pages);
+    
+    bool ok = base != 0;
+    uint32_t mapped = 0;
+    
+    if (ok) {
+        memset((void*)base, 0, pages * PAGE_SIZE);
+        
+        // Страницы принадлежат поверхности: vmm_destroy их не освобождает
+        for (; owner != NULL && mapped < pages; mapped++) {
+            if (!vmm_map(owner->directory, SURFACE_USER_ADDR(id) + mapped * PAGE_SIZE,
+                         base + mapped * PAGE_SIZE, VMM_WRITABLE | VMM_SHARED)) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    
+    if (!ok) {
+        if (owner != NULL) surface_unmap(owner->directory, id, mapped);
+        if (base != 0) pmm_free_range(base, pages);
+        
+        flags = spin_lock_irqsave(&surface_lock);
+        s->state = SURFACE_FREE;
+        spin_unlock_irqrestore(&surface_lock, flags);
+        return -1;
+    }
+    
+    flags = spin_lock_irqsave(&surface_lock);
+    s->owner = owner;
+    s->x = x;
+    s->y = y;
+    s->width = width;
+    s->height = height;
+    s->pixels = (uint32_t*)base;
+    s->pages = pages;
+    s->damaged = false;
+    s->submits = 0;
+    s->frames = 0;
+    s->users = 0;
+    s->state = SURFACE_LIVE;
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    #ifdef DEBUG
+    terminal_printf("Surface %d: %dx%d, %d pages at %x\n", id, width, height, pages, base);
+    #endif
+    
+    return id;
+}
+
+/**
+ * Сообщение об измененной части поверхности
+ * Прямоугольник обрезается по поверхности и объединяется с еще не
+ * выведенным повреждением.
+ * @param id Номер поверхности
+ * @param x Координата X внутри поверхности
+ * @param y Координата Y внутри поверхности
+ * @param width Ширина
+ * @param height Высота
+ * @return false, если поверхность не принадлежит вызывающему
+ */
+bool surface_damage(int32_t id, uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    
+    surface_t* s = surface_get_owned(id);
+    if (s == NULL) {
+        spin_unlock_irqrestore(&surface_lock, flags);
+        return false;
+    }
+    
+    s->submits++;
+    
+    uint32_t x1 = (uint32_t)x + width;
+    uint32_t y1 = (uint32_t)y + height;
+    if (x1 > s->width) x1 = s->width;
+    if (y1 > s->height) y1 = s->height;
+    
+    bool empty = x >= x1 || y >= y1;
+    if (!empty) {
+        if (!s->damaged) {
+            s->damage_x0 = x;
+            s->damage_y0 = y;
+            s->damage_x1 = x1;
+            s->damage_y1 = y1;
+            s->damaged = true;
+        } else {
+            if (x < s->damage_x0) s->damage_x0 = x;
+            if (y < s->damage_y0) s->damage_y0 = y;
+            if (x1 > s->damage_x1) s->damage_x1 = x1;
+            if (y1 > s->damage_y1) s->damage_y1 = y1;
+        }
+    }
+    
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    if (!empty) surface_kick();
+    return true;
+}
+
+/**
+ * Закрытие поверхности
+ * Процесс сразу теряет доступ к страницам, освобождает их композитор.
+ * @param id Номер поверхности
+ * @return false, если поверхность не принадлежит вызывающему
+ */
+bool surface_destroy(int32_t id) {
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    
+    surface_t* s = surface_get_owned(id);
+    if (s == NULL) {
+        spin_unlock_irqrestore(&surface_lock, flags);
+        return false;
+    }
+    
+    s->state = SURFACE_CLOSING;
+    proc_t* owner = s->owner;
+    uint32_t pages = s->pages;
+    
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    if (owner != NULL) surface_unmap(owner->directory, id, pages);
+    
+    surface_kick();
+    return true;
+}
+
+/**
+ * Пиксели поверхности для потока ядра (процесс использует SURFACE_USER_ADDR)
+ * @return Адрес буфера или NULL
+ */
+uint32_t* surface_pixels(int32_t id) {
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    surface_t* s = surface_get_owned(id);
+    uint32_t* pixels = s != NULL ? s->pixels : NULL;
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    return pixels;
+}
+
+/**
+ * Захват поверхности для рисования ядром
+ * Пока счетчик users не обнулится, композитор не освобождает страницы.
+ * @return Поверхность или NULL, если она не принадлежит вызывающему
+ */
+static surface_t* surface_acquire(int32_t id) {
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    surface_t* s = surface_get_owned(id);
+    if (s != NULL) s->users++;
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    return s;
+}
+
+/**
+ * Конец рисования ядром
+ */
+static void surface_put(surface_t* s) {
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    bool closing = --s->users == 0 && s->state == SURFACE_CLOSING;
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    // Закрытие ждало этой операции
+    if (closing) surface_kick();
+}
+
+/**
+ * Обрезка прямоугольника по поверхности
+ * @return false, если от прямоугольника ничего не осталось
+ */
+static bool surface_clip(const surface_t* s, uint16_t x, uint16_t y,
+                         uint16_t* width, uint16_t* height) {
+    if (x >= s->width || y >= s->height) return false;
+    
+    if (*width > s->width - x) *width = s->width - x;
+    if (*height > s->height - y) *height = s->height - y;
+    
+    return *width > 0 && *height > 0;
+}
+
+/**
+ * Заливка прямоугольника поверхности (на экран не выводится)
+ * @param id Номер поверхности
+ * @param x, y Координаты внутри поверхности
+ * @param width, height Размер
+ * @param color Цвет
+ * @return false, если поверхность не принадлежит вызывающему
+ */
+bool surface_fill(int32_t id, uint16_t x, uint16_t y, uint16_t width, uint16_t height,
+                  uint32_t color) {
+    surface_t* s = surface_acquire(id);
+    if (s == NULL) return false;
+    
+    if (surface_clip(s, x, y, &width, &height)) {
+        for (uint16_t py = 0; py < height; py++) {
+            uint32_t* row = &s->pixels[(uint32_t)(y + py) * s->width + x];
+            for (uint16_t px = 0; px < width; px++) {
+                row[px] = color;
+            }
+        }
+    }
+    
+    surface_put(s);
+    return true;
+}
+
+/**
+ * Копирование прямоугольника внутри поверхности (прокрутка)
+ * Области могут перекрываться.
+ * @param id Номер поверхности
+ * @param src_x, src_y Источник
+ * @param dst_x, dst_y Назначение
+ * @param width, height Размер
+ * @return false, если поверхность не принадлежит вызывающему
+ */
+bool surface_copy(int32_t id, uint16_t src_x, uint16_t src_y, uint16_t dst_x, uint16_t dst_y,
+                  uint16_t width, uint16_t height) {
+    surface_t* s = surface_acquire(id);
+    if (s == NULL) return false;
+    
+    if (surface_clip(s, src_x, src_y, &width, &height) &&
+        surface_clip(s, dst_x, dst_y, &width, &height)) {
+        // Сдвиг вниз копируется с последней строки, чтобы не затереть источник
+        bool down = dst_y > src_y;
+        
+        for (uint16_t i = 0; i < height; i++) {
+            uint16_t py = down ? height - 1 - i : i;
+            memmove(&s->pixels[(uint32_t)(dst_y + py) * s->width + dst_x],
+                    &s->pixels[(uint32_t)(src_y + py) * s->width + src_x],
+                    width * sizeof(uint32_t));
+        }
+    }
+    
+    surface_put(s);
+    return true;
+}
+
+/**
+ * Закрытие всех поверхностей завершившегося процесса (из proc_exit)
+ * Отображения не снимаются: каталог процесса освобождается целиком.
+ * @param owner Процесс
+ */
+void surface_release(proc_t* owner) {
+    bool closed = false;
+    
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    for (int i = 0; i < SURFACE_MAX; i++) {
+        if (surfaces[i].state == SURFACE_LIVE && surfaces[i].owner == owner) {
+            surfaces[i].state = SURFACE_CLOSING;
+            closed = true;
+        }
+    }
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    if (closed) surface_kick();
+}
+
+/**
+ * Повреждение всех поверхностей целиком
+ * Вызывается после перерисовки рабочего стола, которая их затерла.
+ */
+void surface_invalidate_all(void) {
+    bool any = false;
+    
+    uint32_t flags = spin_lock_irqsave(&surface_lock);
+    for (int i = 0; i < SURFACE_MAX; i++) {
+        surface_t* s = &surfaces[i];
+        if (s->state != SURFACE_LIVE) continue;
+        
+        s->damage_x0 = 0;
+        s->damage_y0 = 0;
+        s->damage_x1 = s->width;
+        s->damage_y1 = s->height;
+        s->damaged = true;
+        any = true;
+    }
+    spin_unlock_irqrestore(&surface_lock, flags);
+    
+    if (any) surface_kick();
+}
+
+/**
+ * Один проход композитора: вывод повреждений и освобождение
+ * закрытых поверхностей
+ */
+static void surface_composite(void) {
+    bool erased = false;
+    
+    for (int i = 0; i < SURFACE_MAX; i++) {
+        surface_t* s = &surfaces[i];
+        
+        uint32_t flags = spin_lock_irqsave(&surface_lock);
+        
+        if (s->state == SURFACE_CLOSING && s->pixels != NULL && s->users == 0) {
+            uint32_t base = (uint32_t)s->pixels;
+            uint32_t pages = s->pages;
+            s->pixels = NULL;
+            s->owner = NULL;
+            s->state = SURFACE_FREE;
+            spin_unlock_irqrestore(&surface_lock, flags);
+            
+            pmm_free_range(base, pages);
+            erased = true;
+            continue;
+        }
+        
+        if (s->state != SURFACE_LIVE || !s->damaged) {
+            spin_unlock_irqrestore(&surface_lock, flags);
+            continue;
+        }
+        
+        // Забираем повреждение; новое, пришедшее во время вывода,
+        // будет выведено следующим проходом
+        uint16_t x0 = s->damage_x0;
+        uint16_t y0 = s->damage_y0;
+        uint16_t width = s->damage_x1 - x0;
+        uint16_t height = s->damage_y1 - y0;
+        uint16_t screen_x = s->x + x0;
+        uint16_t screen_y = s->y + y0;
+        const uint32_t* src = &s->pixels[(uint32_t)y0 * s->width + x0];
+        uint32_t stride = s->width;
+        s->damaged = false;
+        
+        spin_unlock_irqrestore(&surface_lock, flags);
+        
+        framebuffer_draw_surface(screen_x, screen_y, width, height, src, stride);
+        framebuffer_swap_rect(screen_x, screen_y, width, height);
+        s->frames++;
+    }
+    
+    // Место закрытых окон занимает рабочий стол (он же заново
+    // повредит оставшиеся поверхности)
+    if (erased) {
+        gui_draw_desktop();
+        framebuffer_swap();
+    }
+}
+
+/**
+ * Поток композитора
+ */
+static void surface_thread(void* arg) {
+    (void)arg;
+    
+    for (;;) {
+        wait_event(&surface_wait, surface_pending);
+        surface_pending = false;
+        surface_composite();
+    }
+}
+
+/**
+ * SYS_SURFACE_CREATE - создание поверхности
+ * @param x, y Положение на экране
+ * @param width, height Размер
+ * @return Номер (пиксели по адресу SURFACE_USER_ADDR(номер)) или -1
+ */
+static int32_t sys_surface_create(uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+                                  uint32_t a5) {
+    (void)a5;
+    
+    if (x > 0xFFFF || y > 0xFFFF || width > 0xFFFF || height > 0xFFFF) return -1;
+    return surface_create(x, y, width, height);
+}
+
+/**
+ * SYS_SURFACE_DAMAGE - вывод измененного прямоугольника
+ * @param id Номер поверхности
+ * @param x, y, width, height Прямоугольник внутри поверхности
+ * @return 0 или -1
+ */
+static int32_t sys_surface_damage(uint32_t id, uint32_t x, uint32_t y, uint32_t width,
+                                  uint32_t height) {
+    if (x > 0xFFFF || y > 0xFFFF) return -1;
+    if (width > 0xFFFF) width = 0xFFFF;
+    if (height > 0xFFFF) height = 0xFFFF;
+    
+    return surface_damage((int32_t)id, x, y, width, height) ? 0 : -1;
+}
+
+/**
+ * SYS_SURFACE_DESTROY - закрытие поверхности
+ * @param id Номер поверхности
+ * @return 0 или -1
+ */
+static int32_t sys_surface_destroy(uint32_t id, uint32_t a2, uint32_t a3, uint32_t a4,
+                                   uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return surface_destroy((int32_t)id) ? 0 : -1;
+}
+
+/**
+ * Проверка: кадры градиента из потока ядра, как от клиента
+ */
+static void surface_test(void) {
+    const uint16_t size = 256;
+    const uint32_t count = 120;
+    
+    int32_t id = surface_create(framebuffer_get_width() - size - 20, 40, size, size);
+    uint32_t* pixels = surface_pixels(id);
+    if (pixels == NULL) {
+        terminal_print_line("Cannot create a surface");
+        return;
+    }
+    
+    uint32_t start = timer_get_ticks();
+    
+    for (uint32_t frame = 0; frame < count; frame++) {
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                pixels[y * size + x] = (((x + frame) & 0xFF) << 16) | (((y + frame) & 0xFF) << 8) |
+                                       ((x ^ y) & 0xFF);
+            }
+        }
+        surface_damage(id, 0, 0, size, size);
+        sched_sleep_ms(16);
+    }
+    
+    uint32_t frames = surfaces[id].frames;
+    uint32_t elapsed = timer_get_ticks() - start;
+    surface_destroy(id);
+    
+    terminal_printf("Surface test: %d frames submitted, %d composited in %d ticks\n",
+                    count, frames, elapsed);
+}
+
+/**
+ * Команда: surface [test] - список поверхностей или проверка вывода
+ */
+static void cmd_surface(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "test") == 0) {
+        surface_test();
+        return;
+    }
+    
+    for (int i = 0; i < SURFACE_MAX; i++) {
+        surface_t* s = &surfaces[i];
+        if (s->state == SURFACE_FREE) continue;
+        
+        terminal_printf("%d: %s pid %d at %d,%d %dx%d, %d submits, %d frames\n",
+                        i, surface_state_names[s->state],
+                        s->owner != NULL ? s->owner->pid : 0,
+                        s->x, s->y, s->width, s->height, s->submits, s->frames);
+    }
+}
+
+/**
+ * Инициализация поверхностей (после sched_init)
+ */
+void surface_init(void) {
+    memset(surfaces, 0, sizeof(surfaces));
+    
+    syscall_register(SYS_SURFACE_CREATE, sys_surface_create);
+    syscall_register(SYS_SURFACE_DAMAGE, sys_surface_damage);
+    syscall_register(SYS_SURFACE_DESTROY, sys_surface_destroy);
+    
+    // Композитор рисует на BSP, как и главный цикл
+    sched_create_on("compositor", surface_thread, NULL, SMP_BSP);
+    cmdreg_register("surface", "List window surfaces (surface [test])", cmd_surface);
+}
@@ -0,0 +1,310 @@
+/**
+ * kernel/syscall.c - Системные вызовы
+ *
+ * Оба входа (int 0x80 и SYSENTER) строят на стеке ядра одинаковый
+ * кадр struct registers и попадают в syscall_dispatch(): номер берется
+ * из EAX, обработчик - из таблицы, результат кладется обратно в EAX.
+ * Вызов выполняется в контексте потока при разрешенных прерываниях и
+ * может блокироваться.
+ */
+
+#include "syscall.h"
+#include "gdt.h"
+#include "sched.h"
+#include "smp.h"
+#include "proc.h"
+#include "vmm.h"
+#include "timer.h"
+#include "terminal.h"
+#include "cmdreg.h"
+#include <stddef.h>
+#include <string.h>
+
+// Повторов в "syscall bench"
+#define SYSCALL_BENCH_ITERATIONS 10000
+
+// Сколько ждать завершения замера
+#define SYSCALL_BENCH_TIMEOUT_MS 5000
+
+// Таблица вызовов
+static syscall_func_t syscall_table[SYSCALL_MAX];
+
+// Процессор поддерживает SYSENTER/SYSEXIT
+static bool syscall_sysenter_ok = false;
+
+// Стек и результаты замера в кольце 3
+static uint8_t syscall_bench_stack[4096] __attribute__((aligned(16)));
+static volatile uint32_t syscall_bench_int80_cycles;
+static volatile uint32_t syscall_bench_sysenter_cycles;
+static volatile bool syscall_bench_done;
+
+// Адресное пространство замера: код ядра выполняется в кольце 3,
+// поэтому страницы ядра в нем доступны пользователю
+static uint32_t syscall_bench_directory = 0;
+
+/**
+ * SYS_NULL - пустой вызов
+ */
+static int32_t sys_null(uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return 0;
+}
+
+/**
+ * SYS_EXIT - завершение потока
+ */
+static int32_t sys_exit(uint32_t code, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    
+    #ifdef DEBUG
+    terminal_printf("Thread %s exited with code %d\n", sched_current()->name, code);
+    #else
+    (void)code;
+    #endif
+    
+    sched_exit();
+}
+
+/**
+ * SYS_WRITE - вывод в терминал
+ * @param buf Адрес строки
+ * @param length Длина в байтах
+ * @return Количество выведенных байтов
+ */
+static int32_t sys_write(uint32_t buf, uint32_t length, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a3; (void)a4; (void)a5;
+    
+    if (buf == 0 || !proc_check_user(buf, length, false)) return -1;
+    
+    const char* s = (const char*)buf;
+    for (uint32_t i = 0; i < length; i++) {
+        terminal_putchar(s[i]);
+    }
+    return (int32_t)length;
+}
+
+/**
+ * SYS_YIELD - отдать процессор
+ */
+static int32_t sys_yield(uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    sched_yield();
+    return 0;
+}
+
+/**
+ * SYS_SLEEP - сон
+ * @param ms Миллисекунды
+ */
+static int32_t sys_sleep(uint32_t ms, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    sched_sleep_ms(ms);
+    return 0;
+}
+
+/**
+ * SYS_TIME - миллисекунды с загрузки
+ */
+static int32_t sys_time(uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a1; (void)a2; (void)a3; (void)a4; (void)a5;
+    return (int32_t)timer_get_ticks();
+}
+
+/**
+ * Регистрация обработчика вызова
+ * @param num Номер вызова
+ * @param func Обработчик
+ * @return false, если номер вне таблицы
+ */
+bool syscall_register(uint32_t num, syscall_func_t func) {
+    if (num >= SYSCALL_MAX) return false;
+    
+    syscall_table[num] = func;
+    return true;
+}
+
+/**
+ * Диспетчер вызовов (из syscall_asm.asm)
+ * @param regs Кадр вызова; результат записывается в regs->eax
+ */
+void syscall_dispatch(struct registers* regs) {
+    uint32_t num = regs->eax;
+    
+    if (num >= SYSCALL_MAX || syscall_table[num] == NULL) {
+        regs->eax = (uint32_t)-1;
+        return;
+    }
+    
+    regs->eax = (uint32_t)syscall_table[num](regs->ebx, regs->ecx, regs->edx,
+                                             regs->esi, regs->edi);
+}
+
+/**
+ * Вход через SYSENTER (из syscall_asm.asm)
+ * В ECX и EDX пришли стек и адрес возврата; аргументы 2 и 3
+ * вызывающий код оставил на вершине своего стека. Стек проверяется,
+ * как и буферы вызовов: процесс может передать любой ESP.
+ * @param regs Кадр вызова
+ */
+void syscall_sysenter_handler(struct registers* regs) {
+    if (regs->useresp == 0 || !proc_check_user(regs->useresp, 2 * sizeof(uint32_t), false)) {
+        regs->eax = (uint32_t)-1;
+        return;
+    }
+    
+    const uint32_t* args = (const uint32_t*)regs->useresp;
+    
+    regs->ecx = args[0];
+    regs->edx = args[1];
+    
+    syscall_dispatch(regs);
+}
+
+/**
+ * Проверка поддержки SYSENTER
+ * Pentium Pro (семейство 6, модель < 3, степпинг < 3) сообщает о
+ * SYSENTER, но не поддерживает его.
+ */
+static bool syscall_detect_sysenter(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    
+    if (!(edx & CPUID_EDX_SEP)) return false;
+    
+    uint32_t family = (eax >> 8) & 0xF;
+    uint32_t model = (eax >> 4) & 0xF;
+    uint32_t stepping = eax & 0xF;
+    
+    return !(family == 6 && model < 3 && stepping < 3);
+}
+
+/**
+ * Есть ли быстрый вход SYSENTER
+ */
+bool syscall_has_sysenter(void) {
+    return syscall_sysenter_ok;
+}
+
+/**
+ * Настройка SYSENTER на текущем процессоре
+ * MSR у каждого процессора свои. Стек входа - поле esp0 в TSS
+ * процессора: планировщик обновляет его при каждом переключении,
+ * и вход загружает из него стек текущего потока.
+ */
+void syscall_init_cpu(void) {
+    if (!syscall_sysenter_ok) return;
+    
+    cpu_wrmsr(MSR_SYSENTER_CS, GDT_KERNEL_CODE_SEG);
+    cpu_wrmsr(MSR_SYSENTER_ESP, (uint32_t)&tss[cpu_current()].esp0);
+    cpu_wrmsr(MSR_SYSENTER_EIP, (uint32_t)syscall_sysenter_entry);
+}
+
+/**
+ * Замер стоимости пустого вызова (выполняется в кольце 3)
+ * Пользуется только RDTSC и системными вызовами.
+ */
+static void syscall_bench_user(void) {
+    uint64_t start = cpu_rdtsc();
+    for (int i = 0; i < SYSCALL_BENCH_ITERATIONS; i++) {
+        syscall_int80(SYS_NULL, 0, 0, 0);
+    }
+    syscall_bench_int80_cycles = (uint32_t)((cpu_rdtsc() - start) / SYSCALL_BENCH_ITERATIONS);
+    
+    if (syscall_sysenter_ok) {
+        start = cpu_rdtsc();
+        for (int i = 0; i < SYSCALL_BENCH_ITERATIONS; i++) {
+            syscall_sysenter3(SYS_NULL, 0, 0, 0);
+        }
+        syscall_bench_sysenter_cycles = (uint32_t)((cpu_rdtsc() - start) / SYSCALL_BENCH_ITERATIONS);
+    }
+    
+    syscall_bench_done = true;
+    syscall_int80(SYS_EXIT, 0, 0, 0);
+}
+
+/**
+ * Поток замера: переходит в кольцо 3
+ */
+static void syscall_bench_thread(void* arg) {
+    (void)arg;
+    
+    if (vmm_is_enabled()) {
+        if (syscall_bench_directory == 0) {
+            syscall_bench_directory = vmm_create(true);
+        }
+        if (syscall_bench_directory == 0) return;
+        
+        uint32_t flags = cpu_irq_save();
+        sched_current()->page_directory = syscall_bench_directory;
+        vmm_switch(syscall_bench_directory);
+        cpu_irq_restore(flags);
+    }
+    
+    syscall_enter_user((uint32_t)syscall_bench_user,
+                       (uint32_t)(syscall_bench_stack + sizeof(syscall_bench_stack)));
+}
+
+/**
+ * Команда: syscall [bench] - входы системных вызовов
+ */
+static void cmd_syscall(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        syscall_bench_done = false;
+        syscall_bench_sysenter_cycles = 0;
+        
+        if (sched_create("sysbench", syscall_bench_thread, NULL) == NULL) {
+            terminal_print_line("No free thread");
+            return;
+        }
+        
+        for (uint32_t waited = 0; !syscall_bench_done; waited += 10) {
+            if (waited >= SYSCALL_BENCH_TIMEOUT_MS) {
+                terminal_print_line("Benchmark timed out");
+                return;
+            }
+            sched_sleep_ms(10);
+        }
+        
+        terminal_printf("null syscall: int 0x80 %d cycles", syscall_bench_int80_cycles);
+        if (syscall_sysenter_ok) {
+            terminal_printf(", sysenter %d cycles", syscall_bench_sysenter_cycles);
+        }
+        terminal_putchar('\n');
+        return;
+    }
+    
+    if (argc > 1) {
+        terminal_print_line("Usage: syscall [bench]");
+        return;
+    }
+    
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < SYSCALL_MAX; i++) {
+        if (syscall_table[i] != NULL) count++;
+    }
+    
+    terminal_printf("%d system calls, entry: int 0x80%s\n", count,
+                    syscall_sysenter_ok ? ", sysenter" : "");
+}
+
+/**
+ * Инициализация системных вызовов (на BSP, после idt_init)
+ * AP вызывают syscall_init_cpu() при запуске.
+ */
+void syscall_init(void) {
+    // DPL 3: int 0x80 разрешен из кольца 3
+    idt_set_gate(SYSCALL_VECTOR, (uint32_t)syscall_int80_entry, GDT_KERNEL_CODE_SEG,
+                 IDT_FLAG_PRESENT | IDT_FLAG_RING3 | IDT_FLAG_32BIT_INT);
+    
+    syscall_register(SYS_NULL, sys_null);
+    syscall_register(SYS_EXIT, sys_exit);
+    syscall_register(SYS_WRITE, sys_write);
+    syscall_register(SYS_YIELD, sys_yield);
+    syscall_register(SYS_SLEEP, sys_sleep);
+    syscall_register(SYS_TIME, sys_time);
+    
+    syscall_sysenter_ok = syscall_detect_sysenter();
+    syscall_init_cpu();
+    
+    cmdreg_register("syscall", "System call entry paths (syscall bench)", cmd_syscall);
+}
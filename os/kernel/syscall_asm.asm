@@ -0,0 +1,129 @@
+; kernel/syscall_asm.asm - Входы системных вызовов и переход в кольцо 3
+
+section .text
+    global syscall_int80_entry
+    global syscall_sysenter_entry
+    global syscall_enter_user
+
+extern syscall_dispatch
+extern syscall_sysenter_handler
+
+; Вход через int 0x80
+; Кадр совпадает с кадром прерывания (struct registers); при вызове
+; из кольца 0 поля useresp и ss в нем отсутствуют.
+syscall_int80_entry:
+    push dword 0          ; Код ошибки
+    push dword 0x80       ; Номер вектора
+
+    ; Сохраняем все регистры
+    pusha
+
+    ; Сохраняем сегментные регистры
+    push ds
+    push es
+    push fs
+    push gs
+
+    ; Загружаем сегмент данных ядра
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov ax, 0x30          ; GS - область данных текущего процессора
+    mov gs, ax
+
+    ; Вызов выполняется при разрешенных прерываниях
+    sti
+    push esp
+    call syscall_dispatch
+    add esp, 4
+    cli
+
+    ; Восстанавливаем сегментные регистры
+    pop gs
+    pop fs
+    pop es
+    pop ds
+
+    ; EAX в кадре уже содержит результат
+    popa
+
+    ; Очищаем код ошибки и номер вектора из стека
+    add esp, 8
+    iret
+
+; Вход через SYSENTER
+; Процессор загрузил CS и SS ядра и ESP из MSR_SYSENTER_ESP, который
+; указывает на поле esp0 в TSS процессора; EIP и ESP пользователя не
+; сохранены - они в EDX и ECX. Прерывания запрещены.
+syscall_sysenter_entry:
+    mov esp, [esp]        ; Стек ядра текущего потока
+
+    ; Строим тот же кадр, что и при int 0x80 из кольца 3
+    push dword 0x23       ; SS пользователя
+    push ecx              ; ESP пользователя
+    pushfd
+    or dword [esp], 0x200 ; SYSENTER сбросил IF
+    push dword 0x1B       ; CS пользователя
+    push edx              ; Адрес возврата
+    push dword 0
+    push dword 0x80
+
+    pusha
+
+    push ds
+    push es
+    push fs
+    push gs
+
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov ax, 0x30
+    mov gs, ax
+
+    sti
+    push esp
+    call syscall_sysenter_handler
+    add esp, 4
+    cli
+
+    pop gs
+    pop fs
+    pop es
+    pop ds
+
+    popa
+    add esp, 8
+
+    ; SYSEXIT: EIP из EDX, ESP из ECX
+    mov edx, [esp]        ; Адрес возврата
+    mov ecx, [esp + 12]   ; ESP пользователя
+
+    ; Прерывание после sti придет уже в кольце 3
+    sti
+    sysexit
+
+; Переход в кольцо 3
+; Сигнатура: void syscall_enter_user(uint32_t eip, uint32_t esp)
+; Возврата нет: поток возвращается в ядро только системными вызовами
+; и прерываниями (на стек из esp0 в TSS).
+syscall_enter_user:
+    mov ecx, [esp + 4]    ; Точка входа
+    mov edx, [esp + 8]    ; Стек пользователя
+
+    ; Сегменты данных уровня 3
+    mov ax, 0x23
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+
+    ; Кадр iret со сменой кольца
+    push dword 0x23       ; SS
+    push edx              ; ESP
+    push dword 0x202      ; EFLAGS: IF
+    push dword 0x1B       ; CS
+    push ecx              ; EIP
+    iret
@@ -1,24 +1,56 @@
 /**
  * kernel/terminal.c - Эмулятор терминала
+ *
+ * Терминал состоит из нескольких виртуальных консолей (Alt+F1..F6).
+ * У каждой консоли свой буфер ячеек, история команд и строка ввода.
+ * На экран рисует только активная консоль; фоновые консоли пишут
+ * в свои ячейки и помечаются как измененные.
  */
 
 #include "terminal.h"
 #include "framebuffer.h"
 #include "keyboard.h"
 #include "commands.h"
+#include "cmdreg.h"
+#include "history.h"
 #include "gui.h"
+#include "sched.h"
+#include "timer.h"
+#include "wait.h"
+#include "spinlock.h"
+#include "cpu.h"
 #include <stdbool.h>
 #include <string.h>
 
-// Состояние терминала
-static terminal_state_t term_state;
+// Виртуальная консоль
+typedef struct {
+    terminal_state_t state;
+    char buffer[TERMINAL_BUFFER_SIZE];          // Ячейки консоли
+    history_t history;                          // История команд и обратный поиск (Ctrl+R)
+    char search_saved_line[COMMAND_MAX_LENGTH]; // Строка ввода до начала поиска
+    char pending[COMMAND_MAX_LENGTH];           // Введенная, но еще не выполненная строка
+    bool pending_ready;
+    bool dirty;                                 // Ячейки менялись, пока консоль была в фоне
+    bool surface_valid;                         // Снимок экрана консоли актуален
+    uint32_t surface[TERMINAL_VIEW_WIDTH * TERMINAL_VIEW_HEIGHT]; // Снимок области терминала
+} terminal_console_t;
+
+static terminal_console_t consoles[TERMINAL_CONSOLES];
+static terminal_console_t* active_console = &consoles[0];  // Отображается и получает ввод
+static terminal_console_t* command_console = NULL;         // Выполняет команду (получает ее вывод)
 static bool terminal_initialized = false;
 
-// Буферы терминала
-static char terminal_buffer[TERMINAL_BUFFER_SIZE];
-static char command_history[MAX_HISTORY][COMMAND_MAX_LENGTH];
-static int history_count = 0;
-static int history_index = -1;
+// Поток, ожидающий введенную строку (terminal_wait_input)
+static wait_queue_t terminal_input_wait = WAIT_QUEUE_INIT;
+
+// Передача строк pending/pending_ready от редактора строки потоку команд
+SPINLOCK_DEFINE(terminal_pending_lock, "terminal-pending");
+
+static void terminal_history_search_show(terminal_console_t* c);
+
+// Фаза мигания курсора (общая для консолей: видна только активная)
+static bool terminal_blink_on = true;
+static uint32_t terminal_blink_last = 0;
 
 // Цвета терминала
 static const uint32_t TERM_BG_COLOR = 0x000000;
@@ -31,8 +63,59 @@ static const uint32_t TERM_SUCCESS_COLOR = 0x00FF00;
 static int term_window_id = -1;
 static uint16_t term_x = 10;
 static uint16_t term_y = 30;
-static uint16_t term_width = 580;
-static uint16_t term_height = 340;
+static uint16_t term_width = TERMINAL_VIEW_WIDTH;
+static uint16_t term_height = TERMINAL_VIEW_HEIGHT;
+
+/**
+ * Консоль, в которую идет вывод
+ * Вывод команды попадает в консоль, из которой она запущена,
+ * остальной вывод - в активную консоль.
+ */
+static terminal_console_t* terminal_output(void) {
+    return command_console != NULL ? command_console : active_console;
+}
+
+/**
+ * Команда: history - вывод истории команд
+ */
+static void cmd_history(int argc, char** argv) {
+    (void)argc; // Не используется
+    (void)argv; // Не используется
+    
+    terminal_show_history();
+}
+
+/**
+ * Команда: console - номер текущей консоли или переключение
+ */
+static void cmd_console(int argc, char** argv) {
+    if (argc < 2) {
+        terminal_printf("Console %d of %d (Alt+F1..F%d to switch)\n",
+                        terminal_active_console() + 1, TERMINAL_CONSOLES, TERMINAL_CONSOLES);
+        return;
+    }
+    
+    int index = argv[1][0] - '1';
+    if (argv[1][1] != '\0' || !terminal_switch_console(index)) {
+        terminal_printf("Usage: console [1-%d]\n", TERMINAL_CONSOLES);
+    }
+}
+
+/**
+ * Инициализация консоли
+ * @param c Консоль
+ */
+static void terminal_console_init(terminal_console_t* c) {
+    memset(&c->state, 0, sizeof(terminal_state_t));
+    c->state.cursor_visible = true;
+    lineedit_init(&c->state.input);
+    
+    memset(c->buffer, 0, sizeof(c->buffer));
+    history_init(&c->history);
+    c->pending_ready = false;
+    c->dirty = true;
+    c->surface_valid = false;
+}
 
 /**
  * Инициализация терминала
@@ -40,18 +123,12 @@ static uint16_t term_height = 340;
 void terminal_init(void) {
     if (terminal_initialized) return;
     
-    // Инициализируем состояние терминала
-    memset(&term_state, 0, sizeof(terminal_state_t));
-    term_state.cursor_x = 0;
-    term_state.cursor_y = 0;
-    term_state.scroll_offset = 0;
-    term_state.input_index = 0;
-    term_state.escape_mode = false;
-    term_state.escape_param_count = 0;
-    
-    // Очищаем буферы
-    memset(terminal_buffer, 0, sizeof(terminal_buffer));
-    memset(command_history, 0, sizeof(command_history));
+    // Инициализируем консоли
+    for (int i = 0; i < TERMINAL_CONSOLES; i++) {
+        terminal_console_init(&consoles[i]);
+    }
+    active_console = &consoles[0];
+    command_console = NULL;
     
     // Создаем окно терминала, если оно еще не создано
     if (term_window_id == -1) {
@@ -61,27 +138,60 @@ void terminal_init(void) {
     // Устанавливаем размеры терминала внутри окна
     term_x = 10;
     term_y = 30;
-    term_width = 580;
-    term_height = 340;
+    term_width = TERMINAL_VIEW_WIDTH;
+    term_height = TERMINAL_VIEW_HEIGHT;
+    
+    // Регистрируем команды терминала
+    cmdreg_register("history", "Show command history", cmd_history);
+    cmdreg_register("console", "Show or switch virtual console", cmd_console);
     
     // Добавляем начальное сообщение
     terminal_print_banner();
     
     terminal_initialized = true;
     
+    // Фоновые консоли сразу готовы к вводу
+    for (int i = 1; i < TERMINAL_CONSOLES; i++) {
+        command_console = &consoles[i];
+        terminal_print_banner();
+        terminal_print_prompt();
+    }
+    command_console = NULL;
+    
     #ifdef DEBUG
     terminal_print_line("Terminal initialized");
     #endif
 }
 
+/**
+ * Проверка, видна ли консоль на экране
+ * @param c Консоль
+ * @return Окно терминала или NULL, если рисовать не нужно
+ */
+static gui_window_t* terminal_visible_window(terminal_console_t* c) {
+    if (!terminal_initialized || term_window_id == -1) return NULL;
+    
+    // Фоновая консоль только накапливает изменения
+    if (c != active_console) {
+        c->dirty = true;
+        return NULL;
+    }
+    
+    gui_window_t* win = gui_get_window(term_window_id);
+    if (win == NULL || !win->visible) return NULL;
+    
+    return win;
+}
+
 /**
  * Отрисовка терминала
  */
 void terminal_draw(void) {
-    if (!terminal_initialized || term_window_id == -1) return;
+    terminal_console_t* c = active_console;
+    terminal_state_t* st = &c->state;
     
-    gui_window_t* win = gui_get_window(term_window_id);
-    if (win == NULL || !win->visible) return;
+    gui_window_t* win = terminal_visible_window(c);
+    if (win == NULL) return;
     
     // Рассчитываем абсолютные координаты
     uint16_t abs_x = win->x + term_x;
@@ -91,9 +201,15 @@ void terminal_draw(void) {
     framebuffer_draw_rect(abs_x, abs_y, term_width, term_height, TERM_BG_COLOR);
     
     // Выводим строки из буфера
-    int line_count = term_state.cursor_y + 1;
+    int line_count = st->cursor_y + 1;
     int start_line = 0;
     
+    // Строка ввода может продолжаться ниже курсора
+    if (st->show_prompt) {
+        int input_rows = (st->input_origin + st->input_shown) / TERMINAL_WIDTH + 1;
+        if (input_rows > line_count) line_count = input_rows;
+    }
+    
     // Прокрутка, если слишком много строк
     if (line_count > MAX_TERMINAL_LINES) {
         start_line = line_count - MAX_TERMINAL_LINES;
@@ -103,7 +219,7 @@ void terminal_draw(void) {
         uint16_t line_y = abs_y + (i - start_line) * 16;
         
         // Находим строку в буфере
-        char* line_start = &terminal_buffer[i * TERMINAL_WIDTH];
+        char* line_start = &c->buffer[i * TERMINAL_WIDTH];
         char line[TERMINAL_WIDTH + 1];
         strncpy(line, line_start, TERMINAL_WIDTH);
         line[TERMINAL_WIDTH] = '\0';
@@ -113,93 +229,219 @@ void terminal_draw(void) {
     }
     
     // Отрисовываем курсор ввода
-    if (term_state.cursor_visible) {
-        uint16_t cursor_abs_x = abs_x + term_state.cursor_x * 8;
-        uint16_t cursor_abs_y = abs_y + (term_state.cursor_y - start_line) * 16;
-        
-        // Мигающий курсор
-        static uint32_t last_blink = 0;
-        uint32_t current_ticks = timer_get_ticks();
-        
-        if (current_ticks - last_blink > 500) { // 500ms
-            term_state.cursor_visible = !term_state.cursor_visible;
-            last_blink = current_ticks;
+    if (st->cursor_visible && terminal_blink_on) {
+        uint16_t cursor_abs_x = abs_x + st->cursor_x * 8;
+        uint16_t cursor_abs_y = abs_y + (st->cursor_y - start_line) * 16;
+        framebuffer_draw_rect(cursor_abs_x, cursor_abs_y + 14, 8, 2, TERM_TEXT_COLOR);
+    }
+    
+    // Отрисовываем приглашение там, где оно было выведено
+    if (st->show_prompt) {
+        int prompt_pos = st->input_origin - (int)strlen(st->prompt);
+        if (prompt_pos >= 0) {
+            uint16_t prompt_x = abs_x + (prompt_pos % TERMINAL_WIDTH) * 8;
+            uint16_t prompt_y = abs_y + (prompt_pos / TERMINAL_WIDTH) * 16;
+            framebuffer_draw_string(prompt_x, prompt_y, st->prompt, TERM_PROMPT_COLOR, TERM_BG_COLOR);
         }
+    }
+    
+    c->dirty = false;
+}
+
+/**
+ * Перерисовка диапазона ячеек без перерисовки всего терминала
+ * На экран копируются только затронутые строки пикселей.
+ * @param c Консоль
+ * @param start Первая ячейка (линейная позиция в буфере)
+ * @param end Ячейка после последней
+ */
+static void terminal_draw_cells(terminal_console_t* c, int start, int end) {
+    gui_window_t* win = terminal_visible_window(c);
+    if (win == NULL) return;
+    
+    if (start < 0) start = 0;
+    if (end > TERMINAL_BUFFER_SIZE) end = TERMINAL_BUFFER_SIZE;
+    if (start >= end) return;
+    
+    uint16_t abs_x = win->x + term_x;
+    uint16_t abs_y = win->y + term_y;
+    int cursor = c->state.cursor_y * TERMINAL_WIDTH + c->state.cursor_x;
+    
+    for (int pos = start; pos < end; pos++) {
+        uint16_t cell_x = abs_x + (pos % TERMINAL_WIDTH) * 8;
+        uint16_t cell_y = abs_y + (pos / TERMINAL_WIDTH) * 16;
+        char ch = c->buffer[pos] ? c->buffer[pos] : ' ';
         
-        if (term_state.cursor_visible) {
-            framebuffer_draw_rect(cursor_abs_x, cursor_abs_y + 14, 8, 2, TERM_TEXT_COLOR);
+        framebuffer_draw_char(cell_x, cell_y, ch, TERM_TEXT_COLOR, TERM_BG_COLOR);
+        if (pos == cursor && c->state.cursor_visible && terminal_blink_on) {
+            framebuffer_draw_rect(cell_x, cell_y + 14, 8, 2, TERM_TEXT_COLOR);
         }
     }
     
-    // Отрисовываем приглашение, если это текущая строка
-    if (term_state.show_prompt) {
-        uint16_t prompt_y = abs_y + (term_state.cursor_y - start_line) * 16;
-        framebuffer_draw_string(abs_x, prompt_y, term_state.prompt, TERM_PROMPT_COLOR, TERM_BG_COLOR);
+    // Выводим на экран построчно только измененные ячейки
+    int row = start / TERMINAL_WIDTH;
+    int last_row = (end - 1) / TERMINAL_WIDTH;
+    for (; row <= last_row; row++) {
+        int row_start = row * TERMINAL_WIDTH;
+        int from = start > row_start ? start - row_start : 0;
+        int to = end < row_start + TERMINAL_WIDTH ? end - row_start : TERMINAL_WIDTH;
+        
+        framebuffer_swap_rect(abs_x + from * 8, abs_y + row * 16, (to - from) * 8, 16);
     }
 }
 
 /**
- * Вывод символа в терминал
- * @param c Символ для вывода
+ * Переключение активной консоли
+ * Снимок экрана уходящей консоли сохраняется, и если новая консоль
+ * не менялась в фоне, ее снимок выводится одним копированием
+ * без отрисовки текста.
+ * @param index Номер консоли (0..TERMINAL_CONSOLES-1)
+ * @return true, если консоль переключена
  */
-void terminal_putchar(char c) {
-    if (!terminal_initialized) return;
+bool terminal_switch_console(int index) {
+    if (!terminal_initialized || index < 0 || index >= TERMINAL_CONSOLES) return false;
+    
+    terminal_console_t* next = &consoles[index];
+    if (next == active_console) return true;
+    
+    gui_window_t* win = gui_get_window(term_window_id);
+    if (win == NULL || !win->visible) {
+        active_console = next;
+        return true;
+    }
+    
+    uint16_t abs_x = win->x + term_x;
+    uint16_t abs_y = win->y + term_y;
+    
+    // Сохраняем то, что сейчас на экране у уходящей консоли
+    framebuffer_save_rect(abs_x, abs_y, term_width, term_height, active_console->surface);
+    active_console->surface_valid = true;
+    
+    active_console = next;
+    
+    if (next->surface_valid && !next->dirty) {
+        framebuffer_restore_rect(abs_x, abs_y, term_width, term_height, next->surface);
+    } else {
+        terminal_draw();
+    }
+    
+    framebuffer_swap_rect(abs_x, abs_y, term_width, term_height);
+    return true;
+}
+
+/**
+ * Номер активной консоли
+ */
+int terminal_active_console(void) {
+    return (int)(active_console - consoles);
+}
+
+/**
+ * Линейная позиция курсора в буфере консоли
+ */
+static int terminal_cursor_pos(terminal_console_t* c) {
+    return c->state.cursor_y * TERMINAL_WIDTH + c->state.cursor_x;
+}
+
+/**
+ * Установка курсора по линейной позиции в буфере
+ * @param c Консоль
+ * @param pos Позиция (0 - начало буфера)
+ */
+static void terminal_set_cursor_pos(terminal_console_t* c, int pos) {
+    if (pos < 0) pos = 0;
+    c->state.cursor_x = pos % TERMINAL_WIDTH;
+    c->state.cursor_y = pos / TERMINAL_WIDTH;
+}
+
+/**
+ * Прокрутка буфера консоли на одну строку вверх
+ */
+static void terminal_scroll(terminal_console_t* c) {
+    // Сдвигаем строки вверх
+    memmove(c->buffer, 
+            &c->buffer[TERMINAL_WIDTH], 
+            TERMINAL_BUFFER_SIZE - TERMINAL_WIDTH);
+    
+    // Очищаем последнюю строку
+    memset(&c->buffer[(MAX_TERMINAL_LINES - 1) * TERMINAL_WIDTH], 
+           ' ', TERMINAL_WIDTH);
+    
+    if (c->state.cursor_y > 0) {
+        c->state.cursor_y--;
+    }
+    c->state.input_origin -= TERMINAL_WIDTH;
+    c->state.scroll_offset++;
+}
+
+/**
+ * Запись символа в буфер консоли без перерисовки
+ * @param c Консоль
+ * @param ch Символ для вывода
+ */
+static void terminal_emit(terminal_console_t* c, char ch) {
+    terminal_state_t* st = &c->state;
     
     // Обработка специальных символов
-    switch (c) {
+    switch (ch) {
         case '\n': // Новая строка
-            term_state.cursor_x = 0;
-            term_state.cursor_y++;
+            st->cursor_x = 0;
+            st->cursor_y++;
             break;
-            
+        
         case '\r': // Возврат каретки
-            term_state.cursor_x = 0;
+            st->cursor_x = 0;
             break;
-            
+        
         case '\b': // Backspace
-            if (term_state.cursor_x > 0) {
-                term_state.cursor_x--;
-                int index = term_state.cursor_y * TERMINAL_WIDTH + term_state.cursor_x;
+            if (st->cursor_x > 0) {
+                st->cursor_x--;
+                int index = st->cursor_y * TERMINAL_WIDTH + st->cursor_x;
                 if (index >= 0 && index < TERMINAL_BUFFER_SIZE) {
-                    terminal_buffer[index] = ' ';
+                    c->buffer[index] = ' ';
                 }
             }
             break;
-            
+        
         case '\t': // Табуляция
-            term_state.cursor_x = (term_state.cursor_x + 8) & ~7;
+            st->cursor_x = (st->cursor_x + 8) & ~7;
             break;
-            
+        
         default: // Обычный символ
-            if (c >= 32 && c <= 126) { // Печатные символы
-                int index = term_state.cursor_y * TERMINAL_WIDTH + term_state.cursor_x;
+            if (ch >= 32 && ch <= 126) { // Печатные символы
+                int index = st->cursor_y * TERMINAL_WIDTH + st->cursor_x;
                 if (index >= 0 && index < TERMINAL_BUFFER_SIZE) {
-                    terminal_buffer[index] = c;
+                    c->buffer[index] = ch;
                 }
-                term_state.cursor_x++;
+                st->cursor_x++;
             }
             break;
     }
     
     // Перенос строки при достижении границы
-    if (term_state.cursor_x >= TERMINAL_WIDTH) {
-        term_state.cursor_x = 0;
-        term_state.cursor_y++;
+    if (st->cursor_x >= TERMINAL_WIDTH) {
+        st->cursor_x = 0;
+        st->cursor_y++;
     }
     
     // Прокрутка при заполнении экрана
-    if (term_state.cursor_y >= MAX_TERMINAL_LINES) {
-        // Сдвигаем строки вверх
-        memmove(terminal_buffer, 
-                &terminal_buffer[TERMINAL_WIDTH], 
-                TERMINAL_BUFFER_SIZE - TERMINAL_WIDTH);
-        
-        // Очищаем последнюю строку
-        memset(&terminal_buffer[(MAX_TERMINAL_LINES - 1) * TERMINAL_WIDTH], 
-               ' ', TERMINAL_WIDTH);
-        
-        term_state.cursor_y = MAX_TERMINAL_LINES - 1;
-        term_state.scroll_offset++;
+    if (st->cursor_y >= MAX_TERMINAL_LINES) {
+        terminal_scroll(c);
+    }
+}
+
+/**
+ * Вывод символа в консоль
+ * Фоновая консоль только обновляет ячейки.
+ * @param c Консоль
+ * @param ch Символ
+ */
+static void terminal_console_putchar(terminal_console_t* c, char ch) {
+    terminal_emit(c, ch);
+    
+    if (c != active_console) {
+        c->dirty = true;
+        return;
     }
     
     // Обновляем отображение
@@ -207,6 +449,164 @@ void terminal_putchar(char c) {
     framebuffer_swap();
 }
 
+/**
+ * Вывод символа в терминал
+ * @param c Символ для вывода
+ */
+void terminal_putchar(char c) {
+    if (!terminal_initialized) return;
+    
+    // Вывод команды и эхо ввода идут из разных потоков
+    sched_preempt_disable();
+    terminal_console_putchar(terminal_output(), c);
+    sched_preempt_enable();
+}
+
+/**
+ * Удаление символа перед курсором
+ */
+void terminal_backspace(void) {
+    terminal_putchar('\b');
+}
+
+/**
+ * Выводятся ли правки строки ввода на экран
+ * С Enter до нового приглашения позиция ввода указывает на прежнюю
+ * строку, а курсор принадлежит выводу команды. Набранное в это время
+ * остается только в редакторе и показывается после приглашения.
+ * @param c Консоль
+ */
+static bool terminal_input_visible(terminal_console_t* c) {
+    return __atomic_load_n(&c->state.show_prompt, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Резервирование места под строку ввода заданной длины
+ * Если строка не помещается до конца экрана, буфер прокручивается.
+ * @param c Консоль
+ * @param len Длина строки ввода
+ * @return true, если была прокрутка (нужна полная перерисовка)
+ */
+static bool terminal_input_reserve(terminal_console_t* c, int len) {
+    bool scrolled = false;
+    
+    // Курсор после последнего символа тоже должен остаться на экране
+    while (c->state.input_origin + len >= TERMINAL_BUFFER_SIZE &&
+           c->state.input_origin >= TERMINAL_WIDTH) {
+        terminal_scroll(c);
+        scrolled = true;
+    }
+    
+    return scrolled;
+}
+
+/**
+ * Вывод изменений строки ввода на экран
+ * Затирает хвост прежней строки, ставит курсор и перерисовывает
+ * только ячейки от первой измененной позиции.
+ * @param c Консоль
+ * @param from Первая измененная позиция в строке ввода
+ * @param len Новая длина строки ввода
+ * @param cursor Позиция курсора в строке ввода
+ * @param scrolled Была ли прокрутка при резервировании
+ */
+static void terminal_input_flush(terminal_console_t* c, int from, int len, int cursor, bool scrolled) {
+    terminal_state_t* st = &c->state;
+    int origin = st->input_origin;
+    int end = len > st->input_shown ? len : st->input_shown;
+    
+    for (int i = len; i < st->input_shown; i++) {
+        c->buffer[origin + i] = ' ';
+    }
+    st->input_shown = len;
+    
+    // Во время набора курсор не гаснет
+    terminal_blink_on = true;
+    terminal_blink_last = timer_get_ticks();
+    
+    int old_cursor = terminal_cursor_pos(c);
+    terminal_set_cursor_pos(c, origin + cursor);
+    
+    if (scrolled) {
+        if (c == active_console) {
+            terminal_draw();
+            framebuffer_swap();
+        }
+        return;
+    }
+    
+    terminal_draw_cells(c, origin + from, origin + end);
+    terminal_draw_cells(c, old_cursor, old_cursor + 1);
+    terminal_draw_cells(c, origin + cursor, origin + cursor + 1);
+}
+
+/**
+ * Перерисовка строки ввода начиная с измененной позиции
+ * @param c Консоль
+ * @param from Первая измененная позиция (результат lineedit_*)
+ */
+static void terminal_input_refresh(terminal_console_t* c, int from) {
+    if (!terminal_input_visible(c)) return;
+    
+    lineedit_t* le = &c->state.input;
+    int len = lineedit_length(le);
+    bool scrolled = terminal_input_reserve(c, len);
+    
+    for (int i = from; i < len; i++) {
+        c->buffer[c->state.input_origin + i] = lineedit_char_at(le, i);
+    }
+    
+    terminal_input_flush(c, from, len, lineedit_cursor(le), scrolled);
+}
+
+/**
+ * Отображение произвольного текста на месте строки ввода
+ * Содержимое редактора не меняется (используется поиском по истории).
+ * @param c Консоль
+ * @param text Текст
+ */
+static void terminal_input_show(terminal_console_t* c, const char* text) {
+    if (!terminal_input_visible(c)) return;
+    
+    int len = strlen(text);
+    if (len > LINEEDIT_CAPACITY - 1) len = LINEEDIT_CAPACITY - 1;
+    bool scrolled = terminal_input_reserve(c, len);
+    
+    memcpy(&c->buffer[c->state.input_origin], text, len);
+    terminal_input_flush(c, 0, len, len, scrolled);
+}
+
+/**
+ * Завершение строки ввода по Enter
+ * Строка остается в консоли до выполнения в главном цикле.
+ * @param c Консоль
+ */
+static void terminal_input_submit(terminal_console_t* c) {
+    // Предыдущая строка этой консоли еще не выполнена: Enter ждет
+    // нового приглашения, а набранная строка остается в редакторе.
+    // Пока приглашение выведено, pending_ready не взведен.
+    if (!terminal_input_visible(c)) return;
+    
+    // Курсор в конец строки, затем перевод строки
+    lineedit_end(&c->state.input);
+    terminal_set_cursor_pos(c, c->state.input_origin + lineedit_length(&c->state.input));
+    c->state.show_prompt = false;
+    terminal_console_putchar(c, '\n');
+    
+    // Передаем строку потоку команд после перевода строки,
+    // чтобы вывод команды начинался с новой строки
+    uint32_t flags = spin_lock_irqsave(&terminal_pending_lock);
+    lineedit_get(&c->state.input, c->pending, sizeof(c->pending));
+    c->pending_ready = true;
+    spin_unlock_irqrestore(&terminal_pending_lock, flags);
+    
+    lineedit_clear(&c->state.input);
+    c->state.input_shown = 0;
+    history_reset_cursor(&c->history);
+    
+    wake_up(&terminal_input_wait);
+}
+
 /**
  * Вывод строки в терминал
  * @param str Строка для вывода
@@ -270,10 +670,16 @@ void terminal_printf(const char* format, ...) {
                     break;
                 }
                 case 'x': {
-                    int num = va_arg(args, int);
-                    char num_buf[32];
-                    itoa(num, num_buf, 16);
-                    char* num_str = num_buf;
+                    // Без знака: адреса вроде 0xFEE00000 не должны
+                    // печататься как отрицательные числа
+                    uint32_t num = va_arg(args, uint32_t);
+                    char num_buf[9];
+                    char* num_str = &num_buf[8];
+                    *num_str = '\0';
+                    do {
+                        *--num_str = "0123456789abcdef"[num & 0xF];
+                        num >>= 4;
+                    } while (num != 0);
                     while (*num_str && dst - buffer < 255) {
                         *dst++ = *num_str++;
                     }
@@ -309,29 +715,94 @@ void terminal_print_banner(void) {
 
 /**
  * Отображение приглашения командной строки
+ * Строка, набранная во время выполнения команды, выводится сразу
+ * после приглашения.
  */
 void terminal_print_prompt(void) {
-    term_state.show_prompt = true;
-    strcpy(term_state.prompt, "myos> ");
-    terminal_print(term_state.prompt);
+    terminal_console_t* c = terminal_output();
+    
+    // Приглашение выводит поток команд, правки строки - главный цикл
+    sched_preempt_disable();
+    
+    strcpy(c->state.prompt, "myos> ");
+    terminal_print(c->state.prompt);
+    
+    // Ввод начинается сразу после приглашения
+    c->state.input_origin = terminal_cursor_pos(c);
+    c->state.input_shown = 0;
+    __atomic_store_n(&c->state.show_prompt, true, __ATOMIC_RELEASE);
+    
+    if (c->history.search.active) {
+        terminal_history_search_show(c);
+    } else if (lineedit_length(&c->state.input) > 0) {
+        terminal_input_refresh(c, 0);
+    }
+    
+    // Приглашение рисуется своим цветом только при полной перерисовке
+    if (c == active_console) {
+        terminal_draw();
+        framebuffer_swap();
+    } else {
+        c->dirty = true;
+    }
+    
+    sched_preempt_enable();
 }
 
 /**
- * Обработка ввода с клавиатуры
+ * Обработка введенных строк
+ * Каждая консоль выполняет свою строку, вывод команды
+ * направляется в нее же, даже если она в фоне.
  */
 void terminal_process_input(void) {
     if (!terminal_initialized) return;
     
-    // Проверяем, есть ли символы в буфере клавиатуры
-    char input_buffer[COMMAND_MAX_LENGTH];
-    int len = keyboard_getline(input_buffer, sizeof(input_buffer));
-    
-    if (len > 0) {
-        // Обрабатываем введенную строку
-        terminal_process_command_input(input_buffer);
+    for (int i = 0; i < TERMINAL_CONSOLES; i++) {
+        terminal_console_t* c = &consoles[i];
+        char input_buffer[COMMAND_MAX_LENGTH];
+        
+        uint32_t flags = spin_lock_irqsave(&terminal_pending_lock);
+        bool ready = c->pending_ready;
+        if (ready) {
+            strcpy(input_buffer, c->pending);
+            c->pending_ready = false;
+        }
+        spin_unlock_irqrestore(&terminal_pending_lock, flags);
+        
+        if (!ready) continue;
+        
+        command_console = c;
+        if (input_buffer[0] != '\0') {
+            // Обрабатываем введенную строку
+            terminal_process_command_input(input_buffer);
+        } else {
+            // Пустая строка - только новое приглашение
+            terminal_print_prompt();
+        }
+        command_console = NULL;
     }
 }
 
+/**
+ * Проверка, есть ли введенная строка хотя бы в одной консоли
+ */
+static bool terminal_input_pending(void) {
+    for (int i = 0; i < TERMINAL_CONSOLES; i++) {
+        if (consoles[i].pending_ready) return true;
+    }
+    return false;
+}
+
+/**
+ * Ожидание введенной строки в любой консоли
+ * Поток команд спит здесь, пока Enter не передаст ему строку.
+ */
+void terminal_wait_input(void) {
+    if (!sched_can_block()) return;
+    
+    wait_event(&terminal_input_wait, terminal_input_pending());
+}
+
 /**
  * Обработка введенной команды
  * @param input Введенная строка
@@ -340,23 +811,7 @@ void terminal_process_command_input(const char* input) {
     if (input == NULL || input[0] == '\0') return;
     
     // Добавляем команду в историю
-    if (history_count < MAX_HISTORY) {
-        strncpy(command_history[history_count], input, COMMAND_MAX_LENGTH - 1);
-        command_history[history_count][COMMAND_MAX_LENGTH - 1] = '\0';
-        history_count++;
-    } else {
-        // Сдвигаем историю
-        for (int i = 0; i < MAX_HISTORY - 1; i++) {
-            strcpy(command_history[i], command_history[i + 1]);
-        }
-        strncpy(command_history[MAX_HISTORY - 1], input, COMMAND_MAX_LENGTH - 1);
-        command_history[MAX_HISTORY - 1][COMMAND_MAX_LENGTH - 1] = '\0';
-    }
-    
-    history_index = history_count;
-    
-    // Выводим команду (если она не была выведена ранее)
-    terminal_print_line(input);
+    history_add(&terminal_output()->history, input);
     
     // Обрабатываем команду
     terminal_process_command(input);
@@ -393,30 +848,8 @@ void terminal_process_command(const char* command) {
         return;
     }
     
-    // Ищем и выполняем команду
-    bool found = false;
-    
-    // Проверяем встроенные команды
-    if (strcmp(argv[0], "help") == 0) {
-        execute_help(argc, argv);
-        found = true;
-    }
-    else if (strcmp(argv[0], "echo") == 0) {
-        execute_echo(argc, argv);
-        found = true;
-    }
-    else if (strcmp(argv[0], "about") == 0) {
-        execute_about(argc, argv);
-        found = true;
-    }
-    else if (strcmp(argv[0], "clear") == 0) {
-        terminal_clear();
-        found = true;
-    }
-    else if (strcmp(argv[0], "history") == 0) {
-        terminal_show_history();
-        found = true;
-    }
+    // Ищем и выполняем команду через реестр
+    bool found = cmdreg_execute(argc, argv);
     
     // Если команда не найдена
     if (!found) {
@@ -429,30 +862,45 @@ void terminal_process_command(const char* command) {
  * Очистка терминала
  */
 void terminal_clear(void) {
-    memset(terminal_buffer, ' ', TERMINAL_BUFFER_SIZE);
-    term_state.cursor_x = 0;
-    term_state.cursor_y = 0;
-    term_state.scroll_offset = 0;
+    sched_preempt_disable();
     
-    terminal_draw();
-    framebuffer_swap();
+    terminal_console_t* c = terminal_output();
+    
+    memset(c->buffer, ' ', TERMINAL_BUFFER_SIZE);
+    c->state.cursor_x = 0;
+    c->state.cursor_y = 0;
+    c->state.scroll_offset = 0;
+    
+    if (c == active_console) {
+        terminal_draw();
+        framebuffer_swap();
+    } else {
+        c->dirty = true;
+    }
     
     // Перерисовываем баннер
     terminal_print_banner();
+    
+    sched_preempt_enable();
 }
 
 /**
  * Отображение истории команд
  */
 void terminal_show_history(void) {
-    if (history_count == 0) {
+    history_t* h = &terminal_output()->history;
+    
+    if (history_count(h) == 0) {
         terminal_print_line("No commands in history");
         return;
     }
     
     terminal_print_line("Command history:");
-    for (int i = 0; i < history_count; i++) {
-        terminal_printf("%3d: %s\n", i + 1, command_history[i]);
+    for (uint32_t seq = h->first; seq < h->next; seq++) {
+        // terminal_printf не знает ширины поля: номер выравнивается вручную
+        uint32_t number = seq + 1;
+        terminal_print(number < 10 ? "  " : number < 100 ? " " : "");
+        terminal_printf("%d: %s\n", number, history_get(h, seq));
     }
 }
 
@@ -461,52 +909,239 @@ void terminal_show_history(void) {
  * @param direction Направление: 1 - вверх, -1 - вниз
  */
 void terminal_history_navigate(int direction) {
-    if (history_count == 0) return;
+    terminal_console_t* c = active_console;
+    const char* line = direction > 0 ? history_prev(&c->history)
+                                     : history_next(&c->history);
     
-    if (direction > 0) { // Вверх
-        if (history_index > 0) {
-            history_index--;
-        }
-    } else { // Вниз
-        if (history_index < history_count - 1) {
-            history_index++;
-        }
+    // Текст копируется из арены истории прямо в редактор
+    if (line != NULL) {
+        terminal_input_refresh(c, lineedit_set(&c->state.input, line));
+    }
+}
+
+/**
+ * Добавление строки к буферу отображения поиска
+ */
+static int terminal_search_append(char* dst, int pos, const char* src) {
+    while (*src && pos < COMMAND_MAX_LENGTH - 1) {
+        dst[pos++] = *src++;
     }
+    dst[pos] = '\0';
+    return pos;
+}
+
+/**
+ * Отображение строки обратного поиска вместо строки ввода
+ */
+static void terminal_history_search_show(terminal_console_t* c) {
+    const char* match = history_search_current(&c->history);
+    char display[COMMAND_MAX_LENGTH];
+    int len = 0;
     
-    if (history_index >= 0 && history_index < history_count) {
-        // Восстанавливаем команду из истории
-        // (нужно очистить текущую строку и вставить команду из истории)
-        // Для простоты пока не реализуем
+    len = terminal_search_append(display, len, match != NULL ? "(reverse-i-search)`"
+                                                             : "(failed reverse-i-search)`");
+    len = terminal_search_append(display, len, c->history.search.query);
+    len = terminal_search_append(display, len, "': ");
+    if (match != NULL) {
+        len = terminal_search_append(display, len, match);
     }
+    
+    terminal_input_show(c, display);
+}
+
+/**
+ * Завершение поиска с заменой строки ввода
+ * @param c Консоль
+ * @param line Строка, которая становится строкой ввода
+ */
+static void terminal_history_search_finish(terminal_console_t* c, const char* line) {
+    history_search_end(&c->history);
+    terminal_input_refresh(c, lineedit_set(&c->state.input, line));
+}
+
+/**
+ * Ctrl+R: начало обратного поиска или переход к более старому совпадению
+ */
+void terminal_history_search(void) {
+    terminal_console_t* c = active_console;
+    
+    if (!c->history.search.active) {
+        lineedit_get(&c->state.input, c->search_saved_line, sizeof(c->search_saved_line));
+        history_search_begin(&c->history);
+    } else {
+        history_search_older(&c->history);
+    }
+    
+    terminal_history_search_show(c);
+}
+
+/**
+ * Обработка клавиши в режиме обратного поиска
+ * @param c Консоль
+ * @param key Код клавиши
+ * @return true, если клавиша поглощена поиском
+ */
+static bool terminal_history_search_key(terminal_console_t* c, int key) {
+    const char* match;
+    
+    switch (key) {
+        case KEY_CTRL_R:
+            terminal_history_search();
+            return true;
+        case KEY_ESCAPE:
+            // Отмена с восстановлением исходной строки
+            terminal_history_search_finish(c, c->search_saved_line);
+            return true;
+        case KEY_BACKSPACE:
+            history_search_pop(&c->history);
+            terminal_history_search_show(c);
+            return true;
+        default:
+            break;
+    }
+    
+    if (key >= 32 && key <= 126) {
+        history_search_push(&c->history, (char)key);
+        terminal_history_search_show(c);
+        return true;
+    }
+    
+    // Любая другая клавиша (в том числе Enter) принимает найденную
+    // строку и затем обрабатывается как обычно
+    match = history_search_current(&c->history);
+    terminal_history_search_finish(c, match != NULL ? match : c->search_saved_line);
+    return false;
 }
 
 /**
  * Автодополнение команды (по нажатию Tab)
  */
 void terminal_autocomplete(void) {
-    // Простая реализация - дополнение по первым символам
-    // В реальной системе нужно искать по всем командам
-    
-    const char* commands[] = {"help", "echo", "about", "clear", "history", NULL};
-    
-    // Находим совпадающие команды
-    for (int i = 0; commands[i] != NULL; i++) {
-        if (strncmp(term_state.input_buffer, commands[i], 
-                   strlen(term_state.input_buffer)) == 0) {
-            // Дополняем команду
-            strcpy(term_state.input_buffer, commands[i]);
-            term_state.input_index = strlen(commands[i]);
+    terminal_console_t* c = active_console;
+    char line[COMMAND_MAX_LENGTH];
+    char completion[COMMAND_MAX_LENGTH];
+    int len = lineedit_get(&c->state.input, line, sizeof(line));
+    
+    // Дополняем до самого длинного однозначного префикса по дереву команд
+    int matches = cmdreg_complete(line, completion, sizeof(completion) - 1);
+    if (matches == 0) return;
+    
+    // Единственное совпадение - сразу ставим пробел перед аргументами
+    if (matches == 1) {
+        int end = strlen(completion);
+        completion[end] = ' ';
+        completion[end + 1] = '\0';
+    }
+    
+    // Префикс не меняется, перерисовывается только дописанная часть
+    lineedit_set(&c->state.input, completion);
+    terminal_input_refresh(c, len);
+}
+
+/**
+ * Обработка клавиши редактором строки ввода активной консоли
+ * Каждая правка перерисовывает только ячейки от места правки
+ * до конца строки, перемещение курсора - только две ячейки.
+ * @param key Код клавиши (ASCII или KEY_*)
+ */
+void terminal_handle_key(int key) {
+    if (!terminal_initialized) return;
+    
+    terminal_console_t* c = active_console;
+    
+    // В режиме поиска клавиши сначала получает поиск
+    if (c->history.search.active && terminal_history_search_key(c, key)) {
+        return;
+    }
+    
+    lineedit_t* le = &c->state.input;
+    int from = -1;
+    
+    switch (key) {
+        case KEY_ENTER:
+            terminal_input_submit(c);
+            return;
+        case KEY_TAB:
+            terminal_autocomplete();
+            return;
+        case KEY_CTRL_R:
+            terminal_history_search();
+            return;
+        case KEY_UP:
+            terminal_history_navigate(1);
+            return;
+        case KEY_DOWN:
+            terminal_history_navigate(-1);
+            return;
+        case KEY_BACKSPACE:
+            from = lineedit_backspace(le);
+            break;
+        case KEY_DELETE:
+            from = lineedit_delete(le);
+            break;
+        case KEY_CTRL_W:
+            from = lineedit_kill_word(le);
+            break;
+        case KEY_CTRL_U:
+            from = lineedit_kill_line(le);
+            break;
+        case KEY_LEFT:
+        case KEY_RIGHT:
+        case KEY_HOME:
+        case KEY_END: {
+            bool moved = key == KEY_LEFT  ? lineedit_left(le)
+                       : key == KEY_RIGHT ? lineedit_right(le)
+                       : key == KEY_HOME  ? lineedit_home(le)
+                       :                    lineedit_end(le);
+            
+            // Текст не изменился - перерисовываются только ячейки курсора
+            if (moved) {
+                from = lineedit_length(le);
+            }
             break;
         }
+        default:
+            if (key >= 32 && key <= 126) {
+                from = lineedit_insert(le, (char)key);
+            }
+            break;
+    }
+    
+    if (from >= 0) {
+        terminal_input_refresh(c, from);
     }
 }
 
+/**
+ * Мигание курсора (вызывается из главного цикла)
+ * Раз в TERMINAL_BLINK_MS перерисовывается только ячейка курсора
+ * активной консоли.
+ */
+void terminal_blink(void) {
+    if (!terminal_initialized) return;
+    
+    uint32_t now = timer_get_ticks();
+    if (now - terminal_blink_last < TERMINAL_BLINK_MS) return;
+    
+    // Вывод команды идет из потока команд
+    sched_preempt_disable();
+    
+    terminal_blink_on = !terminal_blink_on;
+    terminal_blink_last = now;
+    
+    terminal_console_t* c = active_console;
+    int cursor = terminal_cursor_pos(c);
+    terminal_draw_cells(c, cursor, cursor + 1);
+    
+    sched_preempt_enable();
+}
+
 /**
  * Получение состояния терминала
- * @return Указатель на состояние терминала
+ * @return Указатель на состояние активной консоли
  */
 terminal_state_t* terminal_get_state(void) {
-    return &term_state;
+    return &active_console->state;
 }
 
 /**
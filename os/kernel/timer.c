@@ -1,19 +1,54 @@
 /**
  * kernel/timer.c - Драйвер программируемого интервального таймера (PIT)
+ *
+ * После загрузки тики идут от PIT с частотой TIMER_FREQUENCY. Если
+ * регистрируется устройство событий (clockevent) с однократным режимом,
+ * PIT останавливается, время считается по clock_ns(), а прерывание
+ * программируется на ближайший таймер. В простое периодический тик
+ * не нужен вовсе.
+ *
+ * Обработчик прерывания только считает тики; сработавшие таймеры
+ * выполняются в SOFTIRQ_TIMER при разрешенных прерываниях.
+ *
+ * Колесо обслуживает BSP (его LAPIC - устройство событий), но взводить
+ * и отменять таймеры можно с любого процессора: структуры колеса
+ * защищены timer_lock.
  */
 
 #include "timer.h"
+#include "clockevent.h"
 #include "idt.h"
+#include "irq.h"
+#include "cpu.h"
+#include "clock.h"
+#include "softirq.h"
+#include "sched.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "wait.h"
 #include "terminal.h"
 #include <stdbool.h>
+#include <stddef.h>
 
-// Частота таймера в Гц
-#define TIMER_FREQUENCY 1000
+// Базовая частота PIT в Гц
+#define PIT_BASE_FREQUENCY 1193182
 
 // Порт команд PIT
 #define PIT_CMD_PORT 0x43
 // Порт данных канала 0 PIT
 #define PIT_CH0_PORT 0x40
+// Порт данных канала 2 PIT и порт управления его затвором
+#define PIT_CH2_PORT  0x42
+#define PIT_GATE_PORT 0x61
+
+// Допуск на срабатывание таймера: 1/TIMER_SLACK_DIV от задержки
+#define TIMER_SLACK_DIV 16
+
+// Задержки короче этой выдерживаются циклом по TSC
+#define TIMER_SPIN_LIMIT_US 50
+
+// Наибольшая задержка одного замера по каналу 2 PIT (16-битный счетчик)
+#define TIMER_PIT_WAIT_MAX_US 50000
 
 // Значение делителя для нужной частоты
 #define PIT_DIVIDER 1193180 / TIMER_FREQUENCY
@@ -23,16 +58,439 @@ static volatile uint32_t timer_ticks = 0;
 static volatile uint32_t timer_seconds = 0;
 static volatile bool timer_initialized = false;
 
-// Список таймерных обратных вызовов
-typedef struct timer_callback {
-    void (*func)(void*);
+// Длительность тика в наносекундах
+#define TIMER_NS_PER_TICK (NSEC_PER_SEC / TIMER_FREQUENCY)
+
+// Показание clock_ns(), соответствующее нулевому тику
+static uint64_t timer_base_ns = 0;
+
+// Устройство событий (NULL - периодический тик от PIT)
+static const clockevent_t* clockevent = NULL;
+static volatile bool timer_idle_state = false;
+static volatile uint64_t sleep_deadline_ns = 0;    // Срок текущего timer_sleep (0 - нет)
+static volatile uint32_t timer_event_count = 0;    // Количество прерываний таймера
+
+// Состояния таймера
+#define TIMER_STATE_FREE    0
+#define TIMER_STATE_PENDING 1   // В одном из слотов колеса
+#define TIMER_STATE_RUNNING 2   // Обратный вызов выполняется
+
+// Максимальный интервал, который помещается в колесо
+#define TIMER_WHEEL_MAX_DELTA ((1u << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+#define TIMER_NONE (-1)
+
+// Таймер (хранится в статическом пуле, списки слотов - по индексам)
+typedef struct {
+    timer_func_t func;
     void* data;
-    uint32_t interval_ticks;
-    uint32_t next_tick;
-    struct timer_callback* next;
-} timer_callback_t;
+    uint32_t expires;       // Тик срабатывания
+    uint32_t period;        // Период в тиках (0 - однократный)
+    uint32_t generation;    // Поколение для проверки дескрипторов
+    int16_t prev;
+    int16_t next;
+    uint16_t slot;          // Номер слота (уровень * TIMER_WHEEL_SLOTS + индекс)
+    uint8_t state;
+} timer_entry_t;
+
+static timer_entry_t timer_pool[TIMER_MAX_TIMERS];
+static int16_t timer_free_head = TIMER_NONE;
+
+// Слоты колеса (индекс первого таймера в слоте) и список сработавших
+// таймеров, ожидающих вызова, в дополнительном слоте
+#define TIMER_EXPIRED_SLOT (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+static int16_t timer_wheel[TIMER_EXPIRED_SLOT + 1];
+
+// Следующий необработанный тик колеса
+static uint32_t wheel_time = 0;
+
+// Колесо, пул таймеров и программирование устройства событий
+SPINLOCK_DEFINE(timer_lock, "timer");
+
+static void timer_program_next(void);
+static void timer_reprogram(void);
+static bool timer_wheel_next(uint32_t* when);
+
+/**
+ * Инициализация пула таймеров и колеса
+ */
+static void timer_wheel_init(void) {
+    for (int i = 0; i <= TIMER_EXPIRED_SLOT; i++) {
+        timer_wheel[i] = TIMER_NONE;
+    }
+    
+    // Все таймеры в списке свободных
+    for (int i = 0; i < TIMER_MAX_TIMERS; i++) {
+        timer_pool[i].state = TIMER_STATE_FREE;
+        timer_pool[i].generation = 1;
+        timer_pool[i].next = (i + 1 < TIMER_MAX_TIMERS) ? i + 1 : TIMER_NONE;
+    }
+    timer_free_head = 0;
+    wheel_time = timer_ticks + 1;
+}
+
+/**
+ * Постановка таймера в слот колеса по времени срабатывания
+ * Уровень выбирается по расстоянию до срабатывания: чем дальше,
+ * тем грубее слот. Когда младший уровень проходит полный круг,
+ * таймеры из слота старшего уровня перераспределяются вниз.
+ * @param index Индекс таймера в пуле
+ */
+static void timer_wheel_add(int16_t index) {
+    timer_entry_t* t = &timer_pool[index];
+    uint32_t expires = t->expires;
+    uint32_t delta = expires - wheel_time;
+    int level = 0;
+    
+    if ((int32_t)delta < 0) {
+        // Уже просрочен - в ближайший обрабатываемый слот
+        expires = wheel_time;
+    } else {
+        if (delta > TIMER_WHEEL_MAX_DELTA) {
+            expires = wheel_time + TIMER_WHEEL_MAX_DELTA;
+            delta = TIMER_WHEEL_MAX_DELTA;
+        }
+        
+        while (level < TIMER_WHEEL_LEVELS - 1 &&
+               delta >= (1u << (TIMER_WHEEL_BITS * (level + 1)))) {
+            level++;
+        }
+    }
+    
+    uint32_t slot = level * TIMER_WHEEL_SLOTS +
+                    ((expires >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+    
+    // Вставка в начало списка слота
+    t->slot = slot;
+    t->prev = TIMER_NONE;
+    t->next = timer_wheel[slot];
+    if (t->next != TIMER_NONE) {
+        timer_pool[t->next].prev = index;
+    }
+    timer_wheel[slot] = index;
+    t->state = TIMER_STATE_PENDING;
+}
+
+/**
+ * Удаление таймера из слота колеса за O(1)
+ * @param index Индекс таймера в пуле
+ */
+static void timer_wheel_remove(int16_t index) {
+    timer_entry_t* t = &timer_pool[index];
+    
+    if (t->prev != TIMER_NONE) {
+        timer_pool[t->prev].next = t->next;
+    } else {
+        timer_wheel[t->slot] = t->next;
+    }
+    if (t->next != TIMER_NONE) {
+        timer_pool[t->next].prev = t->prev;
+    }
+}
+
+/**
+ * Освобождение таймера (старые дескрипторы становятся недействительными)
+ * @param index Индекс таймера в пуле
+ */
+static void timer_free(int16_t index) {
+    timer_entry_t* t = &timer_pool[index];
+    
+    t->state = TIMER_STATE_FREE;
+    t->generation = (t->generation + 1) & 0xFFFFFF;
+    if (t->generation == 0) t->generation = 1;
+    t->next = timer_free_head;
+    timer_free_head = index;
+}
+
+/**
+ * Поиск таймера по дескриптору
+ * @param handle Дескриптор
+ * @return Индекс в пуле или TIMER_NONE, если дескриптор устарел
+ */
+static int16_t timer_lookup(timer_handle_t handle) {
+    uint32_t index = (handle & 0xFF) - 1;
+    uint32_t generation = handle >> 8;
+    
+    if (handle == TIMER_INVALID_HANDLE || index >= TIMER_MAX_TIMERS) return TIMER_NONE;
+    
+    timer_entry_t* t = &timer_pool[index];
+    if (t->state == TIMER_STATE_FREE || t->generation != generation) {
+        return TIMER_NONE;
+    }
+    
+    return (int16_t)index;
+}
+
+/**
+ * Перераспределение слота старшего уровня на младшие уровни
+ * @param level Уровень колеса (1..TIMER_WHEEL_LEVELS-1)
+ * @return Индекс обработанного слота (0 - нужно каскадировать дальше)
+ */
+static uint32_t timer_wheel_cascade(int level) {
+    uint32_t index = (wheel_time >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    uint32_t slot = level * TIMER_WHEEL_SLOTS + index;
+    
+    int16_t cur = timer_wheel[slot];
+    timer_wheel[slot] = TIMER_NONE;
+    
+    while (cur != TIMER_NONE) {
+        int16_t next = timer_pool[cur].next;
+        timer_wheel_add(cur);
+        cur = next;
+    }
+    
+    return index;
+}
+
+/**
+ * Ближайший тик, на котором колесу есть что делать
+ * Для младшего уровня это срок первого непустого слота, для старших -
+ * момент спуска первого непустого слота (раньше него их таймеры
+ * сработать не могут).
+ * @param when Тик (абсолютный)
+ * @return false, если взведенных таймеров нет
+ */
+static bool timer_wheel_next(uint32_t* when) {
+    bool found = false;
+    uint32_t best = 0;
+    
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint32_t shift = TIMER_WHEEL_BITS * level;
+        uint32_t base = wheel_time >> shift;
+        
+        // Текущий слот старшего уровня уже спущен, если мы не на его границе
+        uint32_t first = (level > 0 && (wheel_time & ((1u << shift) - 1)) != 0) ? 1 : 0;
+        
+        for (uint32_t i = first; i < first + TIMER_WHEEL_SLOTS; i++) {
+            uint32_t slot = level * TIMER_WHEEL_SLOTS + ((base + i) & (TIMER_WHEEL_SLOTS - 1));
+            if (timer_wheel[slot] != TIMER_NONE) {
+                uint32_t t = (base + i) << shift;
+                if (!found || (int32_t)(t - best) < 0) {
+                    best = t;
+                    found = true;
+                }
+                break;
+            }
+        }
+    }
+    
+    *when = best;
+    return found;
+}
+
+/**
+ * Округление срока срабатывания в пределах допуска
+ * Срок сдвигается вперед не более чем на 1/TIMER_SLACK_DIV задержки так,
+ * чтобы обнулилось как можно больше младших битов. Близкие по сроку
+ * таймеры попадают на один тик и обслуживаются одним прерыванием.
+ * @param expires Точный срок
+ * @param delay Задержка, от которой считается допуск
+ * @return Округленный срок
+ */
+static uint32_t timer_apply_slack(uint32_t expires, uint32_t delay) {
+    uint32_t slack = delay / TIMER_SLACK_DIV;
+    if (slack == 0) return expires;
+    
+    uint32_t limit = expires + slack;
+    uint32_t bit = 31 - __builtin_clz(expires ^ limit);
+    
+    return limit & ~((1u << bit) - 1);
+}
+
+/**
+ * Обработка прошедших тиков колеса
+ * Вызывается из softirq при разрешенных прерываниях: структуры колеса
+ * меняются под запретом прерываний, обратные вызовы выполняются без него.
+ */
+static void timer_wheel_run(void) {
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    
+    // После долгого простоя пропускаем пустые тики целиком
+    if (timer_ticks - wheel_time > TIMER_WHEEL_SLOTS) {
+        uint32_t next;
+        if (!timer_wheel_next(&next) || (int32_t)(next - timer_ticks) > 0) {
+            wheel_time = timer_ticks + 1;
+            spin_unlock_irqrestore(&timer_lock, flags);
+            return;
+        }
+        if ((int32_t)(next - wheel_time) > 0) {
+            wheel_time = next;
+        }
+    }
+    
+    while ((int32_t)(timer_ticks - wheel_time) >= 0) {
+        uint32_t index = wheel_time & (TIMER_WHEEL_SLOTS - 1);
+        
+        // Младший уровень прошел полный круг - спускаем таймеры сверху
+        if (index == 0) {
+            for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                if (timer_wheel_cascade(level) != 0) break;
+            }
+        }
+        
+        // Переносим весь слот в список сработавших: обратные вызовы могут
+        // взводить новые таймеры в этот же слот, а отменять - таймеры из списка
+        int16_t cur = timer_wheel[index];
+        timer_wheel[index] = TIMER_NONE;
+        timer_wheel[TIMER_EXPIRED_SLOT] = cur;
+        for (int16_t i = cur; i != TIMER_NONE; i = timer_pool[i].next) {
+            timer_pool[i].slot = TIMER_EXPIRED_SLOT;
+        }
+        wheel_time++;
+        
+        while ((cur = timer_wheel[TIMER_EXPIRED_SLOT]) != TIMER_NONE) {
+            timer_entry_t* t = &timer_pool[cur];
+            uint32_t generation = t->generation;
+            timer_func_t func = t->func;
+            void* data = t->data;
+            
+            timer_wheel_remove(cur);
+            t->state = TIMER_STATE_RUNNING;
+            
+            spin_unlock_irqrestore(&timer_lock, flags);
+            func(data);
+            flags = spin_lock_irqsave(&timer_lock);
+            
+            // Обратный вызов мог отменить свой таймер
+            if (t->state == TIMER_STATE_RUNNING && t->generation == generation) {
+                if (t->period != 0) {
+                    t->expires += t->period;
+                    timer_wheel_add(cur);
+                } else {
+                    timer_free(cur);
+                }
+            }
+        }
+    }
+    
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+/**
+ * Взведение нового таймера
+ * @param func Функция обратного вызова
+ * @param data Данные для функции
+ * @param delay_ticks Тиков до первого срабатывания
+ * @param period_ticks Период (0 - однократный)
+ * @return Дескриптор или TIMER_INVALID_HANDLE, если пул исчерпан
+ */
+static timer_handle_t timer_arm(timer_func_t func, void* data,
+                                uint32_t delay_ticks, uint32_t period_ticks) {
+    if (func == NULL) return TIMER_INVALID_HANDLE;
+    
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    
+    int16_t index = timer_free_head;
+    if (index == TIMER_NONE) {
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return TIMER_INVALID_HANDLE;
+    }
+    timer_free_head = timer_pool[index].next;
+    
+    timer_entry_t* t = &timer_pool[index];
+    t->func = func;
+    t->data = data;
+    t->period = period_ticks;
+    if (delay_ticks == 0) delay_ticks = 1;
+    t->expires = timer_apply_slack(timer_ticks + delay_ticks, delay_ticks);
+    timer_wheel_add(index);
+    
+    // Новый таймер может оказаться раньше запрограммированного события
+    timer_reprogram();
+    
+    timer_handle_t handle = (t->generation << 8) | (uint32_t)(index + 1);
+    
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return handle;
+}
+
+/**
+ * Время в наносекундах по шкале тиков таймера
+ * При работе от PIT разрешение - один тик.
+ */
+static uint64_t timer_now_ns(void) {
+    if (clockevent == NULL) {
+        return (uint64_t)timer_ticks * TIMER_NS_PER_TICK;
+    }
+    
+    return clock_ns() - timer_base_ns;
+}
+
+/**
+ * Обновление счетчика тиков по часам (однократный режим)
+ */
+static void timer_update_ticks(void) {
+    if (clockevent == NULL) return;
+    
+    // Счетчик могут обновлять несколько процессоров: он только растет
+    uint32_t ticks = (uint32_t)(timer_now_ns() / TIMER_NS_PER_TICK);
+    uint32_t old = timer_ticks;
+    while ((int32_t)(ticks - old) > 0) {
+        if (__atomic_compare_exchange_n(&timer_ticks, &old, ticks, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            timer_seconds = ticks / TIMER_FREQUENCY;
+            break;
+        }
+    }
+}
 
-static timer_callback_t* callback_list = NULL;
+/**
+ * Программирование следующего прерывания устройства событий
+ * Срок - ближайший таймер колеса, срок timer_sleep или, если система
+ * не простаивает, начало следующего тика.
+ */
+static void timer_program_next(void) {
+    if (clockevent == NULL) return;
+    
+    timer_update_ticks();
+    
+    uint64_t now = timer_now_ns();
+    uint64_t tick_start = (uint64_t)timer_ticks * TIMER_NS_PER_TICK;
+    uint64_t next = (uint64_t)-1;
+    uint32_t when;
+    
+    if (timer_wheel_next(&when)) {
+        int32_t ahead = (int32_t)(when - timer_ticks);
+        next = ahead > 0 ? tick_start + (uint64_t)ahead * TIMER_NS_PER_TICK : now;
+    }
+    
+    // Пока система занята, тик идет как обычно
+    if (!timer_idle_state && tick_start + TIMER_NS_PER_TICK < next) {
+        next = tick_start + TIMER_NS_PER_TICK;
+    }
+    
+    if (sleep_deadline_ns != 0 && sleep_deadline_ns < next) {
+        next = sleep_deadline_ns;
+    }
+    
+    // Округляем вверх, чтобы не проснуться раньше срока
+    uint64_t delta = next > now ? (next - now + NSEC_PER_USEC - 1) / NSEC_PER_USEC : 0;
+    if (delta < clockevent->min_delta_us) delta = clockevent->min_delta_us;
+    if (delta > clockevent->max_delta_us) delta = clockevent->max_delta_us;
+    
+    clockevent->set_next_event((uint32_t)delta);
+}
+
+/**
+ * Пересчет ближайшего события после изменения колеса (под timer_lock)
+ * Устройство событий - LAPIC загрузочного процессора, поэтому AP
+ * поручает перепрограммирование BSP, если тот простаивает; занятый
+ * BSP и так обработает колесо на следующем тике.
+ */
+static void timer_reprogram(void) {
+    if (cpu_current() == SMP_BSP) {
+        timer_program_next();
+    } else if (timer_idle_state) {
+        softirq_raise(SOFTIRQ_TIMER);
+    }
+}
+
+/**
+ * Перевод миллисекунд в тики таймера
+ */
+static uint32_t timer_ms_to_ticks(uint32_t ms) {
+    return (ms * TIMER_FREQUENCY) / 1000;
+}
 
 /**
  * Обработчик прерывания таймера (IRQ0)
@@ -49,24 +507,144 @@ void timer_handler(struct registers* regs) {
         timer_seconds++;
     }
     
-    // Обрабатываем зарегистрированные обратные вызовы
-    timer_callback_t* cb = callback_list;
-    while (cb != NULL) {
-        if (timer_ticks >= cb->next_tick) {
-            // Вызываем функцию обратного вызова
-            cb->func(cb->data);
-            // Планируем следующий вызов
-            cb->next_tick = timer_ticks + cb->interval_ticks;
-        }
-        cb = cb->next;
+    // Сработавшие таймеры обработаем после выхода из прерывания
+    softirq_raise(SOFTIRQ_TIMER);
+}
+
+/**
+ * Обработчик прерывания устройства событий (однократный режим)
+ * Следующее событие программирует softirq после обработки таймеров.
+ */
+void timer_event_handler(void) {
+    timer_event_count++;
+    
+    softirq_raise(SOFTIRQ_TIMER);
+}
+
+/**
+ * Отложенная обработка таймеров (SOFTIRQ_TIMER)
+ */
+static void timer_softirq(void) {
+    timer_update_ticks();
+    timer_wheel_run();
+    
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    timer_program_next();
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
+/**
+ * Ожидание по каналу 2 PIT без прерываний (для калибровки)
+ * @param us Длительность в микросекундах (не более 50000)
+ */
+void timer_pit_wait_us(uint32_t us) {
+    uint32_t count = (uint32_t)(((uint64_t)PIT_BASE_FREQUENCY * us) / 1000000);
+    if (count > 0xFFFF) count = 0xFFFF;
+    
+    // Затвор канала 2 открыт, динамик отключен
+    outb(PIT_GATE_PORT, (inb(PIT_GATE_PORT) & ~0x02) | 0x01);
+    
+    // Канал 2, младший и старший байты, режим 0 (прерывание по счету)
+    outb(PIT_CMD_PORT, 0xB0);
+    outb(PIT_CH2_PORT, count & 0xFF);
+    outb(PIT_CH2_PORT, (count >> 8) & 0xFF);
+    
+    // Выход канала 2 (бит 5) поднимается по окончании счета
+    while (!(inb(PIT_GATE_PORT) & 0x20)) {
+        cpu_relax();
     }
 }
 
+/**
+ * Количество прерываний таймера в однократном режиме
+ */
+uint32_t timer_get_event_count(void) {
+    return timer_event_count;
+}
+
+/**
+ * Регистрация устройства событий
+ * Устройство с более высоким рейтингом заменяет текущее; первое
+ * зарегистрированное устройство останавливает периодический PIT.
+ * @param dev Устройство
+ * @return true, если устройство стало активным
+ */
+bool timer_register_clockevent(const clockevent_t* dev) {
+    if (dev == NULL || dev->set_next_event == NULL) return false;
+    
+    // Время между событиями отсчитывается по часам высокого разрешения
+    if (!clock_is_highres()) return false;
+    
+    if (clockevent != NULL && clockevent->rating >= dev->rating) return false;
+    
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    
+    if (clockevent != NULL) {
+        if (clockevent->shutdown != NULL) clockevent->shutdown();
+    } else {
+        // Останавливаем периодический тик PIT: режим 0 без записи
+        // счетчика не выдает прерываний
+        outb(PIT_CMD_PORT, 0x30);
+        irq_unregister_handler(0);
+        
+        // Отсчет по часам продолжается с текущего тика
+        timer_base_ns = clock_ns() - (uint64_t)timer_ticks * TIMER_NS_PER_TICK;
+    }
+    
+    clockevent = dev;
+    timer_program_next();
+    
+    spin_unlock_irqrestore(&timer_lock, flags);
+    
+    #ifdef DEBUG
+    terminal_printf("Timer: clockevent %s, tickless idle\n", dev->name);
+    #endif
+    
+    return true;
+}
+
+/**
+ * Имя активного устройства событий
+ */
+const char* timer_get_clockevent_name(void) {
+    return clockevent != NULL ? clockevent->name : "pit";
+}
+
+/**
+ * Простой до следующего прерывания
+ * В однократном режиме на время простоя тик отключается и
+ * прерывание программируется на ближайший таймер.
+ */
+void timer_idle(void) {
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
+    
+    timer_idle_state = true;
+    timer_program_next();
+    spin_unlock(&timer_lock);
+    
+    // sti откладывает прерывания на одну инструкцию: пробуждение не потеряется.
+    // Если есть отложенная работа, не засыпаем
+    if (!softirq_pending()) {
+        asm volatile("sti; hlt; cli" : : : "memory");
+    }
+    
+    spin_lock(&timer_lock);
+    timer_idle_state = false;
+    timer_update_ticks();
+    timer_program_next();
+    
+    spin_unlock_irqrestore(&timer_lock, flags);
+}
+
 /**
  * Инициализация таймера
  * @param frequency Желаемая частота таймера в Гц (по умолчанию 1000)
  */
 void timer_init(uint32_t frequency) {
+    // Готовим колесо таймеров до первого прерывания
+    timer_wheel_init();
+    softirq_open(SOFTIRQ_TIMER, timer_softirq);
+    
     // Регистрируем обработчик прерывания таймера
     irq_register_handler(0, timer_handler);
     
@@ -78,7 +656,7 @@ void timer_init(uint32_t frequency) {
     outb(PIT_CMD_PORT, 0x36);
     
     // Устанавливаем делитель частоты (младший и старший байты)
-    uint16_t divider = (uint16_t)(1193180 / frequency);
+    uint16_t divider = (uint16_t)(PIT_BASE_FREQUENCY / frequency);
     outb(PIT_CH0_PORT, divider & 0xFF);        // Младший байт
     outb(PIT_CH0_PORT, (divider >> 8) & 0xFF); // Старший байт
     
@@ -95,6 +673,7 @@ void timer_init(uint32_t frequency) {
  * @return Количество тиков с момента инициализации
  */
 uint32_t timer_get_ticks(void) {
+    timer_update_ticks();
     return timer_ticks;
 }
 
@@ -103,9 +682,39 @@ uint32_t timer_get_ticks(void) {
  * @return Количество секунд с момента инициализации
  */
 uint32_t timer_get_seconds(void) {
+    timer_update_ticks();
     return timer_seconds;
 }
 
+/**
+ * Ожидание до момента времени с пробуждением точно к сроку
+ * @param deadline_ns Срок (timer_now_ns)
+ */
+static void timer_wait_until(uint64_t deadline_ns) {
+    // Устройство событий есть только у BSP; AP ждет циклом
+    if (cpu_current() != SMP_BSP) {
+        while (timer_now_ns() < deadline_ns) {
+            cpu_relax();
+        }
+        return;
+    }
+    
+    while (timer_now_ns() < deadline_ns) {
+        uint32_t flags = cpu_irq_save();
+        
+        if (sleep_deadline_ns == 0 || deadline_ns < sleep_deadline_ns) {
+            sleep_deadline_ns = deadline_ns;
+        }
+        
+        cpu_irq_restore(flags);
+        
+        // Прерывание устройства событий придет к сроку
+        timer_idle();
+    }
+    
+    sleep_deadline_ns = 0;
+}
+
 /**
  * Задержка на указанное количество миллисекунд
  * @param ms Количество миллисекунд для задержки
@@ -113,27 +722,52 @@ uint32_t timer_get_seconds(void) {
 void timer_sleep(uint32_t ms) {
     if (!timer_initialized) return;
     
-    uint32_t start_ticks = timer_ticks;
-    uint32_t ticks_to_wait = (ms * TIMER_FREQUENCY) / 1000;
+    // Поток засыпает, процессор получают другие потоки
+    if (sched_can_block()) {
+        sched_sleep_ms(ms);
+        return;
+    }
     
-    // Ждем, пока не пройдет нужное количество тиков
-    while (timer_ticks - start_ticks < ticks_to_wait) {
-        // Отдаем управление (в будущем здесь будет переключение задач)
-        asm volatile("hlt");
+    if (clockevent != NULL) {
+        timer_wait_until(timer_now_ns() + ms * NSEC_PER_MSEC);
+        return;
+    }
+    
+    // Периодический тик: таймер колеса выводит процессор из простоя к сроку
+    uint64_t deadline = wait_deadline(ms);
+    uint32_t flags = cpu_irq_save();
+    
+    while (wait_sleep_until(deadline)) {
     }
+    
+    cpu_irq_restore(flags);
 }
 
 /**
  * Задержка на указанное количество микросекунд (более точная)
+ * Короткие задержки выдерживаются циклом по clock_cycles(), длинные -
+ * в простое до однократного прерывания.
  * @param us Количество микросекунд для задержки
  */
 void timer_sleep_us(uint32_t us) {
-    // Используем инструкцию CPU для коротких задержек
-    // Примерно 1-2 микросекунды на итерацию (зависит от CPU)
-    uint32_t loops = us / 2;
+    if (!clock_is_highres()) {
+        // Без точных часов отмеряем задержку каналом 2 PIT (работает и при cli)
+        while (us > 0) {
+            uint32_t chunk = us > TIMER_PIT_WAIT_MAX_US ? TIMER_PIT_WAIT_MAX_US : us;
+            timer_pit_wait_us(chunk);
+            us -= chunk;
+        }
+        return;
+    }
+    
+    if (clockevent != NULL && us >= TIMER_SPIN_LIMIT_US) {
+        timer_wait_until(timer_now_ns() + us * NSEC_PER_USEC);
+        return;
+    }
     
-    for (uint32_t i = 0; i < loops; i++) {
-        asm volatile("pause");
+    uint64_t end = clock_cycles() + clock_ns_to_cycles(us * NSEC_PER_USEC);
+    while (clock_cycles() < end) {
+        cpu_relax();
     }
 }
 
@@ -142,57 +776,58 @@ void timer_sleep_us(uint32_t us) {
  * @param func Функция обратного вызова
  * @param data Данные для передачи в функцию
  * @param interval_ms Интервал в миллисекундах
- * @return Указатель на структуру обратного вызова или NULL при ошибке
+ * @return Дескриптор таймера или TIMER_INVALID_HANDLE при ошибке
  */
-timer_callback_t* timer_register_callback(void (*func)(void*), void* data, uint32_t interval_ms) {
-    if (func == NULL) return NULL;
-    
-    // Создаем новую структуру обратного вызова
-    timer_callback_t* new_cb = (timer_callback_t*)malloc(sizeof(timer_callback_t));
-    if (new_cb == NULL) return NULL;
-    
-    new_cb->func = func;
-    new_cb->data = data;
-    new_cb->interval_ticks = (interval_ms * TIMER_FREQUENCY) / 1000;
-    new_cb->next_tick = timer_ticks + new_cb->interval_ticks;
-    new_cb->next = NULL;
-    
-    // Добавляем в начало списка
-    if (callback_list == NULL) {
-        callback_list = new_cb;
-    } else {
-        new_cb->next = callback_list;
-        callback_list = new_cb;
-    }
+timer_handle_t timer_register_callback(timer_func_t func, void* data, uint32_t interval_ms) {
+    uint32_t interval = timer_ms_to_ticks(interval_ms);
+    if (interval == 0) interval = 1;
     
-    return new_cb;
+    return timer_arm(func, data, interval, interval);
+}
+
+/**
+ * Регистрация однократного обратного вызова
+ * @param func Функция обратного вызова
+ * @param data Данные для передачи в функцию
+ * @param delay_ms Задержка в миллисекундах
+ * @return Дескриптор таймера или TIMER_INVALID_HANDLE при ошибке
+ */
+timer_handle_t timer_register_oneshot(timer_func_t func, void* data, uint32_t delay_ms) {
+    return timer_arm(func, data, timer_ms_to_ticks(delay_ms), 0);
 }
 
 /**
- * Удаление зарегистрированного обратного вызова
- * @param cb Указатель на структуру обратного вызова
+ * Отмена таймера
+ * Безопасна для устаревших дескрипторов и из собственного обратного вызова.
+ * @param handle Дескриптор таймера
+ * @return true, если таймер был отменен
  */
-void timer_unregister_callback(timer_callback_t* cb) {
-    if (cb == NULL || callback_list == NULL) return;
+bool timer_unregister_callback(timer_handle_t handle) {
+    uint32_t flags = spin_lock_irqsave(&timer_lock);
     
-    // Если это первый элемент в списке
-    if (callback_list == cb) {
-        callback_list = cb->next;
-        free(cb);
-        return;
+    int16_t index = timer_lookup(handle);
+    if (index == TIMER_NONE) {
+        spin_unlock_irqrestore(&timer_lock, flags);
+        return false;
     }
     
-    // Ищем элемент в списке
-    timer_callback_t* current = callback_list;
-    while (current->next != NULL && current->next != cb) {
-        current = current->next;
+    // Выполняющийся таймер уже вынут из колеса
+    if (timer_pool[index].state == TIMER_STATE_PENDING) {
+        timer_wheel_remove(index);
     }
+    timer_free(index);
     
-    // Если нашли, удаляем
-    if (current->next == cb) {
-        current->next = cb->next;
-        free(cb);
-    }
+    spin_unlock_irqrestore(&timer_lock, flags);
+    return true;
+}
+
+/**
+ * Проверка, взведен ли таймер
+ * @param handle Дескриптор таймера
+ * @return true, если таймер еще не сработал (или периодический)
+ */
+bool timer_is_pending(timer_handle_t handle) {
+    return timer_lookup(handle) != TIMER_NONE;
 }
 
 /**
@@ -228,10 +863,12 @@ void timer_test(void) {
     terminal_printf("Sleeping for 1 second...\n");
     
     uint32_t start_ticks = timer_get_ticks();
+    uint64_t start_ns = clock_ns();
     timer_sleep(1000); // 1 секунда
+    uint64_t elapsed_us = (clock_ns() - start_ns) / NSEC_PER_USEC;
     uint32_t end_ticks = timer_get_ticks();
     
-    terminal_printf("Slept for %d ticks\n", end_ticks - start_ticks);
+    terminal_printf("Slept for %d ticks (%d us)\n", end_ticks - start_ticks, (uint32_t)elapsed_us);
     terminal_printf("Timer test completed.\n");
     #endif
 }
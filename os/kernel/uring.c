@@ -0,0 +1,524 @@
+/**
+ * kernel/uring.c - Кольца отправки и завершения системных вызовов
+ *
+ * Операции из SQ выполняются по одной в порядке отправки, каждая
+ * сразу дает элемент CQ. Ядро не доверяет индексам в общей странице:
+ * свои sq_head и cq_tail оно хранит у себя, а в страницу только
+ * публикует. Элемент SQ копируется перед выполнением, чтобы процесс
+ * не мог подменить аргументы после проверки. Если CQ заполнена,
+ * операции остаются в SQ до следующего входа.
+ *
+ * Поток опроса (URING_SETUP_SQPOLL) выполняется на том же процессоре,
+ * что и процесс, в его адресном пространстве и от его имени
+ * (proc->poller): vmm_unmap сбрасывает TLB только на своем процессоре.
+ */
+
+#include "uring.h"
+#include "surface.h"
+#include "framebuffer.h"
+#include "syscall.h"
+#include "proc.h"
+#include "vmm.h"
+#include "pmm.h"
+#include "sched.h"
+#include "timer.h"
+#include "spinlock.h"
+#include "wait.h"
+#include "cpu.h"
+#include "cmdreg.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+typedef struct {
+    bool used;
+    proc_t* owner;                  // NULL - поток ядра
+    uring_shared_t* shared;         // Физический адрес = адрес ядра
+    uint32_t setup_flags;
+    
+    // Собственные копии индексов ядра
+    uint32_t sq_head;
+    uint32_t cq_tail;
+    
+    // Поток опроса
+    thread_t* poller;
+    volatile bool stopping;
+    volatile bool kicked;           // URING_ENTER_WAKEUP
+    volatile bool poller_done;
+    wait_queue_t poll_wait;         // Здесь спит поток опроса
+    wait_queue_t exit_wait;         // Здесь uring_release ждет его выхода
+    
+    // Здесь SYS_URING_ENTER ждет min_complete результатов
+    wait_queue_t cq_wait;
+    
+    uint32_t enters;                // Входов SYS_URING_ENTER
+    uint32_t completed;             // Выполненных операций
+} uring_t;
+
+static uring_t urings[URING_MAX];
+
+SPINLOCK_DEFINE(uring_lock, "uring");
+
+/**
+ * Запрет компилятору переносить обращения к общей странице
+ * (x86 не меняет порядок записей между собой и чтений между собой)
+ */
+static inline void uring_barrier(void) {
+    asm volatile("" : : : "memory");
+}
+
+/**
+ * Кольцо процесса (или потока ядра)
+ */
+static uring_t* uring_find(proc_t* owner) {
+    uring_t* r = NULL;
+    
+    uint32_t flags = spin_lock_irqsave(&uring_lock);
+    for (int i = 0; i < URING_MAX; i++) {
+        if (urings[i].used && urings[i].owner == owner) {
+            r = &urings[i];
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&uring_lock, flags);
+    
+    return r;
+}
+
+/**
+ * URING_OP_WRITE - вывод в терминал
+ */
+static int32_t uring_op_write(uint32_t buf, uint32_t length) {
+    if (buf == 0 || !proc_check_user(buf, length, false)) return -1;
+    
+    const char* s = (const char*)buf;
+    for (uint32_t i = 0; i < length; i++) {
+        terminal_putchar(s[i]);
+    }
+    return (int32_t)length;
+}
+
+/**
+ * Выполнение одной операции (от имени владельца кольца)
+ * @param sqe Копия элемента SQ
+ * @return Результат для CQ
+ */
+static int32_t uring_execute(const uring_sqe_t* sqe) {
+    const uint32_t* a = sqe->args;
+    
+    switch (sqe->opcode) {
+        case URING_OP_NOP:
+            return 0;
+        
+        case URING_OP_WRITE:
+            return uring_op_write(a[0], a[1]);
+        
+        case URING_OP_FILL:
+            return surface_fill((int32_t)a[0], URING_LOW(a[1]), URING_HIGH(a[1]),
+                                URING_LOW(a[2]), URING_HIGH(a[2]), a[3]) ? 0 : -1;
+        
+        case URING_OP_COPY:
+            return surface_copy((int32_t)a[0], URING_LOW(a[1]), URING_HIGH(a[1]),
+                                URING_LOW(a[2]), URING_HIGH(a[2]),
+                                URING_LOW(a[3]), URING_HIGH(a[3])) ? 0 : -1;
+        
+        case URING_OP_DAMAGE:
+            return surface_damage((int32_t)a[0], URING_LOW(a[1]), URING_HIGH(a[1]),
+                                  URING_LOW(a[2]), URING_HIGH(a[2])) ? 0 : -1;
+        
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Выполнение операций из SQ
+ * Вызывает только один поток кольца: процесс (SYS_URING_ENTER) или,
+ * при URING_SETUP_SQPOLL, поток опроса.
+ * @param limit Наибольшее число операций
+ * @return Сколько операций выполнено
+ */
+static uint32_t uring_submit(uring_t* r, uint32_t limit) {
+    uring_shared_t* sh = r->shared;
+    uint32_t tail = sh->sq_tail;
+    uring_barrier();
+    
+    // Больше URING_ENTRIES элементов процесс выложить не мог
+    if (tail - r->sq_head > URING_ENTRIES) tail = r->sq_head + URING_ENTRIES;
+    
+    uint32_t done = 0;
+    while (r->sq_head != tail && done < limit) {
+        // CQ заполнена: остальное - при следующем входе
+        if (r->cq_tail - sh->cq_head >= URING_ENTRIES) break;
+        
+        uring_sqe_t sqe = sh->sq[r->sq_head & URING_MASK];
+        r->sq_head++;
+        sh->sq_head = r->sq_head;
+        
+        int32_t result = uring_execute(&sqe);
+        
+        uring_cqe_t* cqe = &sh->cq[r->cq_tail & URING_MASK];
+        cqe->user_data = sqe.user_data;
+        cqe->result = result;
+        uring_barrier();
+        sh->cq_tail = ++r->cq_tail;
+        
+        done++;
+    }
+    
+    if (done > 0) {
+        r->completed += done;
+        wake_up_all(&r->cq_wait);
+    }
+    return done;
+}
+
+/**
+ * Поток опроса SQ
+ * Пока операции идут, опрашивает кольцо, уступая процессор; без
+ * операций дольше URING_SQPOLL_IDLE_MS выставляет URING_NEED_WAKEUP
+ * и спит до SYS_URING_ENTER с URING_ENTER_WAKEUP.
+ */
+static void uring_poll_thread(void* arg) {
+    uring_t* r = (uring_t*)arg;
+    thread_t* self = sched_current();
+    uring_shared_t* sh = r->shared;
+    
+    // Адресное пространство и права процесса
+    uint32_t flags = cpu_irq_save();
+    if (r->owner != NULL) {
+        r->owner->poller = self;
+        self->page_directory = r->owner->directory;
+        vmm_switch(r->owner->directory);
+    }
+    cpu_irq_restore(flags);
+    
+    uint32_t idle_since = timer_get_ticks();
+    
+    while (!r->stopping) {
+        if (uring_submit(r, URING_ENTRIES) > 0) {
+            idle_since = timer_get_ticks();
+            continue;
+        }
+        
+        if (timer_get_ticks() - idle_since < URING_SQPOLL_IDLE_MS) {
+            sched_yield();
+            continue;
+        }
+        
+        // Флаг должен стать виден процессу раньше, чем мы в последний
+        // раз посмотрим на sq_tail (запись и чтение - нужен mfence)
+        sh->flags |= URING_NEED_WAKEUP;
+        __sync_synchronize();
+        
+        wait_event(&r->poll_wait, r->stopping || r->kicked || sh->sq_tail != r->sq_head);
+        
+        r->kicked = false;
+        sh->flags &= ~URING_NEED_WAKEUP;
+        idle_since = timer_get_ticks();
+    }
+    
+    flags = cpu_irq_save();
+    if (r->owner != NULL) r->owner->poller = NULL;
+    self->page_directory = 0;
+    vmm_switch(0);
+    cpu_irq_restore(flags);
+    
+    r->poller_done = true;
+    wake_up_all(&r->exit_wait);
+    sched_exit();
+}
+
+/**
+ * Создание кольца для текущего процесса (или потока ядра)
+ * Процесс получает страницу по адресу URING_USER_ADDR, поток ядра -
+ * через uring_shared().
+ * @param flags URING_SETUP_SQPOLL
+ * @return 0 или -1 (кольцо уже есть или нет памяти)
+ */
+int32_t uring_setup(uint32_t flags) {
+    proc_t* owner = proc_current();
+    if (uring_find(owner) != NULL) return -1;
+    
+    uint32_t page = pmm_alloc_zeroed();
+    if (page == 0) return -1;
+    
+    // Страница принадлежит кольцу: vmm_destroy ее не освобождает
+    if (owner != NULL &&
+        !vmm_map(owner->directory, URING_USER_ADDR, page, VMM_WRITABLE | VMM_SHARED)) {
+        pmm_free(page);
+        return -1;
+    }
+    
+    uring_t* r = NULL;
+    
+    uint32_t irq = spin_lock_irqsave(&uring_lock);
+    for (int i = 0; i < URING_MAX; i++) {
+        if (!urings[i].used) {
+            r = &urings[i];
+            memset(r, 0, sizeof(uring_t));
+            r->used = true;
+            r->owner = owner;
+            break;
+        }
+    }
+    spin_unlock_irqrestore(&uring_lock, irq);
+    
+    if (r == NULL) {
+        if (owner != NULL) vmm_unmap(owner->directory, URING_USER_ADDR);
+        pmm_free(page);
+        return -1;
+    }
+    
+    r->shared = (uring_shared_t*)page;
+    r->setup_flags = flags;
+    wait_queue_init(&r->poll_wait);
+    wait_queue_init(&r->exit_wait);
+    wait_queue_init(&r->cq_wait);
+    
+    if (flags & URING_SETUP_SQPOLL) {
+        uint32_t cpu = owner != NULL ? owner->thread->cpu : sched_current()->cpu;
+        r->poller = sched_create_on("uring-poll", uring_poll_thread, r, cpu);
+        if (r->poller == NULL) {
+            r->setup_flags &= ~URING_SETUP_SQPOLL;
+            uring_release(owner);
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * Вход в кольцо
+ * Без потока опроса операции выполняются сразу и min_complete не
+ * нужен: к возврату все их результаты уже в CQ.
+ * @param to_submit Сколько операций выполнить (без потока опроса)
+ * @param min_complete Ждать, пока в CQ не станет столько результатов
+ *                     (с потоком опроса)
+ * @param flags URING_ENTER_WAKEUP
+ * @return Сколько операций выполнено или -1, если кольца нет
+ */
+int32_t uring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    uring_t* r = uring_find(proc_current());
+    if (r == NULL) return -1;
+    
+    r->enters++;
+    
+    if (!(r->setup_flags & URING_SETUP_SQPOLL)) {
+        return (int32_t)uring_submit(r, to_submit);
+    }
+    
+    if (flags & URING_ENTER_WAKEUP) {
+        r->kicked = true;
+        wake_up(&r->poll_wait);
+    }
+    
+    if (min_complete > URING_ENTRIES) min_complete = URING_ENTRIES;
+    if (min_complete > 0) {
+        uring_shared_t* sh = r->shared;
+        wait_event(&r->cq_wait, r->stopping || r->cq_tail - sh->cq_head >= min_complete);
+    }
+    
+    return 0;
+}
+
+/**
+ * Общая страница кольца текущего потока ядра
+ * @return Адрес или NULL
+ */
+uring_shared_t* uring_shared(void) {
+    uring_t* r = uring_find(proc_current());
+    return r != NULL ? r->shared : NULL;
+}
+
+/**
+ * Освобождение кольца (из proc_exit или потоком ядра)
+ * Поток опроса останавливается до возврата, поэтому после вызова
+ * каталог процесса можно освобождать.
+ * @param owner Процесс (NULL - кольцо потока ядра)
+ */
+void uring_release(proc_t* owner) {
+    uring_t* r = uring_find(owner);
+    if (r == NULL) return;
+    
+    if (r->poller != NULL) {
+        r->stopping = true;
+        wake_up(&r->poll_wait);
+        wake_up_all(&r->cq_wait);
+        wait_event(&r->exit_wait, r->poller_done);
+    }
+    
+    // Каталог процесса освобождается целиком, но страница - наша
+    if (owner != NULL && owner->directory != 0) {
+        vmm_unmap(owner->directory, URING_USER_ADDR);
+    }
+    pmm_free((uint32_t)r->shared);
+    
+    uint32_t flags = spin_lock_irqsave(&uring_lock);
+    r->used = false;
+    r->owner = NULL;
+    r->shared = NULL;
+    spin_unlock_irqrestore(&uring_lock, flags);
+}
+
+/**
+ * SYS_URING_SETUP - создание кольца
+ * @param flags URING_SETUP_SQPOLL
+ * @return 0 (страница по адресу URING_USER_ADDR) или -1
+ */
+static int32_t sys_uring_setup(uint32_t flags, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5) {
+    (void)a2; (void)a3; (void)a4; (void)a5;
+    return uring_setup(flags);
+}
+
+/**
+ * SYS_URING_ENTER - выполнение накопленных операций
+ * @param to_submit Сколько операций выполнить
+ * @param min_complete Сколько результатов ждать (с потоком опроса)
+ * @param flags URING_ENTER_WAKEUP
+ * @return Сколько операций выполнено или -1
+ */
+static int32_t sys_uring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags,
+                               uint32_t a4, uint32_t a5) {
+    (void)a4; (void)a5;
+    return uring_enter(to_submit, min_complete, flags);
+}
+
+/**
+ * Помещение операции в SQ (для проверки из потока ядра)
+ */
+static void uring_push(uring_shared_t* sh, uint8_t opcode, uint32_t user_data,
+                       uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+    uring_sqe_t* sqe = &sh->sq[sh->sq_tail & URING_MASK];
+    memset(sqe, 0, sizeof(uring_sqe_t));
+    sqe->opcode = opcode;
+    sqe->user_data = user_data;
+    sqe->args[0] = a0;
+    sqe->args[1] = a1;
+    sqe->args[2] = a2;
+    sqe->args[3] = a3;
+    uring_barrier();
+    sh->sq_tail++;
+}
+
+/**
+ * Подсчет и снятие результатов из CQ
+ * @param failed Сюда прибавляются результаты с ошибкой
+ * @return Сколько результатов снято
+ */
+static uint32_t uring_reap(uring_shared_t* sh, uint32_t* failed) {
+    uint32_t count = 0;
+    
+    while (sh->cq_head != sh->cq_tail) {
+        if (sh->cq[sh->cq_head & URING_MASK].result < 0) (*failed)++;
+        sh->cq_head++;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Проверка: кадр одним входом, стоимость входа, поток опроса
+ */
+static void uring_test(void) {
+    static const char message[] = "uring: frame submitted in one call\n";
+    const uint16_t width = 256;
+    const uint16_t height = 128;
+    
+    int32_t surface = surface_create(framebuffer_get_width() - width - 20, 320, width, height);
+    if (surface < 0 || uring_setup(0) < 0) {
+        if (surface >= 0) surface_destroy(surface);
+        terminal_print_line("Cannot create a surface or a ring");
+        return;
+    }
+    
+    uring_shared_t* sh = uring_shared();
+    uint32_t failed = 0;
+    
+    // Кадр: фон, полосы, копия верхней половины вниз, вывод и сообщение
+    uring_push(sh, URING_OP_FILL, 0, surface, URING_XY(0, 0), URING_XY(width, height), 0x202020);
+    for (uint32_t i = 0; i < 16; i++) {
+        uring_push(sh, URING_OP_FILL, i + 1, surface, URING_XY(i * 16, 0),
+                   URING_XY(12, height / 2), (i * 16) << 16 | (255 - i * 16) << 8 | 0x80);
+    }
+    uring_push(sh, URING_OP_COPY, 17, surface, URING_XY(0, 0), URING_XY(0, height / 2),
+               URING_XY(width, height / 2));
+    uring_push(sh, URING_OP_DAMAGE, 18, surface, URING_XY(0, 0), URING_XY(width, height), 0);
+    uring_push(sh, URING_OP_WRITE, 19, (uint32_t)message, sizeof(message) - 1, 0, 0);
+    
+    int32_t submitted = syscall_int80(SYS_URING_ENTER, URING_ENTRIES, 0, 0);
+    uint32_t reaped = uring_reap(sh, &failed);
+    terminal_printf("Frame: %d ops in one enter, %d completions, %d failed\n",
+                    submitted, reaped, failed);
+    
+    // Стоимость: URING_ENTRIES пустых вызовов по одному и одним входом
+    uint64_t start = cpu_rdtsc();
+    for (uint32_t i = 0; i < URING_ENTRIES; i++) {
+        syscall_int80(SYS_NULL, 0, 0, 0);
+    }
+    uint64_t single = cpu_rdtsc() - start;
+    
+    for (uint32_t i = 0; i < URING_ENTRIES; i++) {
+        uring_push(sh, URING_OP_NOP, i, 0, 0, 0, 0);
+    }
+    start = cpu_rdtsc();
+    syscall_int80(SYS_URING_ENTER, URING_ENTRIES, 0, 0);
+    uint64_t batched = cpu_rdtsc() - start;
+    uring_reap(sh, &failed);
+    
+    terminal_printf("Null op: %d cycles per syscall, %d cycles per ring entry\n",
+                    (uint32_t)(single / URING_ENTRIES), (uint32_t)(batched / URING_ENTRIES));
+    
+    // Поток опроса: операции выполняются без единого входа
+    uring_release(NULL);
+    if (uring_setup(URING_SETUP_SQPOLL) == 0) {
+        sh = uring_shared();
+        for (uint32_t i = 0; i < URING_ENTRIES; i++) {
+            uring_push(sh, URING_OP_NOP, i, 0, 0, 0, 0);
+        }
+        
+        uint32_t waited = 0;
+        reaped = 0;
+        while (reaped < URING_ENTRIES && waited < 1000) {
+            reaped += uring_reap(sh, &failed);
+            sched_sleep_ms(1);
+            waited++;
+        }
+        terminal_printf("SQPOLL: %d of %d ops completed without syscalls\n", reaped, URING_ENTRIES);
+        uring_release(NULL);
+    }
+    
+    surface_destroy(surface);
+}
+
+/**
+ * Команда: uring [test] - кольца и проверка
+ */
+static void cmd_uring(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "test") == 0) {
+        uring_test();
+        return;
+    }
+    
+    for (int i = 0; i < URING_MAX; i++) {
+        uring_t* r = &urings[i];
+        if (!r->used) continue;
+        
+        terminal_printf("%d: pid %d%s, %d enters, %d ops\n", i,
+                        r->owner != NULL ? r->owner->pid : 0,
+                        r->poller != NULL ? " sqpoll" : "", r->enters, r->completed);
+    }
+}
+
+/**
+ * Инициализация колец (после syscall_init)
+ */
+void uring_init(void) {
+    memset(urings, 0, sizeof(urings));
+    
+    syscall_register(SYS_URING_SETUP, sys_uring_setup);
+    syscall_register(SYS_URING_ENTER, sys_uring_enter);
+    
+    cmdreg_register("uring", "Batched system call rings (uring [test])", cmd_uring);
+}
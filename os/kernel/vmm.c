@@ -0,0 +1,269 @@
+/**
+ * kernel/vmm.c - Страничная адресация и адресные пространства
+ *
+ * Ядро видит всю память тождественно: каталог ядра отображает
+ * страницами по 4 МБ (PSE) все адреса, кроме области процесса
+ * [VMM_USER_BASE, VMM_USER_END). Каталог процесса копирует эти
+ * элементы, поэтому ядро после смены CR3 видит то же самое, а
+ * область процесса заполняется таблицами по 4 КБ из pmm. Страницы
+ * ядра доступны только из кольца 0.
+ *
+ * Таблицы и страницы процесса лежат ниже PMM_LIMIT, то есть ядро
+ * пишет в них по физическому адресу из любого адресного пространства.
+ */
+
+#include "vmm.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "terminal.h"
+#include <stddef.h>
+#include <string.h>
+
+#define VMM_ENTRIES         1024
+#define VMM_LARGE_SIZE      0x400000
+
+// Индексы элементов каталога, принадлежащих процессу
+#define VMM_USER_FIRST_PDE  (VMM_USER_BASE / VMM_LARGE_SIZE)
+#define VMM_USER_LAST_PDE   (VMM_USER_END / VMM_LARGE_SIZE)
+
+static uint32_t vmm_kernel_directory[VMM_ENTRIES] __attribute__((aligned(PAGE_SIZE)));
+static bool vmm_enabled = false;
+
+// Таблицы создаются при отображении; каталоги разных процессов
+// меняются редко, одной блокировки достаточно
+SPINLOCK_DEFINE(vmm_lock, "vmm");
+
+/**
+ * Проверка, что элемент каталога - часть области процесса
+ */
+static inline bool vmm_is_user_pde(uint32_t index) {
+    return index >= VMM_USER_FIRST_PDE && index < VMM_USER_LAST_PDE;
+}
+
+/**
+ * Включение страничной адресации на текущем процессоре
+ * BSP - из vmm_init(), AP - при запуске.
+ */
+void vmm_init_cpu(void) {
+    if (!vmm_enabled) return;
+    
+    cpu_write_cr4(cpu_read_cr4() | CR4_PSE);
+    cpu_write_cr3((uint32_t)vmm_kernel_directory);
+    cpu_write_cr0(cpu_read_cr0() | CR0_PG | CR0_WP);
+}
+
+/**
+ * Построение каталога ядра и включение страничной адресации
+ * @return false, если процессор не поддерживает страницы по 4 МБ
+ */
+bool vmm_init(void) {
+    uint32_t eax, ebx, ecx, edx;
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_EDX_PSE)) {
+        #ifdef DEBUG
+        terminal_printf("VMM: no PSE, paging disabled\n");
+        #endif
+        return false;
+    }
+    
+    for (uint32_t i = 0; i < VMM_ENTRIES; i++) {
+        if (vmm_is_user_pde(i)) {
+            vmm_kernel_directory[i] = 0;
+        } else {
+            vmm_kernel_directory[i] = (i * VMM_LARGE_SIZE) | VMM_LARGE | VMM_WRITABLE | VMM_PRESENT;
+        }
+    }
+    
+    vmm_enabled = true;
+    vmm_init_cpu();
+    
+    return true;
+}
+
+/**
+ * Включена ли страничная адресация
+ */
+bool vmm_is_enabled(void) {
+    return vmm_enabled;
+}
+
+/**
+ * Создание адресного пространства
+ * @param kernel_user Разрешить кольцу 3 доступ к памяти ядра (для
+ *                    кода ядра, выполняемого в кольце 3, - syscall bench)
+ * @return Физический адрес каталога или 0
+ */
+uint32_t vmm_create(bool kernel_user) {
+    if (!vmm_enabled) return 0;
+    
+    uint32_t directory = pmm_alloc_zeroed();
+    if (directory == 0) return 0;
+    
+    uint32_t* pd = (uint32_t*)directory;
+    for (uint32_t i = 0; i < VMM_ENTRIES; i++) {
+        if (vmm_is_user_pde(i)) continue;
+        
+        pd[i] = vmm_kernel_directory[i];
+        if (kernel_user) pd[i] |= VMM_USER;
+    }
+    
+    return directory;
+}
+
+/**
+ * Освобождение адресного пространства
+ * Освобождаются таблицы и страницы процесса, кроме помеченных
+ * VMM_SHARED. Каталог не должен быть загружен ни на одном процессоре.
+ * @param directory Физический адрес каталога
+ */
+void vmm_destroy(uint32_t directory) {
+    if (directory == 0) return;
+    
+    uint32_t* pd = (uint32_t*)directory;
+    for (uint32_t i = VMM_USER_FIRST_PDE; i < VMM_USER_LAST_PDE; i++) {
+        if (!(pd[i] & VMM_PRESENT)) continue;
+        
+        uint32_t* table = (uint32_t*)(pd[i] & PAGE_MASK);
+        for (uint32_t j = 0; j < VMM_ENTRIES; j++) {
+            if ((table[j] & VMM_PRESENT) && !(table[j] & VMM_SHARED)) {
+                pmm_free(table[j] & PAGE_MASK);
+            }
+        }
+        pmm_free((uint32_t)table);
+    }
+    
+    pmm_free(directory);
+}
+
+/**
+ * Загрузка адресного пространства на текущем процессоре
+ * @param directory Физический адрес каталога (0 - каталог ядра)
+ */
+void vmm_switch(uint32_t directory) {
+    if (!vmm_enabled) return;
+    
+    if (directory == 0) directory = (uint32_t)vmm_kernel_directory;
+    if (cpu_read_cr3() != directory) {
+        cpu_write_cr3(directory);
+    }
+}
+
+/**
+ * Отображение страницы в области процесса
+ * @param directory Каталог
+ * @param virt Виртуальный адрес (выровнен по странице)
+ * @param phys Физический адрес (выровнен по странице)
+ * @param flags VMM_WRITABLE, VMM_SHARED (VMM_PRESENT и VMM_USER ставятся сами)
+ * @return false, если адрес вне области, уже отображен или нет памяти
+ */
+bool vmm_map(uint32_t directory, uint32_t virt, uint32_t phys, uint32_t flags) {
+    if (directory == 0 || virt < VMM_USER_BASE || virt >= VMM_USER_END) return false;
+    
+    uint32_t* pd = (uint32_t*)directory;
+    uint32_t index = virt / VMM_LARGE_SIZE;
+    bool ok = false;
+    
+    uint32_t irq = spin_lock_irqsave(&vmm_lock);
+    
+    if (!(pd[index] & VMM_PRESENT)) {
+        uint32_t table = pmm_alloc_zeroed();
+        if (table != 0) {
+            // Права задает элемент таблицы
+            pd[index] = table | VMM_USER | VMM_WRITABLE | VMM_PRESENT;
+        }
+    }
+    
+    if (pd[index] & VMM_PRESENT) {
+        uint32_t* table = (uint32_t*)(pd[index] & PAGE_MASK);
+        uint32_t* pte = &table[(virt / PAGE_SIZE) % VMM_ENTRIES];
+        
+        if (!(*pte & VMM_PRESENT)) {
+            *pte = (phys & PAGE_MASK) | (flags & (VMM_WRITABLE | VMM_SHARED)) |
+                   VMM_USER | VMM_PRESENT;
+            ok = true;
+        }
+    }
+    
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    return ok;
+}
+
+/**
+ * Удаление отображения страницы процесса
+ * Страница не освобождается: это делает ее владелец. TLB сбрасывается
+ * только на текущем процессоре - поток процесса закреплен за ним.
+ * @param directory Каталог
+ * @param virt Виртуальный адрес (выровнен по странице)
+ * @return Физический адрес страницы или 0, если она не была отображена
+ */
+uint32_t vmm_unmap(uint32_t directory, uint32_t virt) {
+    if (directory == 0 || virt < VMM_USER_BASE || virt >= VMM_USER_END) return 0;
+    
+    uint32_t* pd = (uint32_t*)directory;
+    uint32_t index = virt / VMM_LARGE_SIZE;
+    uint32_t phys = 0;
+    
+    uint32_t irq = spin_lock_irqsave(&vmm_lock);
+    
+    if (pd[index] & VMM_PRESENT) {
+        uint32_t* table = (uint32_t*)(pd[index] & PAGE_MASK);
+        uint32_t* pte = &table[(virt / PAGE_SIZE) % VMM_ENTRIES];
+        
+        if (*pte & VMM_PRESENT) {
+            phys = *pte & PAGE_MASK;
+            *pte = 0;
+        }
+    }
+    
+    spin_unlock_irqrestore(&vmm_lock, irq);
+    
+    if (phys != 0 && cpu_read_cr3() == directory) {
+        cpu_invlpg(virt);
+    }
+    return phys;
+}
+
+/**
+ * Физический адрес страницы процесса
+ * @param directory Каталог
+ * @param virt Виртуальный адрес
+ * @param flags Если не NULL - биты элемента таблицы
+ * @return Физический адрес байта или 0, если страница не отображена
+ */
+uint32_t vmm_translate(uint32_t directory, uint32_t virt, uint32_t* flags) {
+    if (directory == 0 || virt < VMM_USER_BASE || virt >= VMM_USER_END) return 0;
+    
+    const uint32_t* pd = (const uint32_t*)directory;
+    uint32_t pde = pd[virt / VMM_LARGE_SIZE];
+    if (!(pde & VMM_PRESENT)) return 0;
+    
+    const uint32_t* table = (const uint32_t*)(pde & PAGE_MASK);
+    uint32_t pte = table[(virt / PAGE_SIZE) % VMM_ENTRIES];
+    if (!(pte & VMM_PRESENT)) return 0;
+    
+    if (flags != NULL) *flags = pte;
+    return (pte & PAGE_MASK) | (virt & ~PAGE_MASK);
+}
+
+/**
+ * Проверка буфера, переданного процессом в системный вызов
+ * @param directory Каталог процесса
+ * @param addr Начало буфера
+ * @param length Длина
+ * @param write Ядро будет писать в буфер
+ * @return true, если весь буфер отображен в области процесса
+ */
+bool vmm_check_user(uint32_t directory, uint32_t addr, uint32_t length, bool write) {
+    if (addr < VMM_USER_BASE || addr >= VMM_USER_END ||
+        length > VMM_USER_END - addr) {
+        return false;
+    }
+    
+    for (uint32_t page = PAGE_ALIGN_DOWN(addr); page < addr + length; page += PAGE_SIZE) {
+        uint32_t flags;
+        if (vmm_translate(directory, page, &flags) == 0) return false;
+        if (write && !(flags & VMM_WRITABLE)) return false;
+    }
+    
+    return true;
+}
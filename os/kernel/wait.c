@@ -0,0 +1,182 @@
+/**
+ * kernel/wait.c - Очереди ожидания
+ *
+ * Поток, ждущий условия, ставит в очередь запись на своем стеке,
+ * проверяет условие и блокируется. Производитель (прерывание, другой
+ * поток или процессор) меняет данные и вызывает wake_up(): первая
+ * запись снимается с очереди, ее поток просыпается и проверяет условие
+ * снова. Пробуждение между проверкой и блокировкой не теряется:
+ * sched_block() тогда сразу возвращается.
+ *
+ * Срок ожидания отмеряет однократный таймер колеса, который будит поток.
+ */
+
+#include "wait.h"
+#include "timer.h"
+#include "clock.h"
+#include "smp.h"
+#include <stddef.h>
+
+/**
+ * Инициализация очереди
+ */
+void wait_queue_init(wait_queue_t* wq) {
+    spin_init(&wq->lock);
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+/**
+ * Постановка записи в очередь (если ее там нет)
+ * Вызывается перед проверкой условия при запрещенных прерываниях.
+ * @param wq Очередь
+ * @param entry Запись ожидающего
+ */
+void wait_prepare(wait_queue_t* wq, wait_entry_t* entry) {
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    
+    if (!entry->queued) {
+        // Без планировщика будить некого: процессор проснется от прерывания
+        entry->thread = sched_can_block() ? sched_current() : NULL;
+        entry->next = NULL;
+        entry->queued = true;
+        
+        if (wq->tail != NULL) {
+            wq->tail->next = entry;
+        } else {
+            wq->head = entry;
+        }
+        wq->tail = entry;
+    }
+    
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * Снятие записи с очереди после ожидания
+ * @param wq Очередь
+ * @param entry Запись ожидающего
+ */
+void wait_finish(wait_queue_t* wq, wait_entry_t* entry) {
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    
+    if (entry->queued) {
+        wait_entry_t* prev = NULL;
+        for (wait_entry_t* e = wq->head; e != NULL; prev = e, e = e->next) {
+            if (e != entry) continue;
+            
+            if (prev != NULL) {
+                prev->next = e->next;
+            } else {
+                wq->head = e->next;
+            }
+            if (wq->tail == e) wq->tail = prev;
+            break;
+        }
+        entry->queued = false;
+    }
+    
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * Сон до пробуждения
+ * Вызывается при запрещенных прерываниях. Поток блокируется; без
+ * планировщика BSP простаивает до прерывания, AP коротко ждет.
+ */
+void wait_sleep(void) {
+    if (sched_can_block()) {
+        sched_block();
+    } else if (cpu_current() == SMP_BSP) {
+        timer_idle();
+    } else {
+        cpu_irq_enable();
+        cpu_relax();
+        cpu_irq_disable();
+    }
+}
+
+/**
+ * Пробуждение по истечении срока
+ */
+static void wait_timeout_wakeup(void* data) {
+    sched_wake((thread_t*)data);
+}
+
+/**
+ * Сон до пробуждения или до срока
+ * @param deadline_ns Срок (clock_ns)
+ * @return false, если срок истек
+ */
+bool wait_sleep_until(uint64_t deadline_ns) {
+    uint64_t now = clock_ns();
+    if (now >= deadline_ns) return false;
+    
+    // Таймер будит поток или хотя бы выводит процессор из hlt
+    uint32_t left = (uint32_t)((deadline_ns - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC);
+    thread_t* self = sched_can_block() ? sched_current() : NULL;
+    timer_handle_t handle = timer_register_oneshot(wait_timeout_wakeup, self, left);
+    
+    wait_sleep();
+    
+    if (handle != TIMER_INVALID_HANDLE) {
+        timer_unregister_callback(handle);
+    }
+    
+    return clock_ns() < deadline_ns;
+}
+
+/**
+ * Срок ожидания через ms миллисекунд
+ */
+uint64_t wait_deadline(uint32_t ms) {
+    return clock_ns() + (uint64_t)ms * NSEC_PER_MSEC;
+}
+
+/**
+ * Пробуждение первого ожидающего
+ * Можно вызывать из прерываний и с других процессоров.
+ * @param wq Очередь
+ */
+void wake_up(wait_queue_t* wq) {
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    
+    wait_entry_t* entry = wq->head;
+    thread_t* thread = NULL;
+    
+    if (entry != NULL) {
+        wq->head = entry->next;
+        if (wq->head == NULL) wq->tail = NULL;
+        entry->queued = false;
+        thread = entry->thread;
+    }
+    
+    spin_unlock_irqrestore(&wq->lock, flags);
+    
+    sched_wake(thread);
+}
+
+/**
+ * Пробуждение всех ожидающих
+ * @param wq Очередь
+ */
+void wake_up_all(wait_queue_t* wq) {
+    uint32_t flags = spin_lock_irqsave(&wq->lock);
+    
+    while (wq->head != NULL) {
+        wait_entry_t* entry = wq->head;
+        wq->head = entry->next;
+        entry->queued = false;
+        sched_wake(entry->thread);
+    }
+    wq->tail = NULL;
+    
+    spin_unlock_irqrestore(&wq->lock, flags);
+}
+
+/**
+ * Проверка, ждет ли кто-нибудь в очереди
+ */
+bool wait_queue_active(wait_queue_t* wq) {
+    return wq->head != NULL;
+}